@@ -74,6 +74,7 @@ using namespace s3f;
   	
   	// remember alignment, often used to check for cross-timeline connections
 	__timeline = tl;
+	__executed_events = 0;
 
     // initialize the mutex used to serialize access to the individual
     // Entity state (not the static class variables).
@@ -185,6 +186,19 @@ using namespace s3f;
      return alignment()->schedule( alignment()->__this, now()+delay, user_pri(Timeline::default_sched_pri), act);
    }
 
+	/* **********************************************************
+	
+	bool Entity::reschedule(HandleCode h, ltime_t delay)
+	
+    Move a pending waitFor to the current time plus the delay, without
+      a new event: the event is moved in the event list of the Timeline.
+	
+	**************************************************************/ 
+
+   bool Entity::reschedule(HandleCode h, ltime_t delay) {
+      return alignment()->reschedule( h, now()+delay );
+   }
+
 
 /* **********************************************************
 	
@@ -54,6 +54,7 @@ public:
         PUBLIC INTERFACE TO CLASS ENTITY
      bool cancel(HandleCode h)
      todo: Cancel the waitFor that returned h as a handle. Return flags whether it was successful
+     (for now, Handle(h).cancel() does it)
 
 	 *****************************************************************/
 	/** An Entity is constructed always directed to a Timeline it aligns upon
@@ -167,9 +168,28 @@ public:
 	 */
 	HandleCode		waitFor(ltime_t waitinterval, unsigned int);
 
+	/** Move the activation scheduled by waitFor with handle h to waitinterval from now,
+	 *  in place: the handle stays valid and the priority is kept.  Cheaper than
+	 *  cancelling the activation and scheduling it again, e.g. to push back a timer.
+	 *  The handle must still be live and pending: once the activation has been
+	 *  executed or cancelled its event is released, and passing the handle is a
+	 *  use after free.  Returns false, doing nothing, only if the handle is NULL,
+	 *  the new time is in the past, the event is not a timeout of this Entity's
+	 *  Timeline, or it is not in the event list.
+	 *
+	 *  @param h handle returned by waitFor.
+	 *  @param waitinterval new wait interval (from now) that S3F will process the activation.
+	 */
+	bool			reschedule(HandleCode h, ltime_t waitinterval);
+
 	/** Unique identifier for Entity, index 0 to total number of Entities created. */
 	unsigned int 	s3fid()				{ return __s3fid; }
 
+	/** Number of process bodies of this Entity executed by its Timeline so far
+	 *  (timeouts and activations), e.g. to profile the load of the Entity.
+	 */
+	unsigned long	executed_events()	{ return __executed_events; }
+
 	/* ***************************************************************
 			Public Auxiliary Methods
 
@@ -234,6 +254,7 @@ protected:
 	friend class OutChannel;
 	friend class InChannel;
 	friend class Process;
+	friend class ShardGroup;
 
 	/**  The core of the Entity construction is done by BuildEntity.
 	 *   Finish constructing the Entity.
@@ -262,6 +283,7 @@ protected:
 	string __name;	          ///< text name given at initialization
 	Timeline*  __timeline;      ///< pointer to Timeline on which this Entity is aligned
 	unsigned int __s3fid;		  ///< Unique identity for Entity
+	unsigned long __executed_events; ///< number of process bodies executed, counted by the Timeline
 
 	// state related to time unit conversion
 	/** pow[i] = 10^{i-18}. Used in time scale transformation */
@@ -7,34 +7,34 @@
 
 #ifndef SAFE_MSG_PTR
  Event::Event(ltime_t t, int key2, Process* proc, Activation act, Timeline* home_tl, unsigned int evtnum) : 
-	__evtnum(evtnum), __EventType(EVTYPE_TIMEOUT),  __proc(proc), __act(act), __home_tl(home_tl)  
+	__evtnum(evtnum), __heap_pos(-1), __EventType(EVTYPE_TIMEOUT),  __proc(proc), __act(act), __home_tl(home_tl)  
 		{ if(act) act->inc_evts();
 		  __time = t; __key2 = key2;
 		};
  Event::Event(unsigned int etype, ltime_t t, int key2, InChannel* inc, Activation act, Process* proc, Timeline* home_tl, unsigned int evtnum) : 
-	__evtnum(evtnum), __EventType(etype), __proc(proc),
+	__evtnum(evtnum), __heap_pos(-1), __EventType(etype), __proc(proc),
 	__inc(inc), __act(act),  __home_tl(home_tl) 
 		{ if(act) act->inc_evts();
 		  __time = t; __key2 = key2;
 		} ;
 
 #else
- Event::Event() : __EventType(EVTYPE_NULL) {};
+ Event::Event() : __heap_pos(-1), __EventType(EVTYPE_NULL) {};
  Event::Event(ltime_t t, int key2, Process* proc, Activation act, Timeline* home_tl, unsigned int evtnum) : 
-	__evtnum(evtnum), __EventType(EVTYPE_TIMEOUT), __proc(proc), __act(act),  __home_tl(home_tl)  
+	__evtnum(evtnum), __heap_pos(-1), __EventType(EVTYPE_TIMEOUT), __proc(proc), __act(act),  __home_tl(home_tl)  
 		{ __time = t; __key2 = key2; };
 
  Event::Event(unsigned int etype, ltime_t t, int key2, InChannel* inc, Activation act, Process* proc, Timeline* home_tl, unsigned int evtnum) : 
-	__evtnum(evtnum), __EventType(etype), __proc(proc), 
+	__evtnum(evtnum), __heap_pos(-1), __EventType(etype), __proc(proc), 
 	__inc(inc), __act(act),  __home_tl(home_tl)   
 		{ __time = t; __key2 = key2; };
 #endif
 
 Event::Event(ltime_t t, int key2, unsigned int tl, int type, Timeline* home_tl, unsigned int evtnum ) : 
-	__evtnum(evtnum), __EventType(type), __tl(tl),  __home_tl(home_tl)  
+	__evtnum(evtnum), __heap_pos(-1), __EventType(type), __tl(tl),  __home_tl(home_tl)  
 		{ __time = t; __key2 = key2; };
 Event::Event(ltime_t t, int key2, InChannel* inc, Process* proc, bool bind, unsigned int pri, Timeline* home_tl, unsigned int evtnum) :
-	__evtnum(evtnum), __EventType(EVTYPE_BIND), __proc(proc), __inc(inc), __pri(pri), __bind(bind),  __home_tl(home_tl)  
+	__evtnum(evtnum), __heap_pos(-1), __EventType(EVTYPE_BIND), __proc(proc), __inc(inc), __pri(pri), __bind(bind),  __home_tl(home_tl)  
 		{ __time = t; __key2 = key2; };
 
 Event* Event::get() { return this; }
@@ -65,7 +65,18 @@ unsigned int   Event::get_pri()      { return __pri; }
 unsigned int   Event::get_evtnum()   { return __evtnum; }
 bool        Event::get_bind()         { return __bind; }
  
-void  Event::cancel() { __EventType = EVTYPE_CANCEL; }
+/* A timeout is scheduled and cancelled by the thread of its own timeline, so
+   while it waits in the event list it can be taken out of it and reclaimed
+   right away.  Other events may sit in the list of another timeline (or be
+   on their way to it), so they are only flagged, and dropped when they come
+   to the top of the list */
+void  Event::cancel() {
+	if( __EventType == EVTYPE_TIMEOUT && __heap_pos >= 0 && __home_tl->__events.remove(this) ) {
+		release();
+		return;
+	}
+	__EventType = EVTYPE_CANCEL;
+}
 
 Handle::Handle(void * eptr) {
   __eptr = (Event*)eptr;
@@ -35,7 +35,9 @@ const unsigned int EVTYPE_CANCEL=7;
   *         <BR> EVTYPE_MAKE_APPT -- create outgoing appointment time for named timeline
   *         <BR> EVTYPE_BIND      -- bind a process to an inchannel
   *         <BR> EVTYPE_CANCEL -- used to flag that this event should not
-  *           be executed, is filtered before presenting to the simulation
+  *           be executed, is filtered before presenting to the simulation.
+  *           A cancelled timeout still in the event list is removed from it
+  *           right away instead.
   * 
   * __proc : Pointer to a Process, the one called when executing an 
   *            EVTYPE_TIMEOUT event
@@ -82,6 +84,7 @@ class Event {
   ltime_t     __time;     ///< not used in priority queue but placed here for information
   int         __key2;     ///< priority
   unsigned int  __evtnum; ///< inserted by timeline on scheduling
+  int         __heap_pos; ///< position in the event list of the timeline, -1 when not in it
  protected:
   unsigned int  __EventType; ///< what to do with this event
   Process*   __proc;      ///< process to exec. on TIMEOUT
@@ -1,4 +1,7 @@
 #include <s3f.h>
+#include <algorithm>
+#include <string.h>
+#include <cxxabi.h>
 using namespace std;
 using namespace s3f;
 /**
@@ -51,7 +54,8 @@ TimelineInterface::~TimelineInterface() {
 }
 
 Interface::Interface(int num_timelines, int ltps) : 
-			__num_timelines(num_timelines), __clock(0), __log_ticks_per_sec(ltps)
+			__num_timelines(num_timelines), __clock(0), __log_ticks_per_sec(ltps), __window_bound(0),
+			__profile_cycles(0), __profile_wall(0)
 {
 
 	// set the time-scale in the interface
@@ -88,6 +92,7 @@ Interface::Interface(int num_timelines, int ltps) :
 	pthread_mutex_init(&Timeline::bottom_barrier_min_value_mutex, NULL);
 #endif
 	__start_build_time = get_wall_time();
+	__end_build_time = 0;
 	__start_run_time = 0;
 	__end_run_time = 0;
 	__acc_utime = 0;
@@ -115,17 +120,52 @@ Interface::Interface(int num_timelines, int ltps) :
 	}
 }
 
-/* call the init function of every entity.  Serialize this by stepping through the timelines, one by one */
-void Interface::InitModel() {
-	unsigned int num_timelines = __timeline_threads.size();
-	for(unsigned int t=0; t<num_timelines; t++) {
-		Timeline* tl = __timeline_threads[t].get_timeline();
-		for(unsigned int e = 0;  e< tl->__entity_list.size(); e++ ) {
-			tl->__entity_list[e]->init();
-		}
-		// tl->__in_appt.resize(num_timelines);
-		// tl->__out_appt.resize(num_timelines);
+/* hand a task to every timeline thread and wait for all of them to finish it */
+void Interface::run_timeline_task(timeline_task task, void* arg) {
+	assert(task);
+	next_action prev_action = __tli.get_next_action();
+	__tli.put_task(task, arg);
+	__tli.put_next_action( RUN_TASK );
+
+	// release the threads to run the task...
+#ifdef MUTEX_BARRIER
+	__tli.window_barrier.wait((ltime_t)(-1));
+#endif
+#ifdef SCHED_YIELD_BARRIER
+	__tli.window_barrier.wait(__num_timelines,(ltime_t)(-1));
+#endif
+#ifdef PTHREAD_BARRIER
+	pthread_barrier_wait( &(__tli.window_barrier) );
+#endif
+
+	// ...and wait for them to finish it
+#ifdef MUTEX_BARRIER
+	__tli.window_barrier.wait((ltime_t)(-1));
+#endif
+#ifdef SCHED_YIELD_BARRIER
+	__tli.window_barrier.wait(__num_timelines,(ltime_t)(-1));
+#endif
+#ifdef PTHREAD_BARRIER
+	pthread_barrier_wait( &(__tli.window_barrier) );
+#endif
+
+	__tli.put_task(0, 0);
+	__tli.put_next_action( prev_action );
+}
+
+/* the task run by each timeline thread in InitModel: call the init function
+   of every entity aligned to the timeline, if this shard runs it */
+void Interface::init_timeline_entities(Timeline* tl, void* arg) {
+	ShardGroup* shards = tl->__interface_control->shards;
+	if( shards && !shards->is_local(tl->s3fid()) ) return;
+	for(unsigned int e = 0;  e< tl->__entity_list.size(); e++ ) {
+		tl->__entity_list[e]->init();
 	}
+}
+
+/* call the init function of every entity.  Each timeline initializes its own entities on its own thread */
+void Interface::InitModel() {
+	run_timeline_task(init_timeline_entities, 0);
 
 	// This initialization process will have identified on each timeline
 	// the value of the smallest cross-timeline minimum write time value.
@@ -143,7 +183,9 @@ void Interface::InitModel() {
 	// as a heuristic, set the window threshold equal to the number
 	// of timelines times this minimum
 #ifdef COMPOSITE_SYNC
-	thrs = Timeline::__num_timelines*mxtd;
+	// appointments are kept between the threads of one process; shards
+	// synchronize all their cross-timeline connections at the barriers
+	thrs = __tli.shards ? 0 : Timeline::__num_timelines*mxtd;
 #else
 	thrs = 0;
 #endif
@@ -154,7 +196,7 @@ void Interface::InitModel() {
 	for(unsigned int t=0; t<__timeline_threads.size(); t++ ) {
 		Timeline* tl = __timeline_threads[t].get_timeline();
 		tl->__min_sync_cross_timeline_delay  = tl->min_sync_cross_timeline_delay(thrs);
-		tl->__window_size = thrs;
+		tl->__window_size = tl->__window_base = thrs;
 
 		// initialize the composite synchronization structure using this threshold
 		//
@@ -164,6 +206,8 @@ void Interface::InitModel() {
 			= tl->count_min_delay_crossings(thrs);
 		}
 	}
+
+	__end_build_time = get_wall_time();
 }
 
 Timeline* Interface::get_Timeline(unsigned int tl) {
@@ -178,9 +222,25 @@ Interface::~Interface() {
 	//wait for all the simulation thread to quit
 	__tli.window_barrier.wait(__num_timelines,(ltime_t)(-1));
 #endif
+#ifdef PTHREAD_BARRIER
+	// a thread blocked in a barrier is not cancelled, and the barrier
+	// cannot be destroyed under it; release the threads with a task that
+	// ends them instead, and wait for them
+	__tli.put_task(exit_timeline, 0);
+	__tli.put_next_action( RUN_TASK );
+	pthread_barrier_wait( &(__tli.window_barrier) );
+	for(unsigned int i=0; i< __timeline_threads.size(); i++) {
+		pthread_join( __timeline_threads[i].get_pthread(), NULL );
+	}
+#else
 	for(unsigned int i=0; i< __timeline_threads.size(); i++) {
 		pthread_cancel( __timeline_threads[i].get_pthread() );
 	}
+#endif
+}
+
+void Interface::exit_timeline(Timeline* tl, void* arg) {
+	pthread_exit(NULL);
 }
 
 void Interface::BuildModel( vector<string> vs ) {}
@@ -284,16 +344,28 @@ unsigned long Interface::full_exc_time() {
 	return( __end_run_time - __start_build_time );
 }
 
+unsigned long Interface::build_exc_time() {
+	return( __end_build_time - __start_build_time );
+}
+
 void Interface::runtime_measurements() {
 	unsigned long sum_executed = 0;
 	unsigned long work_executed = 0;
 	unsigned long sync_executed = 0;
+	unsigned long max_events = 0, removed = 0, moved = 0, dead = 0;
 	for(unsigned int i=0; i<__num_timelines; i++) {
 		Timeline *tl = get_Timeline(i);
 		sum_executed  += tl->get_executed();
 		work_executed += tl->get_work_executed();
 		sync_executed += tl->get_sync_executed();
+		if( tl->get_eventlist()->get_max_size() > max_events )
+			max_events = tl->get_eventlist()->get_max_size();
+		removed += tl->get_eventlist()->get_removed();
+		moved   += tl->get_eventlist()->get_moved();
+		dead    += tl->get_dead_executed();
 	}
+	unsigned long windows = 0, run_time = 0, wait_time = 0;
+	barrier_measurements(&windows, &run_time, &wait_time);
 	printf("-------------- runtime measurements ----------------\n");
 	printf("Simulation run of %g sim seconds, with %d timelines\n",
 			((double)__clock)/pow(10.0,__tli.get_log_ticks_per_sec()),
@@ -312,6 +384,7 @@ void Interface::runtime_measurements() {
 #endif
 
 	printf("total run time is %g seconds\n", full_exc_time()/1e6);
+	printf("model build time is %g seconds\n", build_exc_time()/1e6);
 	printf("simulation run time is %g seconds\n", sim_exc_time()/1e6);
 	printf("accumulated usr time is %g seconds\n", 
 			__acc_utime/(1e6*get_numTimelines()));
@@ -322,6 +395,462 @@ void Interface::runtime_measurements() {
 	printf("total exec evt rate %g, work evt rate %g\n",
 			sum_executed*1e6/sim_exc_time(),
 			work_executed*1e6/sim_exc_time());
+	printf("event lists: at most %lu evts, %lu cancelled in place, %lu rescheduled, %lu cancelled evts dropped\n",
+			max_events, removed, moved, dead);
+	printf("%lu sync windows, window rate %g, %.1f%% of the timeline time waiting in barriers\n",
+			windows, windows*1e6/sim_exc_time(),
+			run_time+wait_time ? 100.0*wait_time/(run_time+wait_time) : 0.0);
+	if( __tli.shards )
+		printf("shard %d of %d, %lu writes sent to other shards, %lu received\n",
+				__tli.shards->shard(), __tli.shards->num_shards(),
+				__tli.shards->get_sent(), __tli.shards->get_received());
+	window_measurements();
+	pacing_measurements();
 	printf("----------------------------------------------------\n");
 }
 
+// the windows done (the same on every Timeline of the shard), and the
+// wall time all the Timelines spent executing them and waiting in the
+// barriers between them
+//
+void Interface::barrier_measurements(unsigned long* windows, unsigned long* run_time, unsigned long* wait_time) {
+	for(unsigned int i=0; i<__num_timelines; i++) {
+		Timeline *tl = get_Timeline(i);
+		*windows    = MAX(*windows, tl->get_windows());
+		*run_time  += tl->get_run_time();
+		*wait_time += tl->get_wait_time();
+	}
+}
+
+void Interface::write_measurements(FILE* fp, const char* model) {
+	unsigned long sum_executed = 0, work_executed = 0;
+	for(unsigned int i=0; i<__num_timelines; i++) {
+		sum_executed  += get_Timeline(i)->get_executed();
+		work_executed += get_Timeline(i)->get_work_executed();
+	}
+	unsigned long windows = 0, run_time = 0, wait_time = 0;
+	barrier_measurements(&windows, &run_time, &wait_time);
+	struct rusage use_data;
+	getrusage(RUSAGE_SELF, &use_data);
+	double run = sim_exc_time()/1e6;
+
+	fprintf(fp, "{\"model\": \"%s\", \"timelines\": %u, ", model, __num_timelines);
+	if( __tli.shards )
+		fprintf(fp, "\"shard\": %d, \"shards\": %d, ", __tli.shards->shard(), __tli.shards->num_shards());
+	fprintf(fp, "\"sim_time\": %g, \"build_time\": %g, \"run_time\": %g, ",
+			((double)__clock)/pow(10.0,__tli.get_log_ticks_per_sec()), build_exc_time()/1e6, run);
+	fprintf(fp, "\"events\": %lu, \"work_events\": %lu, \"events_per_sec\": %g, ",
+			sum_executed, work_executed, run > 0 ? sum_executed/run : 0.0);
+	fprintf(fp, "\"windows\": %lu, \"windows_per_sec\": %g, \"barrier_wait_share\": %g, ",
+			windows, run > 0 ? windows/run : 0.0,
+			run_time+wait_time ? (double)wait_time/(run_time+wait_time) : 0.0);
+	if( get_Timeline(0)->__pacer.enabled() ) {
+		PacerStats ps;
+		memset(&ps, 0, sizeof(ps));
+		for(unsigned int i=0; i<__num_timelines; i++) get_Timeline(i)->__pacer.add_stats(&ps);
+		fprintf(fp, "\"pace_ratio\": %g, \"paced_windows\": %lu, \"late_windows\": %lu, ",
+				get_Timeline(0)->__pacer.ratio(), ps.windows, ps.late);
+		fprintf(fp, "\"mean_lateness\": %g, \"max_lateness\": %g, \"lateness_histogram\": [",
+				ps.late ? ps.lateness/1e9/ps.late : 0.0, ps.max_lateness/1e9);
+		int last = PACER_BUCKETS-1;
+		while( last > 0 && !ps.histogram[last] ) last--;
+		for(int k=0; k<=last; k++) fprintf(fp, "%s%lu", k ? ", " : "", ps.histogram[k]);
+		fprintf(fp, "], ");
+	}
+	fprintf(fp, "\"peak_rss_kb\": %ld}\n", (long)use_data.ru_maxrss);
+}
+
+void Interface::profile_processes() {
+	Timeline::__profile_processes = true;
+	__profile_cycles = Timeline::read_cycles();
+	__profile_wall = get_wall_time();
+}
+
+/* the cost of the bodies of a Process, an Entity type or a class, over all the Timelines */
+struct CostRow {
+	string name;
+	unsigned long calls;
+	unsigned long long cycles;
+	CostRow() : calls(0), cycles(0) {}
+	bool operator<(const CostRow& r) const { return cycles > r.cycles; }
+};
+
+// the demangled name of a type, without its namespaces
+static string demangle(const string& name) {
+	int status;
+	char* d = abi::__cxa_demangle(name.c_str(), 0, 0, &status);
+	if( !d ) return name;
+	string s(d);
+	free(d);
+	if( s.find('<') == string::npos && s.rfind("::") != string::npos )
+		s = s.substr(s.rfind("::")+2);
+	return s;
+}
+
+static void print_costs(FILE* fp, const char* title, map<string,CostRow>& rows,
+		unsigned long long total, double cycles_per_sec, int top) {
+	vector<CostRow> sorted;
+	for(map<string,CostRow>::iterator it = rows.begin(); it != rows.end(); it++) {
+		it->second.name = it->first;
+		sorted.push_back(it->second);
+	}
+	sort(sorted.begin(), sorted.end());
+	fprintf(fp, "by %s:\n", title);
+	fprintf(fp, "\t%8s %12s %12s %10s  %s\n", "cycles", "calls", "cycles/call", "seconds", title);
+	for(int i=0; i<(int)sorted.size() && i<top; i++)
+		fprintf(fp, "\t%7.2f%% %12lu %12.0f %10.4f  %s\n",
+				total ? 100.0*sorted[i].cycles/total : 0.0, sorted[i].calls,
+				sorted[i].calls ? (double)sorted[i].cycles/sorted[i].calls : 0.0,
+				cycles_per_sec > 0 ? sorted[i].cycles/cycles_per_sec : 0.0, sorted[i].name.c_str());
+	if( (int)sorted.size() > top )
+		fprintf(fp, "\t(%d more)\n", (int)sorted.size()-top);
+}
+
+// the Processes without a name are rolled up by their owner type only;
+// the class of a named one is what qualifies its name, its owner type
+// if nothing does, and that of a section the type of its code
+//
+void Interface::process_measurements(FILE* fp, int top) {
+	if( !Timeline::profiling_processes() ) return;
+	double cycles_per_sec = 0;
+	unsigned long wall = get_wall_time() - __profile_wall;
+	if( wall ) cycles_per_sec = (Timeline::read_cycles() - __profile_cycles)*1e6/wall;
+
+	map<string,CostRow> by_process, by_entity, by_class;
+	unsigned long calls = 0;
+	unsigned long long total = 0;
+	for(unsigned int i=0; i<__num_timelines; i++) {
+		vector<ProcessCost>* costs = get_Timeline(i)->get_process_cost();
+		for(unsigned int j=0; j<costs->size(); j++) {
+			ProcessCost& pc = (*costs)[j];
+			string owner = demangle(pc.owner_type);
+			string cls = owner, name = pc.name;
+			if( !pc.section_type.empty() ) {
+				cls = demangle(pc.section_type);
+				name = cls + "::" + pc.name;
+			} else {
+				size_t q = pc.name.rfind("::");
+				if( q != string::npos && q > 0 ) cls = pc.name.substr(0, q);
+				if( pc.name.empty() ) name = "(unnamed)";
+				calls += pc.calls;
+			}
+			name += " [" + owner + "]";
+			CostRow* rows[3] = { &by_process[name], &by_entity[owner], &by_class[cls] };
+			for(int k=0; k<3; k++) {
+				// the entries into sections are not executions of the entity
+				if( k != 1 || pc.section_type.empty() ) rows[k]->calls += pc.calls;
+				rows[k]->cycles += pc.cycles;
+			}
+			total += pc.cycles;
+		}
+	}
+	unsigned long run_time = 0, wait_time = 0, windows = 0;
+	barrier_measurements(&windows, &run_time, &wait_time);
+
+	fprintf(fp, "-------------- process body costs ------------------\n");
+	fprintf(fp, "%lu process bodies, %g cycles", calls, (double)total);
+	if( cycles_per_sec > 0 )
+		fprintf(fp, " (%g seconds, %.1f%% of the timeline run time)", total/cycles_per_sec,
+				run_time ? 100.0*total/cycles_per_sec*1e6/run_time : 0.0);
+	fprintf(fp, "\n");
+	print_costs(fp, "process [entity]", by_process, total, cycles_per_sec, top);
+	print_costs(fp, "entity", by_entity, total, cycles_per_sec, top);
+	print_costs(fp, "class", by_class, total, cycles_per_sec, top);
+	fprintf(fp, "----------------------------------------------------\n");
+}
+
+// the trade-off curve of the adapted windows: for each power of two of
+// the advance quantum, the wall time per virtual second and the lateness
+// of the packets injected while the quantum was in that range
+//
+void Interface::window_measurements() {
+	WindowPoint points[WINDOW_CONTROL_POINTS];
+	memset(points, 0, sizeof(points));
+	int adapted = 0;
+	for(unsigned int i=0; i<__num_timelines; i++) {
+		Timeline *tl = get_Timeline(i);
+		if( !tl->__window_ctl.enabled() ) continue;
+		tl->__window_ctl.add_curve(points);
+		adapted++;
+	}
+	if( !adapted ) return;
+
+	double tps = pow(10.0, __tli.get_log_ticks_per_sec());
+	printf("adapted windows on %d timelines, lateness bound %g seconds\n", adapted, __window_bound/tps);
+	printf("\t%12s %10s %12s %10s %9s %9s %7s %12s\n", "quantum(s)", "virt(s)", "wall/virt", "progress", "in prog", "packets", "late", "lateness(s)");
+	for(int k=0; k<WINDOW_CONTROL_POINTS; k++) {
+		WindowPoint& pt = points[k];
+		if( pt.virtual_time <= 0 ) continue;
+		double virt = pt.virtual_time/tps;
+		printf("\t%12g %10g %12g %10ld %8.1f%% %9ld %6.1f%% %12g\n",
+				((ltime_t)1 << k)/tps, virt, pt.wall_time/1e6/virt, pt.progress_calls,
+				pt.wall_time ? 100.0*pt.progress_time/pt.wall_time : 0.0, pt.packets,
+				pt.packets ? 100.0*pt.late/pt.packets : 0.0,
+				pt.late ? pt.lateness/tps/pt.late : 0.0);
+	}
+}
+
+// the lateness of the paced windows: how many ended after the wall time
+// of their upper edge and by how much, a histogram by power of two of
+// the lateness, and how precisely the early ones waited for their edge
+//
+void Interface::pacing_measurements() {
+	if( !get_Timeline(0)->__pacer.enabled() ) return;
+	PacerStats ps;
+	memset(&ps, 0, sizeof(ps));
+	for(unsigned int i=0; i<__num_timelines; i++) get_Timeline(i)->__pacer.add_stats(&ps);
+	if( !ps.windows ) return;
+
+	Pacer& pacer = get_Timeline(0)->__pacer;
+	double tps = pow(10.0, __tli.get_log_ticks_per_sec());
+	printf("paced at %g virtual seconds per wall second, windows of at most %g seconds\n",
+			pacer.ratio(), pacer.quantum()/tps);
+	printf("\t%lu timeline windows, %lu late (%.1f%%), mean lateness %g seconds, max %g seconds\n",
+			ps.windows, ps.late, 100.0*ps.late/ps.windows,
+			ps.late ? ps.lateness/1e9/ps.late : 0.0, ps.max_lateness/1e9);
+	printf("\t%lu waits: %g seconds asleep, %g seconds spinning, past the edge by %g us mean, %g us max\n",
+			ps.waits, ps.slept/1e9, ps.spun/1e9,
+			ps.waits ? ps.overshoot/1e3/ps.waits : 0.0, ps.max_overshoot/1e3);
+	printf("\t%20s %10s %7s\n", "lateness", "windows", "share");
+	for(int k=0; k<PACER_BUCKETS; k++) {
+		if( !ps.histogram[k] ) continue;
+		char range[32];
+		if( k == 0 ) sprintf(range, "on time");
+		else if( k == 1 ) sprintf(range, "< 2 us");
+		else if( k == PACER_BUCKETS-1 ) sprintf(range, ">= %lu us", 1UL << (k-1));
+		else sprintf(range, "%lu-%lu us", 1UL << (k-1), 1UL << k);
+		printf("\t%20s %10lu %6.1f%%\n", range, ps.histogram[k], 100.0*ps.histogram[k]/ps.windows);
+	}
+}
+
+void Interface::pace_windows(double ratio, ltime_t quantum, long long spin) {
+	double tps = pow(10.0, __tli.get_log_ticks_per_sec());
+	long long origin_wall = Pacer::wall_nsec();
+	for(unsigned int i=0; i<__num_timelines; i++)
+		get_Timeline(i)->__pacer.configure(ratio, quantum, tps, __clock, origin_wall, spin);
+}
+
+void Interface::pin_timeline(Timeline* tl, void* arg) {
+	if( !tl->__interface_control->placement->pin_timeline_thread(tl->s3fid()) )
+		*(bool*)arg = false;
+}
+
+bool Interface::place_timelines(CpuPlacement* placement) {
+	__tli.placement = placement;
+	bool pinned = true;
+	run_timeline_task(pin_timeline, &pinned);
+	return pinned;
+}
+
+void Interface::adapt_windows(ltime_t bound, ltime_t qmin, ltime_t qmax) {
+	__window_bound = bound;
+	for(unsigned int i=0; i<__num_timelines; i++) {
+		Timeline *tl = get_Timeline(i);
+		// only the Timelines with LXCs have anything to adapt
+		if( tl->simCtrl->listOfProxiesByTimeline[i]->size() == 0 ) continue;
+		tl->__window_ctl.configure(bound, qmin, qmax, __clock);
+		tl->__lxc_time = __clock;
+		tl->__window_size = MAX(tl->__window_base, tl->__window_ctl.quantum());
+	}
+}
+
+
+/* magic number ("S3FC") and version of the kernel part of a checkpoint */
+static const unsigned int CHECKPOINT_MAGIC   = 0x53334643;
+static const unsigned int CHECKPOINT_VERSION = 1;
+
+// write the clock and the pending events to a checkpoint.  Only the
+// Activations in flight to InChannels are written here; the timeouts
+// are saved by the entities that own them, with the rest of their state
+//
+bool Interface::checkpoint(FILE* fp, CheckpointCodec* codec) {
+	if( __tli.shards ) {
+		printf("Interface::checkpoint : a sharded simulation cannot be saved\n");
+		return false;
+	}
+
+	// gather the pending events: the event lists, and the events other
+	// Timelines buffered for the next window or left at an appointment
+	vector<EventPtr> evts;
+	for(unsigned int t=0; t<__timeline_threads.size(); t++) {
+		Timeline* tl = __timeline_threads[t].get_timeline();
+		vector<EventPtr> pending = tl->__events.evtList;
+		stable_sort(pending.rbegin(), pending.rend(), evt_Comparer());
+		evts.insert(evts.end(), pending.begin(), pending.end());
+		evts.insert(evts.end(), tl->__window_list.begin(), tl->__window_list.end());
+		for(unsigned int i=0; i<tl->__out_appt.size(); i++)
+			evts.insert(evts.end(), tl->__out_appt[i].events.begin(), tl->__out_appt[i].events.end());
+	}
+
+	vector<EventPtr> arrivals;
+	map<Entity*, int> timeouts;
+	for(unsigned int i=0; i<evts.size(); i++) {
+		switch( evts[i]->get_evtype() ) {
+		case EVTYPE_TIMEOUT :
+			timeouts[ evts[i]->get_proc()->owner() ]++;
+			break;
+		case EVTYPE_ACTIVATE :
+			arrivals.push_back( evts[i] );
+			break;
+		case EVTYPE_CANCEL :
+		case EVTYPE_MAKE_APPT :
+		case EVTYPE_WAIT_APPT :
+			// appointments are set up again by the restored model
+			break;
+		default :
+			// bindings and activations are done within the window that
+			// creates them
+			printf("Interface::checkpoint : cannot save event of type %d at time %ld\n",
+					evts[i]->get_evtype(), evts[i]->get_time());
+			return false;
+		}
+	}
+
+	// every timeout must be saved with the state of the entity that owns it
+	for(unsigned int t=0; t<__timeline_threads.size(); t++) {
+		Timeline* tl = __timeline_threads[t].get_timeline();
+		for(unsigned int e=0; e<tl->__entity_list.size(); e++) {
+			Entity* ent = tl->__entity_list[e];
+			int pending = timeouts.count(ent) ? timeouts[ent] : 0;
+			int saved = codec->saved_timeouts(ent);
+			if( pending != saved ) {
+				printf("Interface::checkpoint : entity %s has %d pending timeouts, its state saves %d\n",
+						ent->__name.c_str(), pending, saved);
+				return false;
+			}
+		}
+	}
+
+	unsigned int hdr[2] = { CHECKPOINT_MAGIC, CHECKPOINT_VERSION };
+	unsigned int num[2] = { Entity::__num_entities, (unsigned int)arrivals.size() };
+	fwrite(hdr, sizeof(hdr), 1, fp);
+	fwrite(&__clock, sizeof(__clock), 1, fp);
+	fwrite(num, sizeof(num), 1, fp);
+
+	// an arrival is identified by the Entity owning the InChannel and the
+	// rank of the InChannel among those of the Entity
+	for(unsigned int i=0; i<arrivals.size(); i++) {
+		InChannel* ic = arrivals[i]->get_inc();
+		Entity* ent = ic->owner();
+		unsigned int idx = 0;
+		while( ent->__inchannel_list[idx] != ic ) idx++;
+
+		ltime_t t = arrivals[i]->get_time();
+		int key2 = arrivals[i]->__key2;
+		unsigned int id[2] = { ent->__s3fid, idx };
+		fwrite(&t, sizeof(t), 1, fp);
+		fwrite(&key2, sizeof(key2), 1, fp);
+		fwrite(id, sizeof(id), 1, fp);
+		if( !codec->save_activation(arrivals[i]->get_act(), fp) ) {
+			printf("Interface::checkpoint : cannot save the activation arriving at entity %s at time %ld\n",
+					ent->__name.c_str(), t);
+			return false;
+		}
+	}
+	return !ferror(fp);
+}
+
+// restore a checkpoint in a freshly initialized model
+//
+bool Interface::restore(FILE* fp, CheckpointCodec* codec) {
+	unsigned int hdr[2], num[2];
+	ltime_t ckpt_clock;
+	if( fread(hdr, sizeof(hdr), 1, fp) != 1 || hdr[0] != CHECKPOINT_MAGIC ||
+			hdr[1] != CHECKPOINT_VERSION ) {
+		printf("Interface::restore : not a checkpoint, or of another version\n");
+		return false;
+	}
+	if( fread(&ckpt_clock, sizeof(ckpt_clock), 1, fp) != 1 || fread(num, sizeof(num), 1, fp) != 1 ) {
+		printf("Interface::restore : truncated checkpoint\n");
+		return false;
+	}
+	if( num[0] != Entity::__num_entities ) {
+		printf("Interface::restore : the checkpoint has %u entities, the model %u\n",
+				num[0], Entity::__num_entities);
+		return false;
+	}
+
+	// find the entities by identity
+	vector<Entity*> entities(num[0], (Entity*)NULL);
+	for(unsigned int t=0; t<__timeline_threads.size(); t++) {
+		Timeline* tl = __timeline_threads[t].get_timeline();
+		for(unsigned int e=0; e<tl->__entity_list.size(); e++)
+			entities[ tl->__entity_list[e]->__s3fid ] = tl->__entity_list[e];
+	}
+
+	// discard the events scheduled by the init() methods, except for the
+	// bindings of Processes to InChannels, which are part of the model,
+	// and the first appointments, which move to the time of the checkpoint
+	// as if the run started there; then move the clocks there too
+	for(unsigned int t=0; t<__timeline_threads.size(); t++) {
+		Timeline* tl = __timeline_threads[t].get_timeline();
+		vector<EventPtr> appts;
+		while( !tl->__events.empty_lockless() ) {
+			EventPtr e = tl->__events.top_lockless();
+			tl->__events.pop_lockless();
+			if( e->get_evtype() == EVTYPE_BIND )
+				e->get_inc()->insert_process_pri( e->get_proc(), e->get_bind(), user_pri(e->get_pri()) );
+			if( e->get_evtype() == EVTYPE_MAKE_APPT || e->get_evtype() == EVTYPE_WAIT_APPT ) {
+				Event* a = new Event(ckpt_clock + e->get_time(), e->__key2, e->get_tl(), e->get_evtype(),
+						tl, tl->__evtnum++);
+				appts.push_back( EventPtr(a) );
+			}
+			e->release();
+		}
+		for(unsigned int i=0; i<appts.size(); i++)
+			tl->__events.push( appts[i] );
+		for(unsigned int i=0; i<tl->__window_list.size(); i++)
+			tl->__window_list[i]->release();
+		tl->__window_list.clear();
+		tl->__time = ckpt_clock;
+	}
+	__clock = ckpt_clock;
+
+	// schedule the arrivals on the Timelines of their entities
+	for(unsigned int i=0; i<num[1]; i++) {
+		ltime_t t;
+		int key2;
+		unsigned int id[2];
+		if( fread(&t, sizeof(t), 1, fp) != 1 || fread(&key2, sizeof(key2), 1, fp) != 1 ||
+				fread(id, sizeof(id), 1, fp) != 1 ) {
+			printf("Interface::restore : truncated checkpoint\n");
+			return false;
+		}
+		if( id[0] >= entities.size() || !entities[id[0]] ||
+				id[1] >= entities[id[0]]->__inchannel_list.size() ) {
+			printf("Interface::restore : the checkpoint does not match the model\n");
+			return false;
+		}
+		Activation act = codec->load_activation(fp);
+		if( !act ) {
+			printf("Interface::restore : cannot load the activation arriving at entity %s at time %ld\n",
+					entities[id[0]]->__name.c_str(), t);
+			return false;
+		}
+		InChannel* ic = entities[id[0]]->__inchannel_list[id[1]];
+		Timeline* tgt = ic->owner()->alignment();
+		Event* e = new Event(EVTYPE_ACTIVATE, t, key2, ic, act, NULL, tgt, tgt->__evtnum++);
+		EventPtr eptr(e);
+		tgt->__events.push( eptr );
+	}
+	return true;
+}
+
+// make this process one shard of the group, before the model is built: the
+// model asks the group which Timelines are local as it builds its Entities
+//
+bool Interface::join_shards(ShardGroup* group, ShardCodec* codec) {
+#ifndef PTHREAD_BARRIER
+	printf("Interface::join_shards : shards need the kernel built with PTHREAD_BARRIER\n");
+	return false;
+#else
+	if( group->__num_timelines != __num_timelines ) {
+		printf("Interface::join_shards : the shards were created for %u timelines, the model has %u\n",
+				group->__num_timelines, __num_timelines);
+		return false;
+	}
+	group->join(codec);
+	__tli.shards = group;
+	return true;
+#endif
+}
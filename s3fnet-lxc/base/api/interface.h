@@ -39,7 +39,14 @@ protected:
    time.  That could change, e.g., provide a pointer to a function that gives
    a termination condition.
  */
-enum next_action { STOP_BEFORE_TIME, STOP_FUNCTION };
+enum next_action { STOP_BEFORE_TIME, STOP_FUNCTION, RUN_TASK };
+
+/**
+ * A task the control thread hands to every Timeline thread between epochs
+ * (see Interface::run_timeline_task).  It is called once by each Timeline's
+ * own thread, with the Timeline and the argument given by the control thread.
+ */
+typedef void (*timeline_task)(Timeline*, void*);
 enum stop_cond   { STOP_ON_ANY, STOP_ON_ALL };
 
 /**
@@ -57,8 +64,8 @@ class TimelineInterface {
 public:
 	friend class Timeline;
 
-	TimelineInterface() : __next_action(STOP_FUNCTION), __stop_cond(STOP_ON_ANY) {}
-	TimelineInterface( stop_cond sc ) : __next_action(STOP_FUNCTION), __stop_cond(sc) {}
+	TimelineInterface() : shards(0), placement(0), __next_action(STOP_FUNCTION), __stop_cond(STOP_ON_ANY), __task(0), __task_arg(0) {}
+	TimelineInterface( stop_cond sc ) : shards(0), placement(0), __next_action(STOP_FUNCTION), __stop_cond(sc), __task(0), __task_arg(0) {}
 
 	virtual ~TimelineInterface();
 
@@ -66,12 +73,18 @@ public:
 	// TimelineInterface will contain a pointer to LxcManager
 	// Interface HAS 1 TimelineInterface
 
+	ShardGroup* shards; ///< the shards running the simulation, NULL when it runs in one process
+	CpuPlacement* placement; ///< the CPUs of the Timelines, NULL when the threads are not pinned
+
 	next_action __next_action; ///< type of next synchronization
 	stop_cond   __stop_cond;
 
 	ltime_t   __stop_before; ///< time up to which the Timelines ought to simulate
 	int       __num_Timelines;
 
+	timeline_task __task;     ///< task to run when next action is RUN_TASK
+	void*         __task_arg; ///< argument passed to the task
+
 	// barrier synchronizations used by the control thread and
 	// Timeline threads for synchronization and epoch windows
 	//
@@ -110,8 +123,8 @@ public:
 	void put_log_ticks_per_sec(int ltps) { __log_ticks_per_sec = ltps; }
 	int  get_numTimelines()              { return __num_Timelines; }
 
-	TimelineInterface( ltime_t t ) : __next_action(STOP_BEFORE_TIME),
-			__stop_before(t) {};
+	TimelineInterface( ltime_t t ) : shards(0), placement(0), __next_action(STOP_BEFORE_TIME),
+			__stop_before(t), __task(0), __task_arg(0) {};
 
 
 	/** default stop_condition function is not to stop */
@@ -127,6 +140,36 @@ public:
 	stop_cond   get_stop_cond()          { return __stop_cond; }
 	void put_next_action(next_action na) { __next_action = na;   }
 	void put_stop_cond(stop_cond sc) { __stop_cond = sc;   }
+
+	/** access to the task run by the Timelines when next action is RUN_TASK */
+	timeline_task get_task()             { return __task; }
+	void*  get_task_arg()                { return __task_arg; }
+	void put_task(timeline_task task, void* arg) { __task = task; __task_arg = arg; }
+};
+
+/**
+ * CheckpointCodec supplies what Interface::checkpoint and Interface::restore
+ * cannot interpret themselves: the Activations carried by the events in flight
+ * (instances of classes derived from Message the kernel knows nothing of), and
+ * the timeouts that the entities save with their own state and re-schedule
+ * themselves when restored.
+ */
+class CheckpointCodec {
+public:
+	virtual ~CheckpointCodec() {}
+
+	/** Write the given Activation to fp; return false if it cannot be saved. */
+	virtual bool save_activation(Activation act, FILE* fp) = 0;
+
+	/** Read back an Activation written by save_activation, NULL if it cannot be. */
+	virtual Activation load_activation(FILE* fp) = 0;
+
+	/**
+	 * Return the number of timeouts (events scheduled by waitFor) of the
+	 * given Entity that it saves with its own state.  A checkpoint is refused
+	 * unless this is the number of timeouts pending on the Entity.
+	 */
+	virtual int saved_timeouts(Entity* ent) = 0;
 };
 
 /**
@@ -174,6 +217,15 @@ public:
 	 */
 	void InitModel();
 
+	/**
+	 * Run the given task on every Timeline, each on its own thread, and return
+	 * when all of them have finished.  Between epochs the Timeline threads are
+	 * idle in the window barrier; this lets model construction use them, e.g.,
+	 * to configure and initialize the entities aligned to each Timeline in parallel.
+	 * It must not be called while an epoch is being simulated.
+	 */
+	void run_timeline_task(timeline_task task, void* arg);
+
 	/**
 	 *   Method advance is called to all the simulation to advance to the simulation
 	 *   time passed as an argument, using the method indicated by next_action.
@@ -213,6 +265,92 @@ public:
 	/** Return measurement including simulation time, total time, total events, etc */
 	void runtime_measurements();
 
+	/**
+	 * Write the measurements of the run to fp as one JSON object on a line:
+	 * the model (as given), the Timelines, the run time, the events and
+	 * events per second, the windows and windows per second, the share of
+	 * the Timeline time spent waiting in the barriers, the lateness of the
+	 * windows if paced, and the peak resident set size of the process.
+	 */
+	void write_measurements(FILE* fp, const char* model);
+
+	/**
+	 * Count the cycles spent in every Process body from now on, on each
+	 * Timeline, by Process name and owning Entity type, for process_measurements.
+	 * It is called before advance(); the bodies not profiled cost a test.
+	 */
+	void profile_processes();
+
+	/**
+	 * Write the cost of the Process bodies profiled since profile_processes, the
+	 * Timelines merged, to fp: the top rows by Process name (and by cost section,
+	 * see Timeline::enter_cost_section), by Entity type and by class (the qualifier
+	 * of the Process name, or the type of the code of the section), the costliest
+	 * first.  Nothing if not profiled.
+	 */
+	void process_measurements(FILE* fp, int top);
+
+	/**
+	 * Write the clock and the pending events of the simulation to fp.  Between
+	 * epochs all Timelines are parked in the window barrier, which makes this a
+	 * consistent cut; it must be called by the control thread between calls to
+	 * advance().  Events are saved by Entity and InChannel number, not by
+	 * Timeline, so the checkpoint may be restored on a different number of
+	 * Timelines.  Returns false (with a message) if some event cannot be saved.
+	 */
+	bool checkpoint(FILE* fp, CheckpointCodec* codec);
+
+	/**
+	 * Restore a checkpoint written by checkpoint() in a model built from the
+	 * same description.  It is called after InitModel and before the first
+	 * advance(): the events scheduled by the init() methods are discarded,
+	 * except the bindings of Processes to InChannels which are done right away,
+	 * the clocks are set to the time of the checkpoint, and the saved events
+	 * are scheduled.  The entities then re-schedule their own timeouts.
+	 * Returns false (with a message) if the checkpoint does not match the model.
+	 */
+	bool restore(FILE* fp, CheckpointCodec* codec);
+
+	/**
+	 * Run this process as one shard of the given group.  It is called before
+	 * BuildModel, in every shard, with the codec that packs the Activations
+	 * written across shards.  The model then builds only the Entities aligned
+	 * to the Timelines of this shard (see ShardGroup::is_local), mapping its
+	 * OutChannels to stubs for the InChannels of the other shards, and
+	 * InitModel initializes only those Entities.  Returns false (with a
+	 * message) if the simulation cannot be sharded.
+	 */
+	bool join_shards(ShardGroup* group, ShardCodec* codec);
+
+	/**
+	 * Adapt the advance quantum of the LXCs, and the window offered, on every
+	 * Timeline with LXCs, between qmin and qmax clock ticks, to keep the mean
+	 * lateness of the packets injected into the past of a Timeline within
+	 * bound ticks (see WindowController).  It is called after InitModel (and
+	 * restore) and before the first advance(); a bound of 0 keeps the LXCs
+	 * advancing straight to the next event.
+	 */
+	void adapt_windows(ltime_t bound, ltime_t qmin, ltime_t qmax);
+
+	/**
+	 * Run in paced real time from now on, at ratio virtual seconds per wall
+	 * second, without TimeKeeper: every Timeline cuts its windows at most
+	 * quantum ticks apart and does not end a window before the wall time of
+	 * its upper edge, sleeping until spin nanoseconds before it and spinning
+	 * the rest (see Pacer).  It is called after InitModel (and restore)
+	 * right before the first advance(); a ratio of 0 runs as fast as possible.
+	 */
+	void pace_windows(double ratio, ltime_t quantum, long long spin);
+
+	/**
+	 * Pin the Timeline threads, and later the ingress threads and the LXCs
+	 * of each Timeline, to the CPUs of the given placement.  It is called
+	 * before BuildModel, so that the model built on the Timeline threads is
+	 * allocated on the NUMA node of each.  Returns false if a thread cannot
+	 * be pinned.
+	 */
+	bool place_timelines(CpuPlacement* placement);
+
 	/* ****************************************************
          PROTECTED DATA ELEMENTS
 	 *******************************************************/
@@ -223,12 +361,37 @@ protected:
 	int __log_ticks_per_sec; ///< Time-scale of clock tickc, log base 10 of number of clock ticks in a second
 	TimelineInterface __tli; ///< Pointer to the data structure created to interface with simulation Timelines.
 	unsigned long __start_build_time; ///< time when BuildModel is called;
+	unsigned long __end_build_time;   ///< time when InitModel finishes
 	unsigned long __start_run_time;   ///< time when advance first called
 	unsigned long __end_run_time;     ///< time when advance finishes
 public:
 	unsigned long full_exc_time(); ///< return the entire execution time (simulation + initialization/model-building)
 	unsigned long sim_exc_time(); ///< return the simulation time
+	unsigned long build_exc_time(); ///< return the model building time (BuildModel and InitModel)
 protected:
+	/** The task run by each Timeline in InitModel: initialize the entities aligned to it. */
+	static void init_timeline_entities(Timeline* tl, void* arg);
+
+	/** The task run by each Timeline in place_timelines: pin its thread. */
+	static void pin_timeline(Timeline* tl, void* arg);
+
+	/** The task run by each Timeline when the Interface is destroyed: end its thread. */
+	static void exit_timeline(Timeline* tl, void* arg);
+
+	/** Print the trade-off curve of the adapted windows, if any. */
+	void window_measurements();
+
+	/** Print the lateness of the paced windows, if paced. */
+	void pacing_measurements();
+
+	/** Add up the windows and the wall time the Timelines spent in and between them. */
+	void barrier_measurements(unsigned long* windows, unsigned long* run_time, unsigned long* wait_time);
+
+	ltime_t __window_bound; ///< the lateness bound of the adapted windows, 0 if not adapted
+
+	unsigned long long __profile_cycles; ///< the cycle counter when the Process bodies started being profiled
+	unsigned long __profile_wall;        ///< the wall time then, to convert cycles to seconds
+
 	unsigned long __srt_utime;
 	unsigned long __srt_stime;
 	unsigned long __acc_utime;
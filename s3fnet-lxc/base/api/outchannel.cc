@@ -161,6 +161,39 @@ bool OutChannel::write(Activation act, unsigned int pri) {
 	return write(act, 0, pri);
 }
 
+/* ***************************************************************
+
+  bool OutChannel::write_to(InChannel* ic, Activation act, ltime_t delay, unsigned int pri)
+
+  Deliver the Activation over the one mapping to InChannel ic, under the same
+  rules as write.  The Activation is not copied; if it is not delivered it
+  is deleted, as write does when no delivery is made.
+
+ **************************************************************/
+
+bool OutChannel::write_to(InChannel* ic, Activation act, ltime_t write_delay, unsigned int pri) {
+
+	unsigned int end = __mapped_to.size();
+	unsigned int i;
+	for(i=0; i<end; i++)
+		if( __mapped_to[i].ic() == ic ) break;
+
+	if( i < end ) {
+		ltime_t delivery = owner()->now() + write_delay + __mapped_to[i].transfer_delay() + __min_write_delay;
+		if( !__mapped_to[i].xtimeline() || owner()->alignment()->horizon() <= delivery ||
+				__mapped_to[i].asynchronous() ) {
+			__owner->alignment()->schedule( ic, delivery, user_pri(pri), act );
+			return true;
+		}
+	}
+
+#ifndef SAFE_MSG_PTR
+	printf("s3f outchannel write drop \n");
+	act->erase_all();
+#endif
+	return false;
+}
+
 /**
  * mapto connects this outchannel with the InChannel whose address is passed.
  * A per-mapping delay can be associated with each mapping. If the OutChannel
@@ -218,6 +218,15 @@ public:
 	 */
 	bool write(Activation);
 
+	/**
+	 * Same as the write(Activation, ltime_t delay, unsigned int pri), except that the
+	 * Activation is delivered only to the given InChannel, which must be one of those this
+	 * OutChannel is mapped to, e.g. to carry a unicast frame to the one interface it is
+	 * addressed to on a shared link.  No copy of the Activation is made.  False is returned
+	 * if the InChannel is not mapped to, or if the delivery cannot be made.
+	 */
+	bool write_to(InChannel*, Activation, ltime_t delay, unsigned int pri);
+
 	/**
 	 * Return the least delay among all mappings whose minimum delay is at least as large as the argument.
 	 * Thresholding used to support composite synchronization algorithm.
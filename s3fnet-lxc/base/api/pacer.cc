@@ -0,0 +1,102 @@
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <s3f.h>
+using namespace std;
+using namespace s3f;
+
+/**
+ * \file pacer.cc
+ *
+ * \brief S3F Pacer methods
+ *
+ * authors : Dong (Kevin) Jin
+ */
+
+namespace s3f {
+
+Pacer::Pacer() :
+	__ratio(0), __nsec_per_tick(0), __quantum(0), __origin(0), __origin_wall(0),
+	__spin(0), __last_edge(0)
+{
+	memset(&__stats, 0, sizeof(__stats));
+}
+
+long long Pacer::wall_nsec() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (long long)ts.tv_sec*1000000000LL + ts.tv_nsec;
+}
+
+void Pacer::configure(double ratio, ltime_t quantum, double ticks_per_sec,
+		ltime_t origin, long long origin_wall, long long spin) {
+	__ratio = ratio;
+	__nsec_per_tick = ratio > 0 ? 1e9/(ticks_per_sec*ratio) : 0;
+	__quantum = MAX(quantum, (ltime_t)1);
+	__origin = origin;
+	__origin_wall = origin_wall;
+	__spin = MAX(spin, 0LL);
+	__last_edge = origin;
+}
+
+int Pacer::bucket(long long lateness) {
+	if( lateness <= 0 ) return 0;
+	long long usec = lateness/1000;
+	int k = 1;
+	while( usec > 1 && k < PACER_BUCKETS-1 ) { usec >>= 1; k++; }
+	return k;
+}
+
+void Pacer::pace(ltime_t stop_before) {
+	__last_edge = stop_before;
+	__stats.windows++;
+	long long deadline = __origin_wall + (long long)((stop_before - __origin)*__nsec_per_tick);
+	long long now = wall_nsec();
+	long long lateness = now - deadline;
+	__stats.histogram[bucket(lateness)]++;
+	if( lateness > 0 ) {
+		// the model can't keep up: no waiting, let the next window catch up
+		__stats.late++;
+		__stats.lateness += lateness;
+		__stats.max_lateness = MAX(__stats.max_lateness, lateness);
+		return;
+	}
+
+	// early: sleep most of the way, a timer wakeup being coarse, then spin
+	__stats.waits++;
+	if( deadline - now > __spin ) {
+		long long until = deadline - __spin;
+		struct timespec ts;
+		ts.tv_sec = until/1000000000LL;
+		ts.tv_nsec = until%1000000000LL;
+		while( clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, 0) == EINTR );
+		long long woke = wall_nsec();
+		__stats.slept += woke - now;
+		now = woke;
+	}
+	long long spin_start = now;
+	while( now < deadline ) {
+#if defined(__x86_64__) || defined(__i386__)
+		__builtin_ia32_pause();
+#endif
+		now = wall_nsec();
+	}
+	__stats.spun += now - spin_start;
+	__stats.overshoot += now - deadline;
+	__stats.max_overshoot = MAX(__stats.max_overshoot, now - deadline);
+}
+
+void Pacer::add_stats(PacerStats* stats) {
+	stats->windows      += __stats.windows;
+	stats->late         += __stats.late;
+	stats->lateness     += __stats.lateness;
+	stats->max_lateness  = MAX(stats->max_lateness, __stats.max_lateness);
+	stats->slept        += __stats.slept;
+	stats->spun         += __stats.spun;
+	stats->waits        += __stats.waits;
+	stats->overshoot    += __stats.overshoot;
+	stats->max_overshoot = MAX(stats->max_overshoot, __stats.max_overshoot);
+	for(int k=0; k<PACER_BUCKETS; k++) stats->histogram[k] += __stats.histogram[k];
+}
+
+}
@@ -0,0 +1,94 @@
+/**
+ * \file pacer.h
+ *
+ * \brief S3F paced real-time execution of the synchronization windows
+ *
+ * authors : Dong (Kevin) Jin
+ */
+
+#ifndef __PACER_H__
+#define __PACER_H__
+
+#ifndef __S3F_H__
+#error "pacer.h can only be included by s3f.h"
+#endif
+
+/**
+ * Number of buckets of the lateness histogram: on time, then one per power
+ * of two of the lateness in microseconds, the last one open-ended.
+ */
+#define PACER_BUCKETS 32
+
+/** What a Pacer measured: the windows, how late they were, and how it waited. */
+struct PacerStats {
+	unsigned long windows;        ///< windows paced (on every Timeline)
+	unsigned long late;           ///< windows done after the wall time of their upper edge
+	long long     lateness;       ///< total lateness of the late windows, in nanoseconds
+	long long     max_lateness;   ///< the largest, in nanoseconds
+	long long     slept;          ///< wall time asleep, in nanoseconds
+	long long     spun;           ///< wall time spinning, in nanoseconds
+	unsigned long waits;          ///< windows done early, that waited
+	long long     overshoot;      ///< total time past the edge when the waits ended, in nanoseconds
+	long long     max_overshoot;  ///< the largest, in nanoseconds
+	unsigned long histogram[PACER_BUCKETS]; ///< windows by lateness
+};
+
+/**
+ * Pacer keeps a Timeline running at a fixed ratio of virtual to wall-clock
+ * time, without TimeKeeper: a window may not end before the wall time that
+ * corresponds to its upper edge, __stop_before, and no window reaches more
+ * than a quantum beyond the previous one, so that the events are at most a
+ * quantum early. Every Timeline of the simulation is paced from the same
+ * origin and cuts the windows at the same edges.
+ *
+ * A window done early waits for its edge in two steps to keep the jitter
+ * low: it sleeps until a spin interval before the edge, then spins on the
+ * clock. A window done late starts the next one at once; how late it was
+ * goes into a histogram, which tells when the model can't keep up.
+ */
+class Pacer {
+public:
+	Pacer();
+
+	/**
+	 * Pace at ratio virtual seconds per wall second (0 disables the pacing)
+	 * with windows of at most quantum ticks, from virtual time origin at
+	 * wall time origin_wall (see wall_nsec()); a clock of ticks_per_sec,
+	 * sleeping until spin nanoseconds before the edge of a window.
+	 */
+	void configure(double ratio, ltime_t quantum, double ticks_per_sec,
+			ltime_t origin, long long origin_wall, long long spin);
+
+	bool    enabled() { return __ratio > 0; }
+	double  ratio()   { return __ratio; }
+	ltime_t quantum() { return __quantum; }
+
+	/** The upper edge of the next window: stop_before, cut a quantum after the last edge. */
+	ltime_t edge(ltime_t stop_before) {
+		return stop_before < __last_edge + __quantum ? stop_before : __last_edge + __quantum;
+	}
+
+	/** The window up to stop_before is done: record its lateness, or wait for its wall time. */
+	void pace(ltime_t stop_before);
+
+	/** Add what this Pacer measured to the given stats. */
+	void add_stats(PacerStats* stats);
+
+	/** The bucket of the histogram of a lateness in nanoseconds. */
+	static int bucket(long long lateness);
+
+	/** Monotonic wall clock in nanoseconds. */
+	static long long wall_nsec();
+
+private:
+	double    __ratio;        ///< virtual seconds per wall second
+	double    __nsec_per_tick;///< wall nanoseconds per tick of virtual time
+	ltime_t   __quantum;      ///< the longest window
+	ltime_t   __origin;       ///< the virtual time paced from
+	long long __origin_wall;  ///< and the wall time it corresponds to
+	long long __spin;         ///< spin this long before the edge of a window
+	ltime_t   __last_edge;    ///< upper edge of the last window
+	PacerStats __stats;
+};
+
+#endif /*__PACER_H__*/
@@ -0,0 +1,174 @@
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sched.h>
+#include <dirent.h>
+#include <sys/syscall.h>
+#include <algorithm>
+#include <s3f.h>
+using namespace std;
+using namespace s3f;
+
+/**
+ * \file placement.cc
+ *
+ * \brief S3F CpuPlacement methods
+ *
+ * authors : Dong (Kevin) Jin
+ */
+
+namespace s3f {
+
+/* the memory policy of set_mempolicy(2), without linking libnuma */
+#define PLACEMENT_MPOL_PREFERRED 1
+#define PLACEMENT_MAX_NODES      1024
+
+/* the NUMA node of a CPU, from the nodeN entry of its sysfs directory (0 if none) */
+static int cpu_node(int cpu)
+{
+	char path[64];
+	sprintf(path, "/sys/devices/system/cpu/cpu%d", cpu);
+	DIR* dir = opendir(path);
+	if( !dir ) return 0;
+	int node = 0;
+	struct dirent* de;
+	while( (de = readdir(dir)) ) {
+		if( !strncmp(de->d_name, "node", 4) && de->d_name[4] >= '0' && de->d_name[4] <= '9' ) {
+			node = atoi(de->d_name+4);
+			break;
+		}
+	}
+	closedir(dir);
+	return node;
+}
+
+CpuPlacement* CpuPlacement::create(int num_timelines, int n_cpus) {
+	cpu_set_t allowed;
+	if( sched_getaffinity(0, sizeof(allowed), &allowed) ) {
+		perror("CpuPlacement::create : sched_getaffinity");
+		return NULL;
+	}
+
+	// the CPUs the process may run on, node by node
+	vector< pair<int,int> > cpus;
+	for(int c=0; c<CPU_SETSIZE; c++)
+		if( CPU_ISSET(c, &allowed) ) cpus.push_back(make_pair(cpu_node(c), c));
+	if( cpus.empty() ) {
+		printf("CpuPlacement::create : no CPU to run on\n");
+		return NULL;
+	}
+	sort(cpus.begin(), cpus.end());
+	if( n_cpus > 0 && n_cpus < (int)cpus.size() ) cpus.resize(n_cpus);
+
+	CpuPlacement* p = new CpuPlacement();
+	for(unsigned int i=0; i<cpus.size(); i++) {
+		p->__node.push_back(cpus[i].first);
+		p->__cpus.push_back(cpus[i].second);
+	}
+
+	// contiguous slices, the first ones a CPU larger; or round robin
+	int n = cpus.size();
+	for(int t=0, f=0; t<num_timelines; t++) {
+		if( n >= num_timelines ) {
+			int count = n/num_timelines + (t < n%num_timelines ? 1 : 0);
+			p->__first.push_back(f);
+			p->__count.push_back(count);
+			f += count;
+		} else {
+			p->__first.push_back(t%n);
+			p->__count.push_back(1);
+		}
+	}
+	return p;
+}
+
+bool CpuPlacement::pin_timeline_thread(int tl) {
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	CPU_SET(timeline_cpu(tl), &set);
+	if( sched_setaffinity(0, sizeof(set), &set) ) {
+		perror("CpuPlacement::pin_timeline_thread : sched_setaffinity");
+		return false;
+	}
+
+	// a kernel without NUMA support refuses the policy; the thread is
+	// pinned anyway, and its memory is on the only node there is
+	unsigned long mask[PLACEMENT_MAX_NODES/(8*sizeof(unsigned long))];
+	memset(mask, 0, sizeof(mask));
+	int nd = node(tl);
+	if( nd < PLACEMENT_MAX_NODES ) {
+		mask[nd/(8*sizeof(unsigned long))] |= 1UL << (nd%(8*sizeof(unsigned long)));
+		syscall(SYS_set_mempolicy, PLACEMENT_MPOL_PREFERRED, mask, (unsigned long)PLACEMENT_MAX_NODES);
+	}
+	return true;
+}
+
+bool CpuPlacement::pin_helper(int tid, int tl) {
+	// the cores of the slice but the one of the Timeline thread
+	if( !has_helper_cores(tl) ) return false;
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	for(int i=__first[tl]+1; i<__first[tl]+__count[tl]; i++)
+		CPU_SET(__cpus[i], &set);
+	return sched_setaffinity(tid, sizeof(set), &set) == 0;
+}
+
+bool CpuPlacement::pin_ingress_thread(int tl) {
+	if( !pin_helper(0, tl) ) {
+		perror("CpuPlacement::pin_ingress_thread : sched_setaffinity");
+		return false;
+	}
+	return true;
+}
+
+int CpuPlacement::pin_tree(int pid, int tl) {
+	char path[64];
+	sprintf(path, "/proc/%d/task", pid);
+	DIR* dir = opendir(path);
+	if( !dir ) return 0;
+	int pinned = 0;
+	struct dirent* de;
+	while( (de = readdir(dir)) ) {
+		int tid = atoi(de->d_name);
+		if( tid <= 0 ) continue;
+		if( pin_helper(tid, tl) ) pinned++;
+
+		// the children forked by this thread
+		char cpath[96];
+		sprintf(cpath, "/proc/%d/task/%d/children", pid, tid);
+		FILE* fp = fopen(cpath, "r");
+		if( !fp ) continue;
+		int child;
+		while( fscanf(fp, "%d", &child) == 1 )
+			pinned += pin_tree(child, tl);
+		fclose(fp);
+	}
+	closedir(dir);
+	return pinned;
+}
+
+bool CpuPlacement::pin_lxc(int pid, int tl) {
+	if( pin_tree(pid, tl) == 0 ) {
+		printf("CpuPlacement::pin_lxc : can't pin process %d\n", pid);
+		return false;
+	}
+	return true;
+}
+
+void CpuPlacement::print(FILE* fp) {
+	fprintf(fp, "CPU placement of %d timelines on %d CPUs:\n", (int)__first.size(), num_cpus());
+	for(unsigned int t=0; t<__first.size(); t++) {
+		fprintf(fp, "\ttimeline %u: node %d, timeline thread on cpu %d, ", t, node(t), timeline_cpu(t));
+		if( !has_helper_cores(t) ) {
+			fprintf(fp, "ingress thread and LXCs not pinned\n");
+			continue;
+		}
+		fprintf(fp, "ingress thread and LXCs on cpu");
+		int first = __first[t]+1;
+		for(int i=first; i<__first[t]+__count[t]; i++)
+			fprintf(fp, "%s%d", i == first ? (__count[t] > 2 ? "s " : " ") : ",", __cpus[i]);
+		fprintf(fp, "\n");
+	}
+}
+
+}
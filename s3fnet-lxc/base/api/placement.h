@@ -0,0 +1,87 @@
+/**
+ * \file placement.h
+ *
+ * \brief S3F placement of the Timelines, their ingress threads and their LXCs on CPUs
+ *
+ * authors : Dong (Kevin) Jin
+ */
+
+#ifndef __PLACEMENT_H__
+#define __PLACEMENT_H__
+
+#ifndef __S3F_H__
+#error "placement.h can only be included by s3f.h"
+#endif
+
+/**
+ * CpuPlacement assigns each Timeline a set of cores, on which its thread,
+ * the thread injecting the packets of its LXCs (the ingress thread) and the
+ * LXCs advanced by TimeKeeper on its behalf all run, so that they do not
+ * compete with those of the other Timelines, and their memory stays on
+ * one NUMA node.
+ *
+ * The placement is opt-in (the n_cpus attribute of the model): the
+ * experiment runs on the first n_cpus CPUs the process may run on, taken
+ * node by node.  The CPUs are divided among the Timelines in contiguous
+ * slices, which keeps the slice of a Timeline on one node wherever the
+ * numbers allow it; when there are fewer CPUs than Timelines, the
+ * Timelines share them round robin.  The Timeline thread runs on the
+ * first core of its slice, and the ingress thread and the LXCs on the
+ * others.  They are never given the core of the Timeline thread: when the
+ * slice has only one core, they are left to the scheduler.  The Timeline
+ * thread prefers the memory of the node of its slice, so that what it
+ * allocates, such as the events and, since the model is built on the
+ * Timeline threads, the hosts aligned to it, is local to it.
+ *
+ * The slices are computed from the global Timeline ids, so the shards of
+ * a sharded simulation, each placing its own Timelines, do not overlap.
+ */
+class CpuPlacement {
+public:
+	/**
+	 * Place num_timelines Timelines on the first n_cpus CPUs the process may
+	 * run on (all of them if n_cpus is 0 or more than that).  Returns NULL,
+	 * with a message, if the CPUs of the process cannot be found.
+	 */
+	static CpuPlacement* create(int num_timelines, int n_cpus);
+
+	/** Return the number of CPUs used. */
+	int num_cpus()                { return __cpus.size(); }
+
+	/** Return the CPU of the thread of the given Timeline. */
+	int timeline_cpu(int tl)      { return __cpus[__first[tl]]; }
+
+	/** Return the NUMA node of the given Timeline. */
+	int node(int tl)              { return __node[__first[tl]]; }
+
+	/** Return whether the given Timeline has cores for its ingress thread and its LXCs. */
+	bool has_helper_cores(int tl)  { return __count[tl] > 1; }
+
+	/** Pin the calling thread as the thread of the given Timeline, and prefer the memory of its node. */
+	bool pin_timeline_thread(int tl);
+
+	/** Pin the calling thread as the ingress thread of the given Timeline (see has_helper_cores()). */
+	bool pin_ingress_thread(int tl);
+
+	/** Pin the threads of the process pid and of its descendants (an LXC) to the helper cores of the given Timeline. */
+	bool pin_lxc(int pid, int tl);
+
+	/** Print the placement of every Timeline. */
+	void print(FILE* fp);
+
+private:
+	CpuPlacement() {}
+
+	/** Pin the given thread (0 for the calling one) to the helper cores of the given Timeline. */
+	bool pin_helper(int tid, int tl);
+
+	/** Pin the threads of pid and, recursively, its children; return the number of threads pinned. */
+	int pin_tree(int pid, int tl);
+
+	vector<int> __cpus;   ///< the CPUs used, node by node
+	vector<int> __node;   ///< the NUMA node of each CPU
+	vector<int> __first;  ///< the first CPU (index in __cpus) of each Timeline
+	vector<int> __count;  ///< the number of CPUs of each Timeline
+};
+
+#endif /*__PLACEMENT_H__*/
@@ -44,7 +44,7 @@ __active(0), __pri(Timeline::default_sched_pri) {
 
 Process::Process(Entity* owner, string name, void (Entity::*func)(Activation)) :
 			__owner(owner), __func(func),
-			__active(0), __pri(Timeline::default_sched_pri) {
+			__active(0), __pri(Timeline::default_sched_pri), __name(name) {
 
 	// initialization above ensures that it does not appear as though
 	// the Process was activated, and stores a default scheduling
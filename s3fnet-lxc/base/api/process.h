@@ -84,6 +84,18 @@ public:
 	/** set_pri() assigned the priority */
 	inline void set_pri(int pri)	{ __pri = pri; }
 
+	/** Returns the name of the Process, empty if it was not given one */
+	inline const string& name()		{ return __name; }
+
+	/**
+	 * set_name() names the Process for the cost report of the Process bodies
+	 * (see Interface::profile_processes) without adding it to the names
+	 * looked up on the owner, which must be unique there.  The name is best
+	 * given as the qualified name of the body, e.g. "TCPClientSession::start_timer_callback",
+	 * whose class the report rolls the costs up by.
+	 */
+	inline void set_name(const string& name) { __name = name; }
+
 	/* ***********************************************
  	 METHODS FOR INTERNAL USE AND FRIENDS
 	 ****************************************************/
@@ -118,6 +130,9 @@ protected:
 	/** cached value of owner's timeline */
 	Timeline* __alignment;
 
+	/** name given at construction or by set_name(), empty if none */
+	string __name;
+
 	/* ***********************************************
  	 STATIC STATE VARIABLES
 	 ****************************************************/
@@ -0,0 +1,399 @@
+#include <signal.h>
+#include <string.h>
+#include <unistd.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/prctl.h>
+#include <sys/wait.h>
+#include <s3f.h>
+using namespace std;
+using namespace s3f;
+
+/**
+ * \file shard.cc
+ *
+ * \brief S3F ShardGroup methods
+ *
+ * authors : Dong (Kevin) Jin
+ */
+
+namespace s3f {
+
+/* the start of the shared segment; the rings follow it */
+struct ShardSegment {
+	int               num_shards;
+	int               num_timelines;
+	pthread_barrier_t top_barrier;     ///< top barrier of the Timelines of all the shards
+	pthread_barrier_t bottom_barrier;  ///< bottom barrier of the Timelines of all the shards
+	volatile long     min_value[3];    ///< the min-reductions of three consecutive windows
+};
+
+/* a ring from a shard to a Timeline of another shard.  head and tail count
+   the bytes written and read since the start; they sit on their own cache lines */
+struct ShardRing {
+	volatile unsigned long head;     ///< written by the producer
+	char              pad1[56];
+	volatile unsigned long tail;     ///< written by the consumer
+	char              pad2[56];
+	unsigned long     sent;          ///< writes made, in the ring or waiting for room
+	unsigned long     received;      ///< writes read by the consumer
+	pthread_mutex_t   mutex;         ///< serializes the Timelines of the producing shard
+};
+
+/* a write in a ring: the header, then the packed Activation, padded to 8 bytes */
+struct ShardRecord {
+	unsigned int len;                ///< length of the record, header included
+	unsigned int key;                ///< key the target InChannel was exported with
+	unsigned int size;               ///< length of the packed Activation
+	ltime_t      time;               ///< time of the delivery
+};
+
+/* the placeholder for the Entities of a Timeline of another shard; it owns
+   the stubs of their InChannels, and is never initialized */
+class ShardStub : public Entity {
+public:
+	ShardStub(Timeline* tl) : Entity(tl) {}
+};
+
+/* the stub of an InChannel of another shard */
+class ShardStubChannel : public InChannel {
+public:
+	ShardStubChannel(Entity* stub, unsigned int key) : InChannel(stub), key(key) {}
+	unsigned int key;
+};
+
+}
+
+#define SHARD_ALIGN(x) (((x)+63) & ~63UL)
+
+// the shards forked by this process, for the SIGCHLD handler
+static pid_t* shard_pids = NULL;
+static volatile int* shard_status = NULL;
+static int shard_nchildren = 0;
+
+// a shard that fails takes the others down: they would wait for it at
+// the next barrier forever.  The forked shards die with shard 0.
+static void shard_child_exit(int) {
+	for(int i=0; i<shard_nchildren; i++) {
+		int status;
+		if( shard_status[i] < 0 && waitpid(shard_pids[i], &status, WNOHANG) == shard_pids[i] ) {
+			shard_status[i] = status;
+			if( !WIFEXITED(status) || WEXITSTATUS(status) != 0 ) {
+				const char msg[] = "ShardGroup : a shard failed, stopping the simulation\n";
+				if( write(2, msg, sizeof(msg)-1) ) {}
+				_exit(1);
+			}
+		}
+	}
+}
+
+ShardGroup* ShardGroup::create(int num_shards, int num_timelines, unsigned long ring_bytes,
+		const vector<int>& owners) {
+	assert( num_shards > 1 && (int)owners.size() == num_timelines );
+	vector<int> count(num_shards, 0);
+	for(int t=0; t<num_timelines; t++) {
+		assert( owners[t] >= 0 && owners[t] < num_shards );
+		count[owners[t]]++;
+	}
+	for(int s=0; s<num_shards; s++) {
+		if( count[s] == 0 ) {
+			printf("ShardGroup::create : shard %d of %d runs no timeline\n", s, num_shards);
+			return NULL;
+		}
+	}
+
+	ring_bytes = SHARD_ALIGN(ring_bytes);
+	unsigned long stride = SHARD_ALIGN(sizeof(ShardRing)) + ring_bytes;
+	unsigned long size = SHARD_ALIGN(sizeof(ShardSegment)) + (unsigned long)num_shards*num_timelines*stride;
+
+	// an anonymous shared mapping is inherited by the forked shards; the
+	// pages of the rings are only touched by the connections that are used
+	void* p = mmap(NULL, size, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_ANONYMOUS|MAP_NORESERVE, -1, 0);
+	if( p == MAP_FAILED ) {
+		printf("ShardGroup::create : cannot map %lu bytes for %d shards\n", size, num_shards);
+		return NULL;
+	}
+
+	ShardSegment* seg = (ShardSegment*)p;
+	seg->num_shards = num_shards;
+	seg->num_timelines = num_timelines;
+
+	pthread_barrierattr_t battr;
+	pthread_barrierattr_init(&battr);
+	pthread_barrierattr_setpshared(&battr, PTHREAD_PROCESS_SHARED);
+	pthread_barrier_init(&seg->top_barrier, &battr, num_timelines);
+	pthread_barrier_init(&seg->bottom_barrier, &battr, num_timelines);
+	pthread_barrierattr_destroy(&battr);
+	for(int i=0; i<3; i++) seg->min_value[i] = LONG_MAX;
+
+	ShardGroup* group = new ShardGroup(seg, num_shards, num_timelines, ring_bytes, owners);
+	pthread_mutexattr_t mattr;
+	pthread_mutexattr_init(&mattr);
+	pthread_mutexattr_setpshared(&mattr, PTHREAD_PROCESS_SHARED);
+	for(int s=0; s<num_shards; s++) {
+		for(int t=0; t<num_timelines; t++) {
+			ShardRing* r = group->ring(s, t);
+			r->head = r->tail = 0;
+			r->sent = r->received = 0;
+			pthread_mutex_init(&r->mutex, &mattr);
+		}
+	}
+	pthread_mutexattr_destroy(&mattr);
+	return group;
+}
+
+ShardGroup::ShardGroup(ShardSegment* seg, int num_shards, int num_timelines, unsigned long ring_bytes,
+		const vector<int>& owners) :
+			__seg(seg), __shard(0), __num_shards(num_shards), __num_timelines(num_timelines),
+			__ring_bytes(ring_bytes), __codec(NULL), __owner(owners), __overflow_bytes(0),
+			__sent(0), __received(0)
+{
+	__ring_stride = SHARD_ALIGN(sizeof(ShardRing)) + ring_bytes;
+	__stubs.resize(num_timelines, NULL);
+	__overflow.resize(num_timelines);
+}
+
+ShardRing* ShardGroup::ring(int src, unsigned int tl) {
+	char* base = (char*)__seg + SHARD_ALIGN(sizeof(ShardSegment));
+	return (ShardRing*)(base + ((unsigned long)src*__num_timelines + tl)*__ring_stride);
+}
+
+int ShardGroup::fork_shards() {
+	// whatever is buffered would be printed by every shard
+	fflush(NULL);
+
+	shard_nchildren = __num_shards-1;
+	shard_pids = new pid_t[shard_nchildren];
+	shard_status = new int[shard_nchildren];
+	for(int i=0; i<shard_nchildren; i++) shard_status[i] = -1;
+
+	// the handler is in place before the first shard can fail
+	sigset_t mask, old;
+	sigemptyset(&mask);
+	sigaddset(&mask, SIGCHLD);
+	sigprocmask(SIG_BLOCK, &mask, &old);
+	signal(SIGCHLD, shard_child_exit);
+
+	pid_t parent = getpid();
+	for(int s=1; s<__num_shards; s++) {
+		pid_t pid = fork();
+		if( pid < 0 ) {
+			printf("ShardGroup::fork_shards : cannot fork shard %d\n", s);
+			exit(1);
+		}
+		if( pid == 0 ) {
+			signal(SIGCHLD, SIG_DFL);
+			sigprocmask(SIG_SETMASK, &old, NULL);
+			prctl(PR_SET_PDEATHSIG, SIGKILL);
+			if( getppid() != parent ) _exit(1);
+			shard_nchildren = 0;
+			__shard = s;
+			return s;
+		}
+		shard_pids[s-1] = pid;
+	}
+	sigprocmask(SIG_SETMASK, &old, NULL);
+	return 0;
+}
+
+bool ShardGroup::wait_shards() {
+	if( __shard != 0 ) return true;
+
+	sigset_t mask, old;
+	sigemptyset(&mask);
+	sigaddset(&mask, SIGCHLD);
+	sigprocmask(SIG_BLOCK, &mask, &old);
+	bool ok = true;
+	for(int i=0; i<shard_nchildren; i++) {
+		int status = shard_status[i];
+		if( status < 0 && waitpid(shard_pids[i], &status, 0) != shard_pids[i] ) ok = false;
+		else if( !WIFEXITED(status) || WEXITSTATUS(status) != 0 ) ok = false;
+		shard_status[i] = status;
+	}
+	signal(SIGCHLD, SIG_DFL);
+	sigprocmask(SIG_SETMASK, &old, NULL);
+	return ok;
+}
+
+void ShardGroup::join(ShardCodec* codec) {
+	__codec = codec;
+}
+
+void ShardGroup::export_inchannel(InChannel* ic, unsigned int key) {
+	assert( is_local(ic->alignment()->s3fid()) );
+	if( key >= __exported.size() ) __exported.resize(key+1, NULL);
+	if( __exported[key] && __exported[key] != ic ) {
+		printf("ShardGroup::export_inchannel : key %u is exported twice\n", key);
+		exit(1);
+	}
+	__exported[key] = ic;
+}
+
+InChannel* ShardGroup::remote_inchannel(Timeline* tl, unsigned int key) {
+	unsigned int t = tl->s3fid();
+	assert( !is_local(t) );
+	if( !__stubs[t] ) __stubs[t] = new ShardStub(tl);
+	return new ShardStubChannel(__stubs[t], key);
+}
+
+// copy into and out of a ring, wrapping around its end
+static void ring_copy_in(unsigned char* data, unsigned long size, unsigned long pos,
+		const unsigned char* src, unsigned long len) {
+	unsigned long off = pos % size;
+	unsigned long first = MIN(len, size-off);
+	memcpy(data+off, src, first);
+	if( first < len ) memcpy(data, src+first, len-first);
+}
+
+static void ring_copy_out(const unsigned char* data, unsigned long size, unsigned long pos,
+		unsigned char* dst, unsigned long len) {
+	unsigned long off = pos % size;
+	unsigned long first = MIN(len, size-off);
+	memcpy(dst, data+off, first);
+	if( first < len ) memcpy(dst+first, data, len-first);
+}
+
+/* push a record into a ring, if there is room; the caller holds the ring mutex */
+bool ShardGroup::push(ShardRing* r, const unsigned char* rec, unsigned int len) {
+	unsigned long head = r->head;
+	unsigned long tail = __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE);
+	if( head-tail+len > __ring_bytes ) return false;
+	unsigned char* data = (unsigned char*)r + SHARD_ALIGN(sizeof(ShardRing));
+	ring_copy_in(data, __ring_bytes, head, rec, len);
+	__atomic_store_n(&r->head, head+len, __ATOMIC_RELEASE);
+	return true;
+}
+
+void ShardGroup::send(InChannel* ic, ltime_t t, Activation act) {
+	unsigned int tl = ic->alignment()->s3fid();
+	if( ic->owner() != __stubs[tl] ) {
+		printf("ShardGroup::send : entity %s is aligned to timeline %u of shard %d; "
+				"the model must map its outchannels to stubs (see remote_inchannel)\n",
+				ic->owner()->__name.c_str(), tl, owner(tl));
+		exit(1);
+	}
+
+	vector<unsigned char> buf(sizeof(ShardRecord));
+	if( !__codec || !__codec->pack_activation(act, buf) ) {
+		printf("ShardGroup::send : cannot send the activation arriving at time %ld to shard %d\n",
+				t, owner(tl));
+		exit(1);
+	}
+
+	unsigned long size = buf.size()-sizeof(ShardRecord);
+	buf.resize((buf.size()+7) & ~7UL);
+	if( buf.size() > __ring_bytes ) {
+		printf("ShardGroup::send : a write of %lu bytes does not fit in the rings of %lu bytes\n",
+				(unsigned long)buf.size(), __ring_bytes);
+		exit(1);
+	}
+	ShardRecord* rec = (ShardRecord*)&buf[0];
+	rec->len = buf.size();
+	rec->key = ((ShardStubChannel*)ic)->key;
+	rec->size = size;
+	rec->time = t;
+
+	// a write waits behind those already waiting for room in the ring
+	ShardRing* r = ring(__shard, tl);
+	pthread_mutex_lock(&r->mutex);
+	r->sent++;
+	if( !__overflow[tl].empty() || !push(r, &buf[0], buf.size()) ) {
+		__overflow[tl].insert(__overflow[tl].end(), buf.begin(), buf.end());
+		__sync_fetch_and_add(&__overflow_bytes, (long)buf.size());
+	}
+	pthread_mutex_unlock(&r->mutex);
+	__sync_fetch_and_add(&__sent, 1UL);
+}
+
+/* push the writes waiting for room into the rings as they drain; return
+   true once none is left */
+bool ShardGroup::flush() {
+	if( __overflow_bytes == 0 ) return true;
+	for(unsigned int tl=0; tl<__num_timelines; tl++) {
+		ShardRing* r = ring(__shard, tl);
+		if( pthread_mutex_trylock(&r->mutex) ) continue;
+		vector<unsigned char>& pending = __overflow[tl];
+		unsigned long done = 0;
+		while( done < pending.size() ) {
+			unsigned int len = ((ShardRecord*)&pending[done])->len;
+			if( !push(r, &pending[done], len) ) break;
+			done += len;
+		}
+		if( done > 0 ) {
+			pending.erase(pending.begin(), pending.begin()+done);
+			__sync_fetch_and_sub(&__overflow_bytes, (long)done);
+		}
+		pthread_mutex_unlock(&r->mutex);
+	}
+	return __overflow_bytes == 0;
+}
+
+void ShardGroup::receive(Timeline* tl) {
+	unsigned int me = tl->s3fid();
+	vector<unsigned char> buf;
+	for(;;) {
+		// every write of the last window is counted in sent: the producers
+		// passed the top barrier since, and none writes again before the
+		// bottom barrier, which this Timeline has not reached
+		bool done = flush();
+		bool progress = false;
+		for(int s=0; s<__num_shards; s++) {
+			if( s == __shard ) continue;
+			ShardRing* r = ring(s, me);
+			unsigned char* data = (unsigned char*)r + SHARD_ALIGN(sizeof(ShardRing));
+			unsigned long tail = r->tail;
+			unsigned long head = __atomic_load_n(&r->head, __ATOMIC_ACQUIRE);
+			while( tail < head ) {
+				ShardRecord rec;
+				ring_copy_out(data, __ring_bytes, tail, (unsigned char*)&rec, sizeof(rec));
+				buf.resize(rec.len);
+				ring_copy_out(data, __ring_bytes, tail, &buf[0], rec.len);
+				tail += rec.len;
+				__atomic_store_n(&r->tail, tail, __ATOMIC_RELEASE);
+				r->received++;
+				progress = true;
+
+				Activation act = __codec->unpack_activation(&buf[sizeof(rec)], rec.size);
+				if( !act || rec.key >= __exported.size() || !__exported[rec.key] ||
+						__exported[rec.key]->alignment() != tl ) {
+					printf("ShardGroup::receive : cannot deliver an activation from shard %d to key %u at time %ld\n",
+							s, rec.key, rec.time);
+					exit(1);
+				}
+				InChannel* ic = __exported[rec.key];
+				Event* e = new Event(EVTYPE_ACTIVATE, rec.time, 0, ic, act, NULL, tl, tl->__evtnum++);
+				EventPtr eptr(e);
+				tl->__events.push( eptr );
+				__sync_fetch_and_add(&__received, 1UL);
+			}
+			if( r->received != r->sent ) done = false;
+		}
+		if( done ) break;
+		if( !progress ) sched_yield();
+	}
+}
+
+ltime_t ShardGroup::reduce_min(Timeline* tl, ltime_t offer) {
+	// window k reduces into slot k%3.  After the barrier of window k one
+	// Timeline resets the slot of window k+2: the values of window k-1 in it
+	// were read before that barrier, and no Timeline offers a value for window
+	// k+2 before the barrier of window k+1
+	unsigned long k = tl->__shard_round++;
+	volatile long* slot = &__seg->min_value[k%3];
+	if( offer >= 0 ) {
+		long cur = *slot;
+		while( offer < cur ) {
+			long prev = __sync_val_compare_and_swap(slot, cur, (long)offer);
+			if( prev == cur ) break;
+			cur = prev;
+		}
+	}
+	int status = pthread_barrier_wait(&__seg->bottom_barrier);
+	ltime_t v = *slot;
+	if( status == PTHREAD_BARRIER_SERIAL_THREAD ) __seg->min_value[(k+2)%3] = LONG_MAX;
+	return v;
+}
+
+void ShardGroup::top_wait() {
+	pthread_barrier_wait(&__seg->top_barrier);
+}
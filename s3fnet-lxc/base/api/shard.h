@@ -0,0 +1,166 @@
+/**
+ * \file shard.h
+ *
+ * \brief S3F shards: one simulation run by several processes on one machine
+ *
+ * authors : Dong (Kevin) Jin
+ */
+
+#ifndef __SHARD_H__
+#define __SHARD_H__
+
+#ifndef __S3F_H__
+#error "shard.h can only be included by s3f.h"
+#endif
+
+/**
+ * ShardCodec packs the Activations that cross from one shard to another
+ * into bytes, and back.  The kernel knows nothing of the classes derived
+ * from Message, so the model supplies it.
+ */
+class ShardCodec {
+public:
+	virtual ~ShardCodec() {}
+
+	/** Append the bytes of the given Activation to buf; return false if it cannot be packed. */
+	virtual bool pack_activation(Activation act, vector<unsigned char>& buf) = 0;
+
+	/** Rebuild an Activation from the bytes written by pack_activation, NULL if it cannot be. */
+	virtual Activation unpack_activation(const unsigned char* buf, unsigned int len) = 0;
+};
+
+struct ShardSegment;
+struct ShardRing;
+
+/**
+ * A ShardGroup runs one simulation in several processes of the same machine,
+ * each with its own address space (and so its own allocator).  The Timelines
+ * are divided among the shards by the partition of the model (see dmlpart),
+ * and each shard builds, initializes and runs only the Entities aligned to its
+ * own Timelines.  An InChannel of an Entity of another shard is represented
+ * by a stub (see remote_inchannel), owned by a placeholder Entity of its
+ * Timeline; the model maps its OutChannels to the stubs as it would to the
+ * InChannels themselves, and gives each InChannel a key, the same in every
+ * shard, that names it in the other shards (see export_inchannel).
+ *
+ * The processes share one memory segment, mapped before they are forked.  It
+ * holds the barriers that bound the synchronization windows, shared by the
+ * Timelines of all the shards, with the min-reduction of the window edge; and
+ * a single-producer single-consumer ring for each shard and each Timeline of
+ * another shard, which carries the writes over the cross-shard connections.
+ * A write to a stub is packed (see ShardCodec) into the ring of its Timeline
+ * during the window; the target drains its rings at the start of the next
+ * window, as other Timelines do with their __window_list.  When a ring is full
+ * the writes wait in the memory of the sender and are flushed while the
+ * targets drain the rings, so the ring size only bounds how much is copied at
+ * a time.
+ */
+class ShardGroup {
+public:
+	/**
+	 * Map the shared segment for the given number of shards of a simulation
+	 * with num_timelines Timelines in all, each ring of ring_bytes bytes;
+	 * owners gives the shard that runs each Timeline.  Must be called before
+	 * any thread is created.  Returns NULL, with a message, if the segment
+	 * cannot be mapped or a shard would run no Timeline.
+	 */
+	static ShardGroup* create(int num_shards, int num_timelines, unsigned long ring_bytes,
+			const vector<int>& owners);
+
+	/**
+	 * Fork the other shards: returns the index of the shard in each process,
+	 * 0 in the calling process.  A shard that fails takes the others down.
+	 */
+	int fork_shards();
+
+	/** Wait for the other shards to finish (in shard 0); return false if one failed. */
+	bool wait_shards();
+
+	/** The index of this shard. */
+	int shard()                       { return __shard; }
+
+	/** The number of shards. */
+	int num_shards()                  { return __num_shards; }
+
+	/** The shard that runs the given Timeline. */
+	int owner(unsigned int tl)        { return __owner[tl]; }
+
+	/** Whether the given Timeline is run by this shard. */
+	bool is_local(unsigned int tl)    { return owner(tl) == __shard; }
+
+	/**
+	 * Make an InChannel of an Entity of this shard the target of the writes
+	 * the other shards make to their stubs of the given key.  Called while
+	 * the model is built, from one thread.
+	 */
+	void export_inchannel(InChannel* ic, unsigned int key);
+
+	/**
+	 * The stub of the InChannel of the given key, of an Entity aligned to
+	 * the given Timeline of another shard; a write mapped to it is delivered
+	 * to the InChannel that shard exported with the key.  Called while the
+	 * model is built, from one thread.
+	 */
+	InChannel* remote_inchannel(Timeline* tl, unsigned int key);
+
+	/** The number of writes sent to other shards, and received from them. */
+	unsigned long get_sent()          { return __sent; }
+	unsigned long get_received()      { return __received; }
+
+protected:
+	friend class Interface;
+	friend class Timeline;
+
+	ShardGroup(ShardSegment* seg, int num_shards, int num_timelines, unsigned long ring_bytes,
+			const vector<int>& owners);
+
+	/** Called by the Interface before the model is built. */
+	void join(ShardCodec* codec);
+
+	/**
+	 * Pack a write to the given InChannel, a stub on a Timeline of another
+	 * shard, into the ring of that Timeline.  The Activation is left to the
+	 * caller: an OutChannel may still clone it for its other targets.
+	 */
+	void send(InChannel* ic, ltime_t t, Activation act);
+
+	/**
+	 * Called by each Timeline of this shard at the start of a window: move
+	 * the writes the other shards made to it in the last window to its event
+	 * list, flushing meanwhile the writes of this shard that did not fit in
+	 * the rings.
+	 */
+	void receive(Timeline* tl);
+
+	/**
+	 * The bottom barrier of the Timelines of all the shards, with the
+	 * min-reduction of the values offered; a Timeline with nothing to
+	 * offer gives -1.
+	 */
+	ltime_t reduce_min(Timeline* tl, ltime_t offer);
+
+	/** The top barrier of the Timelines of all the shards. */
+	void top_wait();
+
+private:
+	ShardRing* ring(int src, unsigned int tl);
+	bool push(ShardRing* r, const unsigned char* rec, unsigned int len);
+	bool flush();
+
+	ShardSegment*   __seg;
+	int             __shard;
+	int             __num_shards;
+	unsigned int    __num_timelines;
+	unsigned long   __ring_bytes;
+	unsigned long   __ring_stride;
+	ShardCodec*     __codec;
+	vector<int>     __owner;                  ///< the shard of each Timeline
+	vector<InChannel*> __exported;            ///< the InChannels of this shard by key
+	vector<Entity*> __stubs;                  ///< the owner of the stubs of each Timeline of another shard
+	vector< vector<unsigned char> > __overflow; ///< writes waiting for room, per target Timeline
+	volatile long   __overflow_bytes;         ///< bytes waiting in __overflow
+	volatile unsigned long __sent;
+	volatile unsigned long __received;
+};
+
+#endif /*__SHARD_H__*/
@@ -1,3 +1,7 @@
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#include <typeinfo>
 #include <s3f.h>
 using namespace std;
 using namespace s3f;
@@ -11,13 +15,96 @@ using namespace s3f;
  * authors : David Nicol, Dong (Kevin) Jin
  */
 
+/* wall clock in microseconds */
+static unsigned long wall_usec()
+{
+	struct timeval tv;
+	gettimeofday(&tv, 0);
+	return (unsigned long)(tv.tv_sec*1e6+tv.tv_usec);
+}
+
+/* the cycle counter around the Process bodies; nanoseconds without a time stamp counter */
+static inline unsigned long long cycles()
+{
+#if defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (unsigned long long)ts.tv_sec*1000000000ULL + ts.tv_nsec;
+#endif
+}
+
+unsigned long long Timeline::read_cycles() { return cycles(); }
+
+/* ******************************************
+
+  unsigned int Timeline::process_cost(Process* p)
+
+  The entry of a Process is looked up by name and owner type the first
+  time it runs here, and by s3fid afterwards; the Processes created over
+  and over with the same name (per connection, per timer) share one.
+  It is looked up before the body runs, which may delete the Process.
+
+ ********************************************/
+unsigned int Timeline::process_cost(Process* p) {
+	unsigned int id = p->s3fid();
+	if( id >= __process_cost_slot.size() )
+		__process_cost_slot.resize(id+1+id/2, 0);
+	if( !__process_cost_slot[id] ) {
+		pair<string,string> key(typeid(*p->owner()).name(), p->name());
+		map<pair<string,string>, unsigned int>::iterator it = __process_cost_index.find(key);
+		if( it == __process_cost_index.end() ) {
+			__process_cost.push_back(ProcessCost(key.second, key.first, ""));
+			it = __process_cost_index.insert(make_pair(key, (unsigned int)__process_cost.size())).first;
+		}
+		__process_cost_slot[id] = it->second;
+	}
+	return __process_cost_slot[id];
+}
+
+void Timeline::switch_cost(unsigned int entry) {
+	unsigned long long now = cycles();
+	if( __cost_current ) __process_cost[__cost_current-1].cycles += now - __cost_mark;
+	__cost_mark = now;
+	__cost_current = entry;
+}
+
+/* ******************************************
+
+  unsigned int Timeline::enter_cost_section(const char* type, const char* what)
+  void Timeline::leave_cost_section(unsigned int outer)
+
+  A section is looked up by the addresses of its strings, which are those
+  of type_info names and literals; it is listed under the owner type of
+  the first Process body it is entered from.
+
+ ********************************************/
+unsigned int Timeline::enter_cost_section(const char* type, const char* what) {
+	if( !__cost_current ) return 0;
+	unsigned int outer = __cost_current;
+	pair<const char*,const char*> key(type, what);
+	map<pair<const char*,const char*>, unsigned int>::iterator it = __cost_section_index.find(key);
+	if( it == __cost_section_index.end() ) {
+		__process_cost.push_back(ProcessCost(what, __process_cost[outer-1].owner_type, type));
+		it = __cost_section_index.insert(make_pair(key, (unsigned int)__process_cost.size())).first;
+	}
+	switch_cost(it->second);
+	__process_cost[it->second-1].calls++;
+	return outer;
+}
+
+void Timeline::leave_cost_section(unsigned int outer) {
+	if( outer ) switch_cost(outer);
+}
+
 /* ******************************************
 
   Timeline::Timeline (TimelineInterface* tli) 
 
  ********************************************/
 Timeline::Timeline (TimelineInterface* tli) :
-			 __interface_control(tli), __evtnum(0)  {
+			 __interface_control(tli), __shard_round(0), __evtnum(0)  {
 
 	// mutex for Timeline state must be initialized
 	pthread_mutex_init(&timeline_inst_mutex, NULL);
@@ -35,12 +122,22 @@ Timeline::Timeline (TimelineInterface* tli) :
 	pthread_mutex_unlock(&timekeeperTimelineTimeMutex);
 
 	__window = 0;
+	__run_usec = 0;
+	__wait_usec = 0;
+	__cost_current = 0;
+	__cost_mark = 0;
+
+	// the LXC manager of the interface; a Timeline without hosts has no
+	// other way to get it
+	simCtrl = tli->lm;
 
 	// interface tells us what the timescale is, remember it                                  
 	__log_ticks_per_sec = tli->get_log_ticks_per_sec();
 
 	// -1 means no meaningful value
 	__min_sync_cross_timeline_delay = -1;              
+	__window_size = __window_base = 0;
+	__lxc_time = 0;
 	__channels_at_minimum = 0;	
 
 	// we always start in the initialization state, no process running
@@ -48,6 +145,7 @@ Timeline::Timeline (TimelineInterface* tli) :
 	__this  = NULL;
 	__activeChannel = NULL;
 	__executed = __work_executed = __sync_executed = 0;
+	__dead_executed = 0;
 	__executed_one_window = __work_executed_one_window = __sync_executed_one_window = 0;
 
 	// the default scheduling priority from the user's perspective
@@ -153,6 +251,16 @@ HandleCode Timeline::schedule(InChannel *ic, ltime_t t,
 	// if the activation is crossing timelines, do a reset to avoid
 	// thread unsafety problems
 	Timeline* tgt = ic->owner()->alignment();
+
+	// a Timeline of another shard gets the packed activation through
+	// the shared memory; there is no event here to cancel
+	ShardGroup* shards = __interface_control->shards;
+	if( shards && tgt != this && !shards->is_local(tgt->s3fid()) ) {
+		shards->send(ic, t, act);
+		__shard_sent.push_back( act );
+		return NULL;
+	}
+
 	Event* e =new Event(EVTYPE_ACTIVATE,t, 0, ic, act, NULL, tgt, __evtnum++);
 
 	// return a smart pointer to the event to be scheduled. That's the 
@@ -215,6 +323,22 @@ void  Timeline::schedule(InChannel* ic, Process* proc, bool bind, unsigned int p
 	__events.push (eptr);
 }
 
+/* **************************************************************
+
+    bool Timeline::reschedule(HandleCode h, ltime_t t)
+
+    Move a pending timeout to time t in place.  Only timeouts of
+    this timeline can be moved: they are scheduled and moved by
+    its own thread.
+
+ *****************************************************************/
+bool Timeline::reschedule(HandleCode h, ltime_t t) {
+	Event* e = (Event*)h;
+	if( !e || t < now() || e->get_home_tl() != this || e->get_evtype() != EVTYPE_TIMEOUT )
+		return false;
+	return __events.move(e, t);
+}
+
 /* **************************************************************
 
     ltime_t Timeline::next_time()
@@ -317,8 +441,33 @@ void* Timeline::thread_function() {
 		// out the interface with parameters describing
 		// the first window
 		//
+		// the control thread may hand out a task (e.g., building the model)
+		// instead of an epoch; run it and report back through the same barrier
+		//
+		if( __interface_control->get_next_action() == RUN_TASK ) {
+			__interface_control->get_task()(this, __interface_control->get_task_arg());
+#ifdef MUTEX_BARRIER
+			__interface_control->window_barrier.wait( -1 );
+#endif
+#ifdef SCHED_YIELD_BARRIER
+			__interface_control->window_barrier.wait( s3fid(), -1 );
+#endif
+#ifdef PTHREAD_BARRIER
+			pthread_barrier_wait( &(__interface_control->window_barrier) );
+#endif
+			continue;
+		}
+
 		epoch_end   = __interface_control->get_stop_before();
 
+		// a Timeline run by another shard only keeps the control thread company
+		if( __interface_control->shards && !__interface_control->shards->is_local(s3fid()) ) {
+#ifdef PTHREAD_BARRIER
+			pthread_barrier_wait( &(__interface_control->window_barrier) );
+#endif
+			continue;
+		}
+
 		printf("### Epoch %lu  ### Time %lu ### StopBefore %lu ### windowsize %lu \n", epoch_end, now(), __stop_before, __window_size);
 
 		if( __interface_control->get_next_action() == STOP_BEFORE_TIME )
@@ -336,8 +485,10 @@ void* Timeline::thread_function() {
 
 
 		// enter the loop of doing synchronization windows until the
-		// full simulation epoch is covered.
+		// full simulation epoch is covered.  The wall time outside
+		// sync_window is spent in the barriers.
 		//
+		unsigned long wait_start = wall_usec(), run_start;
 		do {
 			get_cross_timeline_events();
 
@@ -361,12 +512,16 @@ void* Timeline::thread_function() {
 						__interface_control->bottom_barrier.wait( s3fid(), this_window );
 #endif
 #ifdef PTHREAD_BARRIER
+						if( __interface_control->shards )
+							__stop_before = __interface_control->shards->reduce_min(this, this_window);
+						else {
 						int bottom_barrier_status = 0;
 						pthread_mutex_lock(&bottom_barrier_min_value_mutex);
 						if(bottom_barrier_min_value == prev_bottom_barrier_min_value || bottom_barrier_min_value > this_window) bottom_barrier_min_value = this_window;
 						pthread_mutex_unlock(&bottom_barrier_min_value_mutex);
 						bottom_barrier_status = pthread_barrier_wait( &(__interface_control->bottom_barrier) );
 						if(bottom_barrier_status == -1) prev_bottom_barrier_min_value = bottom_barrier_min_value;
+						}
 #endif
 					}
 					else //mean nothing to execute, next_time should be infinitedly large
@@ -378,6 +533,9 @@ void* Timeline::thread_function() {
 						__interface_control->bottom_barrier.wait(s3fid(), -1);
 #endif
 #ifdef PTHREAD_BARRIER
+						if( __interface_control->shards )
+							__stop_before = __interface_control->shards->reduce_min(this, -1);
+						else
 						pthread_barrier_wait( &(__interface_control->bottom_barrier) );
 #endif
 					}
@@ -397,11 +555,15 @@ void* Timeline::thread_function() {
 #ifdef PTHREAD_BARRIER
 					int bottom_barrier_status = 0;
 					ltime_t offered_min_value = MAX(__time,nxt_time) + MAX(0,__min_sync_cross_timeline_delay);
+					if( __interface_control->shards )
+						__stop_before = __interface_control->shards->reduce_min(this, offered_min_value);
+					else {
 					pthread_mutex_lock(&bottom_barrier_min_value_mutex);
 					if(bottom_barrier_min_value == prev_bottom_barrier_min_value || bottom_barrier_min_value > offered_min_value) bottom_barrier_min_value = offered_min_value;
 					pthread_mutex_unlock(&bottom_barrier_min_value_mutex);
 					bottom_barrier_status = pthread_barrier_wait( &(__interface_control->bottom_barrier) );
 					if(bottom_barrier_status == -1) prev_bottom_barrier_min_value = bottom_barrier_min_value;
+					}
 #endif
 				}
 
@@ -409,7 +571,7 @@ void* Timeline::thread_function() {
 				// __stop_before holds that value.
 				//
 #ifdef PTHREAD_BARRIER
-				__stop_before = bottom_barrier_min_value;
+				if( !__interface_control->shards ) __stop_before = bottom_barrier_min_value;
 #else
 				__stop_before = __interface_control->bottom_barrier.get_min_value();
 #endif
@@ -425,6 +587,9 @@ void* Timeline::thread_function() {
 
 			} else __stop_before = epoch_end;
 
+			// in paced real time, no window reaches more than a quantum past the last
+			if( __pacer.enabled() ) __stop_before = __pacer.edge(__stop_before);
+
 			// do the simulation work for the window.
 			//
 			change_state(RUNNING);
@@ -435,9 +600,24 @@ void* Timeline::thread_function() {
 			//printf("############ timeline %d enters sync window [%ld,%ld)\n",
 			//		s3fid(), __time, __stop_before);
 
+			run_start = wall_usec();
+			__wait_usec += run_start - wait_start;
 			sync_window();
+			wait_start = wall_usec();
+			__run_usec += wait_start - run_start;
 			change_state(BLOCKED);
 
+			// wait for the wall time of the upper edge of the window
+			if( __pacer.enabled() ) __pacer.pace(__stop_before);
+
+			// the OutChannels are done with the activations sent to other shards
+			for(unsigned int i=0; i<__shard_sent.size(); i++) {
+#ifndef SAFE_MSG_PTR
+				__shard_sent[i]->erase_all();
+#endif
+			}
+			__shard_sent.clear();
+
 			//printf("############# timeline %d finished sync window [%ld,%ld)\n",
 			//		s3fid(), __time, __stop_before);
 			
@@ -459,11 +639,15 @@ void* Timeline::thread_function() {
 #endif
 #ifdef PTHREAD_BARRIER
 				// PTHREAD_BARRIER_SERIAL_THREAD is -1
-				pthread_barrier_wait( &(__interface_control->top_barrier) );
+				if( __interface_control->shards ) __interface_control->shards->top_wait();
+				else pthread_barrier_wait( &(__interface_control->top_barrier) );
 #endif
 			}
 			else
 			{
+				// the other shards must be done writing to this one before
+				// the next epoch drains the rings
+				if( __interface_control->shards ) __interface_control->shards->top_wait();
 #ifdef MUTEX_BARRIER
 				__interface_control->window_barrier.wait(__stop_before);
 #endif
@@ -477,6 +661,7 @@ void* Timeline::thread_function() {
 			// do another synchronization window if the last one was not the epoch end
 			//
 		} while( __stop_before < epoch_end );
+		__wait_usec += wall_usec() - wait_start;
 	}
 	return (void *)NULL;
 }
@@ -539,7 +724,23 @@ void Timeline::sync_window() {
 		// enter the next epoch.
 		if (nxt_evt->get_time() <= __stop_before )
 		{
-			if (simCtrl->advanceLXCsOnTimeline(s3fid(), nxt_evt->get_time()))
+			// when the window is adapted, the LXCs advance to the next event a
+			// quantum at a time, so that the packets they send in between are
+			// scheduled before the timeline moves on
+			ltime_t target = nxt_evt->get_time();
+			if (__window_ctl.enabled())
+			{
+				if (__lxc_time < __time) __lxc_time = __time;
+				target = __window_ctl.next_target(__lxc_time, target);
+			}
+			bool advanced = simCtrl->advanceLXCsOnTimeline(s3fid(), target);
+			if (__window_ctl.enabled() && target > __lxc_time)
+			{
+				__lxc_time = target;
+				__window_ctl.advanced(this, target);
+				__window_size = MAX(__window_base, __window_ctl.quantum());
+			}
+			if (advanced || target < nxt_evt->get_time())
 			{
 				continue;
 			}
@@ -602,7 +803,15 @@ void Timeline::sync_window() {
 			// Macro to call the Process body associated with the Process pointed to
 			// by __this, passing to it the Activation carried along in the event
 			//
-			CALL_MEMBER_FN( *__this->owner(), __this->__func )(nxt_evt->get_act());
+			__this->owner()->__executed_events++;
+			if( __profile_processes ) {
+				unsigned int entry = process_cost(__this);
+				__process_cost[entry-1].calls++;
+				switch_cost(entry);
+				CALL_MEMBER_FN( *__this->owner(), __this->__func )(nxt_evt->get_act());
+				switch_cost(0);
+			} else
+				CALL_MEMBER_FN( *__this->owner(), __this->__func )(nxt_evt->get_act());
 			__this = NULL;
 
 			break;
@@ -668,7 +877,15 @@ void Timeline::sync_window() {
 			// Macro to call the Process body associated with the Process pointed to
 			// by __this, passing to it the Activation carried along in the event
 			//
-			CALL_MEMBER_FN( *ent, __this->__func)(nxt_evt->get_act());
+			ent->__executed_events++;
+			if( __profile_processes ) {
+				unsigned int entry = process_cost(__this);
+				__process_cost[entry-1].calls++;
+				switch_cost(entry);
+				CALL_MEMBER_FN( *ent, __this->__func)(nxt_evt->get_act());
+				switch_cost(0);
+			} else
+				CALL_MEMBER_FN( *ent, __this->__func)(nxt_evt->get_act());
 
 			put_activeChannel( NULL );
 			__this->put_activeChannel( NULL );
@@ -811,6 +1028,7 @@ void Timeline::sync_window() {
 		case EVTYPE_CANCEL :
 			__executed--;
 			__executed_one_window--;
+			__dead_executed++;
 			break;
 		}
 
@@ -933,8 +1151,11 @@ void Timeline::sync_window() {
 	//
 	if(__recompute_min_delay ) {
 
-		// method min_sync_cross_timeline_delay goes through all entities
-		__min_sync_cross_timeline_delay = min_sync_cross_timeline_delay(__window_size);
+		// method min_sync_cross_timeline_delay goes through all entities;
+		// the threshold is the window computed at init, since the
+		// window controller may have grown __window_size beyond the
+		// delay of some cross-timeline channels
+		__min_sync_cross_timeline_delay = min_sync_cross_timeline_delay(__window_base);
 
 		// count the number of connections whose minimum delays are
 		// exactly the Timeline's overall minimum
@@ -987,6 +1208,9 @@ void Timeline::get_cross_timeline_events() {
 
 	// if the list was not empty, it can be emptied now
 	if( num_to_do > 0 ) __window_list.clear();
+
+	// and the writes from the Timelines of other shards
+	if( __interface_control->shards ) __interface_control->shards->receive(this);
 }
 
 /* *******************************************************
@@ -1205,6 +1429,9 @@ int Timeline::default_sched_pri;
 int Timeline::min_sched_pri;
 vector<Timeline*> Timeline::timeline_adrs;
 
+// set by Interface::profile_processes, for every Timeline
+bool Timeline::__profile_processes = false;
+
 
 // total number of timelines created, used when assigning ids
 unsigned int Timeline::__num_timelines = 0;
@@ -38,6 +38,23 @@ struct OutAppointment_block {
 
 typedef struct OutAppointment_block OutAppointment;
 
+/**
+ * The cost of the bodies of the Processes of one name and owner type on one
+ * Timeline, or of one cost section of them (see Timeline::enter_cost_section),
+ * when the Process bodies are profiled (see Interface::profile_processes).
+ * The cycles are those of the body outside of the sections entered from it.
+ */
+struct ProcessCost {
+	string name;              ///< name of the Processes, empty if they were not given one; or what the section does
+	string owner_type;        ///< type_info name of the owning Entity, mangled
+	string section_type;      ///< type_info name of the object whose code the section runs, mangled; empty for a body
+	unsigned long calls;      ///< number of body executions, or of entries into the section
+	unsigned long long cycles; ///< cycles spent
+
+	ProcessCost(const string& n, const string& t, const string& st) :
+		name(n), owner_type(t), section_type(st), calls(0), cycles(0) {}
+};
+
 /** actions sometimes depend on whether the timeline is running some process,
  *  is being initialized, or during the midst of a run but the simulation is not
  *  active. TimelineState reflects these conditions.
@@ -78,6 +95,22 @@ public:
 	/** The synchronization horizon, the upper edge of the current synchronization window */
 	ltime_t           horizon()   { return __stop_before; }
 
+	/** Returns true if the Process bodies are profiled (see Interface::profile_processes). */
+	static bool profiling_processes()       { return __profile_processes; }
+
+	/**
+	 * Charge the cycles from now to the matching leave_cost_section() to a
+	 * section of its own, the code of an object of the given type (type_info
+	 * name) doing what (a static string), rather than to the Process body
+	 * running; the sections nest.  Returns what leave_cost_section() needs,
+	 * 0 if there is no Process body running to take the section from.  It
+	 * must be called on the thread of this Timeline, by a Process body.
+	 */
+	unsigned int enter_cost_section(const char* type, const char* what);
+
+	/** Return to the section or Process body the section was entered from. */
+	void leave_cost_section(unsigned int outer);
+
 	/** Reports the state of the Timeline. */
 	TimelineState   get_state()   { return __state; }
 
@@ -158,6 +191,8 @@ protected:
 	friend class Interface;
 	friend class OutChannel;
 	friend class InChannel;
+	friend class ShardGroup;
+	friend class Event;
 
 	/**
 	 *  Schedule the given process activation, at the given time,
@@ -204,6 +239,13 @@ protected:
 	 */
 	HandleCode    schedule(InChannel*, ltime_t, unsigned int, Activation);
 
+	/**
+	 *  Move the timeout with the given handle, still in the event list,
+	 *  to time t (not earlier than now), keeping its priority and its
+	 *  handle.  Return false if it is no longer pending.
+	 */
+	bool          reschedule(HandleCode, ltime_t);
+
 	/**
 	 *  In order to avoid an infinite loop where an process that was activated
 	 *  by an arrival on an inchannel calls waitOn for that inchannel AGAIN
@@ -297,6 +339,12 @@ protected:
 	unsigned long get_executed()            { return __executed;     }
 	unsigned long get_work_executed()       { return __work_executed; }
 	unsigned long get_sync_executed()       { return __sync_executed; }
+	unsigned long get_dead_executed()       { return __dead_executed; }
+	unsigned long get_windows()             { return __window;       }
+	unsigned long get_run_time()            { return __run_usec;     } ///< wall time in sync_window, in microseconds
+	unsigned long get_wait_time()           { return __wait_usec;    } ///< wall time in the window barriers, in microseconds
+	vector<ProcessCost>* get_process_cost() { return &__process_cost; } ///< cost of the Process bodies, if profiled
+	STL_EventList* get_eventlist()          { return &__events; }
 
 	/**
 	 * The heart of the thread_body is code that establishes a synchronization
@@ -349,6 +397,18 @@ private:
 
 	ltime_t          __window_size;
 
+	/** The window size computed by Interface::InitModel, which the adapted window never goes below. */
+	ltime_t          __window_base;
+
+	/** Tunes the advance quantum of the LXCs and __window_size (see WindowController). */
+	WindowController __window_ctl;
+
+	/** Keeps the windows in step with the wall clock in paced real time (see Pacer). */
+	Pacer            __pacer;
+
+	/** The time the LXCs aligned to this Timeline were last advanced to, when the window is adapted. */
+	ltime_t          __lxc_time;
+
 	/**
 	 *   After __min_sync_cross_timeline_delay is computed, we count the number of
 	 *   connections whose minimum delay values are exactly this.  Such a count
@@ -391,6 +451,37 @@ private:
 	/** This integer keeps track of the number of synchronization windows that have been completed. */
 	unsigned int     __window;
 
+	/** The wall time spent executing the windows, and waiting in the barriers between them, in microseconds. */
+	unsigned long    __run_usec;
+	unsigned long    __wait_usec;
+
+	/** Set by Interface::profile_processes: count the cycles spent in each Process body. */
+	static bool      __profile_processes;
+
+	/** The cost of the Process bodies executed here, one entry per Process name and owner type, and per section. */
+	vector<ProcessCost> __process_cost;
+
+	/** For each Process s3fid, 1 + its entry in __process_cost, 0 if it has not run here. */
+	vector<unsigned int> __process_cost_slot;
+
+	/** The entries of __process_cost of the Process bodies, by owner type and Process name. */
+	map<pair<string,string>, unsigned int> __process_cost_index;
+
+	/** The entries of __process_cost of the sections, by object type and what they do. */
+	map<pair<const char*,const char*>, unsigned int> __cost_section_index;
+
+	/** 1 + the entry of __process_cost now charged, 0 outside of the Process bodies. */
+	unsigned int     __cost_current;
+
+	/** The cycle counter when the entry now charged was last charged. */
+	unsigned long long __cost_mark;
+
+	/** Return 1 + the entry of __process_cost the body of Process p is charged to. */
+	unsigned int process_cost(Process* p);
+
+	/** Charge the cycles since __cost_mark to the current entry, and make entry the current one. */
+	void switch_cost(unsigned int entry);
+
 	InChannel*       __activeChannel;
 
 	/**
@@ -402,6 +493,16 @@ private:
 
 	/** Access to __window_list is guarded by mutex __events_mutex */
 	pthread_mutex_t  __events_mutex;
+
+	/**
+	 * Activations this Timeline wrote to the Timelines of other shards in the
+	 * current window.  They are packed when written, and erased at the end of
+	 * the window, once the OutChannels are done cloning them.
+	 */
+	vector<Activation> __shard_sent;
+
+	/** The number of windows reduced across the shards (see ShardGroup::reduce_min). */
+	unsigned long    __shard_round;
 	pthread_mutex_t  timeline_inst_mutex;
 
 	/**
@@ -451,6 +552,7 @@ private:
 	unsigned long    __executed_one_window;
 	unsigned long    __work_executed_one_window;
 	unsigned long    __sync_executed_one_window;
+	unsigned long    __dead_executed; ///< cancelled events dropped at the top of the event list
 
 	unsigned int     __evtnum;
 
@@ -483,6 +585,9 @@ public:
 	/** minimum possible scheduling priority, used only by a timeline, not a user priority */
 	static int              min_sched_pri;
 	static vector<Timeline*> timeline_adrs;
+
+	/** Read the cycle counter (the time stamp counter where there is one, nanoseconds otherwise). */
+	static unsigned long long read_cycles();
 #ifdef PTHREAD_BARRIER
 	static pthread_mutex_t bottom_barrier_min_value_mutex;
 	static ltime_t bottom_barrier_min_value;
@@ -0,0 +1,113 @@
+#include <string.h>
+#include <s3f.h>
+using namespace std;
+using namespace s3f;
+
+/**
+ * \file window_control.cc
+ *
+ * \brief S3F WindowController methods
+ *
+ * authors : Dong (Kevin) Jin
+ */
+
+namespace s3f {
+
+/* wall clock in microseconds */
+static unsigned long wall_usec()
+{
+	struct timeval tv;
+	gettimeofday(&tv, 0);
+	return (unsigned long)(tv.tv_sec*1e6+tv.tv_usec);
+}
+
+WindowController::WindowController() :
+	__bound(0), __qmin(0), __qmax(0), __quantum(0), __steps(0),
+	__last_time(0), __last_wall(0), __last_progress_time(0), __last_progress_calls(0),
+	__last_packets(0), __last_late(0), __last_lateness(0)
+{
+	memset(__curve, 0, sizeof(__curve));
+}
+
+void WindowController::configure(ltime_t bound, ltime_t qmin, ltime_t qmax, ltime_t now) {
+	__bound = bound;
+	__qmin = MAX(qmin, (ltime_t)1);
+	__qmax = MAX(qmax, __qmin);
+	// start accurate; an idle start grows the quantum quickly
+	__quantum = __qmin;
+	__steps = 0;
+	__last_time = now;
+	__last_wall = wall_usec();
+}
+
+ltime_t WindowController::next_target(ltime_t lxc_time, ltime_t evt_time) {
+	if( !enabled() || evt_time - lxc_time <= __quantum ) return evt_time;
+	return lxc_time + __quantum;
+}
+
+void WindowController::advanced(Timeline* tl, ltime_t lxc_time) {
+	if( !enabled() ) return;
+	if( ++__steps < WINDOW_CONTROL_STEPS ) return;
+	__steps = 0;
+	adjust(tl, lxc_time);
+}
+
+void WindowController::adjust(Timeline* tl, ltime_t lxc_time) {
+	long packets, late, lateness, progress_calls;
+	unsigned long progress_time;
+	tl->simCtrl->getInjectionStats(tl->s3fid(), &packets, &late, &lateness);
+	tl->simCtrl->getProgressStats(tl->s3fid(), &progress_calls, &progress_time);
+	unsigned long wall = wall_usec();
+
+	long d_packets  = packets - __last_packets;
+	long d_late     = late - __last_late;
+	long d_lateness = lateness - __last_lateness;
+	unsigned long d_wall     = wall - __last_wall;
+	unsigned long d_progress = progress_time - __last_progress_time;
+
+	// charge the interval to the quantum that was in effect
+	int k = 0;
+	while( k < WINDOW_CONTROL_POINTS-1 && ((ltime_t)2 << k) <= __quantum ) k++;
+	WindowPoint& pt = __curve[k];
+	pt.virtual_time   += lxc_time - __last_time;
+	pt.wall_time      += d_wall;
+	pt.progress_time  += d_progress;
+	pt.progress_calls += progress_calls - __last_progress_calls;
+	pt.packets        += d_packets;
+	pt.late           += d_late;
+	pt.lateness       += d_lateness;
+
+	if( d_late > 0 && d_lateness > __bound*d_late ) {
+		// too late: shrink
+		__quantum = MAX(__qmin, __quantum/2);
+	} else if( d_packets == 0 ) {
+		// the LXCs are idle: grow
+		__quantum = MIN(__qmax, 2*__quantum);
+	} else if( 2*d_lateness <= __bound*d_late ) {
+		// within half the bound: grow, faster when the progress calls dominate
+		ltime_t grown = (2*d_progress > d_wall) ? 2*__quantum : __quantum + MAX(__quantum/4, (ltime_t)1);
+		__quantum = MIN(__qmax, grown);
+	}
+
+	__last_time           = lxc_time;
+	__last_wall           = wall;
+	__last_progress_time  = progress_time;
+	__last_progress_calls = progress_calls;
+	__last_packets        = packets;
+	__last_late           = late;
+	__last_lateness       = lateness;
+}
+
+void WindowController::add_curve(WindowPoint* points) {
+	for(int k=0; k<WINDOW_CONTROL_POINTS; k++) {
+		points[k].virtual_time   += __curve[k].virtual_time;
+		points[k].wall_time      += __curve[k].wall_time;
+		points[k].progress_time  += __curve[k].progress_time;
+		points[k].progress_calls += __curve[k].progress_calls;
+		points[k].packets        += __curve[k].packets;
+		points[k].late           += __curve[k].late;
+		points[k].lateness       += __curve[k].lateness;
+	}
+}
+
+}
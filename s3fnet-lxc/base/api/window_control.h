@@ -0,0 +1,107 @@
+/**
+ * \file window_control.h
+ *
+ * \brief S3F adaptive synchronization windows for emulation Timelines
+ *
+ * authors : Dong (Kevin) Jin
+ */
+
+#ifndef __WINDOW_CONTROL_H__
+#define __WINDOW_CONTROL_H__
+
+#ifndef __S3F_H__
+#error "window_control.h can only be included by s3f.h"
+#endif
+
+/** Number of LXC advances between two adjustments of the quantum. */
+#define WINDOW_CONTROL_STEPS 8
+
+/** Number of points of the trade-off curve: one per power of two of the quantum. */
+#define WINDOW_CONTROL_POINTS 64
+
+/**
+ * One point of the trade-off curve: what the simulation did while the
+ * advance quantum was in [2^k, 2^(k+1)) clock ticks.
+ */
+struct WindowPoint {
+	ltime_t       virtual_time; ///< virtual time the LXCs advanced
+	unsigned long wall_time;    ///< wall time it took, in microseconds
+	unsigned long progress_time;///< wall time spent in progress calls, in microseconds
+	long          progress_calls;///< progress calls made
+	long          packets;      ///< packets injected from the LXCs
+	long          late;         ///< packets injected into the past of the Timeline
+	long          lateness;     ///< total time they were injected into the past
+};
+
+/**
+ * WindowController tunes, while the simulation runs, how far the LXCs of
+ * one Timeline advance in a progress call (the advance quantum) and the
+ * synchronization window the Timeline offers when it has no cross-timeline
+ * lookahead, both of which are otherwise fixed.
+ *
+ * A packet sent by an LXC while it advances is injected at the time it was
+ * sent; it lands in the past of the Timeline when the Timeline already moved
+ * beyond that time, which it does up to the next event when the LXCs advance
+ * straight to it.  Advancing the LXCs a quantum at a time bounds how late a
+ * packet can be, at the cost of more progress calls.  Every few advances the
+ * controller compares the mean lateness of the packets injected into the past
+ * with the accuracy bound: it halves the quantum when the bound is exceeded,
+ * doubles it when the LXCs are idle (no packet injected), and otherwise grows
+ * it while the lateness is within half the bound, faster when the progress
+ * calls take most of the wall time.  The window offered follows the quantum.
+ *
+ * The wall time, the progress calls and the lateness are accumulated per
+ * power of two of the quantum, which gives the trade-off between the wall
+ * time and the timing accuracy reported at the end of the run.
+ */
+class WindowController {
+public:
+	WindowController();
+
+	/**
+	 * Adapt the quantum between qmin and qmax clock ticks to keep the mean
+	 * lateness of the packets within bound ticks, from the given time on; a
+	 * bound of 0 disables the controller, and the LXCs advance straight to
+	 * the next event.
+	 */
+	void configure(ltime_t bound, ltime_t qmin, ltime_t qmax, ltime_t now);
+
+	bool    enabled() { return __bound > 0; }
+	ltime_t quantum() { return __quantum; }
+
+	/** Return the time to advance the LXCs to from lxc_time, toward the next event at evt_time. */
+	ltime_t next_target(ltime_t lxc_time, ltime_t evt_time);
+
+	/**
+	 * Record that the LXCs of the Timeline advanced to lxc_time; every
+	 * WINDOW_CONTROL_STEPS advances, sample the injection and progress
+	 * counters of the Timeline and adjust the quantum.
+	 */
+	void advanced(Timeline* tl, ltime_t lxc_time);
+
+	/** Add the trade-off curve of this controller to the given points. */
+	void add_curve(WindowPoint* points);
+
+private:
+	/** Sample the counters and adjust the quantum. */
+	void adjust(Timeline* tl, ltime_t lxc_time);
+
+	ltime_t __bound;         ///< the accuracy bound: mean lateness of the late packets
+	ltime_t __qmin;          ///< the smallest quantum
+	ltime_t __qmax;          ///< the largest quantum
+	ltime_t __quantum;       ///< the current quantum
+	int     __steps;         ///< advances since the last sample
+
+	// the counters at the last sample
+	ltime_t       __last_time;
+	unsigned long __last_wall;
+	unsigned long __last_progress_time;
+	long          __last_progress_calls;
+	long          __last_packets;
+	long          __last_late;
+	long          __last_lateness;
+
+	WindowPoint __curve[WINDOW_CONTROL_POINTS]; ///< the trade-off curve
+};
+
+#endif /*__WINDOW_CONTROL_H__*/
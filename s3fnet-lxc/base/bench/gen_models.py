@@ -0,0 +1,184 @@
+#
+# Synthetic S3FNet workloads for the scaling benchmark: no LXCs, no
+# TimeKeeper, only simulated hosts running the UDP and TCP test
+# applications.
+#
+# usage: python gen_models.py [-p pcap-file] <model> <size> <timelines> <run_time> <out.dml>
+#
+# With -p, every interface captures its frames into the given file
+# (pcapng if it ends in .pcapng), to measure the cost of the capture.
+#
+#   ring <n>    n routers in a ring, each with a LAN of 4 hosts; every
+#               host runs a TCP and a UDP client and server, the clients
+#               pick servers anywhere on the ring
+#   fattree <k> a k-ary fat tree (k even): k pods of k/2 edge and k/2
+#               aggregation routers, (k/2)^2 core routers, k^3/4 hosts
+#               running the same applications
+#   lan <n>     n shared segments of 16 hosts behind a router each, the
+#               routers on a star; all the hosts of a segment exchange
+#               UDP datagrams with each other, so every frame crosses a
+#               segment shared by 17 interfaces
+#
+# The networks are aligned round robin to the timelines (pods for the
+# fat tree, segments for the lan); the propagation delay of the links
+# between them is the lookahead. The clients wait a fixed off time
+# between two downloads. Run dmlenv on the output for the addresses and
+# routes.
+#
+
+import sys
+
+HOSTS_PER_RING_NODE = 4
+HOSTS_PER_SEGMENT = 16
+
+# the pcap attribute of every interface, empty for no capture
+PCAP = ''
+
+UDP_PORT = 10
+TCP_PORT = 20
+
+def header(timelines, run_time):
+	return 'total_timeline %d\ntick_per_second 6\nrun_time %s\nseed 0\n' % (timelines, run_time)
+
+def app_graph(udp_only):
+	# servers first so that they listen before the first clients start
+	g = '    graph [\n'
+	g += '      ProtocolSession [ name udpsrv use "S3F.OS.UDP.test.UDPServer" port %d SHOW_REPORT "false" ]\n' % UDP_PORT
+	g += '      ProtocolSession [ name udpcli use "S3F.OS.UDP.test.UDPClient" start_time 0.01 start_window 0.1'
+	g += ' file_size 20000 off_time 0.05 SHOW_REPORT "false" ]\n'
+	if not udp_only:
+		g += '      ProtocolSession [ name tcpsrv use "S3F.OS.TCP.test.TCPServer" port %d SHOW_REPORT "false" ]\n' % TCP_PORT
+		g += '      ProtocolSession [ name tcpcli use "S3F.OS.TCP.test.TCPClient" start_time 0.01 start_window 0.1'
+		g += ' file_size 100000 off_time 0.1 SHOW_REPORT "false" ]\n'
+		g += '      ProtocolSession [ name tcp use "S3F.OS.TCP" ]\n'
+	g += '      ProtocolSession [ name socket use "S3F.OS.Socket.socketMaster" ]\n'
+	g += '      ProtocolSession [ name udp use "S3F.OS.UDP" ]\n'
+	g += '      ProtocolSession [ name ip use "S3F.OS.IP" ]\n'
+	g += '    ]\n'
+	return g
+
+def router(rid, ifaces, indent='  '):
+	r = indent + 'router [ id %d graph [ ProtocolSession [ name ip use "S3F.OS.IP" ] ]\n' % rid
+	for i in ifaces:
+		r += indent + '  interface [ id %d%s bitrate 1e9 latency 0 ]\n' % (i, PCAP)
+	return r + indent + ']\n'
+
+def hosts(first, count, udp_only):
+	h = '  host [ idrange [ from %d to %d ] rng_level "protocol"\n' % (first, first+count-1)
+	h += app_graph(udp_only)
+	h += '    interface [ id 0%s bitrate 1e8 latency 0 ]\n  ]\n' % PCAP
+	return h
+
+def patterns(clients, servers, udp_only):
+	# clients and servers are lists of nhi strings
+	p = ' traffic [\n'
+	for c in clients:
+		p += '  pattern [ client %s\n' % c
+		for s in servers(c):
+			p += '   servers [ port %d nhi %s(0) list "forUDP" ]\n' % (UDP_PORT, s)
+			if not udp_only:
+				p += '   servers [ port %d nhi %s(0) list "forTCP" ]\n' % (TCP_PORT, s)
+		p += '  ]\n'
+	return p + ' ]\n'
+
+def ring(n, timelines):
+	o = ['Net [\n']
+	names = ['%d:%d' % (r, h) for r in range(n) for h in range(1, HOSTS_PER_RING_NODE+1)]
+	# every host serves the four hosts of the next ring node and one across
+	def servers(c):
+		r = int(c.split(':')[0])
+		return ['%d:%d' % ((r+1) % n, h) for h in range(1, HOSTS_PER_RING_NODE+1)] + \
+			['%d:1' % ((r+n//2) % n)]
+	o.append(patterns(names, servers, False))
+	for r in range(n):
+		o.append(' Net [ id %d alignment %d\n' % (r, r % timelines))
+		o.append(router(0, list(range(1, HOSTS_PER_RING_NODE+1)) + [100, 101]))
+		o.append(hosts(1, HOSTS_PER_RING_NODE, False))
+		for h in range(1, HOSTS_PER_RING_NODE+1):
+			o.append('  link [ attach 0(%d) attach %d(0) min_delay 1e-6 prop_delay 1e-5 ]\n' % (h, h))
+		o.append(' ]\n')
+	for r in range(n):
+		o.append(' link [ attach %d:0(100) attach %d:0(101) min_delay 1e-6 prop_delay 1e-3 ]\n' % (r, (r+1) % n))
+	o.append(']\n')
+	return ''.join(o)
+
+def fattree(k, timelines):
+	half = k//2
+	o = ['Net [\n']
+	# pod p: aggregation routers 0..half-1, edge routers half..k-1,
+	# hosts 100+e*half+i under edge router e
+	names = ['%d:%d' % (p, 100+e*half+i) for p in range(k) for e in range(half) for i in range(half)]
+	def servers(c):
+		p, h = [int(x) for x in c.split(':')]
+		return ['%d:%d' % ((p+1) % k, h), '%d:%d' % ((p+half) % k, 100+(h-100+1) % (half*half)),
+			'%d:%d' % (p, 100+(h-100+half) % (half*half))]
+	o.append(patterns(names, servers, False))
+	for p in range(k):
+		o.append(' Net [ id %d alignment %d\n' % (p, p % timelines))
+		for a in range(half):
+			# down to the edge routers, up to the core
+			o.append(router(a, list(range(half)) + list(range(100, 100+half))))
+		for e in range(half):
+			o.append(router(half+e, list(range(half)) + list(range(100, 100+half))))
+			o.append(hosts(100+e*half, half, False))
+			for i in range(half):
+				o.append('  link [ attach %d(%d) attach %d(0) min_delay 1e-6 prop_delay 1e-5 ]\n' % (half+e, i, 100+e*half+i))
+			for a in range(half):
+				o.append('  link [ attach %d(%d) attach %d(%d) min_delay 1e-6 prop_delay 1e-5 ]\n' % (a, e, half+e, 100+a))
+		o.append(' ]\n')
+	# core router a*half+j links to aggregation router a of every pod
+	o.append(' Net [ id %d alignment 0\n' % k)
+	for c in range(half*half):
+		o.append(router(c, list(range(k)), '  '))
+	o.append(' ]\n')
+	for p in range(k):
+		for a in range(half):
+			for j in range(half):
+				o.append(' link [ attach %d:%d(%d) attach %d:%d(%d) min_delay 1e-6 prop_delay 1e-4 ]\n' %
+					(p, a, 100+j, k, a*half+j, p))
+	o.append(']\n')
+	return ''.join(o)
+
+def lan(n, timelines):
+	o = ['Net [\n']
+	names = ['%d:%d' % (s, h) for s in range(n) for h in range(1, HOSTS_PER_SEGMENT+1)]
+	# all the hosts of the segment, and one of the next segment
+	def servers(c):
+		s, h = [int(x) for x in c.split(':')]
+		return ['%d:%d' % (s, x) for x in range(1, HOSTS_PER_SEGMENT+1) if x != h] + \
+			['%d:%d' % ((s+1) % n, h)]
+	o.append(patterns(names, servers, True))
+	for s in range(n):
+		o.append(' Net [ id %d alignment %d\n' % (s, s % timelines))
+		o.append(router(0, [1, 100]))
+		o.append(hosts(1, HOSTS_PER_SEGMENT, True))
+		attach = ' '.join(['attach %d(0)' % h for h in range(1, HOSTS_PER_SEGMENT+1)])
+		o.append('  link [ attach 0(1) %s min_delay 1e-6 prop_delay 1e-5 ]\n' % attach)
+		o.append(' ]\n')
+	o.append(' Net [ id %d alignment 0\n' % n)
+	o.append(router(0, list(range(n)), '  '))
+	o.append(' ]\n')
+	for s in range(n):
+		o.append(' link [ attach %d:0(100) attach %d:0(%d) min_delay 1e-6 prop_delay 1e-4 ]\n' % (s, n, s))
+	o.append(']\n')
+	return ''.join(o)
+
+MODELS = { 'ring' : ring, 'fattree' : fattree, 'lan' : lan }
+
+if __name__ == '__main__':
+	if len(sys.argv) > 2 and sys.argv[1] == '-p':
+		PCAP = ' pcap "%s"' % sys.argv[2]
+		del sys.argv[1:3]
+	if len(sys.argv) != 6 or sys.argv[1] not in MODELS:
+		sys.stderr.write('usage: %s [-p pcap-file] {ring|fattree|lan} <size> <timelines> <run_time> <out.dml>\n' % sys.argv[0])
+		sys.exit(1)
+	model, size, timelines = sys.argv[1], int(sys.argv[2]), int(sys.argv[3])
+	if model == 'fattree' and size % 2:
+		sys.stderr.write('the fat tree needs an even k\n')
+		sys.exit(1)
+	if model == 'ring' and size < 3:
+		sys.stderr.write('the ring needs at least 3 routers\n')
+		sys.exit(1)
+	with open(sys.argv[5], 'w') as f:
+		f.write(header(timelines, sys.argv[4]))
+		f.write(MODELS[model](size, timelines))
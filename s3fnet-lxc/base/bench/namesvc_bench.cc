@@ -0,0 +1,174 @@
+/**
+ * \file namesvc_bench.cc
+ * \brief Micro-benchmark for the name service tables.
+ *
+ * Builds the tables of the name service for a synthetic network (nets
+ * of hosts, each host with a few interfaces) twice: with the interned
+ * NameTable and IPIndex used by NameService, and with the string-keyed
+ * std::map layout it used before. Reports the heap memory taken by
+ * each, and the time per lookup of an NHI address to its IP address,
+ * of an IP address to its interface, and of an IP address back to its
+ * NHI address.
+ *
+ * usage: namesvc_bench [nets] [hosts_per_net] [ifaces_per_host] [lookups]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <malloc.h>
+#include <sys/time.h>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "env/name_table.h"
+
+using s3f::s3fnet::NameTable;
+using s3f::s3fnet::IPIndex;
+typedef unsigned int IPADDR;
+
+static double wall_usec()
+{
+  struct timeval tv;
+  gettimeofday(&tv, 0);
+  return tv.tv_sec*1e6 + tv.tv_usec;
+}
+
+// bytes in use, including the large blocks malloc takes with mmap
+static size_t heap_bytes()
+{
+#if __GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33)
+  struct mallinfo2 mi = mallinfo2();
+  return mi.uordblks + mi.hblkhd;
+#else
+  struct mallinfo mi = mallinfo();
+  return (unsigned)mi.uordblks + (unsigned)mi.hblkhd;
+#endif
+}
+
+// the nhi address and the ip address of the k-th interface
+static void make_nic(int k, int hosts, int ifaces, char* nhi, IPADDR* ip)
+{
+  int i = k%ifaces, h = (k/ifaces)%hosts, n = k/ifaces/hosts;
+  sprintf(nhi, "%d:%d(%d)", n, h, i);
+  *ip = (10u << 24) + (unsigned)k*4 + 1;
+}
+
+// the layout of the name service before the tables were interned
+struct MapTables {
+  std::map<std::string, IPADDR> nhi2ip;
+  std::map<IPADDR, std::string> ip2nicnhi;
+  std::map<IPADDR, void*> ip2iface;
+  std::map<std::string, std::string> hostnhi2align;
+};
+
+// the layout of the name service now
+struct FlatTables {
+  struct Info { IPADDR ip; int align; void* iface; };
+  NameTable nhis;
+  NameTable aligns;
+  std::vector<Info> info;
+  IPIndex ip2nic;
+};
+
+int main(int argc, char** argv)
+{
+  int nets    = (argc > 1) ? atoi(argv[1]) : 1000;
+  int hosts   = (argc > 2) ? atoi(argv[2]) : 100;
+  int ifaces  = (argc > 3) ? atoi(argv[3]) : 2;
+  int lookups = (argc > 4) ? atoi(argv[4]) : 1000000;
+  if(nets <= 0 || hosts <= 0 || ifaces <= 0 || lookups <= 0)
+  {
+    fprintf(stderr, "usage: %s [nets] [hosts_per_net] [ifaces_per_host] [lookups]\n", argv[0]);
+    return 1;
+  }
+  int nics = nets*hosts*ifaces;
+  printf("namesvc_bench: %d nets, %d hosts/net, %d ifaces/host (%d interfaces)\n", nets, hosts, ifaces, nics);
+
+  char nhi[64], align[32];
+  IPADDR ip;
+
+  size_t m0 = heap_bytes();
+  MapTables* mt = new MapTables;
+  for(int k = 0; k < nics; k++)
+  {
+    make_nic(k, hosts, ifaces, nhi, &ip);
+    mt->nhi2ip.insert(std::make_pair(std::string(nhi), ip));
+    mt->ip2nicnhi.insert(std::make_pair(ip, std::string(nhi)));
+    mt->ip2iface.insert(std::make_pair(ip, (void*)mt));
+    if(k%ifaces == 0)
+    {
+      sprintf(align, "%d", k/ifaces/hosts % 64);
+      mt->hostnhi2align.insert(std::make_pair(std::string(nhi, strchr(nhi, '(')-nhi), std::string(align)));
+    }
+  }
+  size_t m1 = heap_bytes();
+
+  FlatTables* ft = new FlatTables;
+  for(int k = 0; k < nics; k++)
+  {
+    make_nic(k, hosts, ifaces, nhi, &ip);
+    if(k%ifaces == 0)
+    {
+      sprintf(align, "%d", k/ifaces/hosts % 64);
+      FlatTables::Info hi = { ip, ft->aligns.intern(align), 0 };
+      ft->nhis.intern(nhi, strchr(nhi, '(')-nhi);
+      ft->info.push_back(hi);
+    }
+    FlatTables::Info ni = { ip, -1, ft };
+    int id = ft->nhis.intern(nhi);
+    ft->info.push_back(ni);
+    ft->ip2nic.insert(ip, id);
+  }
+  size_t m2 = heap_bytes();
+
+  printf("memory: std::map %.1f MB (%.0f bytes/interface), interned %.1f MB (%.0f bytes/interface)\n",
+	 (m1-m0)/1048576.0, (double)(m1-m0)/nics, (m2-m1)/1048576.0, (double)(m2-m1)/nics);
+
+  // the same random sequence of interfaces for both layouts
+  std::vector<int> keys(lookups);
+  for(int i = 0; i < lookups; i++) keys[i] = rand()%nics;
+  std::vector<std::string> strkeys(lookups);
+  std::vector<IPADDR> ipkeys(lookups);
+  for(int i = 0; i < lookups; i++)
+  {
+    make_nic(keys[i], hosts, ifaces, nhi, &ip);
+    strkeys[i] = nhi;
+    ipkeys[i] = ip;
+  }
+
+  int errors = 0;
+  unsigned long sum = 0;
+  double t0 = wall_usec();
+  for(int i = 0; i < lookups; i++) sum += mt->nhi2ip.find(strkeys[i])->second;
+  double t1 = wall_usec();
+  for(int i = 0; i < lookups; i++) sum -= ft->info[ft->nhis.lookup(strkeys[i].c_str())].ip;
+  double t2 = wall_usec();
+  if(sum) errors++;
+  printf("nhi2ip:    std::map %.1f ns, interned %.1f ns\n", 1e3*(t1-t0)/lookups, 1e3*(t2-t1)/lookups);
+
+  void* p = 0;
+  t0 = wall_usec();
+  for(int i = 0; i < lookups; i++) p = mt->ip2iface.find(ipkeys[i])->second;
+  t1 = wall_usec();
+  if(p != mt) errors++;
+  for(int i = 0; i < lookups; i++) p = ft->info[ft->ip2nic.find(ipkeys[i])].iface;
+  t2 = wall_usec();
+  if(p != ft) errors++;
+  printf("ip2iface:  std::map %.1f ns, interned %.1f ns\n", 1e3*(t1-t0)/lookups, 1e3*(t2-t1)/lookups);
+
+  size_t len = 0;
+  t0 = wall_usec();
+  for(int i = 0; i < lookups; i++) len += strlen(mt->ip2nicnhi.find(ipkeys[i])->second.c_str());
+  t1 = wall_usec();
+  for(int i = 0; i < lookups; i++) len -= strlen(ft->nhis.name(ft->ip2nic.find(ipkeys[i])));
+  t2 = wall_usec();
+  if(len) errors++;
+  printf("ip2nicnhi: std::map %.1f ns, interned %.1f ns\n", 1e3*(t1-t0)/lookups, 1e3*(t2-t1)/lookups);
+
+  delete mt;
+  delete ft;
+  if(errors) printf("%d errors\n", errors);
+  return errors ? 1 : 0;
+}
@@ -0,0 +1,72 @@
+#!/bin/bash
+#
+# Cost of the pcap capture: runs the synthetic S3FNet workloads of
+# gen_models.py with and without a pcap attribute on every interface,
+# a few times each, and prints the median events/sec of both and the
+# throughput lost to the capture. The runtime measurements of every run
+# are written to out.json as one JSON array.
+#
+# usage: ./pcap_overhead.sh [timelines] [runs] [out.json]
+#
+# The sizes and the simulated time of each workload can be changed
+# through the environment: RING_SIZE, FATTREE_K, LAN_SEGMENTS and
+# NET_TIME.
+#
+
+TIMELINES=${1:-2}
+NRUNS=${2:-5}
+OUT=${3:-pcap_overhead.json}
+
+RING_SIZE=${RING_SIZE:-16}
+FATTREE_K=${FATTREE_K:-4}
+LAN_SEGMENTS=${LAN_SEGMENTS:-8}
+NET_TIME=${NET_TIME:-2}
+
+BENCH_DIR=$(cd "$(dirname "$0")" && pwd)
+S3FNET_DIR=$BENCH_DIR/../s3fnet
+MODEL_DIR=$BENCH_DIR/pcap-models
+RUNS=$MODEL_DIR/runs.json
+
+if [ ! -x $S3FNET_DIR/s3fnet ] || [ ! -x $S3FNET_DIR/dmlenv ]; then
+	echo "build s3fnet and dmlenv first"
+	exit 1
+fi
+
+mkdir -p $MODEL_DIR
+rm -f $RUNS
+
+# the median events/sec of the runs of a model in $RUNS
+median_rate() {
+	python -c "
+import json, sys
+r = sorted(json.loads(l)['events_per_sec'] for l in open('$RUNS') if json.loads(l)['model'].endswith('/$1.dml'))
+print(r[len(r)//2] if r else 0)"
+}
+
+for model in "ring $RING_SIZE" "fattree $FATTREE_K" "lan $LAN_SEGMENTS"; do
+	set -- $model
+	name=$1-$2-$TIMELINES
+	python $BENCH_DIR/gen_models.py $1 $2 $TIMELINES $NET_TIME $MODEL_DIR/$name.dml || exit 1
+	python $BENCH_DIR/gen_models.py -p $MODEL_DIR/$name.pcapng $1 $2 $TIMELINES $NET_TIME $MODEL_DIR/$name-pcap.dml || exit 1
+	# the capture does not change the addresses or the routes
+	$S3FNET_DIR/dmlenv -b 10.10.0.0 $MODEL_DIR/$name.dml > $MODEL_DIR/$name-env.dml 2>/dev/null &&
+		$S3FNET_DIR/dmlenv -r all $MODEL_DIR/$name.dml > $MODEL_DIR/$name-rt.dml 2>/dev/null || {
+		echo "dmlenv failed on $name.dml"
+		continue
+	}
+	for r in $(seq 1 $NRUNS); do
+		for m in $name $name-pcap; do
+			$S3FNET_DIR/s3fnet -j $RUNS $MODEL_DIR/$m.dml $MODEL_DIR/$name-env.dml $MODEL_DIR/$name-rt.dml \
+				> $MODEL_DIR/$m.log 2>&1 || echo "  failed, see $MODEL_DIR/$m.log"
+		done
+	done
+	base=$(median_rate $name)
+	pcap=$(median_rate $name-pcap)
+	python -c "print('%-16s %12.0f evts/s, %12.0f evts/s with pcap on every interface: %+.1f%%' % \
+		('$name', $base, $pcap, 100.0*($pcap-$base)/$base if $base else 0))"
+	grep "^pcap:.*captured" $MODEL_DIR/$name-pcap.log
+done
+
+# one JSON array of all the runs
+(echo "["; sed '$!s/$/,/' $RUNS; echo "]") > $OUT
+echo "measurements of $(cat $RUNS | wc -l) runs written to $OUT"
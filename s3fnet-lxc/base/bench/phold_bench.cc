@@ -0,0 +1,174 @@
+/**
+ * \file phold_bench.cc
+ * \brief PHOLD scaling benchmark on raw S3F entities and channels.
+ *
+ * Builds a PHOLD model directly on the S3F API, without S3FNet, LXCs
+ * or TimeKeeper: the nodes are Entities spread round robin over the
+ * timelines, each with one InChannel and one OutChannel mapped to a
+ * fixed random set of other nodes with the lookahead as the transfer
+ * delay. A number of jobs start on each node; a job arriving on a node
+ * waits an exponential think time there and moves on to one of the
+ * node's targets, chosen at random. The targets are on another
+ * timeline with the given probability, which sets how much of the
+ * traffic crosses the synchronization barriers.
+ *
+ * At the end, prints the runtime measurements of the engine and, with
+ * -j, appends them as a JSON object to the given file.
+ *
+ * usage: phold_bench [-j json-file] timelines [nodes] [sim_time]
+ *          [fanout] [remote] [jobs] [think_us] [lookahead_us]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <s3f.h>
+
+/** A job moving among the nodes; it is never copied. */
+class PholdJob : public Message {
+public:
+  PholdJob(int id) : hops(0), job_id(id) {}
+  virtual PholdJob* clone() { return new PholdJob(job_id); }
+  long hops;   ///< nodes visited
+  int job_id;  ///< unique job id
+};
+
+/** A PHOLD node: think for a while on each job, then pass it to a target. */
+class PholdNode : public Entity {
+public:
+  PholdNode(Timeline* tl, int id, int jobs, ltime_t think, ltime_t lookahead);
+
+  /** Map the OutChannel to the InChannels of the targets and start the jobs. */
+  virtual void init();
+
+  /** A job arrives: think. */
+  void arrive(Activation ac);
+
+  /** Done thinking: pass the job on. */
+  void depart(Activation ac);
+
+  vector<int> targets;   ///< the nodes this one sends to
+  InChannel* ic;         ///< where the jobs arrive
+  OutChannel* oc;        ///< mapped to the InChannel of every target
+
+private:
+  Process* arrive_proc;
+  Process* depart_proc;
+  Random::RNG rng;       ///< a counter-based stream of its own, no lock
+  int myid;
+  int jobs;
+  double think_mean;     ///< in ticks
+  ltime_t lookahead;
+};
+
+static vector<PholdNode*> nodes;
+
+PholdNode::PholdNode(Timeline* tl, int id, int njobs, ltime_t think, ltime_t la) :
+  Entity(tl), rng(0x5048u, id), myid(id), jobs(njobs), think_mean(think), lookahead(la)
+{
+  ic = new InChannel(this);
+  oc = new OutChannel(this, 0);
+  arrive_proc = new Process(this, (void (s3f::Entity::*)(s3f::Activation))&PholdNode::arrive);
+  depart_proc = new Process(this, (void (s3f::Entity::*)(s3f::Activation))&PholdNode::depart);
+  ic->bind(arrive_proc);
+}
+
+void PholdNode::init()
+{
+  for(unsigned i=0; i<targets.size(); i++)
+    oc->mapto(nodes[targets[i]]->ic, lookahead);
+  for(int j=0; j<jobs; j++)
+    waitFor(depart_proc, Activation(new PholdJob(myid*jobs+j)), (ltime_t)rng.Exponential(think_mean));
+}
+
+void PholdNode::arrive(Activation ac)
+{
+  ((PholdJob*)ac)->hops++;
+  waitFor(depart_proc, ac, (ltime_t)rng.Exponential(think_mean));
+}
+
+void PholdNode::depart(Activation ac)
+{
+  int tgt = targets[(int)(rng.Random()*targets.size())];
+  oc->write_to(nodes[tgt]->ic, ac, 0, Timeline::default_sched_pri);
+}
+
+/** The PHOLD model: the nodes and their random targets. */
+class PholdInterface : public Interface {
+public:
+  PholdInterface(int tl) : Interface(tl, 6) {}
+
+  void BuildModel(int num_nodes, int fanout, double remote, int jobs, ltime_t think, ltime_t lookahead)
+  {
+    pthread_mutex_init(&RNGS::RngStream::nextState_lock, NULL);
+    int ntl = get_numTimelines();
+    for(int i=0; i<num_nodes; i++)
+      nodes.push_back(new PholdNode(get_Timeline(i%ntl), i, jobs, think, lookahead));
+
+    // the targets on the same timeline are i+k*ntl, the others anything else
+    Random::RNG rng(0x5048u, num_nodes);
+    int local = (num_nodes+ntl-1)/ntl;
+    for(int i=0; i<num_nodes; i++)
+    {
+      for(int f=0; f<fanout; f++)
+      {
+	int tgt;
+	if(ntl == 1 || rng.Random() >= remote)
+	  tgt = (i + ntl*(int)(rng.Random()*local)) % num_nodes;
+	else
+	  do tgt = (int)(rng.Random()*num_nodes); while(tgt%ntl == i%ntl);
+	nodes[i]->targets.push_back(tgt);
+      }
+    }
+  }
+};
+
+int main(int argc, char** argv)
+{
+  char* jsonfile = 0;
+  int c;
+  while((c = getopt(argc, argv, "j:")) != -1)
+    if(c == 'j') jsonfile = optarg;
+  argc -= optind-1;
+  argv += optind-1;
+
+  int timelines = argc > 1 ? atoi(argv[1]) : 0;
+  int num_nodes = argc > 2 ? atoi(argv[2]) : 1024;
+  double sim_time = argc > 3 ? atof(argv[3]) : 0.1;
+  int fanout = argc > 4 ? atoi(argv[4]) : 8;
+  double remote = argc > 5 ? atof(argv[5]) : 0.5;
+  int jobs = argc > 6 ? atoi(argv[6]) : 4;
+  double think_us = argc > 7 ? atof(argv[7]) : 100;
+  double lookahead_us = argc > 8 ? atof(argv[8]) : 50;
+  if(timelines < 1 || num_nodes < timelines || fanout < 1 || sim_time <= 0 || lookahead_us < 1)
+  {
+    fprintf(stderr, "usage: phold_bench [-j json-file] timelines [nodes] [sim_time] "
+	    "[fanout] [remote] [jobs] [think_us] [lookahead_us]\n");
+    return 1;
+  }
+  printf("phold_bench: %d timelines, %d nodes, %g sim seconds, fanout %d, %g remote, %d jobs per node, "
+	 "think %g us, lookahead %g us\n",
+	 timelines, num_nodes, sim_time, fanout, remote, jobs, think_us, lookahead_us);
+
+  // microsecond clock
+  PholdInterface inf(timelines);
+  inf.BuildModel(num_nodes, fanout, remote, jobs, (ltime_t)think_us, (ltime_t)lookahead_us);
+  inf.InitModel();
+  inf.advance(STOP_BEFORE_TIME, (ltime_t)(sim_time*1e6));
+  inf.runtime_measurements();
+
+  if(jsonfile)
+  {
+    FILE* fp = fopen(jsonfile, "a");
+    if(!fp)
+    {
+      fprintf(stderr, "phold_bench: can't open %s\n", jsonfile);
+      return 1;
+    }
+    char model[64];
+    sprintf(model, "phold-%d", num_nodes);
+    inf.write_measurements(fp, model);
+    fclose(fp);
+  }
+  return 0;
+}
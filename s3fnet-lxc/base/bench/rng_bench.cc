@@ -0,0 +1,106 @@
+/**
+ * \file rng_bench.cc
+ * \brief Micro-benchmark for the random number streams.
+ *
+ * Creates a number of streams, as the hosts of a model do at startup,
+ * with the MRG32k3a package (RngStream, which advances a shared seed
+ * under a lock) and with the counter-based Philox streams (keyed by a
+ * hash of the host name). Then draws uniform numbers from one stream
+ * of each kind, one at a time and in batches, and fills an array of
+ * exponential inter-arrival times in batches. Reports the time per
+ * stream created and per number drawn.
+ *
+ * usage: rng_bench [streams] [draws] [batch]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+#include <vector>
+
+#include "rng/rng.h"
+
+static double wall_usec()
+{
+  struct timeval tv;
+  gettimeofday(&tv, 0);
+  return tv.tv_sec*1e6 + tv.tv_usec;
+}
+
+// draw n numbers from the rng, one at a time or in batches, and
+// return the time per number in nanoseconds
+static double draw(Random::RNG* rng, int n, int batch, double* buf, double* sum)
+{
+  double t0 = wall_usec();
+  if(batch <= 1)
+  {
+    for(int i=0; i<n; i++) *sum += rng->Random();
+  }
+  else
+  {
+    for(int i=0; i<n; i+=batch)
+    {
+      rng->Random(buf, batch);
+      for(int j=0; j<batch; j++) *sum += buf[j];
+    }
+  }
+  return 1e3*(wall_usec()-t0)/n;
+}
+
+static double draw_exponential(Random::RNG* rng, int n, int batch, double* buf, double* sum)
+{
+  double t0 = wall_usec();
+  for(int i=0; i<n; i+=batch)
+  {
+    rng->Exponential(0.2, buf, batch);
+    for(int j=0; j<batch; j++) *sum += buf[j];
+  }
+  return 1e3*(wall_usec()-t0)/n;
+}
+
+int main(int argc, char** argv)
+{
+  int streams = argc > 1 ? atoi(argv[1]) : 100000;
+  int draws = argc > 2 ? atoi(argv[2]) : 20000000;
+  int batch = argc > 3 ? atoi(argv[3]) : 256;
+  if(streams < 1 || draws < 1 || batch < 2)
+  {
+    fprintf(stderr, "usage: %s [streams] [draws] [batch]\n", argv[0]);
+    return 1;
+  }
+  draws -= draws % batch;
+  printf("rng_bench: %d streams, %d draws, batch of %d\n", streams, draws, batch);
+
+  pthread_mutex_init(&RNGS::RngStream::nextState_lock, NULL);
+
+  // stream creation
+  std::vector<Random::RNG*> mrg, philox;
+  char name[32];
+  double t0 = wall_usec();
+  for(int i=0; i<streams; i++) mrg.push_back(new Random::RNG());
+  double t1 = wall_usec();
+  for(int i=0; i<streams; i++)
+  {
+    sprintf(name, "%d:%d", i/64, i%64);
+    philox.push_back(new Random::RNG(RNGS::PhiloxStream::HashKey(name, 0), 0));
+  }
+  double t2 = wall_usec();
+  printf("create:      mrg32k3a %.1f ns, philox %.1f ns\n", 1e3*(t1-t0)/streams, 1e3*(t2-t1)/streams);
+
+  // draws
+  double* buf = new double[batch];
+  double sum = 0;
+  double ms = draw(mrg[0], draws, 1, buf, &sum);
+  double mb = draw(mrg[0], draws, batch, buf, &sum);
+  double ps = draw(philox[0], draws, 1, buf, &sum);
+  double pb = draw(philox[0], draws, batch, buf, &sum);
+  printf("uniform:     mrg32k3a %.2f ns (batch %.2f ns), philox %.2f ns (batch %.2f ns)\n", ms, mb, ps, pb);
+
+  double me = draw_exponential(mrg[0], draws, batch, buf, &sum);
+  double pe = draw_exponential(philox[0], draws, batch, buf, &sum);
+  printf("exponential: mrg32k3a %.2f ns, philox %.2f ns (batch)\n", me, pe);
+
+  // the sum keeps the draws from being optimized away
+  printf("(checksum %g)\n", sum);
+  return 0;
+}
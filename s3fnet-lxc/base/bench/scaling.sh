@@ -0,0 +1,62 @@
+#!/bin/bash
+#
+# Scaling sweep: runs PHOLD (phold_bench) and the synthetic S3FNet
+# workloads of gen_models.py on 1..max_timelines timelines, and writes
+# the runtime measurements of every run (events/sec, windows/sec,
+# barrier wait share, peak RSS) to out.json as one JSON array.
+#
+# usage: ./scaling.sh [max_timelines] [out.json]
+#
+# The sizes and the simulated time of each workload can be changed
+# through the environment: PHOLD_NODES, PHOLD_TIME, RING_SIZE,
+# FATTREE_K, LAN_SEGMENTS and NET_TIME.
+#
+
+MAX_TIMELINES=${1:-4}
+OUT=${2:-scaling.json}
+
+PHOLD_NODES=${PHOLD_NODES:-1024}
+PHOLD_TIME=${PHOLD_TIME:-0.1}
+RING_SIZE=${RING_SIZE:-16}
+FATTREE_K=${FATTREE_K:-4}
+LAN_SEGMENTS=${LAN_SEGMENTS:-8}
+NET_TIME=${NET_TIME:-2}
+
+BENCH_DIR=$(cd "$(dirname "$0")" && pwd)
+S3FNET_DIR=$BENCH_DIR/../s3fnet
+MODEL_DIR=$BENCH_DIR/scaling-models
+RUNS=$MODEL_DIR/runs.json
+
+if [ ! -x $S3FNET_DIR/s3fnet ] || [ ! -x $S3FNET_DIR/dmlenv ] || [ ! -x $BENCH_DIR/phold_bench ]; then
+	echo "build s3fnet, dmlenv and phold_bench first"
+	exit 1
+fi
+
+mkdir -p $MODEL_DIR
+rm -f $RUNS
+
+for t in $(seq 1 $MAX_TIMELINES); do
+	echo "== $t timeline(s)"
+
+	echo "  phold, $PHOLD_NODES nodes"
+	$BENCH_DIR/phold_bench -j $RUNS $t $PHOLD_NODES $PHOLD_TIME > $MODEL_DIR/phold-$t.log 2>&1 ||
+		echo "    failed, see $MODEL_DIR/phold-$t.log"
+
+	for model in "ring $RING_SIZE" "fattree $FATTREE_K" "lan $LAN_SEGMENTS"; do
+		set -- $model
+		name=$MODEL_DIR/$1-$2-$t
+		echo "  $1 $2"
+		python $BENCH_DIR/gen_models.py $1 $2 $t $NET_TIME $name.dml || exit 1
+		$S3FNET_DIR/dmlenv -b 10.10.0.0 $name.dml > $name-env.dml 2>/dev/null &&
+			$S3FNET_DIR/dmlenv -r all $name.dml > $name-rt.dml 2>/dev/null || {
+			echo "    dmlenv failed on $name.dml"
+			continue
+		}
+		$S3FNET_DIR/s3fnet -j $RUNS $name.dml $name-env.dml $name-rt.dml > $name.log 2>&1 ||
+			echo "    failed, see $name.log"
+	done
+done
+
+# one JSON array of all the runs
+(echo "["; sed '$!s/$/,/' $RUNS; echo "]") > $OUT
+echo "measurements of $(cat $RUNS | wc -l) runs written to $OUT"
@@ -0,0 +1,161 @@
+/**
+ * \file tcp_bench.cc
+ * \brief Micro-benchmark for the TCP SACK scoreboard and receive window.
+ *
+ * Replays lossy, reordered segment sequences against TCPBlockList (as
+ * used for the sender and receiver SACK scoreboards) and against
+ * TCPRecvWindow (reassembly of real and fake data), checks the
+ * results against a simple reference model, and reports the time
+ * spent per segment.
+ *
+ * usage: tcp_bench [segments] [window_segments] [loss_percent] [seed]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <vector>
+#include <algorithm>
+
+#include "os/tcp/tcp_blocks.h"
+#include "os/tcp/tcp_rcvwnd.h"
+#include "os/base/data_message.h"
+
+using s3f::s3fnet::uint32;
+using s3f::s3fnet::TCPBlockList;
+using s3f::s3fnet::TCPRecvWindow;
+using s3f::s3fnet::DataMessage;
+
+#define BENCH_MSS 1460
+
+static double wall_usec()
+{
+  struct timeval tv;
+  gettimeofday(&tv, 0);
+  return tv.tv_sec*1e6 + tv.tv_usec;
+}
+
+// the byte at the given sequence number of the test stream
+static inline unsigned char stream_byte(uint32 seqno) { return (unsigned char)(seqno*2654435761u >> 24); }
+
+/*
+ * Build the arrival order of the segments: each window of segments is
+ * shuffled, a fraction of them is lost and retransmitted at the end
+ * of the next window, so the receiver always holds many holes.
+ */
+static void make_arrivals(int nsegs, int wnd, int loss, std::vector<int>& order)
+{
+  std::vector<int> lost;
+  for(int base = 0; base < nsegs; base += wnd)
+  {
+    std::vector<int> w;
+    for(int i = base; i < base+wnd && i < nsegs; i++)
+    {
+      if(rand()%100 < loss) lost.push_back(i);
+      else w.push_back(i);
+    }
+    std::random_shuffle(w.begin(), w.end());
+    order.insert(order.end(), w.begin(), w.end());
+    order.insert(order.end(), lost.begin(), lost.end());
+    lost.clear();
+  }
+}
+
+static int bench_scoreboard(std::vector<int>& order)
+{
+  TCPBlockList rcv(TCPBlockList::PATTERN_UNSORTED);
+  TCPBlockList snd(TCPBlockList::PATTERN_INCREASE);
+  uint32 sack[8];
+  uint32 cumack = 0;
+  std::vector<bool> got(order.size(), false);
+  int errors = 0;
+
+  double t0 = wall_usec();
+  for(size_t k = 0; k < order.size(); k++)
+  {
+    uint32 seqno = order[k]*BENCH_MSS;
+    uint32 length = BENCH_MSS;
+    got[order[k]] = true;
+    while(cumack/BENCH_MSS < got.size() && got[cumack/BENCH_MSS]) cumack += BENCH_MSS;
+
+    // receiver side: record the segment, then build the sack option
+    if(rcv.is_new(&seqno, &length)) rcv.insert_block(seqno, length);
+    rcv.clear_blocks(cumack);
+    int n = rcv.fetch_blocks(sack, 4);
+
+    // sender side: apply the ack and the sack blocks, look for a hole
+    snd.clear_blocks(cumack);
+    for(int i = 0; i < n; i++) snd.insert_block(sack[2*i], sack[2*i+1]-sack[2*i]);
+    uint32 hole = snd.unavailable(cumack);
+
+    // the sack blocks never cover the cumulative ack point
+    if(n > 0 && (sack[0] < cumack || hole != cumack)) errors++;
+  }
+  double t1 = wall_usec();
+
+  if(!rcv.empty() || cumack != order.size()*BENCH_MSS) errors++;
+  printf("scoreboard: %lu segments, %.1f ns/segment, %d errors\n",
+	 (unsigned long)order.size(), 1e3*(t1-t0)/order.size(), errors);
+  return errors;
+}
+
+static int bench_reassembly(std::vector<int>& order, bool real)
+{
+  uint32 total = order.size()*BENCH_MSS;
+  TCPRecvWindow rcvwnd(0, total);
+  unsigned char* out = new unsigned char[total];
+  uint32 delivered = 0;
+  int errors = 0;
+
+  double t0 = wall_usec();
+  for(size_t k = 0; k < order.size(); k++)
+  {
+    uint32 seqno = order[k]*BENCH_MSS;
+    unsigned char* data = 0;
+    if(real)
+    {
+      data = new unsigned char[BENCH_MSS];
+      for(uint32 i = 0; i < BENCH_MSS; i++) data[i] = stream_byte(seqno+i);
+    }
+    DataMessage msg(BENCH_MSS, data);
+    rcvwnd.addToBuffer(&msg, seqno);
+    delivered += rcvwnd.generate(total-delivered, out+delivered);
+  }
+  double t1 = wall_usec();
+
+  if(delivered != total) errors++;
+  if(real)
+  {
+    for(uint32 i = 0; i < delivered; i++)
+      if(out[i] != stream_byte(i)) { errors++; break; }
+  }
+  delete[] out;
+
+  printf("reassembly (%s data): %lu segments, %.1f ns/segment, %d errors\n",
+	 real ? "real" : "fake", (unsigned long)order.size(), 1e3*(t1-t0)/order.size(), errors);
+  return errors;
+}
+
+int main(int argc, char** argv)
+{
+  int nsegs = (argc > 1) ? atoi(argv[1]) : 100000;
+  int wnd   = (argc > 2) ? atoi(argv[2]) : 256;
+  int loss  = (argc > 3) ? atoi(argv[3]) : 5;
+  int seed  = (argc > 4) ? atoi(argv[4]) : 1;
+  if(nsegs <= 0 || wnd <= 0 || loss < 0 || loss >= 100)
+  {
+    fprintf(stderr, "usage: %s [segments] [window_segments] [loss_percent] [seed]\n", argv[0]);
+    return 1;
+  }
+  srand(seed);
+
+  std::vector<int> order;
+  make_arrivals(nsegs, wnd, loss, order);
+  printf("tcp_bench: %d segments, window %d segments, %d%% loss\n", nsegs, wnd, loss);
+
+  int errors = bench_scoreboard(order);
+  errors += bench_reassembly(order, false);
+  errors += bench_reassembly(order, true);
+  return errors ? 1 : 0;
+}
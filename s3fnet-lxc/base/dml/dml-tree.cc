@@ -380,6 +380,114 @@ ch_eq(int c1,
 
 /* ************************** END OF WC_STRNCMP *************************** */
 
+/* hash index of the child attributes of a list attribute */
+
+// lists with fewer child attributes are searched linearly
+#ifndef DML_INDEX_MIN_KIDS
+#define DML_INDEX_MIN_KIDS 8
+#endif
+
+/*
+ * AttrIndex maps the case-folded key of each child attribute to the
+ * attributes a keypath component with that key matches, in the same
+ * order as they would be found by scanning the child attributes and
+ * following the _extends references. The keys are the identifiers
+ * interned in the dictionary, so that most comparisons are pointer
+ * comparisons.
+ */
+class AttrIndex {
+public:
+  // An indexed attribute; entries of the same key are chained.
+  struct Entry {
+    AttrNode* node; // the matching attribute
+    int is_find;    // reached by _find (only matches the last key)
+    int next;       // the next entry of the same key, or -1
+  };
+
+  AttrIndex() : mask(0) {}
+
+  // Adds an attribute under the given key; all entries must be
+  // added before the first lookup.
+  void add(const char* key, AttrNode* node, int is_find) {
+    Entry e; e.node = node; e.is_find = is_find; e.next = -1;
+    entries.push_back(e);
+    keys.push_back(key);
+  }
+
+  // Returns the number of indexed attributes.
+  int size() const { return (int)entries.size(); }
+
+  // Builds the hash table after all entries have been added.
+  void build();
+
+  // Returns the first entry of the given key, or -1 if not found.
+  int lookup(const char* key) const;
+
+  // Returns the entry at the given position.
+  const Entry& entry(int e) const { return entries[e]; }
+
+private:
+  // Hashes the case-folded string (FNV-1a).
+  static unsigned int fold_hash(const char* s) {
+    unsigned int h = 2166136261u;
+    for(; *s; s++) h = (h^(unsigned char)tolower(*s))*16777619u;
+    return h;
+  }
+
+  // A distinct key and the chain of its entries.
+  struct Slot {
+    const char* key;
+    unsigned int hash;
+    int first, last;
+  };
+
+  std::vector<Entry> entries;
+  std::vector<const char*> keys; // key of each entry (until built)
+  std::vector<Slot> slots;
+  std::vector<int> table; // open addressing: slot index, or -1
+  unsigned int mask;
+};
+
+void AttrIndex::build()
+{
+  unsigned int n = 2;
+  while(n < 2*entries.size()) n <<= 1;
+  table.assign(n, -1);
+  mask = n-1;
+
+  for(int i=0; i<(int)entries.size(); i++) {
+    const char* key = keys[i];
+    unsigned int h = fold_hash(key);
+    unsigned int t = h&mask;
+    while(table[t] >= 0) {
+      Slot& s = slots[table[t]];
+      if(s.hash == h && (s.key == key || !strcasecmp(s.key, key))) break;
+      t = (t+1)&mask;
+    }
+    if(table[t] < 0) {
+      Slot s; s.key = key; s.hash = h; s.first = s.last = i;
+      table[t] = slots.size();
+      slots.push_back(s);
+    } else {
+      Slot& s = slots[table[t]];
+      entries[s.last].next = i;
+      s.last = i;
+    }
+  }
+  keys.clear();
+}
+
+int AttrIndex::lookup(const char* key) const
+{
+  unsigned int h = fold_hash(key);
+  for(unsigned int t = h&mask; table[t] >= 0; t = (t+1)&mask) {
+    const Slot& s = slots[table[t]];
+    if(s.hash == h && (s.key == key || !strcasecmp(s.key, key)))
+      return s.first;
+  }
+  return -1;
+}
+
 
 /* methods of KeyValue class */
 
@@ -635,6 +743,7 @@ AttrNode::AttrNode(AttrNode* firstkid)
 
   attr_expand = 0; // the node has not been expanded
   expanding = 0;   // we are not expanding now
+  attr_index = 0;  // the index is built on demand
 
   if(firstkid) locinfo.set(firstkid->location());
 }
@@ -650,6 +759,7 @@ AttrNode::AttrNode(AttrKey* key, KeyValue* keyval)
 
   attr_expand = 0; // the node has not been expanded
   expanding = 0;   // we are not expanding now
+  attr_index = 0;  // the index is built on demand
 
 #ifdef DML_LOCINFO_FILEPOS
   locinfo.set_first(&key->locinfo);
@@ -698,6 +808,7 @@ AttrNode::AttrNode(const AttrNode& node)
       attr_expand = node.attr_expand->clone();
     }
   } else attr_expand = 0; // the node has not been expanded
+  attr_index = 0; // the index is built on demand
 
   locinfo.set(node.locinfo);
 }
@@ -743,6 +854,11 @@ void AttrNode::cleanup()
     attr_expand->dispose(); // if this is a true expansion
   attr_expand = 0;
   expanding = 0;
+
+  if(attr_index) {
+    delete attr_index;
+    attr_index = 0;
+  }
 }
 
 AttrNode* AttrNode::clone()
@@ -775,6 +891,7 @@ AttrNode* AttrNode::append_kid(AttrNode* newkid)
   assert(attr_value_list && attr_value_list->size()>0);
   attr_value_list->push_back(newkid);
   newkid->attr_parent = this;
+  if(attr_index) { delete attr_index; attr_index = 0; } // stale now
 #ifdef DML_LOCINFO_FILEPOS
   locinfo.set_last(&newkid->locinfo);
 #endif
@@ -910,8 +1027,22 @@ void AttrNode::find_attributes(char* keypath, std::vector<AttrNode*>& collected,
       goto clear_and_return;
     }
 
-    // search for each child attribute
-    if(attr_value_list) {
+    // search for each child attribute; use the index unless the key
+    // contains wildcards
+    AttrIndex* idx = 0;
+    if(attr_value_list && !strpbrk(mykey, "*?")) idx = index();
+    if(idx) {
+      for(int e = idx->lookup(mykey); e >= 0; e = idx->entry(e).next) {
+        const AttrIndex::Entry& ent = idx->entry(e);
+        if(*newkeypath == 0) { // match to the very last key
+          collected.push_back(ent.node);
+          if(onematch) goto clear_and_return;
+        } else if(!ent.is_find && ent.node->attr_type == DML_ATTRTYPE_LIST) {
+          ent.node->find_attributes(newkeypath, collected, onematch, root);
+          if(onematch && !collected.empty()) goto clear_and_return;
+        }
+      }
+    } else if(attr_value_list) {
       for(std::vector<AttrNode*>::iterator iter = attr_value_list->begin();
           iter != attr_value_list->end(); iter++) {
         if((*iter)->key_type() == AttrKey::DML_KEYTYPE_EXTENDS) {
@@ -945,6 +1076,42 @@ void AttrNode::find_attributes(char* keypath, std::vector<AttrNode*>& collected,
   if(mykey) delete[] mykey;
 }
 
+AttrIndex* AttrNode::index()
+{
+  if(attr_index) return attr_index;
+  if(attr_type != DML_ATTRTYPE_LIST || !attr_expand || !attr_value_list ||
+     attr_value_list->size() < DML_INDEX_MIN_KIDS) return 0;
+
+  AttrIndex* idx = new AttrIndex(); assert(idx);
+  if(index_kids(idx)) { delete idx; return 0; }
+  idx->build();
+
+  // another thread may have built the index at the same time
+  if(!__sync_bool_compare_and_swap(&attr_index, (AttrIndex*)0, idx)) delete idx;
+  return attr_index;
+}
+
+int AttrNode::index_kids(AttrIndex* idx)
+{
+  if(!attr_value_list) return 0;
+  for(std::vector<AttrNode*>::iterator iter = attr_value_list->begin();
+      iter != attr_value_list->end(); iter++) {
+    AttrNode* kid = *iter;
+    if(kid->key_type() == AttrKey::DML_KEYTYPE_EXTENDS) {
+      if(!kid->attr_expand) return 1;
+      assert(kid->attr_expand->attr_type == DML_ATTRTYPE_LIST);
+      if(kid->attr_expand->index_kids(idx)) return 1;
+    } else if(kid->key_type() == AttrKey::DML_KEYTYPE_FIND) {
+      if(!kid->attr_expand) return 1;
+      assert(kid->attr_expand->attr_key); // cannot be the root
+      idx->add(kid->attr_expand->attr_key->ident(), kid->attr_expand, 1);
+    } else if(kid->key_type() == AttrKey::DML_KEYTYPE_IDENT) {
+      idx->add(kid->attr_key->ident(), kid, 0);
+    }
+  }
+  return 0;
+}
+
 const char* AttrNode::key() const
 {
   if(attr_key) // non-root must have a key
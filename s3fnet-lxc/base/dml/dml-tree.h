@@ -21,6 +21,8 @@
 namespace s3f {
 namespace dml {
 
+  class AttrIndex;
+
   /*
    * This data structure is used to connect the lexical scanner with
    * the syntax analyzer. Parsed tokens (except singletons such as '['
@@ -361,6 +363,32 @@ namespace dml {
      */
     AttrNode* search_attribute(char* keypath, AttrNode* root);
 
+    /*
+     * The hash index of the child attributes of an expanded list
+     * attribute, keyed by the case-folded attribute key. It is built
+     * on the first lookup and includes the attributes reached through
+     * _extends (recursively) and _find, so that find_attributes() does
+     * not have to scan the child attributes or follow the references
+     * for each query. NULL if the index has not been built.
+     */
+    AttrIndex* attr_index;
+
+    /*
+     * Returns the hash index of the child attributes, building it if
+     * necessary. Returns NULL if the list is too short to be worth
+     * indexing or if it has not been expanded. The index is built
+     * without locking and published atomically, so that concurrent
+     * lookups from multiple threads are safe.
+     */
+    AttrIndex* index();
+
+    /*
+     * Helper function to the index() method: appends the child
+     * attributes to the given index in order, following the _extends
+     * references. Returns non-zero if a reference is not expanded.
+     */
+    int index_kids(AttrIndex* idx);
+
     // Reclaims everything.
     void cleanup();
   }; // class AttrNode
@@ -20,6 +20,13 @@
 #error "Missing header file: sys/types.h"
 #endif
 
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <map>
+
 #include "dml.h"
 #include "dml-parser.h"
 
@@ -28,9 +35,40 @@ namespace dml {
 
 #define DML_ATTR_BUFSIZ 4096
 
+// signature and format version of the binary model cache
+#define DML_CACHE_MAGIC   0x434c4d44 /* "DMLC" */
+#define DML_CACHE_VERSION 1
+
+// node references stored in the binary model cache
+#define DML_CACHE_NONE -1 // no parent (root), no key, no value, or not expanded
+#define DML_CACHE_SELF -2 // the node is expanded to itself
+
+/*
+ * The binary model cache is a header, followed by an array of node
+ * records (in preorder) and a pool of null-terminated strings; all
+ * references are indices into the node array or offsets into the
+ * string pool, so that the file can be used directly once mapped.
+ */
+struct dml_cache_header {
+  u_int32_t magic;    // DML_CACHE_MAGIC
+  u_int32_t version;  // DML_CACHE_VERSION
+  unsigned long long key; // hash of the DML files (see cache_key())
+  u_int32_t nnodes;   // number of node records
+  u_int32_t poolsz;   // number of bytes in the string pool
+};
+
+struct dml_cache_node {
+  int parent;    // index of the parent node
+  int key_type;  // AttrKey::DML_KEYTYPE_*
+  int key;       // offset of the key string in the pool
+  int attr_type; // AttrNode::DML_ATTRTYPE_*
+  int value;     // offset of the value string (for a string attribute)
+  int expand;    // index of the node referred to by _extends or _find
+};
+
 Dictionary* dmlConfig::dict = 0;
-int dmlConfig::attrbufsz = 0;
-char* dmlConfig::attrbuf = 0;
+__thread int dmlConfig::attrbufsz = 0;
+__thread char* dmlConfig::attrbuf = 0;
 
 int VectorEnumeration::hasMoreElements()
 {
@@ -238,6 +276,197 @@ char* dmlConfig::attribute_buffer(int sz) {
   return attrbuf;
 }
 
+unsigned long long dmlConfig::cache_key(char** filenames)
+{
+  assert(filenames);
+
+  // 64-bit FNV-1a over the contents of the files, in order; the file
+  // boundaries are hashed as well
+  unsigned long long h = 14695981039346656037ULL;
+  unsigned char buf[65536];
+  for(int k=0; filenames[k]; k++) {
+    FILE* fp = fopen(filenames[k], "r");
+    if(!fp) return 0;
+    size_t n;
+    while((n = fread(buf, 1, sizeof(buf), fp)) > 0) {
+      for(size_t i=0; i<n; i++) {
+	h ^= buf[i];
+	h *= 1099511628211ULL;
+      }
+    }
+    fclose(fp);
+    h ^= 0xff; h *= 1099511628211ULL;
+  }
+  return h ? h : 1;
+}
+
+void dmlConfig::cache_collect(AttrNode* node, std::vector<AttrNode*>& nodes)
+{
+  nodes.push_back(node);
+  if(node->attr_type == DML_ATTRTYPE_LIST && node->attr_value_list) {
+    for(std::vector<AttrNode*>::iterator iter = node->attr_value_list->begin();
+	iter != node->attr_value_list->end(); iter++)
+      cache_collect(*iter, nodes);
+  }
+}
+
+int dmlConfig::save_cache(char* cachefile, char** filenames)
+{
+  assert(cachefile && filenames);
+  assert(key_type() == AttrKey::DML_KEYTYPE_ROOT);
+
+  unsigned long long key = cache_key(filenames);
+  if(!key) return 1;
+
+  // number the nodes in preorder
+  std::vector<AttrNode*> nodes;
+  cache_collect(this, nodes);
+  std::map<AttrNode*,int> index;
+  for(unsigned i=0; i<nodes.size(); i++) index[nodes[i]] = i;
+
+  // the strings are aliased by the dictionary, so each distinct
+  // string is entered into the pool once
+  std::vector<char> pool;
+  std::map<const char*,int> offsets;
+  std::vector<dml_cache_node> recs(nodes.size());
+  for(unsigned i=0; i<nodes.size(); i++) {
+    AttrNode* node = nodes[i];
+    dml_cache_node& rec = recs[i];
+    rec.parent = node->attr_parent ? index[node->attr_parent] : DML_CACHE_NONE;
+    rec.key_type = node->key_type();
+    rec.attr_type = node->attr_type;
+
+    const char* strs[2] = { node->key(), node->value() };
+    int* offs[2] = { &rec.key, &rec.value };
+    for(int j=0; j<2; j++) {
+      if(!strs[j]) { *offs[j] = DML_CACHE_NONE; continue; }
+      std::map<const char*,int>::iterator iter = offsets.find(strs[j]);
+      if(iter != offsets.end()) *offs[j] = (*iter).second;
+      else {
+	*offs[j] = offsets[strs[j]] = pool.size();
+	pool.insert(pool.end(), strs[j], strs[j]+strlen(strs[j])+1);
+      }
+    }
+
+    if(!node->attr_expand) rec.expand = DML_CACHE_NONE;
+    else if(node->attr_expand == node) rec.expand = DML_CACHE_SELF;
+    else {
+      // a reference outside of this tree cannot be cached
+      std::map<AttrNode*,int>::iterator iter = index.find(node->attr_expand);
+      if(iter == index.end()) return 1;
+      rec.expand = (*iter).second;
+    }
+  }
+
+  dml_cache_header hdr;
+  memset(&hdr, 0, sizeof(hdr));
+  hdr.magic = DML_CACHE_MAGIC;
+  hdr.version = DML_CACHE_VERSION;
+  hdr.key = key;
+  hdr.nnodes = recs.size();
+  hdr.poolsz = pool.size();
+
+  // write to a temporary file and move it in place
+  char* tmpfile = new char[strlen(cachefile)+32]; assert(tmpfile);
+  sprintf(tmpfile, "%s.%d.tmp", cachefile, (int)getpid());
+  FILE* fp = fopen(tmpfile, "w");
+  int ret = 1;
+  if(fp) {
+    // the file is closed exactly once, whether the writes failed or not
+    bool ok = fwrite(&hdr, sizeof(hdr), 1, fp) == 1 &&
+      fwrite(&recs[0], sizeof(dml_cache_node), recs.size(), fp) == recs.size() &&
+      (pool.empty() || fwrite(&pool[0], 1, pool.size(), fp) == pool.size());
+    if(fclose(fp)) ok = false;
+    if(ok) ret = rename(tmpfile, cachefile) ? 1 : 0;
+    if(ret) unlink(tmpfile);
+  }
+  delete[] tmpfile;
+  return ret;
+}
+
+int dmlConfig::load_cache(char* cachefile, char** filenames)
+{
+  assert(cachefile && filenames);
+  cleanup();
+
+  int fd = open(cachefile, O_RDONLY);
+  if(fd < 0) return 1;
+  struct stat st;
+  if(fstat(fd, &st) || (size_t)st.st_size < sizeof(dml_cache_header)) {
+    close(fd); return 1;
+  }
+  size_t size = st.st_size;
+  void* image = mmap(0, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if(image == MAP_FAILED) return 1;
+
+  // check the header before building anything
+  dml_cache_header* hdr = (dml_cache_header*)image;
+  dml_cache_node* recs = (dml_cache_node*)(hdr+1);
+  const char* pool = (const char*)(recs+hdr->nnodes);
+  if(hdr->magic != DML_CACHE_MAGIC || hdr->version != DML_CACHE_VERSION ||
+     hdr->nnodes < 1 || hdr->nnodes > size/sizeof(dml_cache_node) ||
+     sizeof(dml_cache_header)+hdr->nnodes*sizeof(dml_cache_node)+hdr->poolsz != size ||
+     (hdr->poolsz > 0 && pool[hdr->poolsz-1] != 0) ||
+     hdr->key != cache_key(filenames) ||
+     recs[0].parent != DML_CACHE_NONE || recs[0].attr_type != DML_ATTRTYPE_LIST) {
+    munmap(image, size);
+    return 1;
+  }
+
+  // rebuild the nodes in preorder; 'this' is the root; one attribute
+  // key is made per distinct key string and copied for the others
+  int n = hdr->nnodes;
+  std::vector<AttrNode*> nodes(n);
+  std::map<int,AttrKey*> keys;
+  nodes[0] = this;
+  int bad = 0;
+  for(int i=1; i<n && !bad; i++) {
+    dml_cache_node& rec = recs[i];
+    if(rec.parent < 0 || rec.parent >= i ||
+       nodes[rec.parent]->attr_type != DML_ATTRTYPE_LIST ||
+       rec.key < 0 || rec.key >= (int)hdr->poolsz ||
+       (rec.attr_type != DML_ATTRTYPE_LIST &&
+	(rec.attr_type != DML_ATTRTYPE_STRING || rec.value < 0 || rec.value >= (int)hdr->poolsz))) {
+      bad = 1; break;
+    }
+
+    dmlConfig* node = new dmlConfig((dmlConfig*)0); assert(node);
+    std::map<int,AttrKey*>::iterator kiter = keys.find(rec.key);
+    if(kiter == keys.end()) 
+      kiter = keys.insert(std::make_pair(rec.key, new AttrKey(new KeyValue(&pool[rec.key])))).first;
+    node->attr_key = (*kiter).second->clone(); assert(node->attr_key);
+    if(rec.attr_type == DML_ATTRTYPE_STRING) {
+      node->attr_type = DML_ATTRTYPE_STRING;
+      node->attr_value_string = dictionary()->enter_string(&pool[rec.value]);
+    }
+
+    AttrNode* parent = nodes[rec.parent];
+    if(!parent->attr_value_list) {
+      parent->attr_value_list = new std::vector<AttrNode*>();
+      assert(parent->attr_value_list);
+    }
+    parent->attr_value_list->push_back(node);
+    node->attr_parent = parent;
+    nodes[i] = node;
+    if(node->attr_key->type() != rec.key_type) bad = 1;
+  }
+
+  // restore the references made by _extends and _find
+  for(int i=0; i<n && !bad; i++) {
+    int e = recs[i].expand;
+    if(e == DML_CACHE_SELF) nodes[i]->attr_expand = nodes[i];
+    else if(e >= 0 && e < n && e != i) nodes[i]->attr_expand = nodes[e]->clone();
+    else if(e != DML_CACHE_NONE) bad = 1;
+  }
+
+  for(std::map<int,AttrKey*>::iterator kiter = keys.begin(); kiter != keys.end(); kiter++)
+    delete (*kiter).second;
+  munmap(image, size);
+  if(bad) { cleanup(); return 1; }
+  return 0;
+}
+
 }; // namespace dml
 }; // namespace s3f
 
@@ -380,6 +380,45 @@ namespace dml {
      * using this method. Nothing will happen if the list is empty.
      */
     void load(char** fnames);
+
+    /**
+     * \brief Save the DML tree to a binary model cache.
+     * \param cachefile is the name of the cache file.
+     * \param fnames is the null-terminated list of DML files from
+     * which the tree has been loaded.
+     * \returns zero on success.
+     *
+     * The fully expanded tree (including the references made by
+     * _extends and _find) is written as a flat array of nodes
+     * followed by a string pool, tagged with a hash of the contents
+     * of the given DML files. The file is written to a temporary
+     * name and renamed, so that concurrent runs never see a partial
+     * cache. This method is a PRIME DML extension.
+     */
+    int save_cache(char* cachefile, char** fnames);
+
+    /**
+     * \brief Load the DML tree from a binary model cache.
+     * \param cachefile is the name of the cache file.
+     * \param fnames is the null-terminated list of DML files the
+     * cache is expected to represent.
+     * \returns zero on success.
+     *
+     * The cache file is mapped into memory and the tree is rebuilt
+     * without lexing, parsing or expanding the DML files. Nonzero is
+     * returned (and the current tree is left empty) if the cache is
+     * missing, corrupted, or was made from DML files with different
+     * contents; the caller is then expected to load() the DML files
+     * and save_cache() again. This method is a PRIME DML extension.
+     */
+    int load_cache(char* cachefile, char** fnames);
+
+    /**
+     * \brief Returns the hash of the contents of the given DML files.
+     * \param fnames is a null-terminated list of DML file names.
+     * \returns the hash, or zero if any of the files cannot be read.
+     */
+    static unsigned long long cache_key(char** fnames);
   
     /**
      * \brief Returns the attribute value of a given key.
@@ -443,11 +482,18 @@ namespace dml {
      * wildcard will be returned. To help the user distinguish the
      * attributes returned by this method. We concatenate the DML
      * value and key (separated by a zero) for each enumerated item
-     * returned from the find() method.
+     * returned from the find() method. The buffer is kept per thread,
+     * since the model may be configured by several threads at once.
      */
-    static int attrbufsz;
-    static char* attrbuf;
+    static __thread int attrbufsz;
+    static __thread char* attrbuf;
     static char* attribute_buffer(int size);
+
+    /*
+     * Used by save_cache() to number the nodes of the DML tree in
+     * preorder (so that a parent always precedes its children).
+     */
+    static void cache_collect(AttrNode* node, std::vector<AttrNode*>& nodes);
   }; /*dmlConfig*/
 
 }; // namespace dml
@@ -0,0 +1,269 @@
+/**
+ * \file Philox.cc
+ *
+ * \brief Source file of PhiloxStream class, counter-based %Random number stream generator.
+ *
+ */
+
+#include <string.h>
+#include "Philox.h"
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+// Philox4x32 multipliers and Weyl key increments (Salmon et al., 2011)
+const uint32_t M0 = 0xD2511F53;
+const uint32_t M1 = 0xCD9E8D57;
+const uint32_t W0 = 0x9E3779B9;
+const uint32_t W1 = 0xBB67AE85;
+
+// 2^-53
+const double U53 = 1.0 / 9007199254740992.0;
+
+// number of blocks FillU01 computes side by side: one block in each
+// 32-bit lane of VECS 128-bit vectors
+const int VECS = 2;
+const int LANES = 4 * VECS;
+
+//-------------------------------------------------------------------------
+// Turn the top 52 of 64 random bits into a double in (0,1), 0 and 1
+// excluded: the bits are the mantissa of a double in [1,2), from which
+// 1-2^-53 is subtracted (exactly). Only integer operations and one
+// subtraction, so the conversion is cheap in the batched loop as well.
+//
+inline double ToU01 (uint32_t hi, uint32_t lo)
+{
+   uint64_t x = 0x3FF0000000000000ULL | ((uint64_t) hi << 20) | (lo >> 12);
+   double d;
+   memcpy (&d, &x, sizeof (d));
+   return d - (1.0 - U53);
+}
+
+} // namespace
+
+
+
+//-------------------------------------------------------------------------
+// Compute the two numbers of block i: ten Philox rounds applied to the
+// counter (i, substream).
+//
+void RNGS::PhiloxStream::Block (uint64_t i, double* u0, double* u1) const
+{
+   uint32_t c0 = (uint32_t) i, c1 = (uint32_t) (i >> 32);
+   uint32_t c2 = sub[0], c3 = sub[1];
+   uint32_t k0 = key[0], k1 = key[1];
+
+   for (int r = 0; r < 10; ++r) {
+      uint64_t p0 = (uint64_t) M0 * c0;
+      uint64_t p1 = (uint64_t) M1 * c2;
+      uint32_t n0 = (uint32_t) (p1 >> 32) ^ c1 ^ k0;
+      uint32_t n2 = (uint32_t) (p0 >> 32) ^ c3 ^ k1;
+      c1 = (uint32_t) p1;
+      c3 = (uint32_t) p0;
+      c0 = n0;
+      c2 = n2;
+      k0 += W0;
+      k1 += W1;
+   }
+   *u0 = ToU01 (c0, c1);
+   *u1 = ToU01 (c2, c3);
+}
+
+
+//-------------------------------------------------------------------------
+// constructor
+//
+RNGS::PhiloxStream::PhiloxStream (uint64_t k, uint64_t substream)
+{
+   key[0] = (uint32_t) k;
+   key[1] = (uint32_t) (k >> 32);
+   sub[0] = (uint32_t) substream;
+   sub[1] = (uint32_t) (substream >> 32);
+   ResetStartStream ();
+}
+
+
+//-------------------------------------------------------------------------
+// Reset Stream to beginning of Stream.
+//
+void RNGS::PhiloxStream::ResetStartStream ()
+{
+   ctr = 0;
+   spare = 0.0;
+   hasSpare = false;
+}
+
+
+//-------------------------------------------------------------------------
+// Generate the next random number.
+//
+double RNGS::PhiloxStream::RandU01 ()
+{
+   if (hasSpare) {
+      hasSpare = false;
+      return spare;
+   }
+   double u;
+   Block (ctr++, &u, &spare);
+   hasSpare = true;
+   return u;
+}
+
+
+//-------------------------------------------------------------------------
+// Generate the next n random numbers. Whole blocks are computed LANES
+// at a time, with SSE2 where available; the rest goes through RandU01
+// so that the stream stays in step with the scalar generator.
+//
+void RNGS::PhiloxStream::FillU01 (double* out, int n)
+{
+   if (n > 0 && hasSpare) {
+      *out++ = spare;
+      hasSpare = false;
+      --n;
+   }
+
+#if defined(__SSE2__)
+   // The same rounds as Block(), four blocks to a vector and VECS
+   // independent vectors to hide the latency of the multiplies. The
+   // even and odd lanes are multiplied separately (pmuludq) and the
+   // high and low halves of the products put back in place. The low
+   // word of the counter is incremented within the vector, so a batch
+   // over which it would wrap is left to the portable loop below.
+   const __m128i m0 = _mm_set1_epi32 ((int) M0);
+   const __m128i m1 = _mm_set1_epi32 ((int) M1);
+   const __m128i lomask = _mm_set_epi32 (0, -1, 0, -1);
+   const __m128i step = _mm_set_epi32 (3, 2, 1, 0);
+   const __m128i one = _mm_set1_epi64x (0x3FF0000000000000LL);
+   const __m128d offset = _mm_set1_pd (1.0 - U53);
+   while (n >= 2 * LANES && (uint32_t) ctr <= 0xFFFFFFFFu - LANES) {
+      __m128i x0[VECS], x1[VECS], x2[VECS], x3[VECS];
+      for (int v = 0; v < VECS; ++v) {
+         x0[v] = _mm_add_epi32 (_mm_set1_epi32 ((int) (uint32_t) (ctr + 4 * v)), step);
+         x1[v] = _mm_set1_epi32 ((int) (uint32_t) (ctr >> 32));
+         x2[v] = _mm_set1_epi32 ((int) sub[0]);
+         x3[v] = _mm_set1_epi32 ((int) sub[1]);
+      }
+      uint32_t k0 = key[0], k1 = key[1];
+      for (int r = 0; r < 10; ++r) {
+         __m128i kk0 = _mm_set1_epi32 ((int) k0);
+         __m128i kk1 = _mm_set1_epi32 ((int) k1);
+         for (int v = 0; v < VECS; ++v) {
+            __m128i e0 = _mm_mul_epu32 (x0[v], m0);
+            __m128i o0 = _mm_mul_epu32 (_mm_srli_epi64 (x0[v], 32), m0);
+            __m128i e1 = _mm_mul_epu32 (x2[v], m1);
+            __m128i o1 = _mm_mul_epu32 (_mm_srli_epi64 (x2[v], 32), m1);
+            __m128i lo0 = _mm_or_si128 (_mm_and_si128 (e0, lomask), _mm_slli_epi64 (o0, 32));
+            __m128i hi0 = _mm_or_si128 (_mm_srli_epi64 (e0, 32), _mm_andnot_si128 (lomask, o0));
+            __m128i lo1 = _mm_or_si128 (_mm_and_si128 (e1, lomask), _mm_slli_epi64 (o1, 32));
+            __m128i hi1 = _mm_or_si128 (_mm_srli_epi64 (e1, 32), _mm_andnot_si128 (lomask, o1));
+            x0[v] = _mm_xor_si128 (_mm_xor_si128 (hi1, x1[v]), kk0);
+            x2[v] = _mm_xor_si128 (_mm_xor_si128 (hi0, x3[v]), kk1);
+            x1[v] = lo1;
+            x3[v] = lo0;
+         }
+         k0 += W0;
+         k1 += W1;
+      }
+      // ToU01 on the vectors: pair the words into 64-bit lanes (high
+      // word c0 or c2), then interleave the two numbers of each block
+      for (int v = 0; v < VECS; ++v) {
+         for (int h = 0; h < 2; ++h) {
+            __m128i a = h ? _mm_unpackhi_epi32 (x1[v], x0[v]) : _mm_unpacklo_epi32 (x1[v], x0[v]);
+            __m128i b = h ? _mm_unpackhi_epi32 (x3[v], x2[v]) : _mm_unpacklo_epi32 (x3[v], x2[v]);
+            __m128d ua = _mm_sub_pd (_mm_castsi128_pd (_mm_or_si128 (_mm_srli_epi64 (a, 12), one)), offset);
+            __m128d ub = _mm_sub_pd (_mm_castsi128_pd (_mm_or_si128 (_mm_srli_epi64 (b, 12), one)), offset);
+            _mm_storeu_pd (out + 8 * v + 4 * h, _mm_unpacklo_pd (ua, ub));
+            _mm_storeu_pd (out + 8 * v + 4 * h + 2, _mm_unpackhi_pd (ua, ub));
+         }
+      }
+      ctr += LANES;
+      out += 2 * LANES;
+      n -= 2 * LANES;
+   }
+#endif
+
+   while (n >= 2 * LANES) {
+      uint32_t c0[LANES], c1[LANES], c2[LANES], c3[LANES];
+      for (int j = 0; j < LANES; ++j) {
+         uint64_t i = ctr + j;
+         c0[j] = (uint32_t) i;
+         c1[j] = (uint32_t) (i >> 32);
+         c2[j] = sub[0];
+         c3[j] = sub[1];
+      }
+      uint32_t k0 = key[0], k1 = key[1];
+      for (int r = 0; r < 10; ++r) {
+         for (int j = 0; j < LANES; ++j) {
+            uint64_t p0 = (uint64_t) M0 * c0[j];
+            uint64_t p1 = (uint64_t) M1 * c2[j];
+            uint32_t n0 = (uint32_t) (p1 >> 32) ^ c1[j] ^ k0;
+            uint32_t n2 = (uint32_t) (p0 >> 32) ^ c3[j] ^ k1;
+            c1[j] = (uint32_t) p1;
+            c3[j] = (uint32_t) p0;
+            c0[j] = n0;
+            c2[j] = n2;
+         }
+         k0 += W0;
+         k1 += W1;
+      }
+      for (int j = 0; j < LANES; ++j) {
+         out[2 * j] = ToU01 (c0[j], c1[j]);
+         out[2 * j + 1] = ToU01 (c2[j], c3[j]);
+      }
+      ctr += LANES;
+      out += 2 * LANES;
+      n -= 2 * LANES;
+   }
+
+   while (n-- > 0)
+      *out++ = RandU01 ();
+}
+
+
+//-------------------------------------------------------------------------
+// Mix a string (e.g. the NHI address of a host) and a seed into a key:
+// FNV-1a over the string, then the splitmix64 finalizer.
+//
+uint64_t RNGS::PhiloxStream::HashKey (const char* s, unsigned long seed)
+{
+   uint64_t h = 0xCBF29CE484222325ULL;
+   for (; *s; ++s) {
+      h ^= (unsigned char) *s;
+      h *= 0x100000001B3ULL;
+   }
+   h ^= (uint64_t) seed * 0x9E3779B97F4A7C15ULL;
+   h ^= h >> 30;
+   h *= 0xBF58476D1CE4E5B9ULL;
+   h ^= h >> 27;
+   h *= 0x94D049BB133111EBULL;
+   h ^= h >> 31;
+   return h;
+}
+
+
+//-------------------------------------------------------------------------
+// Write the key, the substream and the position in the stream.
+//
+bool RNGS::PhiloxStream::SaveState (FILE* fp) const
+{
+   char flag = hasSpare;
+   return fwrite (key, sizeof (key), 1, fp) == 1 && fwrite (sub, sizeof (sub), 1, fp) == 1
+      && fwrite (&ctr, sizeof (ctr), 1, fp) == 1 && fwrite (&spare, sizeof (spare), 1, fp) == 1
+      && fwrite (&flag, sizeof (flag), 1, fp) == 1;
+}
+
+
+//-------------------------------------------------------------------------
+bool RNGS::PhiloxStream::LoadState (FILE* fp)
+{
+   char flag;
+   if (fread (key, sizeof (key), 1, fp) != 1 || fread (sub, sizeof (sub), 1, fp) != 1
+       || fread (&ctr, sizeof (ctr), 1, fp) != 1 || fread (&spare, sizeof (spare), 1, fp) != 1
+       || fread (&flag, sizeof (flag), 1, fp) != 1)
+      return false;
+   hasSpare = flag;
+   return true;
+}
@@ -0,0 +1,58 @@
+/**
+ * \file Philox.h
+ *
+ * \brief Header file of PhiloxStream class, counter-based %Random number stream generator.
+ *
+ */
+
+#ifndef PHILOX_H
+#define PHILOX_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+namespace RNGS {
+/**
+ *  Counter-based %Random number stream generator (Philox4x32-10,
+ *  Salmon et al., "Parallel Random Numbers: As Easy as 1, 2, 3", SC'11).
+ *
+ *  The i-th block of a stream is the Philox bijection of the counter
+ *  (i, substream) under the key of the stream, so that a stream is
+ *  entirely determined by its key and substream number: unlike
+ *  RngStream, creating a stream does not advance a shared package
+ *  state, needs no lock, and does not depend on the order in which
+ *  the streams are created.
+ */
+class PhiloxStream
+{
+public:
+  /** constructor; the stream is identified by a 64-bit key and a 64-bit substream number */
+  PhiloxStream (uint64_t key, uint64_t substream);
+  /** Reset Stream to beginning of Stream. */
+  void ResetStartStream ();
+  /** Generate the next random number in (0,1). */
+  double RandU01 ();
+  /** Fill out[0..n-1] with the next n random numbers of the stream;
+   * the result is the same as calling RandU01() n times. */
+  void FillU01 (double* out, int n);
+  /** Mix a string and a seed into a 64-bit key. */
+  static uint64_t HashKey (const char* s, unsigned long seed);
+  /** Write the complete state of the stream (binary) to fp; return false on error. */
+  bool SaveState (FILE* fp) const;
+  /** Read back a state written by SaveState; return false on error. */
+  bool LoadState (FILE* fp);
+
+private:
+  uint32_t key[2];
+  uint32_t sub[2];
+  /** Index of the next block. */
+  uint64_t ctr;
+  /** The second number of the last block, if not consumed yet. */
+  double spare;
+  bool hasSpare;
+  /** Generate the two numbers of the given block. */
+  void Block (uint64_t i, double* u0, double* u1) const;
+};
+}
+
+#endif
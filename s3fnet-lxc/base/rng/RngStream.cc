@@ -475,6 +475,29 @@ void RNGS::RngStream::WriteStateFull () const
 }
 
 
+//-------------------------------------------------------------------------
+// The state is written as is: the seeds are exact in doubles.
+//
+bool RNGS::RngStream::SaveState (FILE* fp) const
+{
+    char flags[2] = { anti, incPrec };
+    return fwrite (Cg, sizeof (Cg), 1, fp) == 1 && fwrite (Bg, sizeof (Bg), 1, fp) == 1
+        && fwrite (Ig, sizeof (Ig), 1, fp) == 1 && fwrite (flags, sizeof (flags), 1, fp) == 1;
+}
+
+
+//-------------------------------------------------------------------------
+bool RNGS::RngStream::LoadState (FILE* fp)
+{
+    char flags[2];
+    if (fread (Cg, sizeof (Cg), 1, fp) != 1 || fread (Bg, sizeof (Bg), 1, fp) != 1
+        || fread (Ig, sizeof (Ig), 1, fp) != 1 || fread (flags, sizeof (flags), 1, fp) != 1)
+        return false;
+    anti = flags[0];
+    incPrec = flags[1];
+    return true;
+}
+
 //-------------------------------------------------------------------------
 void RNGS::RngStream::IncreasedPrecis (bool incp)
 {
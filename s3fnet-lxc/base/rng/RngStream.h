@@ -9,6 +9,7 @@
 #define RNGSTREAM_H
  
 #include <string>
+#include <stdio.h>
 #include <pthread.h>
 
 /**
@@ -43,6 +44,10 @@ public:
   void GetState (unsigned long seed[6]) const;
   void WriteState () const;
   void WriteStateFull () const;
+  /** Write the complete state of the stream (binary) to fp; return false on error. */
+  bool SaveState (FILE* fp) const;
+  /** Read back a state written by SaveState; return false on error. */
+  bool LoadState (FILE* fp);
   /** Generate the next random number. */
   double RandU01 ();
   /** Generate the next random integer. */
@@ -9,10 +9,36 @@
 using namespace Random;
 RNG::RNG() {
   __rngStream = new RNGS::RngStream();
+  __philox = 0;
   // pthread_mutex_init(&(__rngStream->nextState_lock), NULL);
 }
 
-double RNG::Random() { return __rngStream->RandU01(); }
+RNG::RNG(unsigned long long key, unsigned long long substream) {
+  __rngStream = 0;
+  __philox = new RNGS::PhiloxStream(key, substream);
+}
+
+double RNG::Random() {
+  if(__philox) return __philox->RandU01();
+  return __rngStream->RandU01();
+}
+
+void RNG::Random(double* out, int n) {
+  if(__philox) __philox->FillU01(out, n);
+  else for(int i=0; i<n; i++) out[i] = __rngStream->RandU01();
+}
+
+bool RNG::SaveState(FILE* fp) {
+  char kind = __philox ? 'P' : 'M';
+  if(fwrite(&kind, 1, 1, fp) != 1) return false;
+  return __philox ? __philox->SaveState(fp) : __rngStream->SaveState(fp);
+}
+
+bool RNG::LoadState(FILE* fp) {
+  char kind;
+  if(fread(&kind, 1, 1, fp) != 1 || kind != (__philox ? 'P' : 'M')) return false;
+  return __philox ? __philox->LoadState(fp) : __rngStream->LoadState(fp);
+}
 
 /* ------------------------------------------------------------------------- */
 /* These are C lang routines for generating random variables from eight      */
@@ -72,6 +98,26 @@ double RNG::Exponential(double m)
   return(- m * log(1.0 - Random()));
 } /* Exponential */
 
+/* ========================================================================= */
+/*                   void Uniform(), void Exponential()                      */
+/* ========================================================================= */
+/* Fill out[0..n-1] with the next n variates; the uniforms are drawn in one  */
+/* batch and transformed in place.                                           */
+/* ========================================================================= */
+void RNG::Uniform(double a, double b, double* out, int n)
+{
+  Random(out, n);
+  for (int i = 0; i < n; i++)
+    out[i] = a + (b - a) * out[i];
+}  /* Uniform */
+
+void RNG::Exponential(double m, double* out, int n)
+{
+  Random(out, n);
+  for (int i = 0; i < n; i++)
+    out[i] = - m * log(1.0 - out[i]);
+} /* Exponential */
+
 /* ========================================================================= */
 /*                             double Erlang()                               */
 /* ========================================================================= */
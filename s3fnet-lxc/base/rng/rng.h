@@ -12,6 +12,7 @@
 using namespace std;
 #include "binsearch.h"
 #include "RngStream.h"
+#include "Philox.h"
 
 /**
  * \namespace Random %Random Number Generator
@@ -71,9 +72,19 @@ class RngStream;
 
 class RNG {
  public:
+  /** A stream of the MRG32k3a package, the next one in the package sequence. */
   RNG();
+  /** A counter-based (Philox4x32-10) stream, identified by its key and substream. */
+  RNG(unsigned long long key, unsigned long long substream);
   RNGS::RngStream* __rngStream;
+  RNGS::PhiloxStream* __philox;
   double Random();
+  /** Fill out[0..n-1] with the next n numbers of Random(). */
+  void Random(double* out, int n);
+  /** Write the state of the stream to fp; return false on error. */
+  bool SaveState(FILE* fp);
+  /** Read back a state written by SaveState() for a stream of the same kind; return false on error. */
+  bool LoadState(FILE* fp);
   ~RNG() {};
 
 /* include files */
@@ -139,6 +150,10 @@ double Lognormal(double a, double b);
 double Chisquare(long n);
 double Student(long n);
 
+/* batched versions: the same values as n successive scalar calls */
+void Uniform(double a, double b, double* out, int n);
+void Exponential(double m, double* out, int n);
+
 double Ln_Gamma(double a);
 double Ln_Factorial(long n);
 double Ln_Beta(double a, double b);
@@ -156,6 +156,10 @@ class LxcManager;
 #include <aux/fast_barrier.h>
 #include <aux/fast_tree_barrier.h>
 #include <aux/barrier.h>
+#include <api/shard.h>
+#include <api/window_control.h>
+#include <api/pacer.h>
+#include <api/placement.h>
 #include <api/interface.h>
 #include <api/timeline.h>
 #include <tklxcmngr/tk_lxc_manager.h>
@@ -36,6 +36,17 @@ idxtype fx(double min_delay, double max_delay, double delay)
   return ret;
 }
 
+// scale the weights into the range METIS handles comfortably
+#define MAX_VERTEX_WEIGHT 1048576
+#define MAX_EDGE_WEIGHT 16384
+
+// return a weight in [1, 1+max] proportional to w, where wmax is the largest w
+static idxtype scale_weight(double w, double wmax, int max)
+{
+  if(wmax > max) w = w*max/wmax;
+  return 1+(idxtype)w;
+}
+
 static char* ssstrdup(char* str)
 {
   assert(str);
@@ -54,6 +65,10 @@ static void usage(char* program) {
 	  "    <n0>, <n1>, ... are the host names of these machines\n"
 	  "    <p0>, <p1>, ... are the number of shared-memory processors on these machines\n"
 	  "  -f <dml_filename> : set the base filename of the generated model dmls\n"
+	  "  -p <profile_file> : weigh the alignments by the load measured in a previous run\n"
+	  "    (s3fnet -p <profile_file>) instead of the number of hosts, and the connections\n"
+	  "    between them by the packets sent across instead of the link delays\n"
+	  "  -w <w> : weight of one second of LXC advance in events, for -p (default 10000)\n"
 	  "For example, if you want to run on 8 single processor machines:\n"
 	  "  %s -m 8 env.dml\n"
 	  "Or if the simulation is to be run on two dual-processor machines named A and B:\n"
@@ -71,12 +86,96 @@ public:
   int nentities;
   int machid; 
   map<Node*,double> delays;
+  double load; // measured load, from the profile
+  map<Node*,double> traffic; // measured packets to other nodes, from the profile
 
-  Node(char* n, int id) : name(n), serialno(id), nentities(0) {}
+  Node(char* n, int id) : name(n), serialno(id), nentities(0), load(0) {}
 };
 
 int nmachs = 0;
 map<string,Node*> timelines;
+map<string,Node*> host_timelines; // host nhi => its alignment
+
+// the alignment of the host owning the given host or interface nhi; NULL if unknown
+static Node* nhi_timeline(const char* nhi)
+{
+  const char* p = strchr(nhi, '(');
+  string hostnhi = p ? string(nhi, p-nhi) : string(nhi);
+  map<string,Node*>::iterator iter = host_timelines.find(hostnhi);
+  return (iter != host_timelines.end()) ? (*iter).second : 0;
+}
+
+// read the profile of a previous run and add the measured load and
+// traffic to the alignments; return the number of connections found
+static int load_profile(char* filename, double lxc_weight)
+{
+  dmlConfig* profcfg = new dmlConfig(filename);
+  dmlConfig* cfg = (dmlConfig*)profcfg->findSingle("profile");
+  if(!cfg || !dmlConfig::isConf(cfg)) {
+    fprintf(stderr, "ERROR: invalid PROFILE in %s\n", filename);
+    exit(2);
+  }
+
+  Enumeration* henum = cfg->find("host");
+  while(henum->hasMoreElements()) {
+    dmlConfig* hcfg = (dmlConfig*)henum->nextElement();
+    char* nhi = (char*)hcfg->findSingle("nhi");
+    if(!dmlConfig::isConf(hcfg) || !nhi || dmlConfig::isConf(nhi)) {
+      fprintf(stderr, "ERROR: invalid PROFILE.HOST\n");
+      exit(2);
+    }
+    Node* node = nhi_timeline(nhi);
+    if(!node) continue; // the model has changed since
+    char* str = (char*)hcfg->findSingle("events");
+    if(str && !dmlConfig::isConf(str)) node->load += atof(str);
+    str = (char*)hcfg->findSingle("lxc_advance");
+    if(str && !dmlConfig::isConf(str)) node->load += lxc_weight*atof(str);
+  }
+  delete henum;
+
+  int nlinks = 0;
+  Enumeration* lenum = cfg->find("link");
+  while(lenum->hasMoreElements()) {
+    dmlConfig* lcfg = (dmlConfig*)lenum->nextElement();
+    char* str = (char*)lcfg->findSingle("messages");
+    if(!dmlConfig::isConf(lcfg) || !str || dmlConfig::isConf(str)) {
+      fprintf(stderr, "ERROR: invalid PROFILE.LINK\n");
+      exit(2);
+    }
+    double messages = atof(str);
+    if(messages <= 0) continue;
+
+    // the packets on the link count between all alignments it spans
+    set<Node*> nodes;
+    Enumeration* aenum = lcfg->find("attach");
+    while(aenum->hasMoreElements()) {
+      str = (char*)aenum->nextElement();
+      if(dmlConfig::isConf(str)) {
+	fprintf(stderr, "ERROR: invalid PROFILE.LINK.ATTACH\n");
+	exit(2);
+      }
+      Node* node = nhi_timeline(str);
+      if(node) nodes.insert(node);
+    }
+    delete aenum;
+
+    for(set<Node*>::iterator a = nodes.begin(); a != nodes.end(); a++) {
+      for(set<Node*>::iterator b = nodes.begin(); b != nodes.end(); b++) {
+	if(*a == *b) continue;
+	map<Node*,double>::iterator titer = (*a)->traffic.find(*b);
+	if(titer != (*a)->traffic.end()) (*titer).second += messages;
+	else {
+	  (*a)->traffic.insert(make_pair(*b, messages));
+	  nlinks++;
+	}
+      }
+    }
+  }
+  delete lenum;
+
+  delete profcfg;
+  return nlinks;
+}
 
 extern void generate_separate_dmls(char* basename, dmlConfig* modelcfg);
 
@@ -86,14 +185,24 @@ int main(int argc, char* argv[])
   int* mach_nprocs = 0;
   char** mach_names = 0;
   char* base_filename = 0;
+  char* profile_filename = 0;
+  double lxc_weight = 10000;
   /*long start_time = time(NULL);*/
 
   for(;;) {
-    int c = getopt(argc, argv, "f:hm:");
+    int c = getopt(argc, argv, "f:hm:p:w:");
     if(c == -1) break;
     switch(c) {
     case 'f': base_filename = optarg; break;
     case 'h': usage(argv[0]); break;
+    case 'p': profile_filename = optarg; break;
+    case 'w':
+      lxc_weight = atof(optarg);
+      if(lxc_weight < 0) {
+	fprintf(stderr, "ERROR: invalid weight of lxc advance: -w\n");
+	return 1;
+      }
+      break;
     case 'm': {
       char* str = optarg;
       char* colon = strchr(str, ':');
@@ -187,13 +296,21 @@ int main(int argc, char* argv[])
       return 2;
     }
     //printf("host alignment: %s\n", str);
+    Node* node;
     map<string,Node*>::iterator iter = timelines.find(str);
-    if(iter != timelines.end()) (*iter).second->nentities++;
-    else {
-      Node* node = new Node(str, nnodes++);
+    if(iter != timelines.end()) {
+      node = (*iter).second;
+      node->nentities++;
+    } else {
+      node = new Node(str, nnodes++);
       node->nentities = 1;
       timelines.insert(make_pair(str, node));
     }
+    str = (char*)cfg->findSingle("mapto");
+    if(str && !dmlConfig::isConf(str)) {
+      char* p = strchr(str, '(');
+      host_timelines.insert(make_pair(p ? string(str, p-str) : string(str), node));
+    }
   }
   delete hostenum;
 
@@ -252,6 +369,8 @@ int main(int argc, char* argv[])
 
   delete rootcfg; // get rid of the dml tree
 
+  if(profile_filename) inter_timeline_links = load_profile(profile_filename, lxc_weight);
+
   int n = timelines.size();
   idxtype *xadj = new idxtype[n+1];
   xadj[0] = 0;
@@ -278,9 +397,33 @@ int main(int argc, char* argv[])
 	iter != timelines.end(); iter++)
       (*iter).second->machid = 0;
   } else {
+    // with a profile, each host weighs at least one event
+    double max_load = 0, max_traffic = 0;
+    for(map<string,Node*>::iterator iter = timelines.begin();
+	iter != timelines.end(); iter++) {
+      Node* node = (*iter).second;
+      node->load += node->nentities;
+      if(node->load > max_load) max_load = node->load;
+      for(map<Node*,double>::iterator titer = node->traffic.begin();
+	  titer != node->traffic.end(); titer++)
+	if((*titer).second > max_traffic) max_traffic = (*titer).second;
+    }
+
     int x = 0; i = 0; 
     for(map<string,Node*>::iterator iter = timelines.begin();
 	iter != timelines.end(); iter++, i++) {
+      if(profile_filename) {
+	vwgt[i] = scale_weight((*iter).second->load, max_load, MAX_VERTEX_WEIGHT);
+	for(map<Node*,double>::iterator titer = (*iter).second->traffic.begin();
+	    titer != (*iter).second->traffic.end(); titer++) {
+	  adjncy[x] = (*titer).first->serialno;
+	  adjwgt[x] = scale_weight((*titer).second, max_traffic, MAX_EDGE_WEIGHT);
+	  x++;
+	}
+	xadj[i+1] = x;
+	continue;
+      }
+
       vwgt[i] = 1+(*iter).second->nentities;
       for(map<Node*,double>::iterator citer = (*iter).second->delays.begin();
 	  citer != (*iter).second->delays.end(); citer++) {
@@ -0,0 +1,169 @@
+/**
+ * \file name_table.cc
+ * \brief Source file for the NameTable and IPIndex classes.
+ *
+ * authors : Dong (Kevin) Jin
+ */
+
+#include "env/name_table.h"
+#include <assert.h>
+#include <string.h>
+
+namespace s3f {
+namespace s3fnet {
+
+#define NAME_TABLE_INITIAL_SLOTS 64
+#define IP_INDEX_INITIAL_SLOTS 64
+
+NameTable::NameTable() : nslots(NAME_TABLE_INITIAL_SLOTS), chunk_used(NAME_TABLE_ARENA_CHUNK), arena_bytes(0)
+{
+  slots = new Slot[nslots];
+  for(int i=0; i<nslots; i++) slots[i].id = -1;
+}
+
+NameTable::~NameTable()
+{
+  delete[] slots;
+  for(unsigned i=0; i<chunks.size(); i++) delete[] chunks[i];
+}
+
+unsigned NameTable::hash(const char* name, int len)
+{
+  unsigned h = 2166136261u;
+  for(int i=0; i<len; i++)
+  {
+    h ^= (unsigned char)name[i];
+    h *= 16777619u;
+  }
+  return h;
+}
+
+int NameTable::find_slot(const char* name, int len, unsigned h) const
+{
+  int mask = nslots-1;
+  for(int i = h & mask; ; i = (i+1) & mask)
+  {
+    if(slots[i].id < 0) return i;
+    if(slots[i].hash == h)
+    {
+      const char* s = names[slots[i].id];
+      if(!memcmp(s, name, len) && s[len] == 0) return i;
+    }
+  }
+}
+
+int NameTable::lookup(const char* name, int len) const
+{
+  if(len < 0) len = strlen(name);
+  int i = find_slot(name, len, hash(name, len));
+  return slots[i].id;
+}
+
+int NameTable::intern(const char* name, int len)
+{
+  if(len < 0) len = strlen(name);
+  unsigned h = hash(name, len);
+  int i = find_slot(name, len, h);
+  if(slots[i].id >= 0) return slots[i].id;
+
+  int id = names.size();
+  names.push_back(store(name, len));
+  slots[i].hash = h;
+  slots[i].id = id;
+
+  // keep the load factor at most one half
+  if(2*(int)names.size() > nslots) grow();
+  return id;
+}
+
+void NameTable::grow()
+{
+  Slot* old = slots;
+  int oldn = nslots;
+  nslots *= 2;
+  slots = new Slot[nslots];
+  for(int i=0; i<nslots; i++) slots[i].id = -1;
+
+  int mask = nslots-1;
+  for(int k=0; k<oldn; k++)
+  {
+    if(old[k].id < 0) continue;
+    int i = old[k].hash & mask;
+    while(slots[i].id >= 0) i = (i+1) & mask;
+    slots[i] = old[k];
+  }
+  delete[] old;
+}
+
+const char* NameTable::store(const char* name, int len)
+{
+  if(chunk_used+len+1 > NAME_TABLE_ARENA_CHUNK)
+  {
+    // a name longer than a block gets a block of its own
+    int sz = (len+1 > NAME_TABLE_ARENA_CHUNK) ? len+1 : NAME_TABLE_ARENA_CHUNK;
+    chunks.push_back(new char[sz]);
+    arena_bytes += sz;
+    chunk_used = 0;
+  }
+  char* s = chunks.back()+chunk_used;
+  memcpy(s, name, len);
+  s[len] = 0;
+  chunk_used += len+1;
+  if(chunk_used > NAME_TABLE_ARENA_CHUNK) chunk_used = NAME_TABLE_ARENA_CHUNK;
+  return s;
+}
+
+size_t NameTable::memory() const
+{
+  return nslots*sizeof(Slot) + names.capacity()*sizeof(const char*) +
+    chunks.capacity()*sizeof(char*) + arena_bytes;
+}
+
+IPIndex::IPIndex() : mask(IP_INDEX_INITIAL_SLOTS-1), count(0)
+{
+  slots = new Slot[mask+1];
+  for(unsigned i=0; i<=mask; i++) slots[i].value = -1;
+}
+
+IPIndex::~IPIndex()
+{
+  delete[] slots;
+}
+
+bool IPIndex::insert(IPADDR ip, int value)
+{
+  assert(value >= 0);
+  unsigned i = hash(ip) & mask;
+  while(slots[i].value >= 0)
+  {
+    if(slots[i].ip == ip) return false;
+    i = (i+1) & mask;
+  }
+  slots[i].ip = ip;
+  slots[i].value = value;
+
+  // keep the load factor at most one half
+  if(2*(unsigned)++count > mask+1) grow();
+  return true;
+}
+
+void IPIndex::grow()
+{
+  Slot* old = slots;
+  unsigned oldn = mask+1;
+  mask = 2*oldn-1;
+  slots = new Slot[mask+1];
+  for(unsigned i=0; i<=mask; i++) slots[i].value = -1;
+
+  for(unsigned k=0; k<oldn; k++)
+  {
+    if(old[k].value < 0) continue;
+    unsigned i = hash(old[k].ip) & mask;
+    while(slots[i].value >= 0) i = (i+1) & mask;
+    slots[i] = old[k];
+  }
+  delete[] old;
+}
+
+}; // namespace s3fnet
+}; // namespace s3f
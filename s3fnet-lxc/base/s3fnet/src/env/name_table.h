@@ -0,0 +1,148 @@
+/**
+ * \file name_table.h
+ * \brief Header file for the NameTable and IPIndex classes.
+ *
+ * authors : Dong (Kevin) Jin
+ */
+
+#ifndef __NAME_TABLE_H__
+#define __NAME_TABLE_H__
+
+#include "util/shstl.h"
+#include "net/ip_prefix.h"
+
+namespace s3f {
+namespace s3fnet {
+
+/** Size of each block of the string arena of a name table. */
+#define NAME_TABLE_ARENA_CHUNK 65536
+
+/**
+ * \brief Interned names.
+ *
+ * A name table maps each distinct name (such as an NHI address or a
+ * host name) to a small integer id, assigned in the order the names
+ * are interned, starting from zero. The names are copied into a
+ * string arena allocated in large blocks and indexed by an open
+ * addressing hash table, so that a lookup needs neither a temporary
+ * string nor more than a couple of cache misses. Names are never
+ * removed.
+ */
+class NameTable {
+ public:
+  /** The constructor. */
+  NameTable();
+
+  /** The destructor. */
+  ~NameTable();
+
+  /**
+   * Intern the name and return its id. The name is given by its
+   * length, or is zero-terminated if the length is negative.
+   */
+  int intern(const char* name, int len = -1);
+
+  /** Return the id of the name, or -1 if the name has not been interned. */
+  int lookup(const char* name, int len = -1) const;
+
+  /** Return the name of the given id; it lives as long as the table. */
+  const char* name(int id) const { return names[id]; }
+
+  /** Return the number of names interned. */
+  int size() const { return (int)names.size(); }
+
+  /** Return the number of bytes used by the table. */
+  size_t memory() const;
+
+ private:
+  /** A slot of the hash table. */
+  struct Slot {
+    unsigned hash; ///< hash value of the name
+    int id;        ///< id of the name; -1 if the slot is empty
+  };
+
+  /** Hash function of the names (FNV-1a). */
+  static unsigned hash(const char* name, int len);
+
+  /** Return the slot holding the name, or the empty slot where it belongs. */
+  int find_slot(const char* name, int len, unsigned h) const;
+
+  /** Double the hash table. */
+  void grow();
+
+  /** Copy the name into the arena and return the copy. */
+  const char* store(const char* name, int len);
+
+  /** The hash table; the number of slots is a power of two. */
+  Slot* slots;
+  int nslots;
+
+  /** Names indexed by id, pointing into the arena. */
+  S3FNET_VECTOR(const char*) names;
+
+  /** Blocks of the string arena; the last one is being filled. */
+  S3FNET_VECTOR(char*) chunks;
+  int chunk_used;
+  size_t arena_bytes;
+};
+
+/**
+ * \brief Index of IP addresses.
+ *
+ * An open addressing hash table mapping IP addresses to non-negative
+ * integers (such as the id of an interned NHI address).
+ */
+class IPIndex {
+ public:
+  /** The constructor. */
+  IPIndex();
+
+  /** The destructor. */
+  ~IPIndex();
+
+  /** Add the ip address; return false if it is already in the index. */
+  bool insert(IPADDR ip, int value);
+
+  /** Return the value of the ip address, or -1 if it is not in the index. */
+  int find(IPADDR ip) const
+  {
+    for(unsigned i = hash(ip) & mask; ; i = (i+1) & mask)
+    {
+      if(slots[i].value < 0) return -1;
+      if(slots[i].ip == ip) return slots[i].value;
+    }
+  }
+
+  /** Return the number of ip addresses in the index. */
+  int size() const { return count; }
+
+  /** Return the number of bytes used by the index. */
+  size_t memory() const { return (mask+1)*sizeof(Slot); }
+
+ private:
+  /** A slot of the hash table. */
+  struct Slot {
+    IPADDR ip; ///< the ip address
+    int value; ///< the value; -1 if the slot is empty
+  };
+
+  /** Hash function of the ip addresses. */
+  static unsigned hash(IPADDR ip)
+  {
+    unsigned h = ip * 2654435761u;
+    return h ^ (h >> 16);
+  }
+
+  /** Double the hash table. */
+  void grow();
+
+  /** The hash table; the number of slots is mask+1, a power of two. */
+  Slot* slots;
+  unsigned mask;
+  int count;
+};
+
+}; // namespace s3fnet
+}; // namespace s3f
+
+#endif /*__NAME_TABLE_H__*/
@@ -9,9 +9,11 @@
 #include <assert.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include "net/host.h"
 #include "net/network_interface.h"
 #include "net/ip_prefix.h"
+#include "net/nhi.h"
 #include "util/errhandle.h"
 
 namespace s3f {
@@ -23,26 +25,40 @@ namespace s3fnet {
 #define NAMESVC_DUMP(x)
 #endif
 
-NameService::NameService() :
-  hostname2nicnhi_map(0), hostnhi2hostname_map(0), 
-  hostnhi2align_map(0), hostnhi2id_map(0), 
-  nhi2ip_map(0), ip2nicnhi_map(0), ip2iface_map(0)
+NameService::NameService()
 {
   NAMESVC_DUMP(printf("new global name service\n"));
-  ip2iface_map = new IP2IFACE_MAP;
+  pthread_mutex_init(&iface_mutex, NULL);
 }
 
 NameService::~NameService()
 {
   NAMESVC_DUMP(printf("delete global name service\n"));
+  pthread_mutex_destroy(&iface_mutex);
+}
+
+int NameService::intern_nhi(const char* nhi, int len)
+{
+  int id = nhis.intern(nhi, len);
+  if(id == (int)nhi_info.size())
+  {
+    NhiInfo info = { IPADDR_INVALID, -1, -1, -1, false, 0, 0 };
+    nhi_info.push_back(info);
+  }
+  return id;
+}
 
-  if(hostname2nicnhi_map) delete hostname2nicnhi_map;
-  if(hostnhi2hostname_map) delete hostnhi2hostname_map;
-  if(hostnhi2align_map) delete hostnhi2align_map;
-  if(hostnhi2id_map) delete hostnhi2id_map;
-  if(nhi2ip_map) delete nhi2ip_map;
-  if(ip2nicnhi_map) delete ip2nicnhi_map;
-  if(ip2iface_map) delete ip2iface_map;
+NameService::NhiInfo* NameService::find_nhi(const char* nhi, bool hostpart)
+{
+  int len = -1;
+  if(hostpart)
+  {
+    // remove the interface specification in nhi
+    const char* p = strchr(nhi, '(');
+    if(p && p > nhi) len = p-nhi;
+  }
+  int id = nhis.lookup(nhi, len);
+  return (id < 0) ? 0 : &nhi_info[id];
 }
 
 void NameService::config(s3f::dml::Configuration* cfg)
@@ -170,28 +186,23 @@ void NameService::config_hosts(s3f::dml::Configuration* cfg)
   int pos2 = nicnhi.find_first_of(')', pos+1);
   if(pos2 <= 0)
     error_quit("ERROR: NameService::config_hosts(), invalid HOST.MAPTO attribute in ENVIRONMENT_INFO.\n");
-  S3FNET_STRING hostnhi = nicnhi.substr(0, pos);
+  int hostnicidx = atoi(nicnhi.c_str()+pos+1);
 
-  int hostnicidx = atoi(nicnhi.substr(pos+1, pos2-pos+1).c_str());
-  if(!hostnhi2id_map) hostnhi2id_map = new NHI2IDMAP;
-  if(!(hostnhi2id_map->insert(S3FNET_MAKE_PAIR(hostnhi, hostnicidx))).second)
-    error_quit("ERROR: NameService::config_host(),  duplicate host nhi \"%s\" in ENVIRONMENT_INFO.\n", hostnhi.c_str());
+  int hostid = intern_nhi(nicnhi.c_str(), pos);
+  if(nhi_info[hostid].defnic >= 0)
+    error_quit("ERROR: NameService::config_host(),  duplicate host nhi \"%s\" in ENVIRONMENT_INFO.\n", nhis.name(hostid));
+  nhi_info[hostid].defnic = hostnicidx;
 
   // we only remember named hosts (and provide corresponding mapping)
   if(name != "no_name")
   {
-    if(!hostname2nicnhi_map)
-    {
-      hostname2nicnhi_map = new STR2STRMAP;
-      hostnhi2hostname_map = new STR2STRMAP;
-    }
-
-    if(!(hostname2nicnhi_map->insert(S3FNET_MAKE_PAIR(name, nicnhi))).second)
+    int nameid = hostnames.intern(name.c_str());
+    if(nameid < (int)hostname2nic.size())
       error_quit("ERROR: NameService::config_host(), duplicate host name \"%s\" in ENVIRONMENT_INFO.\n", name.c_str());
-    if(!(hostnhi2hostname_map->insert(S3FNET_MAKE_PAIR(hostnhi, name))).second)
-      error_quit("ERROR: NameService::config_host(), duplicate nic nhi \"%s\" in ENVIRONMENT_INFO.\n", nicnhi.c_str());
+    hostname2nic.push_back(intern_nhi(nicnhi.c_str()));
+    nhi_info[hostid].hostname = nameid;
 
-    NAMESVC_DUMP(printf("config_host(): host \"%s\" <=> host nhi \"%s\", nic nhi \"%s\".\n", name.c_str(), hostnhi.c_str(), nicnhi.c_str()));
+    NAMESVC_DUMP(printf("config_host(): host \"%s\" <=> host nhi \"%s\", nic nhi \"%s\".\n", name.c_str(), nhis.name(hostid), nicnhi.c_str()));
   }
   else
   {
@@ -201,22 +212,15 @@ void NameService::config_hosts(s3f::dml::Configuration* cfg)
   str = (char*)cfg->findSingle("alignment");
   if(!str || s3f::dml::dmlConfig::isConf(str))
     error_quit("ERROR: NameService::config_host(), missing or invalid HOST.ALIGNMENT attribute in ENVIRONMENT_INFO.\n");
-  S3FNET_STRING align = str; // implicit copy
+  nhi_info[hostid].align = aligns.intern(str);
 
-  if(!hostnhi2align_map) hostnhi2align_map = new STR2STRMAP;
-  if(!(hostnhi2align_map->insert(S3FNET_MAKE_PAIR(hostnhi, align))).second)
-    error_quit("ERROR: NameService::config_host(),  duplicate host nhi \"%s\" in ENVIRONMENT_INFO.\n", hostnhi.c_str());
-
-  NAMESVC_DUMP(printf("config_host(): host nhi \"%s\" <=> alignment \"%s\".\n", hostnhi.c_str(), align.c_str()));
+  NAMESVC_DUMP(printf("config_host(): host nhi \"%s\" <=> alignment \"%s\".\n", nhis.name(hostid), str));
 }
 
 void NameService::config_nhi_addr(s3f::dml::Configuration* cfg)
 {
   assert(cfg);
 
-  if(!nhi2ip_map) nhi2ip_map = new NHI2IPMAP();
-  if(!ip2nicnhi_map) ip2nicnhi_map = new IP2NHIMAP();
-
   s3f::dml::Enumeration* ienum = cfg->find("interface");
   while(ienum->hasMoreElements())
   {
@@ -234,10 +238,9 @@ void NameService::config_nhi_addr(s3f::dml::Configuration* cfg)
     int pos2 = nicnhi.find_first_of(')', pos+1);
     if(pos2 <= 0)
       error_quit("ERROR: NameService::config_nhi_addr(), invalid ALIGNMENT_INTERFACE.NHI attribute in ENVIRONMENT_INFO.\n");
-    S3FNET_STRING hostnhi = nicnhi.substr(0, pos);
-    int hostnicidx = atoi(nicnhi.substr(pos+1, pos2-pos+1).c_str());
+    int hostnicidx = atoi(nicnhi.c_str()+pos+1);
 
-    IPADDR ip;
+    IPADDR ip = IPADDR_INVALID;
     str = (char*)icfg->findSingle("ip");
     if(str)
     {
@@ -245,24 +248,21 @@ void NameService::config_nhi_addr(s3f::dml::Configuration* cfg)
       ip = IPPrefix::txt2ip(str);
     }
 
-    NHI2IPMAP::iterator iter = nhi2ip_map->find(nicnhi);
-    if(iter != nhi2ip_map->end())
-    {
+    int nicid = intern_nhi(nicnhi.c_str());
+    if(nhi_info[nicid].addressed)
       error_quit("ERROR: NameService::config_nhi_addr(), duplicate nic nhi \"%s\" in ENVIRONMENT_INFO.\n", nicnhi.c_str());
-    }
-    nhi2ip_map->insert(S3FNET_MAKE_PAIR(nicnhi, ip));
-    ip2nicnhi_map->insert(S3FNET_MAKE_PAIR(ip, nicnhi));
+    nhi_info[nicid].ip = ip;
+    nhi_info[nicid].addressed = true;
+    ip2nic.insert(ip, nicid);
 
     NAMESVC_DUMP(printf("config_nhi_addr(): nhi \"%s\" <=> ip \"%s\".\n", nicnhi.c_str(), IPPrefix::ip2txt(ip)));
 
-    if(hostnhi2id_map)
+    int hostid = nhis.lookup(nicnhi.c_str(), pos);
+    if(hostid >= 0 && hostnicidx == nhi_info[hostid].defnic && !nhi_info[hostid].addressed)
     {
-      NHI2IDMAP::iterator iter = hostnhi2id_map->find(hostnhi);
-      if(iter != hostnhi2id_map->end() && hostnicidx == (*iter).second)
-      {
-        nhi2ip_map->insert(S3FNET_MAKE_PAIR(hostnhi, ip));
-        NAMESVC_DUMP(printf("config_nhi_addr(): nhi \"%s\" <=> ip \"%s\".\n", hostnhi.c_str(), IPPrefix::ip2txt(ip)));
-	  }
+      nhi_info[hostid].ip = ip;
+      nhi_info[hostid].addressed = true;
+      NAMESVC_DUMP(printf("config_nhi_addr(): nhi \"%s\" <=> ip \"%s\".\n", nhis.name(hostid), IPPrefix::ip2txt(ip)));
     }
   }
   delete ienum;
@@ -270,81 +270,57 @@ void NameService::config_nhi_addr(s3f::dml::Configuration* cfg)
 
 const char* NameService::hostname2align(const S3FNET_STRING& str)
 {
-  if(!hostname2nicnhi_map) return 0;
-  else
-  {
-    STR2STRMAP::iterator iter = hostname2nicnhi_map->find(str);
-    if(iter == hostname2nicnhi_map->end()) return 0;
-    else return nhi2align((*iter).second);
-  }
+  int nameid = hostnames.lookup(str.c_str());
+  if(nameid < 0) return 0;
+  else return nhi2align(nhis.name(hostname2nic[nameid]));
 }
 
-const char* NameService::nhi2align(const S3FNET_STRING& nhi)
+const char* NameService::nhi2align(const char* nhi)
 {
-  if(!hostnhi2align_map) return 0;
-
-  // remove the interface specification in nhi
-  S3FNET_STRING hostnhi;
-  int pos = nhi.find_first_of('(');
-  if(pos > 0) hostnhi = nhi.substr(0, pos);
-  else hostnhi = nhi;
-
-  STR2STRMAP::iterator iter = hostnhi2align_map->find(hostnhi);
-  if(iter == hostnhi2align_map->end()) return 0;
-  return (*iter).second.c_str();
+  NhiInfo* info = find_nhi(nhi, true);
+  if(!info || info->align < 0) return 0;
+  else return aligns.name(info->align);
 }
 
 IPADDR NameService::hostname2ip(const S3FNET_STRING& str)
 {
-  if(!hostname2nicnhi_map) return 0;
-  else
-  {
-    STR2STRMAP::iterator iter = hostname2nicnhi_map->find(str);
-    if(iter == hostname2nicnhi_map->end()) return 0;
-    else return nhi2ip((*iter).second);
-  }
+  int nameid = hostnames.lookup(str.c_str());
+  if(nameid < 0) return 0;
+  else return nhi_info[hostname2nic[nameid]].ip;
 }
 
-IPADDR NameService::nhi2ip(const S3FNET_STRING& nhi)
+IPADDR NameService::nhi2ip(const char* nhi)
 {
-  if(!nhi2ip_map) return IPADDR_INVALID;
-
-  NHI2IPMAP::iterator iter = nhi2ip_map->find(nhi);
-  if(iter == nhi2ip_map->end()) return IPADDR_INVALID;
-  else return (*iter).second;
+  int id = nhis.lookup(nhi);
+  if(id < 0) return IPADDR_INVALID;
+  else return nhi_info[id].ip;
 }
 
-const char* NameService::nhi2hostname(const S3FNET_STRING& nhi)
+IPADDR NameService::nhi2ip(Nhi& nhi)
 {
-  if(!hostnhi2hostname_map) return 0;
-
-  // remove the interface specification in nhi
-  S3FNET_STRING hostnhi;
-  int pos = nhi.find_first_of('(');
-  if(pos > 0) hostnhi = nhi.substr(0, pos);
-  else hostnhi = nhi;
+  char buf[255];
+  return nhi2ip(nhi.toString(buf));
+}
 
-  STR2STRMAP::iterator iter = hostnhi2hostname_map->find(hostnhi);
-  if(iter == hostnhi2hostname_map->end()) return 0;
-  else return (*iter).second.c_str();
+const char* NameService::nhi2hostname(const char* nhi)
+{
+  NhiInfo* info = find_nhi(nhi, true);
+  if(!info || info->hostname < 0) return 0;
+  else return hostnames.name(info->hostname);
 }
 
 const char* NameService::ip2nicnhi(IPADDR addr)
 {
-  if(!ip2nicnhi_map) return 0;
-
-  IP2NHIMAP::iterator iter = ip2nicnhi_map->find(addr);
-  if(iter == ip2nicnhi_map->end()) return 0;
-  else return (*iter).second.c_str();
+  int id = ip2nic.find(addr);
+  if(id < 0) return 0;
+  else return nhis.name(id);
 }
 
 const char* NameService::ip2align(IPADDR addr)
 {
-  if(!ip2nicnhi_map) return 0;
-
-  IP2NHIMAP::iterator iter = ip2nicnhi_map->find(addr);
-  if(iter == ip2nicnhi_map->end()) return 0;
-  else return nhi2align((*iter).second);
+  int id = ip2nic.find(addr);
+  if(id < 0) return 0;
+  else return nhi2align(nhis.name(id));
 }
 
 bool NameService::netnhi2prefix(const char* str, IPPrefix& prefix)
@@ -394,22 +370,54 @@ Mac48Address* NameService::ip2mac48(IPADDR addr)
 {
 	Mac48Address* mac48_addr = 0;
 
-	NetworkInterface* nw_inf = ip2iface(addr);
-	if(nw_inf != 0)
+	int id = ip2nic.find(addr);
+	if(id < 0) return 0;
+	if(nhi_info[id].iface)
 	{
-		mac48_addr = nw_inf->getMac48Addr();
+		mac48_addr = nhi_info[id].iface->getMac48Addr();
+	}
+	else if(nhi_info[id].remote)
+	{
+		mac48_addr = nhi_info[id].remote->mac48_addr;
 	}
 
 	return mac48_addr;
 }
 
-NetworkInterface* NameService::ip2iface(IPADDR addr)
+bool NameService::register_iface(IPADDR ip, NetworkInterface* iface)
 {
-	if(!ip2iface_map) return 0;
+	int id = ip2nic.find(ip);
+	if(id < 0) return false;
+
+	pthread_mutex_lock(&iface_mutex);
+	bool registered = !nhi_info[id].iface;
+	if(registered) nhi_info[id].iface = iface;
+	pthread_mutex_unlock(&iface_mutex);
+	return registered;
+}
 
-	IP2IFACE_MAP::iterator iter = ip2iface_map->find(addr);
-	if(iter == ip2iface_map->end()) return 0;
-	else return ((*iter).second);
+bool NameService::register_remote_iface(RemoteInterface* remote)
+{
+	int id = ip2nic.find(remote->ip_addr);
+	if(id < 0 || nhi_info[id].iface || nhi_info[id].remote) return false;
+	nhi_info[id].remote = remote;
+	return true;
+}
+
+RemoteInterface* NameService::nhi2remote(const char* nhi)
+{
+	IPADDR ip = nhi2ip(nhi);
+	if(ip == IPADDR_INVALID) return 0;
+	int id = ip2nic.find(ip);
+	if(id < 0) return 0;
+	else return nhi_info[id].remote;
+}
+
+NetworkInterface* NameService::ip2iface(IPADDR addr)
+{
+	int id = ip2nic.find(addr);
+	if(id < 0) return 0;
+	else return nhi_info[id].iface;
 }
 
 Host* NameService::ip2hostobj(IPADDR addr)
@@ -420,14 +428,14 @@ Host* NameService::ip2hostobj(IPADDR addr)
 	else return iface->getHost();
 }
 
-NetworkInterface* NameService::nicnhi2iface(const S3FNET_STRING& nhi)
+NetworkInterface* NameService::nicnhi2iface(const char* nhi)
 {
 	IPADDR ip = nhi2ip(nhi);
 	if(ip == IPADDR_INVALID) return 0;
 	else return ip2iface(ip);
 }
 
-Host* NameService::hostnhi2hostobj(const S3FNET_STRING& nhi)
+Host* NameService::hostnhi2hostobj(const char* nhi)
 {
 	IPADDR ip = nhi2ip(nhi);
 	if(ip == IPADDR_INVALID) return 0;
@@ -437,14 +445,19 @@ Host* NameService::hostnhi2hostobj(const S3FNET_STRING& nhi)
 void NameService::print_ip2iface_map()
 {
 	printf("print_ip2iface_map()\n");
-	IP2IFACE_MAP::iterator iter;
-	for (iter = ip2iface_map->begin(); iter != ip2iface_map->end(); iter++)
+	for(unsigned id = 0; id < nhi_info.size(); id++)
 	{
+		if(!nhi_info[id].iface) continue;
 		printf("ip = %s, iface = %p\n",
-				IPPrefix::ip2txt((IPADDR)((*iter).first)),
-				(NetworkInterface*)((*iter).second));
+				IPPrefix::ip2txt(nhi_info[id].ip), nhi_info[id].iface);
 	}
 }
 
+size_t NameService::memory() const
+{
+	return nhis.memory() + hostnames.memory() + aligns.memory() + ip2nic.memory() +
+		nhi_info.capacity()*sizeof(NhiInfo) + hostname2nic.capacity()*sizeof(int);
+}
+
 }; // namespace s3fnet
 }; // namespace s3f
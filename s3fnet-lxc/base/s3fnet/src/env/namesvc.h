@@ -8,8 +8,10 @@
 #ifndef __NAMESVC_H__
 #define __NAMESVC_H__
 
+#include <pthread.h>
 #include "dml.h"
 #include "net/cidr.h"
+#include "env/name_table.h"
 
 namespace s3f {
 namespace s3fnet {
@@ -18,38 +20,61 @@ class Net;
 class IPPrefix;
 class Host;
 class NetworkInterface;
+struct RemoteInterface;
 class Mac48Address;
+class Nhi;
 
 /**
  * \brief Global name resolution service.
  *
  * This class keeps global information. It can translate between host
  * name, ip address, nhi address, and the alignment names.
+ *
+ * The host and interface NHI addresses, host names and alignment
+ * names are interned once at config time; the information about each
+ * NHI address is kept in a vector indexed by its id, and IP addresses
+ * are resolved through an open addressing hash table. The lookups
+ * taking a const char* or an Nhi do not create temporary strings.
  */
 class NameService {
   friend class Net;
 
  public:
-  typedef S3FNET_MAP(S3FNET_STRING, S3FNET_STRING) STR2STRMAP;
-  typedef S3FNET_MAP(S3FNET_STRING, IPADDR) NHI2IPMAP;
-  typedef S3FNET_MAP(S3FNET_STRING, int) NHI2IDMAP;
-  typedef S3FNET_MAP(IPADDR, S3FNET_STRING) IP2NHIMAP;
-  typedef S3FNET_MAP(IPADDR, NetworkInterface*) IP2IFACE_MAP;
+  /** The constructor. */
+  NameService();
+
+  /** The destructor. */
+  virtual ~NameService();
+
+  /** Configure from DML. */
+  virtual void config(s3f::dml::Configuration* cfg);
 
   /** Resolve host name to alignment name. */
   const char* hostname2align(const string& str);
 
   /** Resolve Host Nhi or NIC Nhi (which is converted to Host Nhi) to alignment name. */
-  const char* nhi2align(const string& nhi);
+  const char* nhi2align(const string& nhi) { return nhi2align(nhi.c_str()); }
+
+  /** Resolve Host Nhi or NIC Nhi (which is converted to Host Nhi) to alignment name. */
+  const char* nhi2align(const char* nhi);
 
   /** Resolve host name to IPADDR. */
   IPADDR hostname2ip(const S3FNET_STRING& str);
 
   /** Resolve Host or NIC Nhi to IPADDR. */
-  IPADDR nhi2ip(const S3FNET_STRING& nhi);
+  IPADDR nhi2ip(const S3FNET_STRING& nhi) { return nhi2ip(nhi.c_str()); }
+
+  /** Resolve Host or NIC Nhi to IPADDR. */
+  IPADDR nhi2ip(const char* nhi);
+
+  /** Resolve Host or NIC Nhi to IPADDR. */
+  IPADDR nhi2ip(Nhi& nhi);
+
+  /** Resolve Host Nhi or NIC Nhi (converted to Host Nhi) to host name, if defined. */
+  const char* nhi2hostname(const S3FNET_STRING& nhi) { return nhi2hostname(nhi.c_str()); }
 
   /** Resolve Host Nhi or NIC Nhi (converted to Host Nhi) to host name, if defined. */
-  const char* nhi2hostname(const S3FNET_STRING& nhi);
+  const char* nhi2hostname(const char* nhi);
 
   /** Resolve IPADDR to the corresponding NIC Nhi. */
   const char* ip2nicnhi(IPADDR addr);
@@ -70,40 +95,79 @@ class NameService {
   Host* ip2hostobj(IPADDR addr);
 
   /** Resolve NIC Nhi to the corresponding NetworkInterface object. */
-  NetworkInterface* nicnhi2iface(const S3FNET_STRING& nhi);
+  NetworkInterface* nicnhi2iface(const S3FNET_STRING& nhi) { return nicnhi2iface(nhi.c_str()); }
+
+  /** Resolve NIC Nhi to the corresponding NetworkInterface object. */
+  NetworkInterface* nicnhi2iface(const char* nhi);
 
   /** Resolve Host Nhi to the corresponding Host object. */
-  Host* hostnhi2hostobj(const S3FNET_STRING& nhi);
+  Host* hostnhi2hostobj(const S3FNET_STRING& nhi) { return hostnhi2hostobj(nhi.c_str()); }
 
-  /** Resolve IPADDR to Mac48Address */
-  Mac48Address* ip2mac48(IPADDR addr);
+  /** Resolve Host Nhi to the corresponding Host object. */
+  Host* hostnhi2hostobj(const char* nhi);
 
-  /** Return the ip2iface_map */
-  IP2IFACE_MAP* get_ip2iface_map() { return ip2iface_map; }
+  /** Resolve IPADDR to Mac48Address, of an interface of this shard or of another. */
+  Mac48Address* ip2mac48(IPADDR addr);
 
-  /** Print the ip2iface_map */
+  /** Resolve IPADDR to the id of its NIC Nhi address, the same in every shard; -1 if unknown. */
+  int ip2nicid(IPADDR addr) { return ip2nic.find(addr); }
+
+  /**
+   * Resolve Host or NIC Nhi to the interface (the default one of a host)
+   * of a host built by another shard; NULL if the host is not one of them.
+   */
+  RemoteInterface* nhi2remote(const char* nhi);
+
+  /**
+   * Register the network interface with the given IP address; return
+   * false if an interface has already been registered with it. The
+   * interfaces register themselves while the hosts are configured in
+   * parallel, so the method is thread-safe. The lookups are not
+   * locked; they may be used once all hosts have been configured.
+   */
+  bool register_iface(IPADDR ip, NetworkInterface* iface);
+
+  /**
+   * Register the interface of a host built by another shard; return
+   * false if an interface has already been registered with its IP
+   * address. Called while the hosts are created, from one thread.
+   */
+  bool register_remote_iface(RemoteInterface* remote);
+
+  /** Print the registered network interfaces. */
   void print_ip2iface_map();
 
+  /** Return the number of bytes used by the name tables. */
+  size_t memory() const;
+
  protected:
   /** CIDR block for the entire network. */
   CidrBlock top_cidr_block;
 
-  STR2STRMAP* hostname2nicnhi_map; ///< map from host name to nic NHI address
-  STR2STRMAP* hostnhi2hostname_map; ///< map from host NHI address to host name
-  STR2STRMAP* hostnhi2align_map; ///< map from host NHI to the name of the alignment it belongs
-  NHI2IDMAP* hostnhi2id_map; ///< map from host NHI to index of its default interface
-  NHI2IPMAP* nhi2ip_map; ///< map from nic NHI to IPADDR
-  IP2NHIMAP* ip2nicnhi_map; ///< map from IPADDR to NHI
-  IP2IFACE_MAP* ip2iface_map; ///< map from IP to NetworkInterface* object
-
-  /** The constructor. */
-  NameService();
-
-  /** The destructor. */
-  virtual ~NameService();
-
-  /** Configure from DML. */
-  virtual void config(s3f::dml::Configuration* cfg);
+  /** What is known about a host or nic NHI address. */
+  struct NhiInfo {
+    IPADDR ip; ///< ip address of the nic, or of the default nic of the host
+    int align; ///< alignment of the host (id in aligns), or -1
+    int hostname; ///< name of the host (id in hostnames), or -1
+    int defnic; ///< index of the default interface of the host, or -1
+    bool addressed; ///< whether the nic has been given an ip address
+    NetworkInterface* iface; ///< the registered nic object, or NULL
+    RemoteInterface* remote; ///< the nic of a host built by another shard, or NULL
+  };
+
+  NameTable nhis; ///< host and nic NHI addresses
+  NameTable hostnames; ///< names of the named hosts
+  NameTable aligns; ///< alignment names
+  S3FNET_VECTOR(NhiInfo) nhi_info; ///< indexed by the id of the NHI address
+  S3FNET_VECTOR(int) hostname2nic; ///< nic NHI id of each host name
+  IPIndex ip2nic; ///< map from IPADDR to the nic NHI id (the first nic wins)
+  pthread_mutex_t iface_mutex; ///< protects the interface registration during the config phase
+
+  /** Intern the NHI address and return its id; a new one gets an empty info record. */
+  int intern_nhi(const char* nhi, int len = -1);
+
+  /** Return the info record of the NHI address, stripped of its interface part if asked; NULL if unknown. */
+  NhiInfo* find_nhi(const char* nhi, bool hostpart);
 
   // helper function for the config method
   void config_topnet_cidr(s3f::dml::Configuration* cfg);
@@ -0,0 +1,145 @@
+/**
+ * \file checkpoint.cc
+ * \brief Source file for the Checkpoint class.
+ *
+ * authors : Dong (Kevin) Jin
+ */
+
+#include <string.h>
+#include <unistd.h>
+#include "net/checkpoint.h"
+#include "net/net.h"
+#include "net/host.h"
+#include "os/base/protocol_message.h"
+#include "util/errhandle.h"
+
+#ifdef CHECKPOINT_DEBUG
+#define CKPT_DUMP(x) printf("CKPT: "); x
+#else
+#define CKPT_DUMP(x)
+#endif
+
+namespace s3f {
+namespace s3fnet {
+
+bool Checkpoint::save(const char* file, Interface* iface, Net* topnet)
+{
+  FILE* fp = fopen(file, "wb");
+  if(!fp)
+  {
+    error_retn("WARNING: Checkpoint::save(), can't open checkpoint file %s.\n", file);
+    return false;
+  }
+
+  // the clock and the packets in flight first, then the hosts
+  Checkpoint ckpt(fp);
+  bool ok = iface->checkpoint(fp, &ckpt) && topnet->save_state(&ckpt);
+  if(fclose(fp) || ckpt.failed) ok = false;
+  if(!ok)
+  {
+    unlink(file);
+    error_retn("WARNING: Checkpoint::save(), no checkpoint written to %s.\n", file);
+    return false;
+  }
+  CKPT_DUMP(printf("saved at time %ld to %s\n", iface->clock(), file));
+  return true;
+}
+
+void Checkpoint::restore(const char* file, Interface* iface, Net* topnet)
+{
+  FILE* fp = fopen(file, "rb");
+  if(!fp) error_quit("ERROR: Checkpoint::restore(), can't open checkpoint file %s.\n", file);
+
+  // the kernel discards the events scheduled by the init methods
+  // before the protocol sessions schedule their timeouts again
+  Checkpoint ckpt(fp);
+  if(!iface->restore(fp, &ckpt))
+    error_quit("ERROR: Checkpoint::restore(), can't restore %s in this model.\n", file);
+  topnet->restore_state(&ckpt);
+
+  char c;
+  if(fread(&c, 1, 1, fp) == 1)
+    error_quit("ERROR: Checkpoint::restore(), the checkpoint %s does not match the model.\n", file);
+  fclose(fp);
+  CKPT_DUMP(printf("restored at time %ld from %s\n", iface->clock(), file));
+}
+
+void Checkpoint::write(const void* buf, size_t n)
+{
+  if(fwrite(buf, 1, n, fp) != n) failed = true;
+}
+
+void Checkpoint::read(void* buf, size_t n)
+{
+  if(n > 0 && fread(buf, 1, n, fp) != n)
+    error_quit("ERROR: Checkpoint::read(), truncated checkpoint.\n");
+}
+
+void Checkpoint::putString(const char* str)
+{
+  int32 len = str ? strlen(str) : -1;
+  put(len);
+  if(len > 0) write(str, len);
+}
+
+S3FNET_STRING Checkpoint::getString()
+{
+  int32 len;
+  get(len);
+  if(len <= 0) return S3FNET_STRING();
+  S3FNET_STRING str(len, '\0');
+  read(&str[0], len);
+  return str;
+}
+
+void Checkpoint::putRandom(Random::RNG* rng)
+{
+  if(!rng->SaveState(fp)) failed = true;
+}
+
+void Checkpoint::getRandom(Random::RNG* rng)
+{
+  if(!rng->LoadState(fp))
+    error_quit("ERROR: Checkpoint::getRandom(), the random stream was saved with another rng_type.\n");
+}
+
+bool Checkpoint::putMessage(ProtocolMessage* msg)
+{
+  vector<byte> buf;
+  if(!msg->serializeAll(buf)) return false;
+  int32 size = buf.size();
+  put(size);
+  write(&buf[0], size);
+  return true;
+}
+
+ProtocolMessage* Checkpoint::getMessage()
+{
+  int32 size;
+  get(size);
+  vector<byte> buf(size);
+  read(&buf[0], size);
+  ProtocolMessage* msg = ProtocolMessage::deserializeAll(&buf[0], size);
+  if(!msg) error_quit("ERROR: Checkpoint::getMessage(), unregistered protocol message type.\n");
+  return msg;
+}
+
+bool Checkpoint::save_activation(Activation act, FILE* file)
+{
+  ProtocolMessage* msg = dynamic_cast<ProtocolMessage*>(act);
+  return msg && putMessage(msg) && !failed;
+}
+
+Activation Checkpoint::load_activation(FILE* file)
+{
+  return getMessage();
+}
+
+int Checkpoint::saved_timeouts(Entity* ent)
+{
+  Host* host = dynamic_cast<Host*>(ent);
+  return host ? host->saved_timeouts() : 0;
+}
+
+}; // namespace s3fnet
+}; // namespace s3f
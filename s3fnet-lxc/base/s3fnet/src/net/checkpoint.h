@@ -0,0 +1,111 @@
+/**
+ * \file checkpoint.h
+ * \brief Header file for the Checkpoint class.
+ *
+ * authors : Dong (Kevin) Jin
+ */
+
+#ifndef __CHECKPOINT_H__
+#define __CHECKPOINT_H__
+
+#include "s3f.h"
+#include "s3fnet.h"
+#include "util/shstl.h"
+
+namespace s3f {
+namespace s3fnet {
+
+class Net;
+class ProtocolMessage;
+
+/**
+ * \brief A checkpoint of the simulation, taken between two epochs.
+ *
+ * Between epochs all the timelines are parked in the window barrier,
+ * which is a consistent cut of the simulation. A checkpoint written
+ * there holds the simulation clock, the packets in flight on the
+ * links (the protocol messages are packed with their serialize()
+ * method), and the state of every host: its random streams and the
+ * dynamic state of its protocol sessions, which includes their
+ * pending timeouts. Restoring the checkpoint in a run built from the
+ * same network model (the parameters of the protocols, read from the
+ * DML, may differ) continues the simulation from the time of the
+ * checkpoint, e.g. to run several experiments from one warmed-up
+ * state.
+ *
+ * Only the protocol sessions (and the protocol messages) that
+ * implement the checkpoint methods can be saved; if one of the hosts
+ * runs another one, the checkpoint is refused, naming the protocol
+ * session. The file is binary and meant to be restored on the same
+ * platform.
+ */
+class Checkpoint : public CheckpointCodec {
+ public:
+  /**
+   * Save the simulation to the given file. It must be called by the
+   * control thread between two epochs. Return false, with a message,
+   * if some of the state cannot be saved; the file is removed.
+   */
+  static bool save(const char* file, Interface* iface, Net* topnet);
+
+  /**
+   * Restore the simulation from the given file, once the model has
+   * been initialized and before the first epoch. The program quits
+   * if the checkpoint cannot be restored in this model.
+   */
+  static void restore(const char* file, Interface* iface, Net* topnet);
+
+  /** Write n bytes to the checkpoint. */
+  void write(const void* buf, size_t n);
+
+  /** Read n bytes from the checkpoint; quit if the file is truncated. */
+  void read(void* buf, size_t n);
+
+  /** Write a value of a plain type. */
+  template<class T> void put(const T& val) { write(&val, sizeof(T)); }
+
+  /** Read a value of a plain type. */
+  template<class T> void get(T& val) { read(&val, sizeof(T)); }
+
+  /** Write a string (which may be NULL). */
+  void putString(const char* str);
+
+  /** Read a string. */
+  S3FNET_STRING getString();
+
+  /** Write the state of a random stream. */
+  void putRandom(Random::RNG* rng);
+
+  /** Restore the state of a random stream; it must be of the same kind. */
+  void getRandom(Random::RNG* rng);
+
+  /**
+   * Write a protocol message and its payload. Return false if one of
+   * the headers cannot be saved (see ProtocolMessage::serializable).
+   */
+  bool putMessage(ProtocolMessage* msg);
+
+  /** Read back a protocol message written by putMessage(). */
+  ProtocolMessage* getMessage();
+
+  /** Save an activation in flight; only protocol messages can be. */
+  virtual bool save_activation(Activation act, FILE* fp);
+
+  /** Read back an activation saved by save_activation(). */
+  virtual Activation load_activation(FILE* fp);
+
+  /** Return the number of timeouts the state of the entity (a host) saves. */
+  virtual int saved_timeouts(Entity* ent);
+
+ private:
+  /** The constructor, on an open file. */
+  Checkpoint(FILE* _fp) : fp(_fp), failed(false) {}
+
+  FILE* fp;    ///< the checkpoint file
+  bool failed; ///< whether a write has failed
+};
+
+}; // namespace s3fnet
+}; // namespace s3f
+
+#endif /*__CHECKPOINT_H__*/
@@ -10,6 +10,7 @@
 #include "net/host.h"
 #include "net/network_interface.h"
 #include "os/base/protocol_message.h"
+#include "net/checkpoint.h"
 
 #ifdef IFACE_DEBUG
 #define IFACE_DUMP(x) printf("NIC: "); x
@@ -92,5 +93,18 @@ ltime_t DroptailQueue::calibrate(int len)
   return jitter;
 }
 
+bool DroptailQueue::save_state(Checkpoint* ckpt)
+{
+  ckpt->put(last_xmit_time);
+  ckpt->put(queue_delay);
+  return true;
+}
+
+void DroptailQueue::restore_state(Checkpoint* ckpt)
+{
+  ckpt->get(last_xmit_time);
+  ckpt->get(queue_delay);
+}
+
 }; // namespace s3fnet
 }; // namespace s3f
@@ -53,6 +53,12 @@ class DroptailQueue: public NicQueue {
    * be dropped.
    */
   void enqueue(Activation msg);
+
+  /** Save the queueing delay to a checkpoint. */
+  virtual bool save_state(Checkpoint* ckpt);
+
+  /** Restore the queueing delay from a checkpoint. */
+  virtual void restore_state(Checkpoint* ckpt);
   
  protected:
   /**
@@ -184,11 +184,13 @@ RouteInfo* RouteInfo::resolve(Host* machine)
     
     // find the other attachment point to be the next hop
     //S3FNET_STRING_VECTOR& v = link->getIfaceNhis();
-    vector<NetworkInterface*> ifaces = link->getNetworkInterfaces();
+    S3FNET_STRING_VECTOR nhis;
+    S3FNET_VECTOR(IPADDR) ips;
+    link->getAttachments(nhis, ips);
 
-    for(unsigned i = 0; i < ifaces.size(); i++)
+    for(unsigned i = 0; i < ips.size(); i++)
     {
-      next_hop = ifaces[i]->getIP();
+      next_hop = ips[i];
       if(next_hop != local_ip) break;
     }
   }
@@ -196,10 +198,12 @@ RouteInfo* RouteInfo::resolve(Host* machine)
   { // if next hop is specified, make sure it's one of the attachment points
     bool found = false;
     //S3FNET_STRING_VECTOR& v = link->getIfaceNhis();
-    vector<NetworkInterface*> ifaces = link->getNetworkInterfaces();
-    for(unsigned i = 0; i < ifaces.size(); i++)
+    S3FNET_STRING_VECTOR nhis;
+    S3FNET_VECTOR(IPADDR) ips;
+    link->getAttachments(nhis, ips);
+    for(unsigned i = 0; i < ips.size(); i++)
     {
-      IPADDR attached = ifaces[i]->getIP();
+      IPADDR attached = ips[i];
       if(attached == next_hop)
       { // note that next hop cannot be local ip (see above)
     	found = true;
@@ -521,13 +525,13 @@ RouteInfo* DMLRouteInfo::resolve(Host* machine)
       if(dst_str[0] != ':')
       {
         NameService* namesvc = machine->inNet()->getNameService();
-	    route->destination.addr = namesvc->nhi2ip(S3FNET_STRING(dst_str));
+	    route->destination.addr = namesvc->nhi2ip(dst_str);
       }
       else
       {
 	    // we need to strip off the first colon if necessary
     	NameService* namesvc = machine->inNet()->getNameService();
-	    route->destination.addr = namesvc->nhi2ip(S3FNET_STRING(&dst_str[1]));
+	    route->destination.addr = namesvc->nhi2ip(&dst_str[1]);
       }
     }
 
@@ -585,12 +589,14 @@ RouteInfo* DMLRouteInfo::resolve(Host* machine)
     
     // get the other ip address to be the next hop address
     //S3FNET_STRING_VECTOR& v = link->getIfaceNhis();
-    vector<NetworkInterface*> ifaces = link->getNetworkInterfaces();
+    S3FNET_STRING_VECTOR nhis;
+    S3FNET_VECTOR(IPADDR) ips;
+    link->getAttachments(nhis, ips);
 
     IPADDR local_ip = route->nic->getIP();
-    for(unsigned i = 0; i < ifaces.size(); i++)
+    for(unsigned i = 0; i < ips.size(); i++)
     {
-      route->next_hop = ifaces[i]->getIP();
+      route->next_hop = ips[i];
       if(route->next_hop != local_ip) break;
     }
   }
@@ -612,15 +618,17 @@ RouteInfo* DMLRouteInfo::resolve(Host* machine)
     }
 
     //S3FNET_STRING_VECTOR& v = link->getIfaceNhis();
-    vector<NetworkInterface*> ifaces = link->getNetworkInterfaces();
+    S3FNET_STRING_VECTOR nhis;
+    S3FNET_VECTOR(IPADDR) ips;
+    link->getAttachments(nhis, ips);
     bool found = false; int i;
 
     // we first assume it's relative
-    for(i=0; i<(int)ifaces.size(); i++)
+    for(i=0; i<(int)nhis.size(); i++)
     {
-      if(ifaces[i]->nhi.toStlString() == abs_addr)
+      if(nhis[i] == abs_addr)
       {
-    	  route->next_hop = ifaces[i]->getIP();
+    	  route->next_hop = ips[i];
     	  found = true;
     	  break;
       }
@@ -631,11 +639,11 @@ RouteInfo* DMLRouteInfo::resolve(Host* machine)
     // previous step
     if(!found && nexthop_str[0] != ':')
     {
-      for(i=0; i<(int)ifaces.size(); i++)
+      for(i=0; i<(int)nhis.size(); i++)
       {
-    	  if(ifaces[i]->nhi.toStlString() == S3FNET_STRING(nexthop_str))
+    	  if(nhis[i] == S3FNET_STRING(nexthop_str))
     	  {
-    		  route->next_hop = ifaces[i]->getIP();
+    		  route->next_hop = ips[i];
     		  found = true;
     		  break;
     	  }
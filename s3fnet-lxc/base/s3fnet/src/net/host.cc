@@ -12,6 +12,7 @@
 #include "net/network_interface.h"
 #include "net/forwardingtable.h"
 #include "env/namesvc.h"
+#include "net/checkpoint.h"
 
 namespace s3f {
 namespace s3fnet {
@@ -23,7 +24,7 @@ namespace s3fnet {
 #endif
 
 Host::Host(Timeline* tl, Net* parent, long hostid) : Entity(tl), DmlObject(parent, hostid),
-		host_seed(0), is_router(false), is_switch(false), network_prot(0)
+		rng(0), rng_key(0), rng_substreams(0), host_seed(0), is_router(false), is_switch(false), network_prot(0)
 {
   HOST_DUMP(printf("[id=%ld] new host.\n", id));
   int i;
@@ -163,10 +164,44 @@ void Host::config(s3f::dml::Configuration* cfg)
   {
 		isCompromised = true;
   }
+}
+
+void Host::finish_config(s3f::dml::Configuration* cfg)
+{
+  S3FNET_HOST_IFACE_MAP::iterator iter;
+  for(iter = ifaces.begin(); iter != ifaces.end(); iter++)
+    (*iter).second->finish_config();
 
   initLxcProxy(cfg);
 }
 
+bool Host::counter_based_rng = false;
+unsigned long Host::rng_seed = 0;
+
+void Host::create_random_streams()
+{
+  if(!rng) rng = new_random_stream();
+
+  // the streams of the sessions are created in the same order as
+  // the sessions are initialized
+  if(host_seed != 0)
+  {
+    ProtocolGraph::create_random_streams(this);
+    S3FNET_HOST_IFACE_MAP::iterator iter;
+    for(iter = ifaces.begin(); iter != ifaces.end(); iter++)
+      (*iter).second->create_random_streams(this);
+  }
+}
+
+Random::RNG* Host::new_random_stream()
+{
+  if(!counter_based_rng) return new Random::RNG();
+
+  if(!rng_key)
+    rng_key = RNGS::PhiloxStream::HashKey(nhi.toStlString().c_str(), rng_seed);
+  return new Random::RNG(rng_key, rng_substreams++);
+}
+
 void Host::initLxcProxy(s3f::dml::Configuration* cfg)
 {
 	char* lxcstr = (char*) cfg->findSingle("isEmulated");
@@ -216,13 +251,16 @@ void Host::init()
   if(ifaces.empty())
     error_retn("WARNING: Host nhi=\"%s\" has no active interface.\n", nhi.toString());
 
-  rng = new Random::RNG();
+  // normally created beforehand by create_random_streams(), except
+  // for counter-based streams, which are created here in parallel
+  if(!rng) create_random_streams();
 
   HOST_DUMP(printf("[calling ProtocolGraph init() nhi=\"%s\"] init().\n", nhi.toString()));
   ProtocolGraph::init();
 
   HOST_DUMP(printf("[creating new listen Process nhi=\"%s\"] init().\n", nhi.toString()));
   listen_proc = new Process( (Entity *)this, (void (s3f::Entity::*)(s3f::Activation))&Host::listen);
+  listen_proc->set_name("Host::listen");
 
   //init all network interfaces, and binding the "listen" process to the InChannels
   S3FNET_HOST_IFACE_MAP::iterator iter;
@@ -289,7 +327,7 @@ void Host::loadForwardingTable(s3f::dml::Configuration* cfg)
 IPADDR Host::getDefaultIP()
 {
   NameService* namesvc = inNet()->getNameService();
-  return namesvc->nhi2ip(nhi.toStlString());
+  return namesvc->nhi2ip(nhi);
 }
 
 NetworkInterface* Host::getNetworkInterfaceByIP(IPADDR ipaddr)
@@ -308,6 +346,64 @@ void Host::display(int indent)
   printf("%*cHost %lu", indent, ' ', id);
 }
 
+bool Host::save_state(Checkpoint* ckpt)
+{
+  if(isEmulated)
+  {
+    error_retn("WARNING: [host=\"%s\"] Host::save_state(), the state of an emulated host "
+	       "can't be saved.\n", nhi.toString());
+    return false;
+  }
+
+  ckpt->putString(nhi.toString());
+  ckpt->putRandom(rng);
+  if(!save_sessions(ckpt)) return false;
+  uint32 n = ifaces.size();
+  ckpt->put(n);
+  for(S3FNET_HOST_IFACE_MAP::iterator iter = ifaces.begin();
+      iter != ifaces.end(); iter++)
+  {
+    int32 ifid = (*iter).first;
+    ckpt->put(ifid);
+    if(!(*iter).second->save_state(ckpt)) return false;
+  }
+  return true;
+}
+
+void Host::restore_state(Checkpoint* ckpt)
+{
+  S3FNET_STRING name = ckpt->getString();
+  if(name != nhi.toString())
+    error_quit("ERROR: Host::restore_state(), the checkpoint has host %s in place of %s.\n",
+	       name.c_str(), nhi.toString());
+  ckpt->getRandom(rng);
+  restore_sessions(ckpt);
+  uint32 n;
+  ckpt->get(n);
+  if(n != ifaces.size())
+    error_quit("ERROR: [host=\"%s\"] Host::restore_state(), the checkpoint has %u network interfaces, "
+	       "the host has %u.\n", nhi.toString(), n, (unsigned)ifaces.size());
+  for(S3FNET_HOST_IFACE_MAP::iterator iter = ifaces.begin();
+      iter != ifaces.end(); iter++)
+  {
+    int32 ifid;
+    ckpt->get(ifid);
+    if(ifid != (*iter).first)
+      error_quit("ERROR: [host=\"%s\"] Host::restore_state(), the checkpoint has network interface %d "
+		 "in place of %d.\n", nhi.toString(), ifid, (*iter).first);
+    (*iter).second->restore_state(ckpt);
+  }
+}
+
+int Host::saved_timeouts()
+{
+  int n = session_timeouts();
+  for(S3FNET_HOST_IFACE_MAP::iterator iter = ifaces.begin();
+      iter != ifaces.end(); iter++)
+    n += (*iter).second->session_timeouts();
+  return n;
+}
+
 ProtocolSession* Host::getNetworkLayerProtocol()
 { 
   if(!network_prot)
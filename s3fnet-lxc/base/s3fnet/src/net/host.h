@@ -19,6 +19,7 @@ namespace s3fnet {
 
 class NetworkInterface;
 class Net;
+class Checkpoint;
 
 typedef S3FNET_MAP(int,NetworkInterface*) S3FNET_HOST_IFACE_MAP;
 
@@ -62,6 +63,40 @@ class Host : public Entity, public DmlObject, public ProtocolGraph {
    */
   virtual void config(s3f::dml::Configuration* cfg);
 
+  /**
+   * Finish the configuration of the host. Hosts are configured in
+   * parallel by the timeline threads; this method is then called for
+   * each host in the order the hosts were created, to assign the mac
+   * addresses of the interfaces and register the lxc proxy.
+   */
+  void finish_config(s3f::dml::Configuration* cfg);
+
+  /**
+   * Create the random number generator of this host and, if each
+   * protocol session has its own random stream, those of the protocol
+   * sessions. It is called for each host in a fixed order before the
+   * hosts are initialized in parallel, so that the streams assigned
+   * do not depend on the order in which the threads run.
+   */
+  void create_random_streams();
+
+  /**
+   * Return a new random stream for this host or one of its protocol
+   * sessions. With the default generator, this is the next stream of
+   * the MRG32k3a package, so the stream depends on the order in which
+   * the streams are created across all hosts. With the counter-based
+   * generator, the stream is keyed by the NHI address of the host and
+   * the seed, and numbered within the host; it needs no lock and is
+   * the same whatever the order in which the hosts are built.
+   */
+  Random::RNG* new_random_stream();
+
+  /** Whether the hosts use counter-based random streams (DML attribute rng_type "philox"). */
+  static bool counter_based_rng;
+
+  /** The seed (DML attribute seed) mixed into the keys of the counter-based streams. */
+  static unsigned long rng_seed;
+
   /**
    * The init method is used to initialize the host once it has been
    * configured. The init method will initialize the interfaces and
@@ -111,6 +146,19 @@ class Host : public Entity, public DmlObject, public ProtocolGraph {
   /** Print out the name of this host. */
   virtual void display(int indent = 0);
 
+  /**
+   * Save the random stream of the host and the state of its protocol
+   * sessions and network interfaces to a checkpoint. Return false if
+   * some of the state cannot be saved; an emulated host cannot be.
+   */
+  bool save_state(Checkpoint* ckpt);
+
+  /** Restore the state of the host from a checkpoint. */
+  void restore_state(Checkpoint* ckpt);
+
+  /** Return the number of timeouts the state of the host saves. */
+  int saved_timeouts();
+
   /** print out the current simulation time with thousand separator */
   char* getNowWithThousandSeparator();
 
@@ -133,6 +181,12 @@ class Host : public Entity, public DmlObject, public ProtocolGraph {
    * of the host id.
    */
   Random::RNG* rng;
+
+  /** The key of the counter-based streams of this host, 0 until the first one is created. */
+  unsigned long long rng_key;
+
+  /** The number of counter-based streams created on this host. */
+  unsigned long long rng_substreams;
  
 
   /**
@@ -33,10 +33,9 @@ IPADDR IPPrefix::masks[33] = {
   0xFFFFFFF8,0xFFFFFFFC,0xFFFFFFFE,0xFFFFFFFF
 };
 
-// CAUTION: there could be a problem with global static variables;
-// they may be shared and unprotected for simultaneous access by
-// multiple threads!!!
-char IPPrefix::dispbuf[50];
+// the display buffer is per thread, since the timelines (and the
+// hosts configured in parallel by them) print addresses concurrently
+__thread char IPPrefix::dispbuf[50];
 
 char* IPPrefix::ip2txt(IPADDR ip, char* str)
 {
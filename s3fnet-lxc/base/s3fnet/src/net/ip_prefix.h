@@ -139,8 +139,8 @@ class IPPrefix {
   static IPADDR masks[33];
 
   /** The buffer used to store the textual representation of this
-      prefix for display. */
-  static char dispbuf[50];
+      prefix for display; one per thread. */
+  static __thread char dispbuf[50];
 };
 
 }; // namespace s3fnet
@@ -10,6 +10,8 @@
 #include "net/host.h"
 #include "util/errhandle.h"
 #include "net/network_interface.h"
+#include "env/namesvc.h"
+#include "os/simple_mac/simple_mac_message.h"
 
 
 namespace s3f {
@@ -63,9 +65,12 @@ void Link::config(s3f::dml::Configuration* cfg)
     S3FNET_STRING nhi = myParent->myParent ? (pnhi + ":" + str) : str;
     LINK_DUMP(printf("\t %s \n", nhi.c_str()));
 
-    //add all attached network_interfaces
+    //add all attached network_interfaces; those of hosts built by other shards are only known by name
     NetworkInterface* iface = (NetworkInterface*)(owner_net->nicnhi_to_obj(nhi));
-    connected_nw_iface_vec.push_back(iface);
+    RemoteInterface* remote = iface ? 0 : owner_net->getNameService()->nhi2remote(nhi.c_str());
+    if(iface) connected_nw_iface_vec.push_back(iface);
+    else if(remote) remote_iface_vec.push_back(remote);
+    else error_quit("ERROR: Link::config(), unknown network interface \"%s\" in LINK.ATTACH.\n", nhi.c_str());
   }
   delete aenum;
 
@@ -75,11 +80,11 @@ int Link::connect(Net* pNet)
 {
   LINK_DUMP(printf("connect().\n"));
 
-  /* the default switched Ethernet type connection, size of connected_nw_iface_vec is always 2
-     which is not true for CSMA type connection */
-  if(connected_nw_iface_vec.size()!=2)
+  /* the default switched Ethernet type connection has two interfaces; a shared
+     segment (CSMA type connection) has more */
+  if(getNumOfNetworkInterface() < 2)
   {
-	  LINK_DUMP(printf("connected_nw_iface_vec has size %d.\n", (int)connected_nw_iface_vec.size()));
+	  LINK_DUMP(printf("connected_nw_iface_vec has size %d.\n", getNumOfNetworkInterface()));
 	  error_quit("ERROR: Link::connect(), invalid size of connected_nw_iface_vec vector.\n");
   }
 
@@ -107,20 +112,63 @@ int Link::connect(Net* pNet)
 	    iface->attach_to_link(this);
   }
 
+  // the InChannels of the attached interfaces, the local ones first; an
+  // interface of another shard is written to through the stub of its
+  // InChannel, shared by the links of this shard
+  vector<InChannel*> ics;
+  for(unsigned i=0; i<connected_nw_iface_vec.size(); i++)
+    ics.push_back(connected_nw_iface_vec[i]->ic);
+  for(unsigned i=0; i<remote_iface_vec.size(); i++)
+  {
+    RemoteInterface* remote = remote_iface_vec[i];
+    if(!remote->ic)
+      remote->ic = pNet->getSimInterface()->get_timeline_interface()->shards->remote_inchannel(remote->alignment, remote->key);
+    ics.push_back(remote->ic);
+  }
+
   //map InChannel and OutChannel
   /* use link delay in dml as mapping delay, it can be equal to min_packet_size/max_bandwidth + propagation delay,
   may need to compute here instead of getting directly from dml */
-  NetworkInterface* iface1 = connected_nw_iface_vec[0];
-  NetworkInterface* iface2 = connected_nw_iface_vec[1];
-  iface1->oc->mapto(iface2->ic, iface1->getHost()->d2t(delay, 0));
-  iface2->oc->mapto(iface1->ic, iface2->getHost()->d2t(delay, 0));
-  iface1->is_oc_connected = true;
-  iface1->is_ic_connected = true;
-  iface2->is_oc_connected = true;
-  iface2->is_ic_connected = true;
-
-  iface1->dst_nic = iface2;
-  iface2->dst_nic = iface1;
+  if(isMultiAccess())
+  {
+    // every interface can reach all the others; the MAC addresses,
+    // allocated when the hosts are configured, pick the target of a unicast frame
+    for(unsigned i=0; i<connected_nw_iface_vec.size(); i++)
+    {
+      NetworkInterface* iface = connected_nw_iface_vec[i];
+      for(unsigned j=0; j<ics.size(); j++)
+      {
+        if(i == j) continue;
+        iface->oc->mapto(ics[j], iface->getHost()->d2t(delay, 0));
+      }
+      iface->is_oc_connected = true;
+      iface->is_ic_connected = true;
+    }
+    for(unsigned j=0; j<ics.size(); j++)
+    {
+      Mac48Address* mac = (j < connected_nw_iface_vec.size()) ? connected_nw_iface_vec[j]->getMac48Addr() :
+          remote_iface_vec[j-connected_nw_iface_vec.size()]->mac48_addr;
+      assert(mac);
+      if(!mac_to_iface.insert(S3FNET_MAKE_PAIR(*mac, ics[j])).second)
+        error_quit("ERROR: Link::connect(), duplicate MAC address on link.\n");
+    }
+    LINK_DUMP(printf("connect(): shared segment of %d interfaces.\n", (int)ics.size()));
+    return 0;
+  }
+
+  for(unsigned i=0; i<connected_nw_iface_vec.size(); i++)
+  {
+    NetworkInterface* iface = connected_nw_iface_vec[i];
+    iface->oc->mapto(ics[1-i], iface->getHost()->d2t(delay, 0));
+    iface->is_oc_connected = true;
+    iface->is_ic_connected = true;
+  }
+
+  if(connected_nw_iface_vec.size() == 2)
+  {
+    connected_nw_iface_vec[0]->dst_nic = connected_nw_iface_vec[1];
+    connected_nw_iface_vec[1]->dst_nic = connected_nw_iface_vec[0];
+  }
 
   return 0;
 }
@@ -137,6 +185,10 @@ void Link::display(int indent)
   {
     printf("%s ", connected_nw_iface_vec[i]->nhi.toStlString().c_str());
   }
+  for (unsigned int i=0; i < remote_iface_vec.size(); i++)
+  {
+    printf("%s ", remote_iface_vec[i]->nhi.c_str());
+  }
   printf(" ]\n");
 }
 
@@ -148,9 +200,38 @@ Link* Link::createLink(Net* theNet, s3f::dml::Configuration* cfg)
   return link;
 }
 
+InChannel* Link::getUnicastTarget(Activation frame)
+{
+  // on a point-to-point link the one peer gets every frame anyway
+  if(!isMultiAccess()) return 0;
+
+  // only the simple MAC header is known here; other frames are flooded
+  ProtocolMessage* hdr = (ProtocolMessage*)frame;
+  if(hdr->type() != S3FNET_PROTOCOL_TYPE_SIMPLE_MAC) return 0;
+  Mac48Address* dst = ((SimpleMacMessage*)hdr)->dst48;
+  if(!dst || dst->IsGroup()) return 0;
+
+  S3FNET_MAP(Mac48Address, InChannel*)::iterator iter = mac_to_iface.find(*dst);
+  return (iter != mac_to_iface.end()) ? iter->second : 0;
+}
+
 int Link::getNumOfNetworkInterface()
 {
-	return (int)connected_nw_iface_vec.size();
+	return (int)(connected_nw_iface_vec.size() + remote_iface_vec.size());
+}
+
+void Link::getAttachments(S3FNET_STRING_VECTOR& nhis, S3FNET_VECTOR(IPADDR)& ips)
+{
+	for(unsigned i = 0; i < connected_nw_iface_vec.size(); i++)
+	{
+		nhis.push_back(connected_nw_iface_vec[i]->nhi.toStlString());
+		ips.push_back(connected_nw_iface_vec[i]->getIP());
+	}
+	for(unsigned i = 0; i < remote_iface_vec.size(); i++)
+	{
+		nhis.push_back(remote_iface_vec[i]->nhi);
+		ips.push_back(remote_iface_vec[i]->ip_addr);
+	}
 }
 
 }; // namespace s3fnet
@@ -11,15 +11,27 @@
 #include "util/shstl.h"
 #include "net/ip_prefix.h"
 #include "net/dmlobj.h"
+#include "net/mac48_address.h"
 
 namespace s3f {
 namespace s3fnet {
 
 class Net;
 class NetworkInterface;
+struct RemoteInterface;
 
 /** 
  * \brief A link that connects interfaces.
+ *
+ * A link attaches two interfaces (point-to-point), or more (a shared
+ * segment, e.g. a LAN of devices). On a shared segment every interface
+ * is mapped to all the others, but a unicast frame is delivered only to
+ * the interface that owns its destination MAC address; broadcast and
+ * multicast frames, and frames for an address not on the segment, go to
+ * all of them.
+ *
+ * In a sharded simulation an attached interface may belong to a host of
+ * another shard; it is then mapped to through the stub of its InChannel.
  */
 class Link : public DmlObject {
   friend class Net;
@@ -50,13 +62,23 @@ class Link : public DmlObject {
   /** Return the delay of the link. */
   inline double getDelay() { return delay; }
 
+  /** Return the number of attached interfaces, of this shard or another. */
   int getNumOfNetworkInterface();
 
   /**
-   * Return the vector of all the connected network interfaces.
+   * Return the NHI and IP addresses of all the attached interfaces, of
+   * this shard or another.
    */
+  void getAttachments(S3FNET_STRING_VECTOR& nhis, S3FNET_VECTOR(IPADDR)& ips);
 
-  vector<NetworkInterface*> getNetworkInterfaces() { return connected_nw_iface_vec;}
+  /** Return whether more than two interfaces share the link. */
+  bool isMultiAccess() { return getNumOfNetworkInterface() > 2; }
+
+  /**
+   * Return the InChannel a frame sent on the link is addressed to, or
+   * NULL if it is to be delivered to all the attached interfaces.
+   */
+  InChannel* getUnicastTarget(Activation frame);
 
  protected:
   /** The parent net of this link */
@@ -65,6 +87,9 @@ class Link : public DmlObject {
   /** The vector storing all the connected network interfaces of this link */
   vector<NetworkInterface*> connected_nw_iface_vec;
 
+  /** The attached interfaces of hosts built by other shards. */
+  vector<RemoteInterface*> remote_iface_vec;
+
   /** The minimum link delay.
    *  e.g., min packet size / max bandwidth
    */
@@ -79,6 +104,9 @@ class Link : public DmlObject {
   /** IP Address block for this link. */
   IPPrefix ip_prefix;
 
+  /** The InChannels of the attached interfaces by MAC address, on a shared segment. */
+  S3FNET_MAP(Mac48Address, InChannel*) mac_to_iface;
+
   /** Called by the net to create a link. */
   static Link* createLink(Net* net, s3f::dml::Configuration* cfg);
 
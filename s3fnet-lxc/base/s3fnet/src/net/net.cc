@@ -32,14 +32,15 @@ namespace s3fnet {
 
 Net::Net(SimInterface* sim_interface) :
 		DmlObject(0), ip_prefix(0, 0), is_top_net(true), namesvc(0),
-		sim_iface(sim_interface), top_net(this), traffic(0), netacc(0)
+		sim_iface(sim_interface), top_net(this), traffic(0), netacc(0), net_cfg(0)
 {
   NET_DUMP(printf("new topnet.\n"));
 }
 
 Net::Net(SimInterface* sim_interface, Net* parent, long myid):
 		DmlObject(parent, myid), ip_prefix(0, 0), is_top_net(false), netacc(0),
-		namesvc(parent->namesvc), sim_iface(sim_interface), top_net(parent->top_net), traffic(0)
+		namesvc(parent->namesvc), sim_iface(sim_interface), top_net(parent->top_net), traffic(0),
+		net_cfg(0)
 {
   NET_DUMP(printf("new subnet: id=%ld.\n", myid));
 }
@@ -68,6 +69,9 @@ Net::~Net()
     delete (Link*)(links[i]);
   }
 
+  for(unsigned i=0; i<remote_ifaces.size(); i++)
+    delete remote_ifaces[i];
+
   NET_DUMP(printf("delete net done: nhi=\"%s\".\n", nhi.toString()));
 
 }
@@ -145,9 +149,65 @@ void Net::config(s3f::dml::Configuration* cfg)
   }
   delete henum;
 
+  // the links and lxc commands are configured once all the hosts are
+  net_cfg = cfg;
+
+  if(!myParent)
+  {
+    // configure the hosts in parallel, each by the thread of its timeline
+    NET_DUMP(printf("configure %d hosts on the timelines.\n", (int)pending_hosts.size()));
+    sim_iface->run_timeline_task(config_hosts_task, this);
+
+    // mac addresses and lxc proxies are assigned in the order the
+    // hosts were created, so that they do not depend on the threads;
+    // the hosts of the other shards take their mac addresses too, so
+    // that every shard has the same
+    unsigned remote = 0;
+    for(unsigned i = 0; i < pending_hosts.size(); i++)
+    {
+      if(pending_hosts[i].host)
+        pending_hosts[i].host->finish_config(pending_hosts[i].cfg);
+      else for(int j = 0; j < pending_hosts[i].remote_ifaces; j++)
+        remote_ifaces[remote++]->mac48_addr = Mac48Address::Allocate();
+    }
+
+    config_links();
+    finish_config_top_net(topcfg);
+    configLxcCommands(topcfg);
+  }
+}
+
+void Net::config_hosts_task(Timeline* tl, void* topnet)
+{
+  PENDING_HOST_VECTOR& hlist = ((Net*)topnet)->pending_hosts;
+  for(unsigned i = 0; i < hlist.size(); i++)
+  {
+    if(hlist[i].host && hlist[i].host->alignment() == tl)
+      hlist[i].host->config(hlist[i].cfg);
+  }
+}
+
+void Net::load_fwdtables_task(Timeline* tl, void* topnet)
+{
+  PENDING_HOST_VECTOR& flist = ((Net*)topnet)->pending_fwdtables;
+  for(unsigned i = 0; i < flist.size(); i++)
+  {
+    if(flist[i].host->alignment() == tl)
+      flist[i].host->loadForwardingTable(flist[i].cfg);
+  }
+}
+
+void Net::config_links()
+{
+  for(S3FNET_INT2PTR_MAP::iterator iter = nets.begin(); iter != nets.end(); iter++)
+  {
+    Net* nn = (Net*)(iter->second);
+    nn->config_links();
+  }
+
   // config links
   NET_DUMP(printf("net \"%s\" config links.\n", nhi.toString()));
-  s3f::dml::Enumeration* lenum = cfg->find("link");
+  s3f::dml::Enumeration* lenum = net_cfg->find("link");
   while(lenum->hasMoreElements())
   {
     s3f::dml::Configuration* lcfg = (s3f::dml::Configuration*)lenum->nextElement();
@@ -157,10 +217,7 @@ void Net::config(s3f::dml::Configuration* cfg)
   }
   delete lenum;
 
-  if(!myParent) finish_config_top_net(topcfg);
-
-  if (myParent)  configLxcCommands(cfg);
-  if (!myParent) configLxcCommands(topcfg);
+  if(myParent) configLxcCommands(net_cfg);
 }
 
 void Net::connect_links()
@@ -195,7 +252,7 @@ NameService* Net::getNameService()
 	return namesvc;
 }
 
-IPADDR Net::nicnhi2ip(S3FNET_STRING nhi_str)
+IPADDR Net::nicnhi2ip(const S3FNET_STRING& nhi_str)
 {
   NameService* namesvc = getNameService();
   assert(namesvc);
@@ -213,7 +270,8 @@ DmlObject* Net::nhi2obj(Nhi* pNhi)
   // if it's a network interface, use nicnhi_to_obj_map in the topnet
   if(pNhi->type == Nhi::NHI_INTERFACE)
   {
-    return top_net->nicnhi_to_obj(pNhi->toStlString());
+    char buf[255];
+    return namesvc->nicnhi2iface(pNhi->toString(buf));
   }
 
   // if it's host or net NHI, search in its nets / hosts
@@ -325,6 +383,84 @@ void Net::init()
   {
       ((Link*)links[i])->init();
   }
+
+  if(!myParent)
+  {
+    // The hosts are initialized in parallel by the timeline threads.
+    // Create their random streams beforehand, timeline by timeline in
+    // the order the hosts were created, so that each host gets the same
+    // stream as when the hosts were initialized one after another.
+    // Counter-based streams do not depend on the order: each host
+    // creates its own in init().
+    for(unsigned t = 0; t < sim_iface->get_numTimelines() && !Host::counter_based_rng; t++)
+    {
+      Timeline* tl = sim_iface->get_Timeline(t);
+      for(unsigned i = 0; i < pending_hosts.size(); i++)
+      {
+        if(pending_hosts[i].host && pending_hosts[i].host->alignment() == tl)
+          pending_hosts[i].host->create_random_streams();
+      }
+    }
+    pending_hosts.clear();
+  }
+}
+
+void Net::write_profile(FILE* fp)
+{
+  char buf[255];
+
+  for(S3FNET_INT2PTR_MAP::iterator iter = hosts.begin();
+      iter != hosts.end(); iter++)
+  {
+    Host* h = (Host*)(iter->second);
+    LXC_Proxy* proxy = h->getLXCproxy();
+    double lxc_advance = proxy ? proxy->getElapsedTime()/1e6 : 0;
+    fprintf(fp, "  host [ nhi %s events %lu lxc_advance %g ]\n",
+	    h->nhi.toString(buf), h->executed_events(), lxc_advance);
+  }
+
+  for(unsigned i = 0; i < links.size(); i++)
+  {
+    Link* l = (Link*)links[i];
+    unsigned long messages = 0;
+    fprintf(fp, "  link [");
+    for(unsigned j = 0; j < l->connected_nw_iface_vec.size(); j++)
+    {
+      NetworkInterface* iface = l->connected_nw_iface_vec[j];
+      messages += iface->getPacketsSent();
+      fprintf(fp, " attach %s", iface->nhi.toString(buf));
+    }
+    for(unsigned j = 0; j < l->remote_iface_vec.size(); j++)
+      fprintf(fp, " attach %s", l->remote_iface_vec[j]->nhi.c_str());
+    fprintf(fp, " messages %lu ]\n", messages);
+  }
+
+  for(S3FNET_INT2PTR_MAP::iterator iter = nets.begin();
+      iter != nets.end(); iter++)
+    ((Net*)(iter->second))->write_profile(fp);
+}
+
+bool Net::save_state(Checkpoint* ckpt)
+{
+  for(S3FNET_INT2PTR_MAP::iterator iter = hosts.begin();
+      iter != hosts.end(); iter++)
+    if(!((Host*)(iter->second))->save_state(ckpt)) return false;
+
+  for(S3FNET_INT2PTR_MAP::iterator iter = nets.begin();
+      iter != nets.end(); iter++)
+    if(!((Net*)(iter->second))->save_state(ckpt)) return false;
+  return true;
+}
+
+void Net::restore_state(Checkpoint* ckpt)
+{
+  for(S3FNET_INT2PTR_MAP::iterator iter = hosts.begin();
+      iter != hosts.end(); iter++)
+    ((Host*)(iter->second))->restore_state(ckpt);
+
+  for(S3FNET_INT2PTR_MAP::iterator iter = nets.begin();
+      iter != nets.end(); iter++)
+    ((Net*)(iter->second))->restore_state(ckpt);
 }
 
 void Net::display(int indent)
@@ -368,14 +504,70 @@ void Net::config_host(s3f::dml::Configuration* cfg, S3FNET_LONG_SET& uniqset, bo
     if(!uniqset.insert((long)i).second)
       error_quit("ERROR: duplicate ID %d used for NET.HOST/ROUTER.\n", i);
 
+    // a host of another shard is known only by its interfaces
+    Timeline* tl = sim_iface->get_Timeline(alignment);
+    ShardGroup* shards = sim_iface->get_timeline_interface()->shards;
+    if(shards && !shards->is_local(alignment))
+    {
+      PendingHost ph = { 0, cfg, config_remote_host(cfg, (long)i, tl) };
+      top_net->pending_hosts.push_back(ph);
+      continue;
+    }
+
     NET_DUMP(printf("config_host(), created host %d on timeline %d\n", i, alignment));
 
-    Timeline* tl = sim_iface->get_Timeline(alignment);
     Host* h = new Host(tl, this, (long)i);
     hosts.insert(S3FNET_MAKE_PAIR(i, h));
     if(is_router) h->is_router = true;
-    h->config(cfg);
+
+    // the host is configured later by the thread of its timeline
+    PendingHost ph = { h, cfg, 0 };
+    top_net->pending_hosts.push_back(ph);
+  }
+}
+
+int Net::config_remote_host(s3f::dml::Configuration* cfg, long hostid, Timeline* tl)
+{
+  Nhi host_nhi = nhi;
+  host_nhi += hostid;
+  host_nhi.type = Nhi::NHI_MACHINE;
+
+  // the interfaces in the order of their ids, as a host allocates their mac addresses
+  S3FNET_MAP(int, RemoteInterface*) ifaces;
+  s3f::dml::Enumeration* ss = cfg->find("interface");
+  while(ss->hasMoreElements())
+  {
+    s3f::dml::Configuration* icfg = (s3f::dml::Configuration*)ss->nextElement();
+    if(!s3f::dml::dmlConfig::isConf(icfg))
+      error_quit("ERROR: Net::config_remote_host(), invalid HOST.INTERFACE attribute.\n");
+    int low, high;
+    getIdrangeLimits(icfg, low, high);
+    for(int j = low; j <= high; j++)
+    {
+      Nhi iface_nhi = host_nhi;
+      iface_nhi += j;
+      iface_nhi.type = Nhi::NHI_INTERFACE;
+
+      RemoteInterface* remote = new RemoteInterface;
+      remote->nhi = iface_nhi.toStlString();
+      remote->ip_addr = namesvc->nhi2ip(iface_nhi);
+      remote->mac48_addr = 0;
+      remote->alignment = tl;
+      remote->key = namesvc->ip2nicid(remote->ip_addr);
+      remote->ic = 0;
+      if(!namesvc->register_remote_iface(remote))
+        error_quit("ERROR: Net::config_remote_host(), network interface \"%s\" not found in "
+            "ENVIRONMENT_INFO or registered twice.\n", remote->nhi.c_str());
+      if(!ifaces.insert(S3FNET_MAKE_PAIR(j, remote)).second)
+        error_quit("ERROR: Net::config_remote_host(), duplicate interface %d on host \"%s\".\n",
+            j, host_nhi.toString());
+    }
   }
+  delete ss;
+
+  for(S3FNET_MAP(int, RemoteInterface*)::iterator iter = ifaces.begin(); iter != ifaces.end(); iter++)
+    top_net->remote_ifaces.push_back(iter->second);
+  return (int)ifaces.size();
 }
 
 void Net::config_router(s3f::dml::Configuration* cfg, S3FNET_LONG_SET& uniqset)
@@ -417,8 +609,13 @@ void Net::config_net(s3f::dml::Configuration* cfg, S3FNET_LONG_SET& uniqset)
 void Net::config_link(s3f::dml::Configuration* cfg)
 {
   NET_DUMP(printf("config_link().\n"));
-  // construct default link
+  // construct default link; a link between hosts of other shards is theirs
   Link* newlink = Link::createLink(this, cfg);
+  if(newlink->connected_nw_iface_vec.empty())
+  {
+    delete newlink;
+    return;
+  }
   links.push_back(newlink);
 }
 
@@ -464,7 +661,8 @@ void Net::finish_config_top_net(s3f::dml::Configuration* cfg)
   // connect the links in the net
   connect_links();
 
-  // load the forwarding tables if specified
+  // load the forwarding tables if specified; the tables are collected
+  // here and loaded in parallel, each by the thread of its host's timeline
   s3f::dml::Enumeration* fenum = cfg->find("forwarding_table");
   while(fenum->hasMoreElements())
   {
@@ -474,6 +672,12 @@ void Net::finish_config_top_net(s3f::dml::Configuration* cfg)
     load_fwdtable(fcfg);
   }
   delete fenum;
+
+  if(!pending_fwdtables.empty())
+  {
+    sim_iface->run_timeline_task(load_fwdtables_task, this);
+    pending_fwdtables.clear();
+  }
 }
 
 void Net::configLxcCommands(s3f::dml::Configuration* cfg)
@@ -580,7 +784,7 @@ void Net::configLxcCommands(s3f::dml::Configuration* cfg)
 				memcpy(nhi, origCommand + nhiBegin, nhiLength);
 				nhi[nhiLength] = '\0';
 
-				IPADDR peer = getNameService()->nhi2ip(string(nhi));
+				IPADDR peer = getNameService()->nhi2ip(nhi);
 				char buffer[20];
 				unsigned int convertedIP = htonl(peer);
 				const char* result = inet_ntop(AF_INET, &convertedIP, buffer, sizeof(buffer));
@@ -599,11 +803,11 @@ void Net::load_fwdtable(s3f::dml::Configuration* cfg)
   char* str = (char*)cfg->findSingle("node_nhi");
   if (!str || s3f::dml::dmlConfig::isConf(str))
     error_quit("ERROR: Net::load_fwdtable(), missing or invalid FORWARDING_TABLE.NODE_NHI attribute.\n");
-  S3FNET_STRING hostnhi = str;
-
-  Host* host = namesvc->hostnhi2hostobj(hostnhi);
+  Host* host = namesvc->hostnhi2hostobj(str);
+  if(!host && namesvc->nhi2remote(str)) return; // built by another shard
   assert(host);
-  host->loadForwardingTable(cfg);
+  PendingHost ph = { host, cfg, 0 };
+  top_net->pending_fwdtables.push_back(ph);
 }
 
 void Net::register_host(Host* host, const S3FNET_STRING& name)
@@ -620,14 +824,19 @@ void Net::register_interface(NetworkInterface* iface, IPADDR ip_addr)
 
   NET_DUMP(printf("register_interface(): ip=\"%s\".\n", IPPrefix::ip2txt(ip_addr)));
 
-  if( !(namesvc->get_ip2iface_map()->insert(S3FNET_MAKE_PAIR(ip_addr, iface))).second )
+  if(!namesvc->ip2nicnhi(ip_addr))
+  {
+	  error_quit("ERROR: Net::register_interface(), "
+			  "network interface IP=\"%s\" not found in ENVIRONMENT_INFO", IPPrefix::ip2txt(ip_addr));
+  }
+  if(!namesvc->register_iface(ip_addr, iface))
   {
 	  error_quit("ERROR: Net::register_interface(), "
 			  "duplicate registered network interface: IP=\"%s\"", IPPrefix::ip2txt(ip_addr));
   }
 }
 
-NetworkInterface* Net::nicnhi_to_obj(S3FNET_STRING nhi_str)
+NetworkInterface* Net::nicnhi_to_obj(const S3FNET_STRING& nhi_str)
 {
 	return namesvc->nicnhi2iface(nhi_str);
 }
@@ -787,13 +996,16 @@ void Net::injectEmuEvent(Host* destinationHost, EmuPacket* pkt, unsigned int des
 	// Currently, S3Fnet does not need to specify a SRC IP. As a result, it is currently set to 1.
 	// See dummy_session.cc
 
-	LxcemuSession* sess = (LxcemuSession*)destinationHost->sessionForName(LXCEMU_PROTOCOL_NAME);
+	// resolved through the host's protocol number dispatch table; this is
+	// called once for every packet coming out of the emulated containers
+	LxcemuSession* sess = (LxcemuSession*)destinationHost->sessionForNumber(S3FNET_PROTOCOL_TYPE_LXCEMU);
+	assert(sess != NULL);
 	sess->injectEvent(pkt, 1, destIP);
 }
 
 void Net::injectSerialEvent(Host * destinationHost, ltime_t incoming_time, int conn_id){
 
-  SerialSession* sess = (SerialSession*)destinationHost->sessionForName(NET_PROTOCOL_NAME);
+  SerialSession* sess = (SerialSession*)destinationHost->getNetworkLayerProtocol();
   assert(sess != NULL);
   fprintf(stdout,"Injecting serial event\n");
   fflush(stdout);
@@ -18,11 +18,13 @@ namespace s3fnet {
 
 class Link;
 class NetworkInterface;
+struct RemoteInterface;
 class Traffic;
 class NetAccessory;
 class CidrBlock;
 class Host;
 class NameService;
+class Checkpoint;
 
 //only TRAFFIC is in use
 enum {
@@ -88,6 +90,23 @@ class Net: public DmlObject {
   /** Displays the contents of this net.*/
   virtual void display(int indent = 0);
 
+  /**
+   * Write the runtime profile of the hosts and links in this net and
+   * its subnets as DML attributes: the events executed by each host
+   * and the time its LXC advanced, and the packets sent over each
+   * link. The profile is used by dmlpart to weigh the partitioning.
+   */
+  void write_profile(FILE* fp);
+
+  /**
+   * Save the state of the hosts in this net and its subnets to a
+   * checkpoint. Return false if the state of a host cannot be saved.
+   */
+  bool save_state(Checkpoint* ckpt);
+
+  /** Restore the state of the hosts in this net and its subnets from a checkpoint. */
+  void restore_state(Checkpoint* ckpt);
+
   /**
    * Resolves the given NHI address relative to this network.  Returns
    * NULL if no such object exists in this network.  Depending on the
@@ -101,7 +120,7 @@ class Net: public DmlObject {
    * Resolve the given interface NHI to an address.
    * If failed, it returns IPADDR_INVALID.
    */
-  IPADDR nicnhi2ip(S3FNET_STRING nhi);
+  IPADDR nicnhi2ip(const S3FNET_STRING& nhi);
   
   /**
    * Resolve IPADDR to the corresponding nic nhi.
@@ -128,7 +147,7 @@ class Net: public DmlObject {
   NameService* getNameService();
 
   /** Return the network interface object by giving the NHI of the interface */
-  NetworkInterface* nicnhi_to_obj(S3FNET_STRING nhi_str);
+  NetworkInterface* nicnhi_to_obj(const S3FNET_STRING& nhi_str);
 
   /** Register local host with given name.
    *  This method should be called in the config phase of each connected interface.
@@ -200,6 +219,38 @@ class Net: public DmlObject {
   /** Traffic object (topnet only) */
   Traffic* traffic;
 
+  /** The DML configuration of this net, kept for the links and lxc commands. */
+  s3f::dml::Configuration* net_cfg;
+
+  /**
+   * A host created by config_host, waiting to be configured with its
+   * DML; or, with host NULL, a host built by another shard, of which
+   * the next remote_ifaces interfaces of the top net stand for.
+   */
+  struct PendingHost {
+    Host* host;
+    s3f::dml::Configuration* cfg;
+    int remote_ifaces;
+  };
+  typedef S3FNET_VECTOR(PendingHost) PENDING_HOST_VECTOR;
+
+  /**
+   * Hosts of the whole network in the order they are created (topnet
+   * only). The hosts are configured in parallel, each by the thread of
+   * its timeline, once the entire structure has been created; the
+   * order is kept for the parts that must stay deterministic.
+   */
+  PENDING_HOST_VECTOR pending_hosts;
+
+  /** Forwarding tables to be loaded, one per host (topnet only). */
+  PENDING_HOST_VECTOR pending_fwdtables;
+
+  /**
+   * The interfaces of the hosts built by the other shards, in the
+   * order of the hosts (topnet only, in a sharded simulation).
+   */
+  S3FNET_VECTOR(RemoteInterface*) remote_ifaces;
+
   /** Configure the top net. */
   void config_top_net(s3f::dml::Configuration* cfg);
 
@@ -212,6 +263,12 @@ class Net: public DmlObject {
   /** Configure a router. */
   void config_router(s3f::dml::Configuration* cfg, S3FNET_LONG_SET& uniqset);
 
+  /**
+   * Record the interfaces of a host aligned to a timeline of another
+   * shard, which this shard does not build; return their number.
+   */
+  int config_remote_host(s3f::dml::Configuration* cfg, long hostid, Timeline* tl);
+
   /** Configure a sub network. */
   void config_net(s3f::dml::Configuration* cfg, S3FNET_LONG_SET& uniqset);
 
@@ -231,6 +288,15 @@ class Net: public DmlObject {
 
   /** load forwarding tables of all the hosts containing in this net */
   void load_fwdtable(s3f::dml::Configuration* cfg);
+
+  /** Configure the links of this net and its subnets, deepest first. */
+  void config_links();
+
+  /** Timeline task: configure the pending hosts aligned to the timeline. */
+  static void config_hosts_task(Timeline* tl, void* topnet);
+
+  /** Timeline task: load the pending forwarding tables of the hosts aligned to the timeline. */
+  static void load_fwdtables_task(Timeline* tl, void* topnet);
 };
 
 /**
@@ -15,6 +15,8 @@
 #include "os/simple_mac/simple_mac.h"
 #include "env/namesvc.h"
 #include "net/link.h"
+#include "net/checkpoint.h"
+#include "net/pcap_capture.h"
 
 
 namespace s3f {
@@ -30,14 +32,15 @@ namespace s3fnet {
 #endif
 
 NetworkInterface::NetworkInterface(Host* parent, long nicid) :
-  DmlObject(parent, nicid), attached_link(0), mac_sess(0), phy_sess(0)
+  DmlObject(parent, nicid), packets_sent(0), attached_link(0), mac_sess(0), phy_sess(0),
+  std_mac(0), std_phy(0), pcap_port(0)
 {
   assert(myParent); // the parent is the host
 
   IFACE_DUMP(printf("[id=%ld] new network interface.\n", nicid));
 
-  /* init mac48_addr */
-  mac48_addr = Mac48Address::Allocate();
+  /* mac48_addr is allocated in finish_config() */
+  mac48_addr = 0;
 
   dst_nic = NULL;
 
@@ -59,17 +62,14 @@ void NetworkInterface::config(s3f::dml::Configuration* cfg)
   nhi.type = Nhi::NHI_INTERFACE;
 
   // settle the ip address and register the interface to the community
-  S3FNET_STRING nhi_str = nhi.toStlString();
-
   Net* owner_net = getHost()->inNet();
   Host* owner_host = getHost();
-  ip_addr = owner_net->getNameService()->nhi2ip(nhi_str);
+  ip_addr = owner_net->getNameService()->nhi2ip(nhi);
 
   //if(owner_host->getNetworkLayerProtocol()->getProtocolNumber() != S3FNET_PROTOCOL_TYPE_SERIAL){
     owner_net->register_interface(this, ip_addr);
-    IFACE_DUMP(cout << "NIC = " << nhi_str.c_str()
-		  << ", IP = " << IPPrefix::ip2txt(ip_addr)
-  	  	  << ", MAC = " << mac48_addr << endl;);
+    IFACE_DUMP(cout << "NIC = " << nhi.toStlString().c_str()
+		  << ", IP = " << IPPrefix::ip2txt(ip_addr) << endl;);
   //}
 
   // configure the protocol sessions (this will skip the mac/phy
@@ -91,7 +91,7 @@ void NetworkInterface::config(s3f::dml::Configuration* cfg)
     insert_session(mac_sess);
   }
   IFACE_DUMP(printf("[nhi=\"%s\", ip=\"%s\"] config(): mac session \"%s\".\n",
-		    nhi_str.c_str(), IPPrefix::ip2txt(ip_addr), mac_sess->use));
+		    nhi.toString(), IPPrefix::ip2txt(ip_addr), mac_sess->use));
 
   // if phy protocol is not specified, create the default phy protocol
   phy_sess = (LowestProtocolSession*)sessionForName(PHY_PROTOCOL_NAME);
@@ -112,7 +112,7 @@ void NetworkInterface::config(s3f::dml::Configuration* cfg)
   if(phy_sess->control(PSESS_CTRL_SESSION_IS_LOWEST, &is_lowest, 0) || !is_lowest)
     error_quit("ERROR: PHY session \"%s\" is not the lowest protocol session.\n", phy_sess->use);
   IFACE_DUMP(printf("[nhi=\"%s\", ip=\"%s\"] config(): phy session \"%s\".\n",
-		    nhi_str.c_str(), IPPrefix::ip2txt(ip_addr), phy_sess->use));
+		    nhi.toString(), IPPrefix::ip2txt(ip_addr), phy_sess->use));
 
   ProtocolSession* ip_sess = getHost()->getNetworkLayerProtocol();
 
@@ -125,6 +125,47 @@ void NetworkInterface::config(s3f::dml::Configuration* cfg)
   ss << "IC-" << nhi.toStlString();
   ic = new InChannel( (Host *)this->myParent, ss.str());
 
+  // capture the frames sent and received, into the named file or
+  // <nhi>.pcapng for "true" (the value of an attribute is only good
+  // until the next lookup)
+  uint32 snaplen = PCAP_DEFAULT_SNAPLEN;
+  char* str = (char*)cfg->findSingle("snaplen");
+  if(str)
+  {
+    if(s3f::dml::dmlConfig::isConf(str) || atoi(str) <= 0 || atoi(str) > PCAP_DEFAULT_SNAPLEN)
+      error_quit("ERROR: NetworkInterface::config(), invalid SNAPLEN attribute.\n");
+    snaplen = atoi(str);
+  }
+  str = (char*)cfg->findSingle("pcap");
+  if(str)
+  {
+    if(s3f::dml::dmlConfig::isConf(str))
+      error_quit("ERROR: NetworkInterface::config(), invalid PCAP attribute.\n");
+    if(!strcasecmp(str, "true"))
+    {
+      // 1:2(0) becomes 1_2_0.pcapng
+      S3FNET_STRING name = nhi.toStlString(), file;
+      for(unsigned i=0; i<name.size(); i++)
+        if(name[i] == ':' || name[i] == '(') file += '_';
+        else if(name[i] != ')') file += name[i];
+      pcap_port = PcapCapture::add_interface(this, (file + ".pcapng").c_str(), snaplen);
+    }
+    else if(strcasecmp(str, "false"))
+      pcap_port = PcapCapture::add_interface(this, str, snaplen);
+  }
+
+}
+
+void NetworkInterface::finish_config()
+{
+  // the allocation counter is global; allocate in the (serial) order
+  // the host asks for it rather than from the parallel config phase
+  mac48_addr = Mac48Address::Allocate();
+  IFACE_DUMP(cout << "NIC = " << nhi.toStlString().c_str() << ", MAC = " << mac48_addr << endl;);
+
+  // the other shards write to the stubs of the interface by the id of its address
+  ShardGroup* shards = getHost()->inNet()->getTopNet()->getSimInterface()->get_timeline_interface()->shards;
+  if(shards) shards->export_inchannel(ic, getHost()->inNet()->getNameService()->ip2nicid(ip_addr));
 }
 
 void NetworkInterface::init()
@@ -132,6 +173,10 @@ void NetworkInterface::init()
   IFACE_DUMP(printf("[nhi=\"%s\", ip=\"%s\"] init().\n", nhi.toString(), IPPrefix::ip2txt(ip_addr)));
 
   ProtocolGraph::init();
+
+  // the standard stack takes the static pipeline
+  std_mac = ProtocolSession::session_of_class<SimpleMac>(mac_sess);
+  std_phy = ProtocolSession::session_of_class<SimplePhy>(phy_sess);
 }
 
 void NetworkInterface::sendPacket(Activation pkt, ltime_t delay)
@@ -163,7 +208,11 @@ void NetworkInterface::sendPacket(Activation pkt, ltime_t delay)
   IFACE_DUMP(printf("NetworkInterface::sendPacket, link_min_delay = %ld, "
 		  "delay to write to outChannel = %ld, pri = %u\n", link_min_delay, delay, pri));
 
-  oc->write(pkt, delay, pri);
+  packets_sent++;
+  if(pcap_port) PcapCapture::capture(pcap_port, true, (ProtocolMessage*)pkt);
+  InChannel* target = attached_link->getUnicastTarget(pkt);
+  if(target) oc->write_to(target, pkt, delay, pri);
+  else oc->write(pkt, delay, pri);
 }
 
 void NetworkInterface::receivePacket(Activation pkt)
@@ -171,8 +220,11 @@ void NetworkInterface::receivePacket(Activation pkt)
   IFACE_DUMP(printf("[nhi=\"%s\", ip=\"%s\"] %s: receive a packet.\n",
 		    nhi.toString(), IPPrefix::ip2txt(ip_addr), getHost()->getNowWithThousandSeparator()));
 
+  if(pcap_port) PcapCapture::capture(pcap_port, false, (ProtocolMessage*)pkt);
+
   // we pass the packet directly to the phy session
-  phy_sess->receivePacket(pkt);
+  if(std_phy) std_phy->SimplePhy::receivePacket(pkt);
+  else phy_sess->receivePacket(pkt);
 }
 
 void NetworkInterface::attach_to_link(Link* link)
@@ -184,6 +236,18 @@ void NetworkInterface::attach_to_link(Link* link)
   attached_link = link;
 }
 
+bool NetworkInterface::save_state(Checkpoint* ckpt)
+{
+  ckpt->put(packets_sent);
+  return save_sessions(ckpt);
+}
+
+void NetworkInterface::restore_state(Checkpoint* ckpt)
+{
+  ckpt->get(packets_sent);
+  restore_sessions(ckpt);
+}
+
 Host* NetworkInterface::getHost()
 {
   return dynamic_cast<Host*>(myParent);
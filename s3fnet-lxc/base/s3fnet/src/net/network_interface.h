@@ -21,6 +21,10 @@ namespace s3fnet {
 
 class Host;
 class Link;
+struct PcapPort;
+class Checkpoint;
+class SimpleMac;
+class SimplePhy;
 
 typedef S3FNET_VECTOR(IPADDR) S3FNET_IFACE_IPADDR_VECTOR;
 
@@ -51,6 +55,12 @@ class NetworkInterface : public DmlObject, public ProtocolGraph {
   /** Configure the network interface from DML. */
   virtual void config(s3f::dml::Configuration* cfg);
 
+  /**
+   * Finish the configuration: assign the 48-bit MAC address. Called
+   * by the host in a fixed order after the (parallel) config phase.
+   */
+  void finish_config();
+
   /** Initialize all protocol sessions defined in this network interface. */
   virtual void init();
 
@@ -82,6 +92,10 @@ class NetworkInterface : public DmlObject, public ProtocolGraph {
   /** Return the lowest protocol session in the interface, i.e., the physical layer session. */
   ProtocolSession* getLowestProtocolSession() { return phy_sess; }
 
+  /** Return the MAC session if it is a SimpleMac, for the static
+      pipeline (see ProtocolSession::pushdown_to()); NULL otherwise. */
+  SimpleMac* getStandardMac() { return std_mac; }
+
   /** Return the host that contains this network interface. */
   Host* getHost();
 
@@ -102,12 +116,22 @@ class NetworkInterface : public DmlObject, public ProtocolGraph {
    */
   void receivePacket(Activation pkt);
 
+  /** Return the number of packets sent to the link so far. */
+  unsigned long getPacketsSent() { return packets_sent; }
+
+  /** Save the state of the MAC and PHY sessions to a checkpoint. */
+  bool save_state(Checkpoint* ckpt);
+
+  /** Restore the state of the MAC and PHY sessions from a checkpoint. */
+  void restore_state(Checkpoint* ckpt);
+
   /** The associated S3F OutChannel. */
   OutChannel* oc;
 
   /** The associated S3F InChannel. */
   InChannel* ic;
 
+  /** The other interface of a point-to-point link, if it is built by this shard. */
   NetworkInterface * dst_nic;
 
   NetworkInterface * get_dst_nic() { return dst_nic; }
@@ -122,6 +146,9 @@ class NetworkInterface : public DmlObject, public ProtocolGraph {
   /** The MAC48 address (48 bit IEEE addresses) allocated to this interface. */
   Mac48Address* mac48_addr;
 
+  /** Number of packets sent to the link. */
+  unsigned long packets_sent;
+
   /**
    * Indicator of whether the OutChannel is connected.
    * Default is false, change when mapping to other InChannel
@@ -151,6 +178,32 @@ class NetworkInterface : public DmlObject, public ProtocolGraph {
    *  Should be the lowest protocol layer in the interface's protocol graph.
    */
   LowestProtocolSession* phy_sess;
+
+  /** The MAC session if it is a SimpleMac, NULL otherwise. */
+  SimpleMac* std_mac;
+
+  /** The PHY session if it is a SimplePhy, NULL otherwise. */
+  SimplePhy* std_phy;
+
+  /** Where the frames are captured, if the pcap attribute is set; NULL otherwise. */
+  PcapPort* pcap_port;
+};
+
+/**
+ * \brief A network interface of a host built by another shard.
+ *
+ * A sharded simulation builds in each shard only the hosts aligned to the
+ * timelines of the shard (see ShardGroup). The interfaces of the other
+ * hosts are known to the links and to the name service by these records:
+ * the addresses the interface would have, and the stub of its InChannel.
+ */
+struct RemoteInterface {
+  S3FNET_STRING nhi; ///< the NHI address of the interface
+  IPADDR ip_addr; ///< its IP address
+  Mac48Address* mac48_addr; ///< its MAC address, allocated in the order of the hosts
+  Timeline* alignment; ///< the timeline of its host
+  unsigned int key; ///< the key its InChannel is exported with (the id of its NHI address)
+  InChannel* ic; ///< the stub of its InChannel, created when a link maps to it
 };
 
 }; // namespace s3fnet
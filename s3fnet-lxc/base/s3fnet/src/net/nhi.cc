@@ -12,7 +12,7 @@
 namespace s3f {
 namespace s3fnet {
 
-char Nhi::internal_buf[50];
+__thread char Nhi::internal_buf[50];
 
 Nhi::Nhi() : start(0), type(NHI_INVALID)
 {}
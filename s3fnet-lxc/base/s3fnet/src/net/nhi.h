@@ -129,7 +129,8 @@ class Nhi {
   int type;
 
  private:
-  static char internal_buf[50];
+  /** Buffer used by toString(); one per thread since hosts are configured in parallel. */
+  static __thread char internal_buf[50];
 };
 
 }; // namespace s3fnet
@@ -16,6 +16,7 @@ namespace s3fnet {
 
 class ProtocolSession;
 class LowestProtocolSession;
+class Checkpoint;
 
 #define S3FNET_INIT_NIC_QUEUES 16
 
@@ -57,6 +58,15 @@ class NicQueue {
 
   /** The wrapup method is called when the simulation finishes. */
   virtual void wrapup() {}
+
+  /**
+   * Save the state of the queue to a checkpoint. Return false if the
+   * queue does not support checkpoints, which is the default.
+   */
+  virtual bool save_state(Checkpoint* ckpt) { return false; }
+
+  /** Restore the state of the queue from a checkpoint. */
+  virtual void restore_state(Checkpoint* ckpt) {}
   
   /** Return the type of this queue. */
   virtual int type() = 0;
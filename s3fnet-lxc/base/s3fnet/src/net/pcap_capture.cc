@@ -0,0 +1,689 @@
+/**
+ * \file pcap_capture.cc
+ * \brief Source file for the PcapCapture class.
+ *
+ * authors : Dong (Kevin) Jin
+ */
+
+#include <string.h>
+#include <time.h>
+#include <algorithm>
+#include "net/pcap_capture.h"
+#include "net/network_interface.h"
+#include "net/host.h"
+#include "net/ip_prefix.h"
+#include "util/errhandle.h"
+#include "os/base/data_message.h"
+#include "os/simple_mac/simple_mac_message.h"
+#include "os/ipv4/ip_message.h"
+#include "os/tcp/tcp_message.h"
+#include "os/udp/udp_message.h"
+#include "os/lxcemu/lxcemu_message.h"
+#include "os/cApp/cApp_message.h"
+
+#ifdef PCAP_DEBUG
+#define PCAP_DUMP(x) printf("PCAP: "); x
+#else
+#define PCAP_DUMP(x)
+#endif
+
+namespace s3f {
+namespace s3fnet {
+
+/** A capture file and the interfaces captured into it. */
+struct PcapFile {
+  string name;              ///< the file name
+  bool ng;                  ///< pcapng rather than pcap
+  FILE* fp;                 ///< open between start() and finish()
+  vector<PcapPort*> ports;  ///< the interfaces, by rank once started
+  unsigned long frames;     ///< frames written
+  byte* out;                ///< the blocks not yet written, PCAP_OUT_BYTES
+  uint32 out_len;           ///< bytes in out
+};
+
+/** Bytes of the blocks the writer thread collects for a file before writing them. */
+#define PCAP_OUT_BYTES (1<<20)
+
+/** Bytes of the data that may follow a record: the frame of an LXC, or TCP options and payload. */
+#define PCAP_FRAME_BYTES (PCAP_DEFAULT_SNAPLEN+1024)
+
+/** The capture buffer of a timeline: its thread moves head, the writer thread tail. */
+struct PcapRing {
+  volatile unsigned long head;  ///< written by the timeline
+  char pad1[56];
+  volatile unsigned long tail;  ///< written by the writer
+  char pad2[56];
+  unsigned long captured;       ///< frames put in the buffer
+  unsigned long dropped;        ///< frames dropped, the buffer full
+  byte* data;                   ///< PCAP_RING_BYTES bytes
+  byte frame[PCAP_FRAME_BYTES]; ///< where the timeline collects the data of a frame
+};
+
+/** What a frame is made of, as far as the capture goes. */
+enum {
+  PCAP_FRAME_RAW,  ///< the bytes an LXC sent, as they are
+  PCAP_FRAME_ETH,  ///< a frame that does not carry IP
+  PCAP_FRAME_IP,   ///< IP carrying neither TCP nor UDP
+  PCAP_FRAME_TCP,  ///< IP and TCP, then the TCP options and the payload
+  PCAP_FRAME_UDP   ///< IP and UDP, then the payload
+};
+
+/**
+ * A frame in a buffer: this header, then data_len bytes of data,
+ * padded to 8 bytes. The timeline only records the fields of the
+ * headers; the writer thread builds them.
+ */
+struct PcapRecord {
+  uint32 len;       ///< length of the record, header included
+  uint32 data_len;  ///< bytes of data after the header
+  uint32 orig_len;  ///< bytes of the frame
+  uint8 kind;       ///< PCAP_FRAME_*
+  uint8 out;        ///< sent rather than received
+  uint8 ttl;        ///< IP time to live
+  uint8 proto;      ///< IP protocol number
+  uint16 ip_len;    ///< IP total length
+  uint16 sport;     ///< TCP or UDP source port
+  uint16 dport;     ///< TCP or UDP destination port
+  uint16 wsize;     ///< TCP window
+  uint8 tcp_off;    ///< TCP header length, in words
+  uint8 tcp_flags;  ///< TCP flags
+  uint8 optlen;     ///< TCP option bytes at the start of the data
+  uint8 unused;
+  uint32 src_ip;    ///< IP source address
+  uint32 dst_ip;    ///< IP destination address
+  uint32 seq;       ///< TCP sequence number
+  uint32 ack;       ///< TCP acknowledgment number
+  byte mac[12];     ///< Ethernet destination, then source
+  PcapPort* port;   ///< where it was captured
+  ltime_t time;     ///< when
+};
+
+/**
+ * A piece of the payload in the data of a record, after the TCP
+ * options: bytes of a shared payload buffer, of which the record
+ * holds a reference until the writer has copied them; or, if shared
+ * is NULL, len bytes that follow, padded to 8 bytes.
+ */
+struct PcapPiece {
+  uint32 len;            ///< bytes of the piece
+  uint32 unused;
+  PayloadBuffer* shared; ///< the buffer the bytes are in, if any
+  const byte* bytes;     ///< the bytes, in the shared buffer
+};
+
+static inline uint32 pad8(uint32 len) { return (len+7) & ~7; }
+
+static pthread_mutex_t pcap_mutex = PTHREAD_MUTEX_INITIALIZER;
+static vector<PcapFile*> pcap_files;
+static vector<PcapRing*> pcap_rings;
+static pthread_t pcap_writer;
+static volatile bool pcap_stop = false;
+static int pcap_tps = 0;
+
+static inline void put16(byte* p, uint16 v) { p[0] = v>>8; p[1] = v; }
+static inline void put32(byte* p, uint32 v) { p[0] = v>>24; p[1] = v>>16; p[2] = v>>8; p[3] = v; }
+
+/* a MAC address, the IEEE one if there is one; otherwise a locally administered one from the simulated one */
+static void put_mac(byte* p, Mac48Address* mac48, MACADDR mac)
+{
+  if(mac48) { mac48->CopyTo(p); return; }
+  p[0] = 0x02; p[1] = 0;
+  put32(p+2, (uint32)mac);
+}
+
+/* add a piece of payload to the data of a record at p, if it fits; return its length in the data, 0 if not */
+static uint32 add_piece(byte* p, uint32 room, const byte* bytes, uint32 len, PayloadBuffer* shared)
+{
+  uint32 n = sizeof(PcapPiece) + (shared ? 0 : pad8(len));
+  if(n > room) return 0;
+  PcapPiece* piece = (PcapPiece*)p;
+  piece->len = len;
+  piece->shared = shared;
+  piece->bytes = bytes;
+  if(!shared) memcpy(p+sizeof(PcapPiece), bytes, len);
+  return n;
+}
+
+/*
+ * record the payload that the simulation carries, up to snap bytes, as
+ * pieces in the data of a record at p (room bytes); return the length
+ * of the pieces. The bytes of shared payload buffers are not copied.
+ */
+static uint32 collect_payload(ProtocolMessage* msg, byte* p, uint32 room, uint32 snap)
+{
+  uint32 n = 0;
+  for(; msg && snap > 0; msg = msg->payload())
+  {
+    if(msg->type() != S3FNET_PROTOCOL_TYPE_OPAQUE_DATA) break;
+    DataMessage* dmsg = (DataMessage*)msg;
+    if(dmsg->real_length > 0)
+    {
+      if(!dmsg->payload) break;
+      uint32 k = mymin(snap, (uint32)dmsg->real_length);
+      uint32 used = add_piece(p+n, room-n, (byte*)dmsg->payload, k, dmsg->shared);
+      if(!used) break;
+      n += used;
+      snap -= k;
+    }
+    else
+    {
+      for(DataChunk* c = (DataChunk*)dmsg->payload; c && snap > 0; c = c->next)
+      {
+	if(!c->real_data) return n;
+	uint32 k = mymin(snap, c->real_length);
+	uint32 used = add_piece(p+n, room-n, c->real_data, k, c->shared);
+	if(!used) return n;
+	n += used;
+	snap -= k;
+      }
+    }
+  }
+  return n;
+}
+
+/*
+ * record the fields of the headers of a frame, and collect its data
+ * into buf (PCAP_FRAME_BYTES); return the length of the data. This is
+ * all a timeline does for a frame.
+ */
+static uint32 collect_frame(ProtocolMessage* frame, PcapRecord* rec, byte* buf, uint32 snaplen)
+{
+  ProtocolMessage* m = frame;
+  memset(rec->mac, 0, 12);
+  if(m->type() == S3FNET_PROTOCOL_TYPE_SIMPLE_MAC)
+  {
+    SimpleMacMessage* mac = (SimpleMacMessage*)m;
+    put_mac(rec->mac, mac->dst48, mac->dest);
+    put_mac(rec->mac+6, mac->src48, mac->src);
+    m = m->payload();
+  }
+
+  rec->kind = PCAP_FRAME_ETH;
+  rec->orig_len = 14;
+  rec->optlen = 0;
+  uint32 hdr_len = 14;
+  for(; m; m = m->payload())
+  {
+    int type = m->type();
+    if(type == S3FNET_PROTOCOL_TYPE_LXCEMU || type == S3FNET_PROTOCOL_TYPE_CAPP)
+    {
+      // the frames of the LXCs carry the bytes read from them
+      EmuPacket* pkt = type == S3FNET_PROTOCOL_TYPE_LXCEMU ?
+	((LxcemuMessage*)m)->ppkt : ((cAppMessage*)m)->ppkt;
+      if(!pkt) continue;
+      rec->kind = PCAP_FRAME_RAW;
+      rec->orig_len = pkt->len;
+      uint32 n = mymin(snaplen, (uint32)pkt->len);
+      memcpy(buf, pkt->data, n);
+      return n;
+    }
+    if(rec->kind == PCAP_FRAME_ETH)
+    {
+      rec->orig_len = 14 + m->totalRealBytes();
+      if(type != S3FNET_PROTOCOL_TYPE_IPV4) break;
+      IPMessage* ip = (IPMessage*)m;
+      rec->kind = PCAP_FRAME_IP;
+      rec->ip_len = rec->orig_len - 14;
+      rec->ttl = ip->time_to_live;
+      rec->proto = ip->protocol_no;
+      rec->src_ip = ip->src_ip;
+      rec->dst_ip = ip->dst_ip;
+      hdr_len += S3FNET_IPHDR_LENGTH;
+    }
+    else if(rec->kind == PCAP_FRAME_IP)
+    {
+      if(type == S3FNET_PROTOCOL_TYPE_TCP)
+      {
+	TCPMessage* tcp = (TCPMessage*)m;
+	rec->kind = PCAP_FRAME_TCP;
+	rec->sport = tcp->src_port;
+	rec->dport = tcp->dst_port;
+	rec->seq = tcp->seqno;
+	rec->ack = tcp->ackno;
+	rec->tcp_off = tcp->length;
+	rec->tcp_flags = tcp->flags;
+	rec->wsize = tcp->wsize;
+	int optlen = tcp->realByteCount() - 20;
+	rec->optlen = optlen > 0 && optlen <= 40 ? optlen : 0;
+	hdr_len += 20 + rec->optlen;
+	break;
+      }
+      else if(type == S3FNET_PROTOCOL_TYPE_UDP)
+      {
+	rec->kind = PCAP_FRAME_UDP;
+	rec->sport = ((UDPMessage*)m)->src_port;
+	rec->dport = ((UDPMessage*)m)->dst_port;
+	hdr_len += S3FNET_UDPHDR_LENGTH;
+	break;
+      }
+      else break;
+    }
+  }
+
+  // the TCP options (no-ops if the message has none), then the payload
+  uint32 n = 0;
+  if(rec->kind == PCAP_FRAME_TCP && rec->optlen)
+  {
+    TCPMessage* tcp = (TCPMessage*)m;
+    if(tcp->options) memcpy(buf, tcp->options, rec->optlen);
+    else memset(buf, 1, rec->optlen);
+    n = pad8(rec->optlen);
+  }
+  if((rec->kind == PCAP_FRAME_TCP || rec->kind == PCAP_FRAME_UDP) && hdr_len < snaplen)
+    n += collect_payload(m->payload(), buf+n, PCAP_FRAME_BYTES-n, snaplen-hdr_len);
+  return n;
+}
+
+/* build the headers of a simulated frame into hdr (128 bytes); return their length */
+static uint32 build_headers(PcapRecord* rec, const byte* data, byte* hdr)
+{
+  memcpy(hdr, rec->mac, 12);
+  if(rec->kind == PCAP_FRAME_ETH)
+  {
+    // not IP: an experimental ethertype, and nothing of the rest
+    put16(hdr+12, 0x88b5);
+    return 14;
+  }
+
+  put16(hdr+12, 0x0800);
+  byte* h = hdr+14;
+  memset(h, 0, S3FNET_IPHDR_LENGTH);
+  h[0] = 0x45;
+  put16(h+2, rec->ip_len);
+  h[6] = 0x40; // don't fragment
+  h[8] = rec->ttl;
+  h[9] = rec->proto;
+  put32(h+12, rec->src_ip);
+  put32(h+16, rec->dst_ip);
+  uint32 sum = 0;
+  for(int i=0; i<S3FNET_IPHDR_LENGTH; i+=2) sum += (h[i]<<8) | h[i+1];
+  while(sum >> 16) sum = (sum & 0xffff) + (sum >> 16);
+  put16(h+10, ~sum);
+  uint32 n = 14 + S3FNET_IPHDR_LENGTH;
+
+  h = hdr+n;
+  if(rec->kind == PCAP_FRAME_TCP)
+  {
+    memset(h, 0, 20);
+    put16(h, rec->sport);
+    put16(h+2, rec->dport);
+    put32(h+4, rec->seq);
+    put32(h+8, rec->ack);
+    h[12] = rec->tcp_off << 4;
+    h[13] = rec->tcp_flags;
+    put16(h+14, rec->wsize);
+    // the checksum is left out (0)
+    memcpy(h+20, data, rec->optlen);
+    n += 20 + rec->optlen;
+  }
+  else if(rec->kind == PCAP_FRAME_UDP)
+  {
+    put16(h, rec->sport);
+    put16(h+2, rec->dport);
+    put16(h+4, rec->ip_len - S3FNET_IPHDR_LENGTH);
+    put16(h+6, 0); // no checksum
+    n += S3FNET_UDPHDR_LENGTH;
+  }
+  return n;
+}
+
+/* copy len bytes into or out of a ring at position pos, wrapping around */
+static void ring_copy_in(byte* data, unsigned long pos, const void* src, uint32 len)
+{
+  unsigned long off = pos % PCAP_RING_BYTES;
+  uint32 first = mymin((unsigned long)len, PCAP_RING_BYTES-off);
+  memcpy(data+off, src, first);
+  if(first < len) memcpy(data, (const byte*)src+first, len-first);
+}
+
+static void ring_copy_out(byte* data, unsigned long pos, void* dst, uint32 len)
+{
+  unsigned long off = pos % PCAP_RING_BYTES;
+  uint32 first = mymin((unsigned long)len, PCAP_RING_BYTES-off);
+  memcpy(dst, data+off, first);
+  if(first < len) memcpy((byte*)dst+first, data, len-first);
+}
+
+/* a pcapng option, padded to 4 bytes */
+static void write_option(FILE* fp, uint16 code, const void* value, uint16 len)
+{
+  static const byte pad[4] = { 0, 0, 0, 0 };
+  fwrite(&code, 2, 1, fp);
+  fwrite(&len, 2, 1, fp);
+  fwrite(value, len, 1, fp);
+  if(len & 3) fwrite(pad, 4-(len&3), 1, fp);
+}
+
+/* the end of the options of a pcapng block: code 0, length 0 */
+static void write_end_of_options(FILE* fp)
+{
+  static const byte end[4] = { 0, 0, 0, 0 };
+  fwrite(end, 4, 1, fp);
+}
+
+static inline uint32 pad4(uint32 len) { return (len+3) & ~3; }
+
+/* the header of a file, and the description of its interfaces for pcapng */
+static void write_header(PcapFile* f)
+{
+  uint32 snaplen = 0;
+  for(unsigned i=0; i<f->ports.size(); i++) snaplen = mymax(snaplen, f->ports[i]->snaplen);
+  if(!f->ng)
+  {
+    // microseconds, or nanoseconds for a finer clock; Ethernet
+    uint32 hdr[6] = { pcap_tps <= 6 ? 0xa1b2c3d4 : 0xa1b23c4d, 2 | (4<<16), 0, 0, snaplen, 1 };
+    fwrite(hdr, sizeof(hdr), 1, f->fp);
+    return;
+  }
+
+  // the section header, of unknown length
+  uint32 shb[7] = { 0x0a0d0d0a, 28, 0x1a2b3c4d, 1, 0xffffffff, 0xffffffff, 28 };
+  fwrite(shb, sizeof(shb), 1, f->fp);
+
+  // an interface description for each interface: its nhi, its IP
+  // address, and the clock resolution
+  for(unsigned i=0; i<f->ports.size(); i++)
+  {
+    NetworkInterface* iface = f->ports[i]->iface;
+    string name = iface->nhi.toStlString();
+    char ip[32];
+    IPPrefix::ip2txt(iface->getIP(), ip);
+    byte tsresol = pcap_tps;
+    uint32 len = 20 + 4+pad4(name.size()) + 4+pad4(strlen(ip)) + 4+4 + 4;
+    uint32 idb[4] = { 1, len, 1, f->ports[i]->snaplen }; // Ethernet
+    fwrite(idb, sizeof(idb), 1, f->fp);
+    write_option(f->fp, 2, name.c_str(), name.size());
+    write_option(f->fp, 3, ip, strlen(ip));
+    write_option(f->fp, 9, &tsresol, 1);
+    write_end_of_options(f->fp);
+    fwrite(&len, 4, 1, f->fp);
+  }
+}
+
+/* write the blocks collected for a file */
+static void flush_out(PcapFile* f)
+{
+  if(f->out_len) fwrite(f->out, f->out_len, 1, f->fp);
+  f->out_len = 0;
+}
+
+/*
+ * build a frame taken from a buffer (its record and data) into the
+ * blocks of its file, in one piece; the references to shared payload
+ * buffers held by the record are dropped
+ */
+static void write_frame(PcapRecord* rec, byte* data)
+{
+  PcapFile* f = pcap_files[rec->port->file];
+  uint32 snaplen = rec->port->snaplen;
+
+  // the headers, cut by the snapshot length, then the pieces of the payload
+  byte hdr[128];
+  uint32 hdr_len = 0, cap_len;
+  byte* pieces = data + pad8(rec->optlen);
+  byte* end = data + rec->data_len;
+  if(rec->kind == PCAP_FRAME_RAW) cap_len = rec->data_len;
+  else
+  {
+    hdr_len = mymin(build_headers(rec, data, hdr), snaplen);
+    cap_len = hdr_len;
+    if(rec->kind != PCAP_FRAME_TCP && rec->kind != PCAP_FRAME_UDP) pieces = end;
+    for(byte* p = pieces; p < end; )
+    {
+      PcapPiece* piece = (PcapPiece*)p;
+      cap_len += piece->len;
+      p += sizeof(PcapPiece) + (piece->shared ? 0 : pad8(piece->len));
+    }
+  }
+
+  uint32 len = f->ng ? 28 + pad4(cap_len) + 4+4 + 4 + 4 : 16 + cap_len;
+  if(f->out_len + len > PCAP_OUT_BYTES) flush_out(f);
+  byte* p = f->out + f->out_len;
+  f->out_len += len;
+  if(f->ng)
+  {
+    // an enhanced packet block, with the direction of the frame
+    uint32 epb[7] = { 6, len, (uint32)rec->port->rank, (uint32)((uint64)rec->time >> 32),
+		      (uint32)rec->time, cap_len, rec->orig_len };
+    memcpy(p, epb, sizeof(epb));
+    p += 28;
+  }
+  else
+  {
+    ltime_t unit = 1;
+    for(int i=0; i<pcap_tps; i++) unit *= 10;
+    ltime_t frac = rec->time % unit;
+    int digits = pcap_tps <= 6 ? 6 : 9;
+    for(int i=pcap_tps; i<digits; i++) frac *= 10;
+    for(int i=digits; i<pcap_tps; i++) frac /= 10;
+    uint32 phdr[4] = { (uint32)(rec->time/unit), (uint32)frac, cap_len, rec->orig_len };
+    memcpy(p, phdr, sizeof(phdr));
+    p += 16;
+  }
+
+  if(rec->kind == PCAP_FRAME_RAW)
+  {
+    memcpy(p, data, cap_len);
+    p += cap_len;
+  }
+  else
+  {
+    memcpy(p, hdr, hdr_len);
+    p += hdr_len;
+    while(pieces < end)
+    {
+      PcapPiece* piece = (PcapPiece*)pieces;
+      if(piece->shared)
+      {
+	memcpy(p, piece->bytes, piece->len);
+	piece->shared->unref();
+	pieces += sizeof(PcapPiece);
+      }
+      else
+      {
+	memcpy(p, pieces+sizeof(PcapPiece), piece->len);
+	pieces += sizeof(PcapPiece) + pad8(piece->len);
+      }
+      p += piece->len;
+    }
+  }
+
+  if(f->ng)
+  {
+    for(uint32 i=cap_len; i&3; i++) *p++ = 0;
+    uint32 opts[4] = { 2 | (4<<16), rec->out ? 2u : 1u, 0, len }; // epb_flags, end, length
+    memcpy(p, opts, sizeof(opts));
+  }
+  f->frames++;
+}
+
+/* the writer thread: drain the buffers of the timelines until stopped, then once more */
+static void* pcap_writer_thread(void*)
+{
+  byte* buf = new byte[sizeof(PcapRecord)+PCAP_FRAME_BYTES];
+  for(;;)
+  {
+    bool stop = __atomic_load_n(&pcap_stop, __ATOMIC_ACQUIRE);
+    bool idle = true;
+    for(unsigned t=0; t<pcap_rings.size(); t++)
+    {
+      PcapRing* r = pcap_rings[t];
+      unsigned long tail = r->tail;
+      unsigned long head = __atomic_load_n(&r->head, __ATOMIC_ACQUIRE);
+      while(tail < head)
+      {
+	// a record is read in place unless it wraps around
+	unsigned long off = tail % PCAP_RING_BYTES;
+	PcapRecord* rec = (PcapRecord*)(r->data + off);
+	if(off + sizeof(PcapRecord) > PCAP_RING_BYTES ||
+	   off + sizeof(PcapRecord) + rec->data_len > PCAP_RING_BYTES)
+	{
+	  ring_copy_out(r->data, tail, buf, sizeof(PcapRecord));
+	  rec = (PcapRecord*)buf;
+	  ring_copy_out(r->data, tail+sizeof(PcapRecord), buf+sizeof(PcapRecord), rec->data_len);
+	}
+	tail += rec->len;
+	write_frame(rec, (byte*)(rec+1));
+	idle = false;
+      }
+      __atomic_store_n(&r->tail, tail, __ATOMIC_RELEASE);
+    }
+    if(stop) break;
+    if(idle)
+    {
+      // nothing new: write what was collected while waiting for more
+      for(unsigned i=0; i<pcap_files.size(); i++) flush_out(pcap_files[i]);
+      struct timespec ts = { 0, 1000000 };
+      nanosleep(&ts, 0);
+    }
+  }
+  delete[] buf;
+  return 0;
+}
+
+PcapPort* PcapCapture::add_interface(NetworkInterface* iface, const char* file, uint32 snaplen)
+{
+  PcapPort* port = new PcapPort;
+  port->iface = iface;
+  port->host = iface->getHost();
+  port->snaplen = snaplen;
+  port->rank = 0;
+
+  pthread_mutex_lock(&pcap_mutex);
+  unsigned i = 0;
+  while(i < pcap_files.size() && pcap_files[i]->name != file) i++;
+  if(i == pcap_files.size())
+  {
+    PcapFile* f = new PcapFile;
+    f->name = file;
+    f->ng = f->name.size() > 7 && f->name.substr(f->name.size()-7) == ".pcapng";
+    f->fp = 0;
+    f->frames = 0;
+    f->out = 0;
+    f->out_len = 0;
+    pcap_files.push_back(f);
+  }
+  port->file = i;
+  pcap_files[i]->ports.push_back(port);
+  pthread_mutex_unlock(&pcap_mutex);
+  return port;
+}
+
+static bool port_order(PcapPort* a, PcapPort* b)
+{
+  return a->iface->nhi.toStlString() < b->iface->nhi.toStlString();
+}
+
+void PcapCapture::start(int num_timelines, int log_ticks_per_sec, int shard, int num_shards)
+{
+  if(pcap_files.empty()) return;
+  pcap_tps = log_ticks_per_sec;
+
+  for(unsigned i=0; i<pcap_files.size(); i++)
+  {
+    PcapFile* f = pcap_files[i];
+
+    // the interfaces were added by the timelines in parallel: number
+    // them in the order of their nhi, the same in every run
+    std::sort(f->ports.begin(), f->ports.end(), port_order);
+    for(unsigned j=0; j<f->ports.size(); j++) f->ports[j]->rank = j;
+
+    if(num_shards > 1)
+    {
+      char sfx[16];
+      sprintf(sfx, ".%d", shard);
+      size_t dot = f->name.rfind('.');
+      if(dot == string::npos || dot == 0 || f->name.find('/', dot) != string::npos)
+	f->name += sfx;
+      else f->name.insert(dot, sfx);
+    }
+    f->fp = fopen(f->name.c_str(), "w");
+    if(!f->fp) error_quit("ERROR: PcapCapture::start(), can't open capture file %s.\n", f->name.c_str());
+    write_header(f);
+    f->out = new byte[PCAP_OUT_BYTES];
+    PCAP_DUMP(printf("capturing %d interfaces into %s.\n", (int)f->ports.size(), f->name.c_str()));
+  }
+
+  for(int t=0; t<num_timelines; t++)
+  {
+    PcapRing* r = new PcapRing;
+    r->head = r->tail = 0;
+    r->captured = r->dropped = 0;
+    r->data = new byte[PCAP_RING_BYTES];
+    pcap_rings.push_back(r);
+  }
+  pcap_stop = false;
+  if(pthread_create(&pcap_writer, 0, pcap_writer_thread, 0))
+    error_quit("ERROR: PcapCapture::start(), can't create the writer thread.\n");
+}
+
+void PcapCapture::capture(PcapPort* port, bool out, ProtocolMessage* frame)
+{
+  if(pcap_rings.empty()) return;
+  Host* host = port->host;
+  PcapRing* r = pcap_rings[host->alignment()->s3fid()];
+  PcapRecord rec;
+  rec.data_len = collect_frame(frame, &rec, r->frame, port->snaplen);
+  rec.len = pad8(sizeof(PcapRecord)+rec.data_len);
+  rec.out = out;
+  rec.port = port;
+  rec.time = host->now();
+
+  // never wait for the writer: drop the frame if there is no room
+  unsigned long head = r->head;
+  unsigned long tail = __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE);
+  if(head-tail+rec.len > PCAP_RING_BYTES)
+  {
+    r->dropped++;
+    return;
+  }
+
+  // the shared payload the record refers to is kept for the writer
+  if(rec.kind == PCAP_FRAME_TCP || rec.kind == PCAP_FRAME_UDP)
+  {
+    for(uint32 i = pad8(rec.optlen); i < rec.data_len; )
+    {
+      PcapPiece* piece = (PcapPiece*)(r->frame+i);
+      if(piece->shared) piece->shared->ref();
+      i += sizeof(PcapPiece) + (piece->shared ? 0 : pad8(piece->len));
+    }
+  }
+  ring_copy_in(r->data, head, &rec, sizeof(PcapRecord));
+  ring_copy_in(r->data, head+sizeof(PcapRecord), r->frame, rec.data_len);
+  __atomic_store_n(&r->head, head+rec.len, __ATOMIC_RELEASE);
+  r->captured++;
+}
+
+void PcapCapture::finish(bool silent)
+{
+  if(pcap_rings.empty()) return;
+  __atomic_store_n(&pcap_stop, true, __ATOMIC_RELEASE);
+  pthread_join(pcap_writer, 0);
+
+  unsigned long captured = 0, dropped = 0;
+  for(unsigned t=0; t<pcap_rings.size(); t++)
+  {
+    captured += pcap_rings[t]->captured;
+    dropped += pcap_rings[t]->dropped;
+    delete[] pcap_rings[t]->data;
+    delete pcap_rings[t];
+  }
+  pcap_rings.clear();
+
+  for(unsigned i=0; i<pcap_files.size(); i++)
+  {
+    flush_out(pcap_files[i]);
+    delete[] pcap_files[i]->out;
+    pcap_files[i]->out = 0;
+    fclose(pcap_files[i]->fp);
+    pcap_files[i]->fp = 0;
+    if(!silent)
+      printf("pcap: %lu frames of %d interfaces written to %s\n", pcap_files[i]->frames,
+	     (int)pcap_files[i]->ports.size(), pcap_files[i]->name.c_str());
+  }
+  if(dropped || !silent)
+    printf("pcap: %lu frames captured, %lu dropped with the capture buffers full\n", captured, dropped);
+}
+
+}; // namespace s3fnet
+}; // namespace s3f
@@ -0,0 +1,97 @@
+/**
+ * \file pcap_capture.h
+ * \brief Header file for the PcapCapture class.
+ *
+ * authors : Dong (Kevin) Jin
+ */
+
+#ifndef __PCAP_CAPTURE_H__
+#define __PCAP_CAPTURE_H__
+
+#include "s3fnet.h"
+#include "s3f.h"
+
+namespace s3f {
+namespace s3fnet {
+
+class Host;
+class NetworkInterface;
+class ProtocolMessage;
+
+/** Bytes of the capture buffer of each timeline. */
+#define PCAP_RING_BYTES (4<<20)
+
+/** Bytes kept of each frame unless the snaplen attribute says otherwise. */
+#define PCAP_DEFAULT_SNAPLEN 65535
+
+/** Where the frames of a network interface are captured. */
+struct PcapPort {
+  NetworkInterface* iface; ///< the interface
+  Host* host;              ///< and its host
+  int file;                ///< index of the capture file
+  int rank;                ///< the interface id in the file (pcapng)
+  uint32 snaplen;          ///< bytes kept of each frame
+};
+
+/**
+ * \brief Asynchronous pcap/pcapng capture at the network interfaces.
+ *
+ * A network interface given a pcap attribute in DML (a file name, or
+ * "true" for <nhi>.pcapng) captures the frames it sends and receives,
+ * stamped with the virtual time, at most snaplen bytes of each.
+ * A file named *.pcapng is written in the pcapng format, with an
+ * interface description for each of the network interfaces captured
+ * into it (named after their nhi) and the direction of each frame;
+ * any other name, in the classic pcap format. Several interfaces
+ * (such as those of a host idrange) may share a file.
+ *
+ * The timeline thread running a host records each frame into a
+ * single-producer single-consumer buffer of its own, without a lock;
+ * a writer thread drains the buffers of all the timelines to the
+ * files. A frame that does not fit in a full buffer is dropped (and
+ * counted) rather than stalling the timeline. The frames of a file
+ * are in time order for each timeline, not across the timelines.
+ * The timelines only pay for recording the fields of the headers and
+ * the payload of each frame (references to shared payload buffers,
+ * the bytes of any other); the writer thread builds the headers and
+ * copies the bytes, and needs a CPU of its own to stay out of their
+ * way (bench/pcap_overhead.sh measures the cost).
+ *
+ * The frames of the LXCs are captured as the bytes the LXC sent; the
+ * simulated ones are encoded as Ethernet, IPv4, TCP or UDP headers
+ * from the protocol messages, followed by the bytes of the payload
+ * that the simulation carries (DataMessage). A payload of which the
+ * simulation only keeps the length ends the captured part of the
+ * frame, as if cut by the snapshot length.
+ */
+class PcapCapture {
+ public:
+  /**
+   * Capture the frames of the given network interface into the given
+   * file; called by the config() of the interface, on any timeline.
+   */
+  static PcapPort* add_interface(NetworkInterface* iface, const char* file, uint32 snaplen);
+
+  /**
+   * Open the files and start the writer thread, once the model is
+   * built and before it runs. The files of shard s of a sharded
+   * simulation are suffixed with .s; timestamps are in units of
+   * 10^-log_ticks_per_sec seconds.
+   */
+  static void start(int num_timelines, int log_ticks_per_sec, int shard, int num_shards);
+
+  /**
+   * Capture a frame sent (out is true) or received at the interface of
+   * the given port, at the current time of its host; called by the
+   * timeline thread of the host.
+   */
+  static void capture(PcapPort* port, bool out, ProtocolMessage* frame);
+
+  /** Drain the buffers, stop the writer thread, close the files and report. */
+  static void finish(bool silent);
+};
+
+}; // namespace s3fnet
+}; // namespace s3f
+
+#endif /*__PCAP_CAPTURE_H__*/
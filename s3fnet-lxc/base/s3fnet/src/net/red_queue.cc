@@ -10,6 +10,7 @@
 #include "util/errhandle.h"
 #include "net/network_interface.h"
 #include "os/simple_mac/simple_mac_message.h"
+#include "net/checkpoint.h"
 
 #ifdef IFACE_DEBUG
 #define IFACE_DUMP(x) printf("RED: "); x
@@ -268,5 +269,28 @@ ltime_t RedQueue::calibrate(float len)
   return jitter;
 }
 
+bool RedQueue::save_state(Checkpoint* ckpt)
+{
+  ckpt->put(queue);
+  ckpt->put(avgque);
+  ckpt->put(loss);
+  ckpt->put(crossing);
+  ckpt->put(interdrop);
+  ckpt->put(last_update_time);
+  ckpt->put(vacate_time);
+  return true;
+}
+
+void RedQueue::restore_state(Checkpoint* ckpt)
+{
+  ckpt->get(queue);
+  ckpt->get(avgque);
+  ckpt->get(loss);
+  ckpt->get(crossing);
+  ckpt->get(interdrop);
+  ckpt->get(last_update_time);
+  ckpt->get(vacate_time);
+}
+
 }; // namespace s3fnet
 }; // namespace s3f
@@ -62,6 +62,12 @@ class RedQueue: public NicQueue {
    */
   void enqueue(Activation msg);
 
+  /** Save the instantaneous and average queue sizes to a checkpoint. */
+  virtual bool save_state(Checkpoint* ckpt);
+
+  /** Restore the instantaneous and average queue sizes from a checkpoint. */
+  virtual void restore_state(Checkpoint* ckpt);
+
  private:  
   /** Weight used by the AQM policy to calculate average queue length
       ON EACH PACKET ARRIVAL. */
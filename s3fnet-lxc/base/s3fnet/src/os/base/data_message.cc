@@ -5,14 +5,22 @@
  * authors : Dong (Kevin) Jin
  */
 
+#include <string.h>
 #include "os/base/data_message.h"
 
 namespace s3f {
 namespace s3fnet {
 
-DataMessage::DataMessage() : payload(0), real_length(0) {}
+#ifdef DATAMSG_DEBUG
+#define DATAMSG_DUMP(x) printf("DATAMSG: "); x
+#else
+#define DATAMSG_DUMP(x)
+#endif
 
-DataMessage::DataMessage(int real_len, byte* byte_array, bool need_copying) : real_length(real_len)
+DataMessage::DataMessage() : payload(0), real_length(0), shared(0) {}
+
+DataMessage::DataMessage(int real_len, byte* byte_array, bool need_copying) :
+  real_length(real_len), shared(0)
 {
   assert(real_len > 0);
   if(byte_array && need_copying)
@@ -23,7 +31,8 @@ DataMessage::DataMessage(int real_len, byte* byte_array, bool need_copying) : re
   else payload = byte_array;
 }
 
-DataMessage::DataMessage(DataChunk* datachk, bool need_copying) : real_length(0) // to identify the payload is a list of data chunks
+DataMessage::DataMessage(DataChunk* datachk, bool need_copying) :
+  real_length(0), shared(0) // zero real_length identifies the payload is a list of data chunks
 {
   if(datachk && need_copying)
   {
@@ -32,12 +41,27 @@ DataMessage::DataMessage(DataChunk* datachk, bool need_copying) : real_length(0)
   else payload = datachk;
 }
 
+DataMessage::DataMessage(int real_len, PayloadBuffer* buf, uint32 offset) :
+  real_length(real_len)
+{
+  assert(real_len > 0 && buf && offset+real_len <= buf->size);
+  shared = buf->ref();
+  payload = buf->data+offset;
+}
+
 DataMessage::DataMessage(const DataMessage& dmsg) : ProtocolMessage(dmsg) // important !!!
 {
   real_length = dmsg.real_length;
+  shared = 0;
   if(dmsg.payload)
   {
-    if(real_length > 0)
+    if(dmsg.shared)
+    {
+      // a slice of a shared buffer is never copied
+      shared = dmsg.shared->ref();
+      payload = dmsg.payload;
+    }
+    else if(real_length > 0)
     {
       payload = new byte[real_length]; assert(payload);
       memcpy((byte*)payload, (byte*)dmsg.payload, real_length);
@@ -57,8 +81,9 @@ ProtocolMessage* DataMessage::clone()
 
 DataMessage::~DataMessage()
 {
-  printf("Deleting Data Message\n");
-  if(payload)
+  DATAMSG_DUMP(printf("delete data message.\n"));
+  if(shared) shared->unref();
+  else if(payload)
   {
     if(real_length > 0) delete[] (byte*)payload;
     else delete (DataChunk*)payload;
@@ -76,6 +101,70 @@ int DataMessage::packingSize()
   else return base;
 }
 
+void DataMessage::serialize(byte* buf, int& offset)
+{
+  ProtocolMessage::serialize(buf, offset);
+  int32 len = real_length;
+  memcpy(&buf[offset], &len, sizeof(int32)); offset += sizeof(int32);
+
+  // a byte array is counted as one chunk if it's there; zero real
+  // length means a list of data chunks
+  int32 num = 0;
+  if(real_length > 0) num = payload ? 1 : 0;
+  else for(DataChunk* chk = (DataChunk*)payload; chk; chk = chk->next) num++;
+  memcpy(&buf[offset], &num, sizeof(int32)); offset += sizeof(int32);
+
+  if(real_length > 0)
+  {
+    if(payload) { memcpy(&buf[offset], payload, real_length); offset += real_length; }
+    return;
+  }
+  for(DataChunk* chk = (DataChunk*)payload; chk; chk = chk->next)
+  {
+    int32 chklen = chk->real_length;
+    int32 real = chk->real_data ? 1 : 0;
+    memcpy(&buf[offset], &chklen, sizeof(int32)); offset += sizeof(int32);
+    memcpy(&buf[offset], &real, sizeof(int32)); offset += sizeof(int32);
+    if(real) { memcpy(&buf[offset], chk->real_data, chklen); offset += chklen; }
+  }
+}
+
+void DataMessage::deserialize(byte* buf, int& offset)
+{
+  ProtocolMessage::deserialize(buf, offset);
+  int32 len, num;
+  memcpy(&len, &buf[offset], sizeof(int32)); offset += sizeof(int32);
+  memcpy(&num, &buf[offset], sizeof(int32)); offset += sizeof(int32);
+  real_length = len;
+  shared = 0;
+  payload = 0;
+
+  if(real_length > 0)
+  {
+    if(num > 0)
+    {
+      payload = new byte[real_length]; assert(payload);
+      memcpy(payload, &buf[offset], real_length); offset += real_length;
+    }
+    return;
+  }
+  DataChunk** tail = (DataChunk**)&payload;
+  for(int i=0; i<num; i++)
+  {
+    int32 chklen, real;
+    memcpy(&chklen, &buf[offset], sizeof(int32)); offset += sizeof(int32);
+    memcpy(&real, &buf[offset], sizeof(int32)); offset += sizeof(int32);
+    byte* data = 0;
+    if(real)
+    {
+      data = new byte[chklen]; assert(data);
+      memcpy(data, &buf[offset], chklen); offset += chklen;
+    }
+    *tail = new DataChunk(chklen, data);
+    tail = &(*tail)->next;
+  }
+}
+
 int DataMessage::realByteCount() 
 { 
   if(real_length > 0) return real_length; 
@@ -83,7 +172,8 @@ int DataMessage::realByteCount()
   else return 0;
 }
 
-S3FNET_REGISTER_MESSAGE(DataMessage, S3FNET_PROTOCOL_TYPE_OPAQUE_DATA);
+S3FNET_DEFINE_MESSAGE_POOL(DataChunk);
+S3FNET_REGISTER_POOLED_MESSAGE(DataMessage, S3FNET_PROTOCOL_TYPE_OPAQUE_DATA);
 
 }; // namespace s3fnet
 }; // namespace s3f
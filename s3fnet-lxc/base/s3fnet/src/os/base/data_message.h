@@ -13,6 +13,48 @@
 namespace s3f {
 namespace s3fnet {
 
+/**
+ * \brief A reference-counted byte buffer.
+ *
+ * Used when the application data is carried in the shared payload
+ * mode: the bytes are copied once into a payload buffer, and the
+ * data chunks and data messages carrying the data (including their
+ * clones and retransmissions) only view a slice of it. The reference
+ * count is updated atomically since messages may be handed from one
+ * timeline to another.
+ */
+class PayloadBuffer {
+ public:
+  /** Create a buffer holding a copy of the given bytes (or
+      uninitialized if bytes is NULL); the caller holds the first
+      reference. */
+  PayloadBuffer(uint32 len, byte* bytes = 0) : size(len), refcnt(1)
+  {
+    data = new byte[len]; assert(data);
+    if(bytes) memcpy(data, bytes, len);
+  }
+
+  /** Add a reference and return the buffer. */
+  PayloadBuffer* ref() { __sync_add_and_fetch(&refcnt, 1); return this; }
+
+  /** Drop a reference; the buffer is reclaimed with the last one. */
+  void unref() { if(__sync_sub_and_fetch(&refcnt, 1) == 0) delete this; }
+
+ public:
+  /** The bytes. */
+  byte* data;
+
+  /** Number of bytes in the buffer. */
+  uint32 size;
+
+ private:
+  /** The destructor; only called by unref(). */
+  ~PayloadBuffer() { delete[] data; }
+
+  /** Number of chunks, messages and users referring to the buffer. */
+  int refcnt;
+};
+
 /**
  * \brief List of data chunks to be carried by a protocol message.
  * 
@@ -25,22 +67,42 @@ namespace s3fnet {
 class DataChunk {
  public:
   /** The constructor without setting the fields. */
-  DataChunk() : real_length(0), real_data(0), next(0) {}
+  DataChunk() : real_length(0), real_data(0), shared(0), next(0) {}
   
   /** The constructor with specific fields. */
   DataChunk(uint32 len, byte* data = 0, DataChunk* nxt = 0) :
-    real_length(len), real_data(data), next(nxt) {}
+    real_length(len), real_data(data), shared(0), next(nxt) {}
+
+  /** The constructor for a chunk viewing len bytes of a shared
+      payload buffer from the given offset; a reference to the buffer
+      is added. */
+  DataChunk(uint32 len, PayloadBuffer* buf, uint32 offset, DataChunk* nxt = 0) :
+    real_length(len), real_data(buf->data+offset), shared(buf->ref()), next(nxt)
+  {
+    assert(offset+len <= buf->size);
+  }
 
   /** The copy constructor; make a copy of this data chunk as well as
-      all chunks following this one. */
+      all chunks following this one. A chunk viewing a shared payload
+      buffer is not copied, the copy views the same bytes. */
   DataChunk(const DataChunk& chunk) : real_length(chunk.real_length)
   {
-    if(chunk.real_data)
+    if(chunk.shared)
+    {
+      shared = chunk.shared->ref();
+      real_data = chunk.real_data;
+    }
+    else if(chunk.real_data)
     {
+      shared = 0;
       real_data = new byte[real_length]; assert(real_data);
       memcpy(real_data, chunk.real_data, real_length);
     }
-    else real_data = 0;
+    else
+    {
+      shared = 0;
+      real_data = 0;
+    }
 
     if(chunk.next) next = chunk.next->clone();
     else next = 0;
@@ -52,14 +114,15 @@ class DataChunk {
   /** The destructor. */
   ~DataChunk()
   {
-    if(real_data) delete[] real_data;
+    if(shared) shared->unref();
+    else if(real_data) delete[] real_data;
     if(next) delete next;
   }
 
   /** When packing this data node, how much space is needed to pack
       the data into a byte array. This is the size of the data
       eventually got transferred in the simulation system. */
-  int packingSize() { return 2*sizeof(int32)+real_data?real_length:0; }
+  int packingSize() { return 2*sizeof(int32)+(real_data?real_length:0); }
   
   /** Total packing size including this chunk and the followers. */
   int totalPackingSize()
@@ -87,9 +150,16 @@ class DataChunk {
 
   /** The real data. if it's NULL, this is a fake data block. */
   byte* real_data;
+
+  /** If not NULL, real_data points into this shared buffer (which
+      the chunk does not own) rather than to a private copy. */
+  PayloadBuffer* shared;
   
   /** Points to the next data chunk. */
   DataChunk* next;
+
+  /** Data chunks are recycled through a message pool. */
+  S3FNET_POOLED_MESSAGE(DataChunk);
 };
 
 /**
@@ -107,7 +177,8 @@ class DataChunk {
  * case the list could have both fake data and real data blocks. This
  * situation is identified by having real_length set to be zero. The
  * real length of the payload can be obtained by invoking the
- * DataChunk::totalRealBytes method.
+ * DataChunk::totalRealBytes method. In the former case, the byte
+ * array may also be a slice of a shared payload buffer.
  */
 class DataMessage : public ProtocolMessage {
  public:
@@ -120,6 +191,10 @@ class DataMessage : public ProtocolMessage {
       payload is a list of data chunks. */
   int real_length;
 
+  /** If not NULL, the byte array payload is a slice of this shared
+      buffer rather than owned by the message. */
+  PayloadBuffer* shared;
+
   /** Default constructor without any argument. */
   DataMessage();
 
@@ -142,6 +217,13 @@ class DataMessage : public ProtocolMessage {
    */
   DataMessage(DataChunk* data_chunks, bool need_copying = false);
 
+  /**
+   * This is the constructor for a payload of real_len bytes viewing a
+   * shared payload buffer from the given offset. The bytes are not
+   * copied; a reference to the buffer is added.
+   */
+  DataMessage(int real_len, PayloadBuffer* buf, uint32 offset);
+
   /** The copy constructor. */
   DataMessage(const DataMessage&);
 
@@ -160,6 +242,22 @@ class DataMessage : public ProtocolMessage {
    */
   virtual int packingSize();
 
+  /**
+   * Pack this data message to buffer starting from the given offset:
+   * the real length and the number of chunks (or whether the byte
+   * array is there), then the bytes of each chunk. Fake data is only
+   * packed as its length; a slice of a shared buffer is packed as its
+   * bytes.
+   */
+  virtual void serialize(byte* buf, int& offset);
+
+  /** Unpack the data message from buf from given offset; the payload
+      is owned by the message, never shared. */
+  virtual void deserialize(byte* buf, int& offset);
+
+  /** The data message can be saved in a checkpoint or sent to another shard. */
+  virtual bool serializable() { return true; }
+
   /**
    * Return the number of bytes that this data message occupies in the
    * real world, even though we might not actually allocating the
@@ -167,6 +265,8 @@ class DataMessage : public ProtocolMessage {
    */
   virtual int realByteCount();
 
+  /** Data messages are recycled through a message pool. */
+  S3FNET_POOLED_MESSAGE(DataMessage);
 };
 
 }; // namespace s3fnet
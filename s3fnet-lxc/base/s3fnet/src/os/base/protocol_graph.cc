@@ -9,6 +9,8 @@
 #include "util/errhandle.h"
 #include "os/base/protocol_session.h"
 #include "os/base/protocols.h"
+#include "net/host.h"
+#include "net/checkpoint.h"
 
 namespace s3f {
 namespace s3fnet {
@@ -50,6 +52,10 @@ void ProtocolGraph::config(s3f::dml::Configuration* cfg)
 
 void ProtocolGraph::init() 
 {
+  // resolve the protocol number dispatch table once all sessions
+  // (including the default ones inserted by the host) are known
+  resolve_dispatch_table();
+
   // Initialize each protocol session: the order in which protocol
   // sessions are initialized in this case is that the last 'session' 
   // defined in 'graph' attribute goes first, although it's after
@@ -62,6 +68,16 @@ void ProtocolGraph::init()
   }
 }
 
+void ProtocolGraph::create_random_streams(Host* host)
+{
+  for(S3FNET_GRAPH_PSESS_VECTOR::reverse_iterator iter = protocol_list.rbegin();
+      iter != protocol_list.rend(); iter++)
+  {
+    if(!(*iter)->initialized() && !(*iter)->sess_rng)
+      (*iter)->sess_rng = host->new_random_stream();
+  }
+}
+
 void ProtocolGraph::wrapup() 
 {
   // wrapup each protocol session
@@ -72,6 +88,83 @@ void ProtocolGraph::wrapup()
   }
 }
 
+bool ProtocolGraph::save_sessions(Checkpoint* ckpt)
+{
+  uint32 n = protocol_list.size();
+  ckpt->put(n);
+  for(S3FNET_GRAPH_PSESS_VECTOR::iterator iter = protocol_list.begin();
+      iter != protocol_list.end(); iter++)
+  {
+    ProtocolSession* sess = *iter;
+    ckpt->putString(sess->name);
+    ckpt->putString(sess->use);
+
+    // a session drawing from the random stream of the host saves nothing
+    bool own_rng = sess->getRandom() && sess->getRandom() != sess->inHost()->getRandom();
+    ckpt->put(own_rng);
+    if(own_rng) ckpt->putRandom(sess->getRandom());
+
+    if(!sess->save_state(ckpt))
+    {
+      error_retn("WARNING: [host=\"%s\"] ProtocolGraph::save_sessions(), "
+		 "protocol session %s (%s) does not support checkpoints.\n",
+		 sess->inHost()->nhi.toString(), sess->name, sess->use);
+      return false;
+    }
+  }
+  return true;
+}
+
+void ProtocolGraph::restore_sessions(Checkpoint* ckpt)
+{
+  uint32 n;
+  ckpt->get(n);
+  if(n != protocol_list.size())
+    error_quit("ERROR: ProtocolGraph::restore_sessions(), the checkpoint has %u protocol sessions, "
+	       "the graph has %u.\n", n, (unsigned)protocol_list.size());
+  for(S3FNET_GRAPH_PSESS_VECTOR::iterator iter = protocol_list.begin();
+      iter != protocol_list.end(); iter++)
+  {
+    ProtocolSession* sess = *iter;
+    S3FNET_STRING name = ckpt->getString();
+    S3FNET_STRING use = ckpt->getString();
+    if(name != sess->name || use != sess->use)
+      error_quit("ERROR: [host=\"%s\"] ProtocolGraph::restore_sessions(), the checkpoint has "
+		 "protocol session %s (%s) in place of %s (%s).\n", sess->inHost()->nhi.toString(),
+		 name.c_str(), use.c_str(), sess->name, sess->use);
+
+    bool own_rng;
+    ckpt->get(own_rng);
+    if(own_rng != (sess->getRandom() && sess->getRandom() != sess->inHost()->getRandom()))
+      error_quit("ERROR: [host=\"%s\"] ProtocolGraph::restore_sessions(), protocol session %s "
+		 "was saved with another random stream.\n", sess->inHost()->nhi.toString(), sess->name);
+    if(own_rng) ckpt->getRandom(sess->getRandom());
+
+    sess->restore_state(ckpt);
+  }
+
+  // the sessions may refer to each other only once all are restored
+  for(S3FNET_GRAPH_PSESS_VECTOR::iterator iter = protocol_list.begin();
+      iter != protocol_list.end(); iter++)
+    (*iter)->restore_links();
+}
+
+int ProtocolGraph::session_timeouts()
+{
+  int n = 0;
+  for(S3FNET_GRAPH_PSESS_VECTOR::iterator iter = protocol_list.begin();
+      iter != protocol_list.end(); iter++)
+    n += (*iter)->saved_timeouts();
+  return n;
+}
+
+int ProtocolGraph::sessionIndex(ProtocolSession* sess)
+{
+  for(unsigned i=0; i<protocol_list.size(); i++)
+    if(protocol_list[i] == sess) return i;
+  return -1;
+}
+
 ProtocolSession* ProtocolGraph::sessionForName(char* pname) 
 {
   // return protocol session of the given name or NULL if not found
@@ -81,18 +174,31 @@ ProtocolSession* ProtocolGraph::sessionForName(char* pname)
   else return 0;
 }
 
-ProtocolSession* ProtocolGraph::sessionForNumber(int pno)
+ProtocolSession* ProtocolGraph::session_for_number_slow(int pno)
 {
-  // return protocol session of the given name or NULL if not found
+  // return protocol session of the given number or NULL if not found
   S3FNET_GRAPH_PROTONUM_MAP::iterator iter = pno_map.find(pno);
   if(iter != pno_map.end()) return (*iter).second;
   else return 0;
 }
 
+void ProtocolGraph::resolve_dispatch_table()
+{
+  memset(pno_table, 0, sizeof(pno_table));
+  for(S3FNET_GRAPH_PROTONUM_MAP::iterator iter = pno_map.begin();
+      iter != pno_map.end(); iter++)
+  {
+    if((*iter).first >= 0 && (*iter).first < S3FNET_GRAPH_DISPATCH_SIZE)
+      pno_table[(*iter).first] = (*iter).second;
+  }
+}
+
 ProtocolGraph::ProtocolGraph() : 
   // initialize the object accordingly
   description(0)
-{}
+{
+  memset(pno_table, 0, sizeof(pno_table));
+}
 
 ProtocolGraph::~ProtocolGraph() 
 {
@@ -154,6 +260,8 @@ void ProtocolGraph::insert_session(ProtocolSession* psess)
 
   int sno = psess->getProtocolNumber();
   S3FNET_PAIR(S3FNET_GRAPH_PROTONUM_MAP::iterator, bool) ret1 = pno_map.insert(S3FNET_MAKE_PAIR(sno, psess));
+  // keep the dispatch table in step so lookups before init() agree with the map
+  if(ret1.second && sno >= 0 && sno < S3FNET_GRAPH_DISPATCH_SIZE) pno_table[sno] = psess;
   if(!ret1.second)
   {
     if(psess->instantiation_type() == ProtocolSession::PROT_UNIQUE_INSTANCE)
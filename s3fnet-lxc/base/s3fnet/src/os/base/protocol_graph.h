@@ -16,11 +16,20 @@ namespace s3fnet {
 
 class ProtocolSession;
 class Host;
+class Checkpoint;
 
 typedef S3FNET_MAP(S3FNET_STRING, ProtocolSession*) S3FNET_GRAPH_PROTONAME_MAP;
 typedef S3FNET_MAP(int, ProtocolSession*) S3FNET_GRAPH_PROTONUM_MAP;
 typedef S3FNET_VECTOR(ProtocolSession*) S3FNET_GRAPH_PSESS_VECTOR;
 
+/**
+ * Size of the per-graph dispatch table indexed directly by protocol
+ * number; it covers every number in S3FNetProtocolType. Sessions with
+ * a protocol number beyond the table are still reachable through the
+ * protocol number map.
+ */
+#define S3FNET_GRAPH_DISPATCH_SIZE 257
+
 /**
  * \brief A stack of protocol sessions.
  *
@@ -80,6 +89,16 @@ class ProtocolGraph : public s3f::dml::Configurable {
    */
   virtual void init();
 
+  /**
+   * Create a random stream for each protocol session not yet
+   * initialized, in the order in which init() initializes them. It is
+   * used when each session has its own random stream, so that the
+   * streams can be handed out in a fixed order before the graphs of
+   * different hosts are initialized in parallel. The streams are
+   * obtained from the given host (see Host::new_random_stream).
+   */
+  void create_random_streams(Host* host);
+
   /**
    * The wrapup method is called at the end of the simulation. It is
    * used to collect statistical information of the simulation run.
@@ -89,6 +108,32 @@ class ProtocolGraph : public s3f::dml::Configurable {
    */
   virtual void wrapup();
 
+  /**
+   * Save the random streams and the state of the protocol sessions in
+   * the graph to a checkpoint. Return false, naming the protocol
+   * session, if one of them does not support checkpoints.
+   */
+  bool save_sessions(Checkpoint* ckpt);
+
+  /** Restore the state of the protocol sessions from a checkpoint. */
+  void restore_sessions(Checkpoint* ckpt);
+
+  /** Return the number of timeouts the protocol sessions have scheduled. */
+  int session_timeouts();
+
+  /**
+   * Return the position of the protocol session in the graph, or -1
+   * if it is not in the graph; it names the protocol session in a
+   * checkpoint, even if several instances share the same name.
+   */
+  int sessionIndex(ProtocolSession* sess);
+
+  /** Return the protocol session at the given position, or NULL. */
+  ProtocolSession* sessionForIndex(int idx)
+  {
+    return (idx >= 0 && idx < (int)protocol_list.size()) ? protocol_list[idx] : 0;
+  }
+
   /**
    * If a protocol session has been created and registered under the 
    * given name, the method returns the protocol session. Otherwise,
@@ -99,9 +144,16 @@ class ProtocolGraph : public s3f::dml::Configurable {
   /**
    * If a protocol session has been created and registered under the 
    * given protocol number, the method returns the protocol session. 
-   * Otherwise, a NULL is returned.
+   * Otherwise, a NULL is returned. Protocol numbers within the
+   * dispatch table are resolved with a single array index, so this
+   * method is meant to be used on the per-packet path instead of
+   * sessionForName().
    */
-  ProtocolSession* sessionForNumber(int pno);
+  inline ProtocolSession* sessionForNumber(int pno)
+  {
+    if(pno >= 0 && pno < S3FNET_GRAPH_DISPATCH_SIZE) return pno_table[pno];
+    return session_for_number_slow(pno);
+  }
 
  protected:
   /** Mapping between protocol names and instances of protocol sessions. */
@@ -113,6 +165,12 @@ class ProtocolGraph : public s3f::dml::Configurable {
   /** List of protocol sessions created. */
   S3FNET_GRAPH_PSESS_VECTOR protocol_list;
 
+  /**
+   * Dispatch table indexed by protocol number, mirroring pno_map for
+   * the numbers it covers. It is rebuilt from pno_map in init().
+   */
+  ProtocolSession* pno_table[S3FNET_GRAPH_DISPATCH_SIZE];
+
  protected:
   /** The constructor. */
   ProtocolGraph();
@@ -125,6 +183,12 @@ class ProtocolGraph : public s3f::dml::Configurable {
 
   /** Insert a protocol session to this protocol graph. */
   void insert_session(ProtocolSession* psess);
+
+  /** Internal use: look up a protocol number outside the dispatch table. */
+  ProtocolSession* session_for_number_slow(int pno);
+
+  /** Internal use: rebuild the dispatch table from the protocol number map. */
+  void resolve_dispatch_table();
 };
 
 }; // namespace s3fnet
@@ -5,6 +5,7 @@
  * authors : Dong (Kevin) Jin
  */
 
+#include <string.h>
 #include "os/base/protocol_message.h"
 #include "util/errhandle.h"
 
@@ -73,6 +74,70 @@ int ProtocolMessage::packingSize()
   return sizeof(int32);
 }
 
+void ProtocolMessage::serialize(byte* buf, int& offset)
+{
+  int32 t = type();
+  memcpy(&buf[offset], &t, sizeof(int32));
+  offset += sizeof(int32);
+}
+
+void ProtocolMessage::deserialize(byte* buf, int& offset)
+{
+  // the type has been read to create the message
+  offset += sizeof(int32);
+}
+
+bool ProtocolMessage::serializeAll(vector<byte>& buf)
+{
+  int size = 0;
+  for(ProtocolMessage* m = this; m; m = m->next)
+  {
+    if(!m->serializable())
+    {
+      error_retn("WARNING: ProtocolMessage::serializeAll(), protocol message of type %d can't be packed.\n", m->type());
+      return false;
+    }
+    size += m->packingSize();
+  }
+
+  int offset = buf.size();
+  buf.resize(offset+size);
+  for(ProtocolMessage* m = this; m; m = m->next)
+  {
+    int start = offset;
+    m->serialize(&buf[0], offset);
+    if(offset-start != m->packingSize())
+      error_quit("ERROR: ProtocolMessage::serializeAll(), protocol message of type %d packs %d bytes, "
+		 "its packing size is %d.\n", m->type(), offset-start, m->packingSize());
+  }
+  return true;
+}
+
+ProtocolMessage* ProtocolMessage::deserializeAll(const byte* buf, int size)
+{
+  // each header starts with its type, from which it is created
+  ProtocolMessage* head = 0;
+  ProtocolMessage* tail = 0;
+  int offset = 0;
+  while(offset < size)
+  {
+    int32 type;
+    memcpy(&type, &buf[offset], sizeof(int32));
+    S3FNET_INT2PTR_MAP::iterator iter = registered_messages->find(type);
+    if(iter == registered_messages->end())
+    {
+      if(head) head->erase_all();
+      return 0;
+    }
+    ProtocolMessage* m = ((ProtocolMessage* (*)())(*iter).second)();
+    m->deserialize((byte*)buf, offset);
+    if(tail) tail->carryPayload(m);
+    else head = m;
+    tail = m;
+  }
+  return head;
+}
+
 int ProtocolMessage::totalRealBytes()
 {
   // add them all
@@ -112,6 +177,112 @@ int ProtocolMessage::registerMessage(ProtocolMessage* (*fct)(), int type)
   return 0;
 }
 
+__thread MessagePool::FreeList* MessagePool::local_lists[S3FNET_MSGPOOL_MAX_TYPES];
+MessagePool* MessagePool::pools[S3FNET_MSGPOOL_MAX_TYPES];
+int MessagePool::num_pools = 0;
+pthread_mutex_t MessagePool::pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+MessagePool::MessagePool(const char* name, size_t objsize) :
+  pool_name(name), object_size(objsize), all_lists(0)
+{
+  // pools are created during static initialization, one per pooled class
+  if(num_pools < S3FNET_MSGPOOL_MAX_TYPES)
+  {
+    pool_id = num_pools++;
+    pools[pool_id] = this;
+  }
+  else
+  {
+    error_retn("WARNING: MessagePool(), too many pooled message types, %s is not pooled\n", name);
+    pool_id = -1;
+  }
+}
+
+MessagePool::FreeList* MessagePool::local_freelist()
+{
+  FreeList* fl = local_lists[pool_id];
+  if(!fl)
+  {
+    fl = new FreeList; assert(fl);
+    fl->head = 0;
+    fl->length = 0;
+    fl->requests = fl->hits = fl->releases = fl->trimmed = 0;
+
+    // the statistics of all timelines are collected for the final report
+    pthread_mutex_lock(&pool_mutex);
+    fl->next_list = all_lists;
+    all_lists = fl;
+    pthread_mutex_unlock(&pool_mutex);
+
+    local_lists[pool_id] = fl;
+  }
+  return fl;
+}
+
+void* MessagePool::allocate(size_t sz)
+{
+  // derived classes without their own pool are allocated from the heap
+  if(pool_id < 0 || sz != object_size) return ::operator new(sz);
+
+  FreeList* fl = local_freelist();
+  fl->requests++;
+  if(fl->head)
+  {
+    void* obj = fl->head;
+    fl->head = *(void**)obj;
+    fl->length--;
+    fl->hits++;
+    return obj;
+  }
+  return ::operator new(sz);
+}
+
+void MessagePool::release(void* obj, size_t sz)
+{
+  if(!obj) return;
+  if(pool_id < 0 || sz != object_size)
+  {
+    ::operator delete(obj);
+    return;
+  }
+
+  FreeList* fl = local_freelist();
+  fl->releases++;
+  if(fl->length >= S3FNET_MSGPOOL_MAX_FREE)
+  {
+    // keep a timeline that mostly receives messages from hoarding them
+    fl->trimmed++;
+    ::operator delete(obj);
+    return;
+  }
+  *(void**)obj = fl->head;
+  fl->head = obj;
+  fl->length++;
+}
+
+void MessagePool::report()
+{
+  printf("-------------- message pool statistics -------------\n");
+  printf("%-18s %12s %12s %8s %12s %10s\n", "pool", "requests", "hits", "hit%", "released", "trimmed");
+  for(int i=0; i<num_pools; i++)
+  {
+    uint64 requests = 0, hits = 0, releases = 0, trimmed = 0;
+    pthread_mutex_lock(&pool_mutex);
+    for(FreeList* fl = pools[i]->all_lists; fl; fl = fl->next_list)
+    {
+      requests += fl->requests;
+      hits += fl->hits;
+      releases += fl->releases;
+      trimmed += fl->trimmed;
+    }
+    pthread_mutex_unlock(&pool_mutex);
+    if(!requests && !releases) continue;
+    printf("%-18s %12llu %12llu %7.2f%% %12llu %10llu\n", pools[i]->pool_name,
+	   requests, hits, requests ? 100.0*hits/requests : 0.0, releases, trimmed);
+  }
+  printf("----------------------------------------------------\n");
+}
+
 }; // namespace s3fnet
 }; // namespace s3f
 
@@ -14,6 +14,81 @@
 namespace s3f {
 namespace s3fnet {
 
+/** Maximum number of message classes that may own a pool. */
+#define S3FNET_MSGPOOL_MAX_TYPES 32
+
+/** Maximum number of free objects a timeline keeps in one pool; the
+    surplus is handed back to the heap. */
+#define S3FNET_MSGPOOL_MAX_FREE 4096
+
+/**
+ * \brief Per-type freelist of protocol message objects.
+ *
+ * Each pooled message class (see S3FNET_POOLED_MESSAGE) owns one
+ * MessagePool, which overrides the class-specific new and delete
+ * operators. Released objects are kept on a freelist private to the
+ * calling thread, i.e., to the timeline that erased the message, so
+ * neither the factory nor erase() needs a lock. A message that is
+ * created on one timeline and erased on another simply moves to the
+ * pool of the latter.
+ */
+class MessagePool {
+ public:
+  /** The constructor; called once per pooled class at static
+      initialization time by S3FNET_REGISTER_POOLED_MESSAGE. */
+  MessagePool(const char* name, size_t objsize);
+
+  /** Return an object from the freelist of the calling timeline, or
+      from the heap if the freelist is empty. */
+  void* allocate(size_t sz);
+
+  /** Put the object back onto the freelist of the calling timeline. */
+  void release(void* obj, size_t sz);
+
+  /** Print the hit rates of all pools (summed over all timelines). */
+  static void report();
+
+ private:
+  /** The freelist of one pool owned by one timeline. */
+  struct FreeList {
+    void* head; ///< first free object; the link is kept in the object itself
+    int length; ///< number of objects on the freelist
+    uint64 requests; ///< number of allocations
+    uint64 hits; ///< number of allocations served from the freelist
+    uint64 releases; ///< number of objects returned
+    uint64 trimmed; ///< number of returned objects handed back to the heap
+    FreeList* next_list; ///< chains all freelists of the same pool
+  };
+
+  /** Return (create on first use) the freelist of the calling thread. */
+  FreeList* local_freelist();
+
+  /** Index of this pool; -1 if we ran out of pool slots. */
+  int pool_id;
+
+  /** Name of the pooled class, used for reporting. */
+  const char* pool_name;
+
+  /** Size of the pooled class; objects of other sizes (i.e., derived
+      classes without a pool of their own) bypass the pool. */
+  size_t object_size;
+
+  /** All freelists of this pool, one per timeline that has used it. */
+  FreeList* all_lists;
+
+  /** Freelists of the calling thread, indexed by pool id. */
+  static __thread FreeList* local_lists[S3FNET_MSGPOOL_MAX_TYPES];
+
+  /** All pools created, indexed by pool id. */
+  static MessagePool* pools[S3FNET_MSGPOOL_MAX_TYPES];
+
+  /** Number of pools created. */
+  static int num_pools;
+
+  /** Protects all_lists when a timeline creates its freelist. */
+  static pthread_mutex_t pool_mutex;
+};
+
 /**
  * \brief Protocol message through the protocol stack.
  *
@@ -106,7 +181,8 @@ class ProtocolMessage : public Message
    * This method is called to release the memory of this packet and
    * its subsequent payload. One must avoid deleting a protocol
    * message object directly.  This requirement is necessary for the
-   * support to optimizations such as the reference counter.
+   * support to optimizations such as the reference counter and the
+   * message pools (a pooled message goes back to its MessagePool).
    *
    * For better protection, the destructor of the protocol message
    * (and its extended classes) should be defined as protected.
@@ -131,6 +207,37 @@ class ProtocolMessage : public Message
    */
   virtual int packingSize();
 
+  /**
+   * Pack this protocol header (not the payload) into buf from the
+   * given offset, and advance the offset by packingSize() bytes. It
+   * is used to save the packets in flight in a checkpoint (see the
+   * Checkpoint class) and to send them to another shard (see
+   * SimInterface::pack_activation). The derived class should override this
+   * method, deserialize() and serializable() together. <b>The method
+   * in the base class must be called first</b>: it packs the type of
+   * the message, from which the message is created again.
+   */
+  virtual void serialize(byte* buf, int& offset);
+
+  /** Unpack the protocol header packed by serialize() from buf at
+      the given offset, and advance the offset. */
+  virtual void deserialize(byte* buf, int& offset);
+
+  /** Return true if serialize() packs the whole header. The default
+      is false: the message cannot be saved in a checkpoint, nor
+      cross shards. */
+  virtual bool serializable() { return false; }
+
+  /**
+   * Pack this protocol message and its payload, appended to buf. Return
+   * false, with a message, if one of the headers cannot be packed.
+   */
+  bool serializeAll(vector<byte>& buf);
+
+  /** Rebuild a protocol message packed by serializeAll() from the given
+      bytes; return NULL if one of the types is not registered. */
+  static ProtocolMessage* deserializeAll(const byte* buf, int size);
+
   /** Returns the total number of bytes of the protocol message
       including the payload in the real-world. */
   int totalRealBytes();
@@ -167,6 +274,28 @@ class ProtocolMessage : public Message
   static ProtocolMessage* s3fnet_new_message_##name() { return new name; } \
   int s3fnet_register_message_##name = ProtocolMessage::registerMessage(s3fnet_new_message_##name, type)
 
+/**
+ * Place this macro in the class declaration of a protocol message (or
+ * any other frequently allocated object, such as DataChunk) to have
+ * its objects recycled through a per-type, per-timeline MessagePool.
+ * The members following the macro are public.
+ */
+#define S3FNET_POOLED_MESSAGE(name) \
+ public: \
+  static void* operator new(size_t sz) { return name::msg_pool.allocate(sz); } \
+  static void operator delete(void* obj, size_t sz) { name::msg_pool.release(obj, sz); } \
+  static MessagePool msg_pool
+
+/** Define the pool of a class declared with S3FNET_POOLED_MESSAGE. */
+#define S3FNET_DEFINE_MESSAGE_POOL(name) \
+  MessagePool name::msg_pool(#name, sizeof(name))
+
+/** Same as S3FNET_REGISTER_MESSAGE, for a protocol message declared
+    with S3FNET_POOLED_MESSAGE. */
+#define S3FNET_REGISTER_POOLED_MESSAGE(name, type) \
+  S3FNET_DEFINE_MESSAGE_POOL(name); \
+  S3FNET_REGISTER_MESSAGE(name, type)
+
 }; // namespace s3fnet
 }; // namespace s3f
 
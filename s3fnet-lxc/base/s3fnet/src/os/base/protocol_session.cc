@@ -5,6 +5,7 @@
  * authors : Dong (Kevin) Jin
  */
 
+#include <typeinfo>
 #include "os/base/protocol_session.h"
 #include "util/errhandle.h"
 #include "net/host.h"
@@ -52,8 +53,8 @@ void ProtocolSession::init()
 
   if(inHost()->getHostSeed() == 0) //host-level rng, i.e. same rng within one host
 	  sess_rng = inHost()->getRandom();
-  else
-	  sess_rng = new Random::RNG();
+  else if(!sess_rng) //normally created beforehand by the protocol graph
+	  sess_rng = inHost()->new_random_stream();
 }
 
 void ProtocolSession::wrapup()
@@ -71,12 +72,31 @@ void ProtocolSession::wrapup()
 
 int ProtocolSession::pushdown(Activation msg, ProtocolSession* hi_sess, void* extinfo, size_t extinfo_size)
 {
-  return push(msg, hi_sess, extinfo, extinfo_size);
+  if(!Timeline::profiling_processes()) return push(msg, hi_sess, extinfo, extinfo_size);
+  unsigned int outer = enter_cost("push");
+  int ret = push(msg, hi_sess, extinfo, extinfo_size);
+  leave_cost(outer);
+  return ret;
 }
 
 int ProtocolSession::popup(Activation msg, ProtocolSession* lo_sess, void* extinfo, size_t extinfo_size)
 {
-  return pop(msg, lo_sess, extinfo, extinfo_size);
+  if(!Timeline::profiling_processes()) return pop(msg, lo_sess, extinfo, extinfo_size);
+  unsigned int outer = enter_cost("pop");
+  int ret = pop(msg, lo_sess, extinfo, extinfo_size);
+  leave_cost(outer);
+  return ret;
+}
+
+unsigned int ProtocolSession::enter_cost(const char* what)
+{
+  if(!Timeline::profiling_processes()) return 0;
+  return inHost()->alignment()->enter_cost_section(typeid(*this).name(), what);
+}
+
+void ProtocolSession::leave_cost(unsigned int outer)
+{
+  if(outer) inHost()->alignment()->leave_cost_section(outer);
 }
 
 int ProtocolSession::push(Activation msg, ProtocolSession* hi_sess, void* extinfo, size_t extinfo_size)
@@ -8,6 +8,7 @@
 #ifndef __PROTOCOL_SESSION_H__
 #define __PROTOCOL_SESSION_H__
 
+#include <typeinfo>
 #include "dml.h"
 #include "s3f.h"
 #include "s3fnet.h"
@@ -17,6 +18,8 @@ namespace s3fnet {
 
 class Host;
 class ProtocolGraph;
+class Checkpoint;
+class SocketContinuation;
 
 /**
  * \brief A protocol layer on the protocol stack.
@@ -123,6 +126,56 @@ class ProtocolSession : public s3f::dml::Configurable {
    */
   virtual void wrapup();
 
+  /**
+   * The method is used to save the dynamic state of the protocol
+   * session in a checkpoint taken between two epochs (see the
+   * Checkpoint class); the configuration is not saved, it is read
+   * from the DML of the run that restores the checkpoint. The method
+   * returns false if the protocol session does not support
+   * checkpoints, which is the default behavior: the derived class
+   * should override this method and restore_state() together.
+   */
+  virtual bool save_state(Checkpoint* ckpt) { return false; }
+
+  /**
+   * The method is used to restore the state saved by save_state(),
+   * after the protocol session has been initialized. The timeouts
+   * of the session pending at the checkpoint must be scheduled again
+   * here; those scheduled by init() have been discarded.
+   */
+  virtual void restore_state(Checkpoint* ckpt) {}
+
+  /**
+   * Return the number of timeouts (S3F events scheduled by waitFor)
+   * of the protocol session that save_state() saves and
+   * restore_state() schedules again. The default is zero.
+   */
+  virtual int saved_timeouts() { return 0; }
+
+  /**
+   * The method is called once all the protocol sessions of the host
+   * have restored their state from a checkpoint, to link again the
+   * state that refers to other protocol sessions (such as the sockets
+   * to their TCP sessions). The default behavior is doing nothing.
+   */
+  virtual void restore_links() {}
+
+  /**
+   * The method is used by the socket master to save the state of a
+   * socket continuation owned by this protocol session, which is
+   * blocked on a socket at the checkpoint. It returns false if the
+   * protocol session cannot save its continuations, which is the
+   * default behavior.
+   */
+  virtual bool save_continuation(Checkpoint* ckpt, SocketContinuation* cnt) { return false; }
+
+  /**
+   * The method is used to create the socket continuation saved by
+   * save_continuation(), blocked on the given socket. Any timeout of
+   * the continuation must be scheduled again here.
+   */
+  virtual SocketContinuation* restore_continuation(Checkpoint* ckpt, int sock) { return 0; }
+
   /**
    * The original push method is divided into pushdown() and push().
    * The pushdown method is the generic part of the code, which is
@@ -140,6 +193,54 @@ class ProtocolSession : public s3f::dml::Configurable {
    */
   int popup(Activation msg, ProtocolSession* lo_sess, void* extinfo = 0, size_t extinfo_size = 0);
 
+  /**
+   * The static pipeline through the standard PHY-MAC-IP-{TCP,UDP,LXCEMU}
+   * stack: pushdown() to sess, where std_sess is the same session if it
+   * is of class T exactly (see session_of_class()) and NULL otherwise.
+   * T::push() is then called directly rather than through the virtual
+   * table. The stacks assembled otherwise in DML, and the profiled runs
+   * (s3fnet -P), take the generic pushdown(). T must befriend
+   * ProtocolSession if its push() is not public.
+   */
+  template<class T>
+  static int pushdown_to(T* std_sess, ProtocolSession* sess, Activation msg, ProtocolSession* hi_sess,
+			 void* extinfo = 0, size_t extinfo_size = 0)
+  {
+    if(std_sess && !Timeline::profiling_processes())
+      return std_sess->T::push(msg, hi_sess, extinfo, extinfo_size);
+    return sess->pushdown(msg, hi_sess, extinfo, extinfo_size);
+  }
+
+  /** The static pipeline for popup(), as pushdown_to() for pushdown(). */
+  template<class T>
+  static int popup_to(T* std_sess, ProtocolSession* sess, Activation msg, ProtocolSession* lo_sess,
+		      void* extinfo = 0, size_t extinfo_size = 0)
+  {
+    if(std_sess && !Timeline::profiling_processes())
+      return std_sess->T::pop(msg, lo_sess, extinfo, extinfo_size);
+    return sess->popup(msg, lo_sess, extinfo, extinfo_size);
+  }
+
+  /** Return sess if it is of class T exactly, not of a class derived
+      from T, or NULL: the session the static pipeline can call. */
+  template<class T>
+  static T* session_of_class(ProtocolSession* sess)
+  {
+    return (sess && typeid(*sess) == typeid(T)) ? (T*)sess : 0;
+  }
+
+  /**
+   * When the process bodies are profiled (s3fnet -P), charge the cycles
+   * from now to the matching leave_cost() to the class of this session
+   * doing what (a string literal), rather than to the process body
+   * running; pushdown() and popup() do so for push() and pop().
+   * Returns what leave_cost() needs.
+   */
+  unsigned int enter_cost(const char* what);
+
+  /** Return to the code running before the matching enter_cost(). */
+  void leave_cost(unsigned int outer);
+
   /**
    * The control method is used by the protocol session to receive
    * control messages (or information queries) from other protocol
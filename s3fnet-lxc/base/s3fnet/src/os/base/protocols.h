@@ -36,7 +36,9 @@ class Protocols {
  public:
   /**
    * The method is used by ProtocolGraph's config method to create
-   * protocol session instances from the DML description.
+   * protocol session instances from the DML description. The protocols
+   * are all registered during static initialization, so the method
+   * may be called from the timeline threads configuring the hosts.
    */
   static ProtocolSession* newInstance(char* classname, ProtocolGraph* graph);
 
@@ -0,0 +1,164 @@
+/**
+ * \file cApp_flow.cc
+ * \brief Source file for the per-flow state table of the cApp session.
+ *
+ * authors : Vignesh Babu
+ */
+
+#include <string.h>
+#include "os/cApp/cApp_flow.h"
+
+namespace s3f {
+namespace s3fnet {
+
+/** Initial number of slots of the hash table. */
+#define CAPP_FLOW_TABLE_SLOTS 64
+
+cAppFlowTable::cAppFlowTable() : mask(CAPP_FLOW_TABLE_SLOTS-1), count(0)
+{
+  slots = new int[CAPP_FLOW_TABLE_SLOTS];
+  for(unsigned i=0; i<=mask; i++) slots[i] = -1;
+}
+
+cAppFlowTable::~cAppFlowTable()
+{
+  delete[] slots;
+}
+
+unsigned cAppFlowTable::hash(const cAppFlowKey& k)
+{
+  unsigned h = k.ip[0]*2654435761u ^ k.ip[1]*2246822519u ^
+    (((unsigned)k.port[0] << 16) | k.port[1])*3266489917u ^ k.proto;
+  return h ^ (h >> 16);
+}
+
+unsigned cAppFlowTable::find_slot(const cAppFlowKey& k) const
+{
+  for(unsigned i = hash(k) & mask; ; i = (i+1) & mask)
+    if(slots[i] < 0 || flows[slots[i]].key == k) return i;
+}
+
+cAppFlow* cAppFlowTable::find(const cAppFlowKey& k) const
+{
+  int idx = slots[find_slot(k)];
+  return idx < 0 ? 0 : (cAppFlow*)&flows[idx];
+}
+
+void cAppFlowTable::rebuild(unsigned nslots)
+{
+  delete[] slots;
+  slots = new int[nslots];
+  mask = nslots-1;
+  for(unsigned i=0; i<nslots; i++) slots[i] = -1;
+  for(unsigned idx=0; idx<flows.size(); idx++)
+    if(flows[idx].key.proto) slots[find_slot(flows[idx].key)] = idx;
+}
+
+cAppFlow* cAppFlowTable::lookup(const cAppPacket& pkt, ltime_t now, int* dir)
+{
+  if(!pkt.isTCP() && !pkt.isUDP()) return 0;
+
+  // the lower endpoint first
+  IPv4View iph = pkt.ip();
+  IPADDR src = iph.src(), dst = iph.dst();
+  uint16 sport = pkt.srcPort(), dport = pkt.dstPort();
+  int d = (src < dst || (src == dst && sport <= dport)) ? 0 : 1;
+  cAppFlowKey k;
+  k.ip[d] = src; k.ip[1-d] = dst;
+  k.port[d] = sport; k.port[1-d] = dport;
+  k.proto = iph.protocol();
+
+  unsigned i = find_slot(k);
+  cAppFlow* f;
+  if(slots[i] >= 0) f = &flows[slots[i]];
+  else
+  {
+    // keep the table at most half full
+    if(2*(count+1) > (int)mask+1)
+    {
+      rebuild(2*(mask+1));
+      i = find_slot(k);
+    }
+    int idx;
+    if(!free_flows.empty())
+    {
+      idx = free_flows.back();
+      free_flows.pop_back();
+    }
+    else
+    {
+      idx = flows.size();
+      flows.push_back(cAppFlow());
+    }
+    f = &flows[idx];
+    memset(f, 0, sizeof(cAppFlow));
+    f->key = k;
+    f->first_seen = now;
+    slots[i] = idx;
+    count++;
+  }
+
+  f->last_seen = now;
+  f->packets[d]++;
+  f->bytes[d] += pkt.length();
+  if(pkt.isTCP())
+  {
+    f->tcp_flags[d] |= pkt.tcp().flags();
+    if(pkt.payloadLength() > 0) track_modbus(f, pkt);
+  }
+  if(dir) *dir = d;
+  return f;
+}
+
+void cAppFlowTable::track_modbus(cAppFlow* f, const cAppPacket& pkt)
+{
+  bool request = (pkt.dstPort() == MODBUS_TCP_PORT);
+  ModbusTCPView v;
+  for(int off = 0; pkt.modbusAt(off, v); off += v.size())
+  {
+    if(request)
+    {
+      f->mb_requests++;
+      f->mb_pending = true;
+      f->mb_tid = v.transactionId();
+      f->mb_function = v.function();
+      f->mb_address = v.pduLength() >= 3 ? v.address() : 0;
+      f->mb_quantity = 1;
+      if(v.pduLength() >= 5 &&
+	 (v.function() <= MODBUS_READ_INPUT_REGISTERS ||
+	  v.function() == MODBUS_WRITE_MULTIPLE_COILS ||
+	  v.function() == MODBUS_WRITE_MULTIPLE_REGISTERS))
+	f->mb_quantity = v.quantity();
+    }
+    else
+    {
+      // the request stays in the flow to read the response with
+      f->mb_responses++;
+      if(f->mb_pending && v.transactionId() == f->mb_tid) f->mb_pending = false;
+    }
+  }
+}
+
+int cAppFlowTable::expire(ltime_t now, ltime_t idle)
+{
+  int removed = 0;
+  for(unsigned idx=0; idx<flows.size(); idx++)
+  {
+    cAppFlow& f = flows[idx];
+    if(f.key.proto && now-f.last_seen > idle)
+    {
+      f.key.proto = 0; // the place is free
+      free_flows.push_back(idx);
+      removed++;
+    }
+  }
+  if(removed)
+  {
+    count -= removed;
+    rebuild(mask+1);
+  }
+  return removed;
+}
+
+}; // namespace s3fnet
+}; // namespace s3f
@@ -0,0 +1,120 @@
+/**
+ * \file cApp_flow.h
+ * \brief Header file for the per-flow state table of the cApp session.
+ *
+ * authors : Vignesh Babu
+ */
+
+#ifndef __CAPP_FLOW_H__
+#define __CAPP_FLOW_H__
+
+#include "os/cApp/cApp_packet.h"
+#include "util/shstl.h"
+
+namespace s3f {
+namespace s3fnet {
+
+/**
+ * \brief The key of a flow: its 5-tuple.
+ *
+ * The endpoint with the lower address (and port) comes first, so that
+ * both directions of a connection have the same key.
+ */
+struct cAppFlowKey {
+  IPADDR ip[2];   ///< the addresses of the endpoints, in host byte order
+  uint16 port[2]; ///< the ports of the endpoints
+  byte proto;     ///< the IP protocol
+
+  bool operator==(const cAppFlowKey& k) const {
+    return ip[0] == k.ip[0] && ip[1] == k.ip[1] && port[0] == k.port[0] &&
+      port[1] == k.port[1] && proto == k.proto;
+  }
+};
+
+/**
+ * \brief The state of a flow seen by the compromised router.
+ *
+ * Direction 0 is from the first endpoint of the key to the second.
+ * Besides the counters kept by the table, a flow carries the last
+ * Modbus request seen on it, so that the response answering it can be
+ * read (a read response does not say which addresses it holds), and
+ * a few words left to the attack or IDS logic.
+ */
+struct cAppFlow {
+  cAppFlowKey key;
+  ltime_t first_seen;   ///< the time of the first packet
+  ltime_t last_seen;    ///< the time of the last packet
+  uint64 packets[2];    ///< packets in each direction
+  uint64 bytes[2];      ///< bytes in each direction
+  byte tcp_flags[2];    ///< the TCP flags seen in each direction
+
+  bool mb_pending;      ///< a Modbus request is waiting for its response
+  uint16 mb_tid;        ///< the transaction id of the request
+  byte mb_function;     ///< the function of the request
+  uint16 mb_address;    ///< the (first) address of the request
+  uint16 mb_quantity;   ///< the quantity of the request
+  uint64 mb_requests;   ///< Modbus requests seen
+  uint64 mb_responses;  ///< Modbus responses seen
+
+  uint64 user[4];       ///< free for the attack or IDS logic; zero in a new flow
+};
+
+/**
+ * \brief Table of the flows seen by the compromised router.
+ *
+ * The flows are kept in a deque, so that a flow stays where it is for
+ * as long as it is in the table, and indexed by an open addressing
+ * hash table of their 5-tuples. Flows idle for longer than a timeout
+ * are removed by expire(), after which their places are reused.
+ */
+class cAppFlowTable {
+ public:
+  /** The constructor. */
+  cAppFlowTable();
+
+  /** The destructor. */
+  ~cAppFlowTable();
+
+  /**
+   * Return the flow of the given packet, created if it is new, after
+   * counting the packet; the direction of the packet is returned in
+   * dir. Return NULL if the packet is not a TCP or UDP packet.
+   */
+  cAppFlow* lookup(const cAppPacket& pkt, ltime_t now, int* dir = 0);
+
+  /** Return the flow of the given key, or NULL if it is not in the table. */
+  cAppFlow* find(const cAppFlowKey& key) const;
+
+  /** Remove the flows idle for longer than the given time; return how many. */
+  int expire(ltime_t now, ltime_t idle);
+
+  /** Return the number of flows in the table. */
+  int size() const { return count; }
+
+  /** Return the number of bytes used by the table. */
+  size_t memory() const { return flows.size()*sizeof(cAppFlow)+(mask+1)*sizeof(int); }
+
+ private:
+  /** Hash function of the keys. */
+  static unsigned hash(const cAppFlowKey& k);
+
+  /** Return the slot holding the key, or the empty slot where it belongs. */
+  unsigned find_slot(const cAppFlowKey& k) const;
+
+  /** Index the flows in a hash table of the given number of slots. */
+  void rebuild(unsigned nslots);
+
+  /** Record the Modbus frames of the packet in the flow. */
+  void track_modbus(cAppFlow* f, const cAppPacket& pkt);
+
+  S3FNET_DEQUE(cAppFlow) flows;   ///< the flows, and the places of the removed ones
+  S3FNET_VECTOR(int) free_flows;  ///< the places of the removed flows
+  int* slots;                     ///< the hash table: index of a flow, -1 if empty
+  unsigned mask;                  ///< the number of slots minus one (a power of two)
+  int count;                      ///< the number of flows
+};
+
+}; // namespace s3fnet
+}; // namespace s3f
+
+#endif /*__CAPP_FLOW_H__*/
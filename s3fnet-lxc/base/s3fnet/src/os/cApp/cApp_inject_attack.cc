@@ -41,6 +41,22 @@ namespace s3fnet {
  * srcIP 	 = IP of generating PLC
  * dstIP 	 = IP of destination PLC/IDS
  * call sendPacket(pkt,srcIP,dstIP) after appropriate modification to forward the packet
+ *
+ * pkt_view  = the parsed headers of pkt (see cApp_packet.h); e.g. to scale the
+ *             registers of the Modbus read responses of a PLC, in place:
+ *
+ *               ModbusTCPView mb;
+ *               for(int off = 0; pkt_view.modbusAt(off, mb); off += mb.size())
+ *                 if(pkt_view.srcPort() == MODBUS_TCP_PORT && !mb.isException() &&
+ *                    mb.function() == MODBUS_READ_HOLDING_REGISTERS)
+ *                   for(int i = 0; i < mb.byteCount()/2; i++)
+ *                     pkt_view.setModbusRegister(mb, i, 2*modbus_get16(mb.p+mb.registerOffset(i, false)));
+ *
+ *             the set methods keep the IP and TCP checksums right.
+ * flow      = the state of the connection of pkt (see cApp_flow.h), NULL if it is
+ *             not TCP or UDP; flow->mb_address is the first register of the request
+ *             a response answers, and flow->user is free for the attack
+ * flow_dir  = the direction of pkt in the flow
  */
 void cAppSession::inject_attack(EmuPacket * pkt, unsigned int srcIP, unsigned int dstIP){
 
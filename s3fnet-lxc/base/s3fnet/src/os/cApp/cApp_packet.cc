@@ -0,0 +1,248 @@
+/**
+ * \file cApp_packet.cc
+ * \brief Source file for the header views used by the cApp session.
+ *
+ * authors : Vignesh Babu
+ */
+
+#include <string.h>
+#include "os/cApp/cApp_packet.h"
+
+namespace s3f {
+namespace s3fnet {
+
+#define ETHER_TYPE_IPV4  0x0800
+#define ETHER_TYPE_VLAN  0x8100
+#define IPV4_MIN_HDR     20
+#define TCP_MIN_HDR      20
+
+uint32 capp_csum_add(uint32 sum, const byte* p, int len)
+{
+  for(; len > 1; p += 2, len -= 2) sum += (p[0] << 8) | p[1];
+  if(len > 0) sum += p[0] << 8;
+  return sum;
+}
+
+/* fold the sum to 16 bits */
+static inline uint16 csum_fold(uint32 sum)
+{
+  while(sum >> 16) sum = (sum & 0xffff) + (sum >> 16);
+  return (uint16)sum;
+}
+
+uint16 capp_crc16(const byte* p, int len)
+{
+  uint16 crc = 0xffff;
+  for(int i=0; i<len; i++)
+  {
+    crc ^= p[i];
+    for(int b=0; b<8; b++)
+      crc = (crc & 1) ? (crc >> 1) ^ 0xa001 : (crc >> 1);
+  }
+  return crc;
+}
+
+bool cAppPacket::parse(EmuPacket* p)
+{
+  bool ok = parse(p->data, p->len);
+  pkt = p;
+  return ok;
+}
+
+bool cAppPacket::parse(byte* buf, int length)
+{
+  pkt = 0;
+  data = buf;
+  len = length;
+  l3 = l4 = pl = -1;
+  l4_len = pl_len = 0;
+  ethtype = 0;
+  proto = 0;
+  if(len < EthernetView::SIZE) return false;
+
+  int off = EthernetView::SIZE;
+  ethtype = modbus_get16(data+12);
+  if(ethtype == ETHER_TYPE_VLAN && len >= off+4)
+  {
+    ethtype = modbus_get16(data+16);
+    off += 4;
+  }
+  if(ethtype != ETHER_TYPE_IPV4 || len < off+IPV4_MIN_HDR) return true;
+
+  // a truncated packet, or a fragment, has no transport layer we can use
+  IPv4View iph = { data+off };
+  int hl = iph.headerLength();
+  int total = iph.totalLength();
+  if(iph.version() != 4 || hl < IPV4_MIN_HDR || total < hl || off+total > len) return true;
+  l3 = off;
+  proto = iph.protocol();
+  if(iph.laterFragment() || (modbus_get16(iph.p+6) & 0x2000)) return true;
+
+  int seglen = total-hl;
+  if(proto == IPPROTO_TCP_NUMBER && seglen >= TCP_MIN_HDR)
+  {
+    TCPView th = { data+l3+hl };
+    int thl = th.headerLength();
+    if(thl < TCP_MIN_HDR || thl > seglen) return true;
+    l4 = l3+hl;
+    l4_len = seglen;
+    pl = l4+thl;
+    pl_len = seglen-thl;
+  }
+  else if(proto == IPPROTO_UDP_NUMBER && seglen >= UDPView::SIZE)
+  {
+    UDPView uh = { data+l3+hl };
+    int ulen = uh.length();
+    if(ulen < UDPView::SIZE || ulen > seglen) return true;
+    l4 = l3+hl;
+    l4_len = ulen;
+    pl = l4+UDPView::SIZE;
+    pl_len = ulen-UDPView::SIZE;
+  }
+  return true;
+}
+
+bool cAppPacket::modbusAt(int offset, ModbusTCPView& v, uint16 port) const
+{
+  if(!isTCP() || (srcPort() != port && dstPort() != port)) return false;
+  if(offset < 0 || offset+MODBUS_MBAP_SIZE > pl_len) return false;
+  v.p = data+pl+offset;
+  v.len = pl_len-offset;
+  return v.protocolId() == 0 && v.length() >= 2 && v.complete();
+}
+
+int cAppPacket::l4_csum_offset() const
+{
+  if(l4 < 0) return -1;
+  if(proto == IPPROTO_TCP_NUMBER) return l4+16;
+  // a UDP checksum of zero means the sender computed none
+  if(modbus_get16(data+l4+6) == 0) return -1;
+  return l4+6;
+}
+
+void cAppPacket::update_csum(int csum_at, int parity, const byte* buf, const byte* nbuf, int n)
+{
+  uint16 csum = modbus_get16(data+csum_at);
+  for(int i=0; i<n; i++)
+  {
+    if(buf[i] == nbuf[i]) continue;
+    bool high = ((parity+i) & 1) == 0;
+    csum = capp_csum_update(csum, high ? buf[i] << 8 : buf[i], high ? nbuf[i] << 8 : nbuf[i]);
+  }
+  if(csum == 0 && proto == IPPROTO_UDP_NUMBER && csum_at == l4+6) csum = 0xffff;
+  modbus_put16(data+csum_at, csum);
+}
+
+void cAppPacket::write_ip(int off, const byte* buf, int n)
+{
+  byte* at = data+l3+off;
+  update_csum(l3+10, off, at, buf, n);
+  // the addresses are also covered by the TCP or UDP checksum
+  // (the pseudo header), in which they are aligned as in the header
+  int c = l4_csum_offset();
+  if(off >= 12 && c >= 0) update_csum(c, off, at, buf, n);
+  memcpy(at, buf, n);
+}
+
+void cAppPacket::write_l4(int off, const byte* buf, int n)
+{
+  byte* at = data+l4+off;
+  int c = l4_csum_offset();
+  if(c >= 0) update_csum(c, off, at, buf, n);
+  memcpy(at, buf, n);
+}
+
+void cAppPacket::setTTL(byte ttl)
+{
+  if(l3 < 0) return;
+  write_ip(8, &ttl, 1);
+}
+
+void cAppPacket::setSrcIP(IPADDR ip)
+{
+  if(l3 < 0) return;
+  byte b[4];
+  capp_put32(b, ip);
+  write_ip(12, b, 4);
+}
+
+void cAppPacket::setDstIP(IPADDR ip)
+{
+  if(l3 < 0) return;
+  byte b[4];
+  capp_put32(b, ip);
+  write_ip(16, b, 4);
+}
+
+void cAppPacket::setSrcPort(uint16 port)
+{
+  if(l4 < 0) return;
+  byte b[2];
+  modbus_put16(b, port);
+  write_l4(0, b, 2);
+}
+
+void cAppPacket::setDstPort(uint16 port)
+{
+  if(l4 < 0) return;
+  byte b[2];
+  modbus_put16(b, port);
+  write_l4(2, b, 2);
+}
+
+void cAppPacket::setSeq(uint32 seq)
+{
+  if(!isTCP()) return;
+  byte b[4];
+  capp_put32(b, seq);
+  write_l4(4, b, 4);
+}
+
+void cAppPacket::setAck(uint32 ack)
+{
+  if(!isTCP()) return;
+  byte b[4];
+  capp_put32(b, ack);
+  write_l4(8, b, 4);
+}
+
+void cAppPacket::setPayload(int offset, const byte* buf, int n)
+{
+  assert(pl >= 0 && offset >= 0 && offset+n <= pl_len);
+  write_l4(pl-l4+offset, buf, n);
+}
+
+uint16 cAppPacket::l4_checksum() const
+{
+  // the pseudo header: the addresses, the protocol and the length
+  uint32 sum = capp_csum_add(0, data+l3+12, 8);
+  sum += proto+l4_len;
+  int c = (proto == IPPROTO_TCP_NUMBER) ? 16 : 6;
+  sum = capp_csum_add(sum, data+l4, c);
+  sum = capp_csum_add(sum, data+l4+c+2, l4_len-c-2);
+  uint16 csum = ~csum_fold(sum);
+  if(csum == 0 && proto == IPPROTO_UDP_NUMBER) csum = 0xffff;
+  return csum;
+}
+
+void cAppPacket::fixChecksums()
+{
+  if(l3 < 0) return;
+  IPv4View iph = ip();
+  modbus_put16(iph.p+10, 0);
+  modbus_put16(iph.p+10, ~csum_fold(capp_csum_add(0, iph.p, iph.headerLength())));
+  int c = l4_csum_offset();
+  if(c >= 0) modbus_put16(data+c, l4_checksum());
+}
+
+bool cAppPacket::checksumsValid() const
+{
+  if(l3 < 0) return true;
+  IPv4View iph = ip();
+  if(csum_fold(capp_csum_add(0, iph.p, iph.headerLength())) != 0xffff) return false;
+  int c = l4_csum_offset();
+  return c < 0 || modbus_get16(data+c) == l4_checksum();
+}
+
+}; // namespace s3fnet
+}; // namespace s3f
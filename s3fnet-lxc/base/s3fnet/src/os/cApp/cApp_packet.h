@@ -0,0 +1,285 @@
+/**
+ * \file cApp_packet.h
+ * \brief Header file for the header views used by the cApp session.
+ *
+ * The views read and write the headers of an emulated packet in place,
+ * in the buffer of the EmuPacket: nothing is copied, and the
+ * checksums are updated incrementally (RFC 1624) as the fields are
+ * written, so that an attack can change a few bytes of a packet and
+ * forward it as it is.
+ *
+ * authors : Vignesh Babu
+ */
+
+#ifndef __CAPP_PACKET_H__
+#define __CAPP_PACKET_H__
+
+#include "s3f.h"
+#include "s3fnet.h"
+#include "net/ip_prefix.h"
+#include "os/modbus/modbus_map.h"
+
+namespace s3f {
+namespace s3fnet {
+
+/** Read a big-endian 32-bit field of a header. */
+inline uint32 capp_get32(const byte* p)
+{
+  return ((uint32)p[0] << 24) | ((uint32)p[1] << 16) | ((uint32)p[2] << 8) | p[3];
+}
+
+/** Write a big-endian 32-bit field of a header. */
+inline void capp_put32(byte* p, uint32 v)
+{
+  p[0] = (byte)(v >> 24); p[1] = (byte)(v >> 16); p[2] = (byte)(v >> 8); p[3] = (byte)v;
+}
+
+/**
+ * Update an Internet checksum for a 16-bit word of the covered data
+ * changed from old_word to new_word (RFC 1624, eqn. 3).
+ */
+inline uint16 capp_csum_update(uint16 csum, uint16 old_word, uint16 new_word)
+{
+  uint32 sum = (uint16)~csum + (uint32)(uint16)~old_word + new_word;
+  sum = (sum & 0xffff) + (sum >> 16);
+  sum = (sum & 0xffff) + (sum >> 16);
+  return (uint16)~sum;
+}
+
+/** Return the one's complement sum of the given bytes, added to sum (not folded). */
+uint32 capp_csum_add(uint32 sum, const byte* p, int len);
+
+/** Return the Modbus RTU CRC-16 of the given bytes. */
+uint16 capp_crc16(const byte* p, int len);
+
+/** \brief View of an Ethernet header. */
+struct EthernetView {
+  enum { SIZE = 14 };
+  byte* p;
+  const byte* dst() const { return p; }       ///< destination MAC address
+  const byte* src() const { return p+6; }     ///< source MAC address
+  uint16 type() const { return modbus_get16(p+12); } ///< the EtherType
+};
+
+/** \brief View of an IPv4 header. */
+struct IPv4View {
+  byte* p;
+  int version() const { return p[0] >> 4; }
+  int headerLength() const { return (p[0] & 0x0f)*4; }
+  uint16 totalLength() const { return modbus_get16(p+2); }
+  uint16 id() const { return modbus_get16(p+4); }
+  /** Return true if the packet is a fragment other than the first. */
+  bool laterFragment() const { return (modbus_get16(p+6) & 0x1fff) != 0; }
+  byte ttl() const { return p[8]; }
+  byte protocol() const { return p[9]; }
+  uint16 checksum() const { return modbus_get16(p+10); }
+  IPADDR src() const { return capp_get32(p+12); } ///< in host byte order
+  IPADDR dst() const { return capp_get32(p+16); } ///< in host byte order
+};
+
+/** \brief View of a TCP header. */
+struct TCPView {
+  enum { FIN = 0x01, SYN = 0x02, RST = 0x04, PSH = 0x08, ACK = 0x10, URG = 0x20 };
+  byte* p;
+  uint16 srcPort() const { return modbus_get16(p); }
+  uint16 dstPort() const { return modbus_get16(p+2); }
+  uint32 seq() const { return capp_get32(p+4); }
+  uint32 ack() const { return capp_get32(p+8); }
+  int headerLength() const { return (p[12] >> 4)*4; }
+  byte flags() const { return p[13]; }
+  uint16 window() const { return modbus_get16(p+14); }
+  uint16 checksum() const { return modbus_get16(p+16); }
+};
+
+/** \brief View of a UDP header. */
+struct UDPView {
+  enum { SIZE = 8 };
+  byte* p;
+  uint16 srcPort() const { return modbus_get16(p); }
+  uint16 dstPort() const { return modbus_get16(p+2); }
+  uint16 length() const { return modbus_get16(p+4); }
+  uint16 checksum() const { return modbus_get16(p+6); }
+};
+
+/**
+ * \brief View of a Modbus/TCP frame (MBAP header and PDU).
+ *
+ * Besides the header fields, the view gives the fields of the
+ * requests and responses of the functions in ModbusFunctionCode;
+ * whether a frame is a request or a response depends on its
+ * direction, which the view does not know.
+ */
+struct ModbusTCPView {
+  byte* p;  ///< the frame
+  int len;  ///< the bytes of the frame in the buffer
+  uint16 transactionId() const { return modbus_get16(p); }
+  uint16 protocolId() const { return modbus_get16(p+2); }
+  uint16 length() const { return modbus_get16(p+4); } ///< the unit id and the PDU
+  byte unitId() const { return p[6]; }
+  byte* pdu() const { return p+MODBUS_MBAP_SIZE; }
+  int pduLength() const { return length()-1; }
+  /** Return the size of the whole frame. */
+  int size() const { return MODBUS_MBAP_SIZE-1+length(); }
+  /** Return true if the whole frame is in the buffer. */
+  bool complete() const { return len >= MODBUS_MBAP_SIZE && size() <= len; }
+  byte function() const { return p[7] & 0x7f; }
+  bool isException() const { return (p[7] & 0x80) != 0; }
+  byte exceptionCode() const { return p[8]; }
+  /** The address of a request (the first address for the multiple functions). */
+  uint16 address() const { return modbus_get16(p+8); }
+  /** The quantity of a read or write-multiple request. */
+  uint16 quantity() const { return modbus_get16(p+10); }
+  /** The byte count of a read response. */
+  byte byteCount() const { return p[8]; }
+  /** Offset in the frame of register i of a read response or a write-multiple request. */
+  int registerOffset(int i, bool request) const { return (request ? 13 : 9)+2*i; }
+};
+
+/**
+ * \brief View of a Modbus RTU frame (unit address, PDU and CRC).
+ *
+ * RTU frames come in serial lines (and in RTU-over-TCP gateways);
+ * the CRC covers the whole frame, so the view recomputes it after
+ * changes rather than updating it.
+ */
+struct ModbusRTUView {
+  byte* p;
+  int len;
+  byte unitId() const { return p[0]; }
+  byte* pdu() const { return p+1; }
+  int pduLength() const { return len-3; }
+  byte function() const { return p[1] & 0x7f; }
+  bool isException() const { return (p[1] & 0x80) != 0; }
+  /** The CRC is sent low byte first. */
+  uint16 crc() const { return (uint16)(p[len-2] | (p[len-1] << 8)); }
+  bool crcValid() const { return len >= 4 && crc() == capp_crc16(p, len-2); }
+  void updateCRC() { uint16 c = capp_crc16(p, len-2); p[len-2] = (byte)c; p[len-1] = (byte)(c >> 8); }
+};
+
+/**
+ * \brief An emulated packet seen through its headers.
+ *
+ * parse() finds the headers of the packet once (an Ethernet frame,
+ * with one 802.1Q tag at most, carrying IPv4 and TCP or UDP); the
+ * views of the layers then point into the buffer of the packet. The
+ * set methods write a field and update the checksums that cover it:
+ * the IPv4 header checksum, and the TCP or UDP checksum, which also
+ * covers the IP addresses (a UDP checksum of zero, i.e. none, is left
+ * alone). A whole header or payload rewritten by other means can be
+ * fixed with fixChecksums().
+ */
+class cAppPacket {
+ public:
+  /** The constructor; the view is empty. */
+  cAppPacket() : pkt(0), data(0), len(0), l3(-1), l4(-1), pl(-1), l4_len(0), pl_len(0), ethtype(0), proto(0) {}
+
+  /** Parse the headers of the given packet; return false if it is not an Ethernet frame. */
+  bool parse(EmuPacket* p);
+
+  /** Parse the headers of a frame in the given buffer. */
+  bool parse(byte* buf, int length);
+
+  /** The packet parsed, and its bytes. */
+  EmuPacket* packet() const { return pkt; }
+  byte* bytes() const { return data; }
+  int length() const { return len; }
+
+  /** The EtherType (of the tagged frame if there is an 802.1Q tag). */
+  uint16 etherType() const { return ethtype; }
+  bool isIPv4() const { return l3 >= 0; }
+  bool isTCP() const { return l4 >= 0 && proto == IPPROTO_TCP_NUMBER; }
+  bool isUDP() const { return l4 >= 0 && proto == IPPROTO_UDP_NUMBER; }
+
+  /** The views of the headers; valid only if the packet has the layer. */
+  EthernetView ethernet() const { EthernetView v = { data }; return v; }
+  IPv4View ip() const { IPv4View v = { data+l3 }; return v; }
+  TCPView tcp() const { TCPView v = { data+l4 }; return v; }
+  UDPView udp() const { UDPView v = { data+l4 }; return v; }
+
+  /** The payload of the TCP segment or the UDP datagram. */
+  byte* payload() const { return pl >= 0 ? data+pl : 0; }
+  int payloadLength() const { return pl >= 0 ? pl_len : 0; }
+
+  /** The ports of a TCP or UDP packet (0 otherwise). */
+  uint16 srcPort() const { return l4 >= 0 ? modbus_get16(data+l4) : 0; }
+  uint16 dstPort() const { return l4 >= 0 ? modbus_get16(data+l4+2) : 0; }
+
+  /**
+   * Find the Modbus/TCP frame at the given offset of the payload of a
+   * TCP segment from or to the given port; the next frame of the
+   * segment, if any, is at offset+v.size(). Return false if there is
+   * no complete frame there.
+   */
+  bool modbusAt(int offset, ModbusTCPView& v, uint16 port = MODBUS_TCP_PORT) const;
+
+  /** Write the IPv4 time to live, the addresses and the ports. */
+  void setTTL(byte ttl);
+  void setSrcIP(IPADDR ip);
+  void setDstIP(IPADDR ip);
+  void setSrcPort(uint16 port);
+  void setDstPort(uint16 port);
+
+  /** Write the TCP sequence and acknowledgement numbers. */
+  void setSeq(uint32 seq);
+  void setAck(uint32 ack);
+
+  /** Write bytes of the payload at the given offset. */
+  void setPayload(int offset, const byte* buf, int n);
+
+  /** Write a 16-bit field of the payload at the given offset. */
+  void setPayload16(int offset, uint16 v) { byte b[2]; modbus_put16(b, v); setPayload(offset, b, 2); }
+
+  /**
+   * Write register i of a read response (request false) or of a
+   * write-multiple request (request true) of the given Modbus frame,
+   * which must be in the payload of this packet.
+   */
+  void setModbusRegister(const ModbusTCPView& v, int i, uint16 value, bool request = false)
+  {
+    setPayload16((int)(v.p-payload())+v.registerOffset(i, request), value);
+  }
+
+  /** Recompute the IPv4 and the TCP or UDP checksums. */
+  void fixChecksums();
+
+  /** Return true if the IPv4 and the TCP or UDP checksums are correct. */
+  bool checksumsValid() const;
+
+ private:
+  enum { IPPROTO_TCP_NUMBER = 6, IPPROTO_UDP_NUMBER = 17 };
+
+  /** Write the bytes at the given offset of the IP header and update its checksum. */
+  void write_ip(int off, const byte* buf, int n);
+
+  /** Write the bytes at the given offset of the TCP or UDP segment and update its checksum. */
+  void write_l4(int off, const byte* buf, int n);
+
+  /**
+   * Update the checksum at csum_at for n bytes of the data it covers
+   * changed from old to buf; parity is the offset of the first byte
+   * from the (even) start of the covered data.
+   */
+  void update_csum(int csum_at, int parity, const byte* old, const byte* buf, int n);
+
+  /** Offset of the TCP or UDP checksum, or -1 if the checksum is not used. */
+  int l4_csum_offset() const;
+
+  /** The checksum of the TCP or UDP segment as it should be. */
+  uint16 l4_checksum() const;
+
+  EmuPacket* pkt;
+  byte* data;
+  int len;
+  int l3;         ///< offset of the IPv4 header, -1 if none
+  int l4;         ///< offset of the TCP or UDP header, -1 if none
+  int pl;         ///< offset of the payload, -1 if none
+  int l4_len;     ///< length of the TCP or UDP segment
+  int pl_len;     ///< length of the payload
+  uint16 ethtype; ///< the EtherType
+  byte proto;     ///< the IPv4 protocol
+};
+
+}; // namespace s3fnet
+}; // namespace s3f
+
+#endif /*__CAPP_PACKET_H__*/
@@ -24,7 +24,8 @@ namespace s3fnet {
 S3FNET_REGISTER_PROTOCOL(cAppSession, CAPP_PROTOCOL_CLASSNAME);
 
 cAppSession::cAppSession(ProtocolGraph* graph) :
-    ProtocolSession(graph) {
+    ProtocolSession(graph), flow(0), flow_dir(0), track_flows(true),
+    flow_timeout(0), last_expire(0) {
   // create your session-related variables here
   CAPP_DUMP(printf("A CAPP protocol session is created.\n"));
 }
@@ -40,6 +41,26 @@ void cAppSession::config(s3f::dml::Configuration* cfg) {
   // the same method at the parent class must be called
   ProtocolSession::config(cfg);
   // parameterize your protocol session from DML configuration
+
+  char* str = (char*)cfg->findSingle("track_flows");
+  if(str)
+  {
+    if(s3f::dml::dmlConfig::isConf(str))
+      error_quit("ERROR: cAppSession::config(), invalid TRACK_FLOWS attribute.\n");
+    if(!strcasecmp(str, "true")) track_flows = true;
+    else if(!strcasecmp(str, "false")) track_flows = false;
+    else error_quit("ERROR: cAppSession::config(), invalid TRACK_FLOWS attribute.\n");
+  }
+  else track_flows = true;
+
+  str = (char*)cfg->findSingle("flow_timeout");
+  if(str)
+  {
+    if(s3f::dml::dmlConfig::isConf(str) || atof(str) <= 0)
+      error_quit("ERROR: cAppSession::config(), invalid FLOW_TIMEOUT attribute.\n");
+    flow_timeout = inHost()->d2t(atof(str), 0);
+  }
+  else flow_timeout = inHost()->d2t(60, 0);
 }
 
 void cAppSession::init() {
@@ -57,6 +78,7 @@ void cAppSession::init() {
   Host* owner_host = inHost();
   callback_proc = new Process((Entity *) owner_host,
       (void (s3f::Entity::*)(s3f::Activation))&cAppSession::callback);
+  callback_proc->set_name("cAppSession::callback");
 
   inject_attack_init();
 
@@ -113,76 +135,38 @@ void cAppSession::sendPacket(EmuPacket* packet, IPADDR srcIP, IPADDR destIP)
 int cAppSession::analyzePacket(char* pkt_ptr, int len, u_short * ethT, unsigned int* srcIP, unsigned int* dstIP)
 {
   assert(ethT != NULL);
-  sniff_ethernet* ether = (sniff_ethernet*)pkt_ptr;
-  u_short ether_type    = ntohs(ether->ether_type);
-  unsigned short sum;
-
-  int ether_offset     = 0;
-  int dstIPAddr_offset = 0;
-  int srcIPAddr_offset = 0;
-  struct icmphdr* hdr;
-  struct iphdr* tk_ip_header;
-  struct udphdr* tk_udp_header;
-  struct tcphdr* tk_tcp_header;
-  int is_tcp = 0;
-  u_short udp_src_port;
-  int parse_packet_type = PARSE_PACKET_SUCCESS_IP;
-
-  (*ethT) = ether_type;
-
-  switch(ether_type)
+  cAppPacket view;
+  if(!view.parse((byte*)pkt_ptr, len))
+    return PACKET_PARSE_IGNORE_PACKET;
+
+  (*ethT) = view.etherType();
+  switch(view.etherType())
   {
     case ETHER_TYPE_IP:
-      ether_offset = 14;
-      dstIPAddr_offset = 16;
-      srcIPAddr_offset = 12;
-      hdr  = (struct icmphdr*)(pkt_ptr + ether_offset + 20);
-      assert(hdr != NULL);
-      
-      tk_ip_header = (struct iphdr*)(pkt_ptr + ether_offset);
-      if (tk_ip_header->protocol == 0x11) // UDP
-      {
-        tk_udp_header = (struct udphdr*)(pkt_ptr + ether_offset + 20);
-        udp_src_port = ntohs(tk_udp_header->source);
-        sum = (unsigned short)tk_udp_header->check;
-        unsigned short udpLen = htons(tk_udp_header->len);
-        
-        if (udp_src_port == 68)
-          return PACKET_PARSE_IGNORE_PACKET;
-      }
-      if (tk_ip_header->protocol == 0x06) // TCP
-      {
-        is_tcp = 1;
-        tk_tcp_header = (struct tcphdr*)(pkt_ptr + ether_offset + 20);
-      }
-      parse_packet_type = PARSE_PACKET_SUCCESS_IP;
-      break;
-
-    case ETHER_TYPE_8021Q:
-      return PACKET_PARSE_IGNORE_PACKET;      
-      break;
+      if(!view.isIPv4())
+        return PACKET_PARSE_IGNORE_PACKET;
+      if(view.isUDP() && view.srcPort() == 68) // DHCP client
+        return PACKET_PARSE_IGNORE_PACKET;
+      // the addresses as they are in the packet (network byte order)
+      *srcIP = htonl(view.ip().src());
+      *dstIP = htonl(view.ip().dst());
+      return PARSE_PACKET_SUCCESS_IP;
 
     case ETHER_TYPE_ARP:
-      ether_offset = 14;
-      dstIPAddr_offset = 24;
-      srcIPAddr_offset = 14;
-      parse_packet_type = PARSE_PACKET_SUCCESS_ARP;
-      break;
+      if(len < SIZE_ETHERNET+28)
+        return PACKET_PARSE_IGNORE_PACKET;
+      // the sender and target protocol addresses
+      memcpy(srcIP, pkt_ptr+SIZE_ETHERNET+14, 4);
+      memcpy(dstIP, pkt_ptr+SIZE_ETHERNET+24, 4);
+      return PARSE_PACKET_SUCCESS_ARP;
 
     case ETHER_TYPE_IPV6:
       return PACKET_PARSE_IGNORE_PACKET;
-      break;
 
     default:
-      fprintf(stderr, "Unknown ethernet type, %04x %d, skipping...\n", ether_type, ether_type );
+      fprintf(stderr, "Unknown ethernet type, %04x %d, skipping...\n", view.etherType(), view.etherType());
       return PACKET_PARSE_IGNORE_PACKET;
-      break;
   }
-
-  char* ptrToIPAddr = (pkt_ptr + ether_offset + dstIPAddr_offset);
-  *dstIP = *(unsigned int*)(ptrToIPAddr);
-  char* ptrToSrcIPAddr = (pkt_ptr + ether_offset + srcIPAddr_offset);
-  *srcIP = *(unsigned int*)(ptrToSrcIPAddr);   
 }
 
 
@@ -209,6 +193,23 @@ int cAppSession::pop(Activation msg, ProtocolSession* lo_sess, void* extinfo,
   //  inject_attack(pkt,srcIP,dstIP);
   //}
 
+  // parse the packet once, and find its flow, for the attack
+  pkt_view.parse(pkt);
+  flow = 0;
+  flow_dir = 0;
+  if(track_flows)
+  {
+    ltime_t now = getNow();
+    if(now-last_expire >= flow_timeout)
+    {
+      CAPP_DUMP(int before = flows.size());
+      flows.expire(now, flow_timeout);
+      CAPP_DUMP(printf("%d idle flows removed, %d flows left.\n", before-flows.size(), flows.size()));
+      last_expire = now;
+    }
+    flow = flows.lookup(pkt_view, now, &flow_dir);
+  }
+
 	inject_attack(pkt,ipopt->src_ip,ipopt->dst_ip);
 
   
@@ -12,6 +12,7 @@
 #include "os/base/protocol_session.h"
 #include "util/shstl.h"
 #include "net/ip_prefix.h"
+#include "os/cApp/cApp_flow.h"
 #include <netinet/ip_icmp.h>
 #include <netinet/udp.h>
 #include <netinet/ip.h>
@@ -68,6 +69,15 @@ class cAppSessionCallbackActivation : public ProtocolCallbackActivation
 
 /**
  * \brief A compromised Application (cApp) protocol session for injecting attacks.
+ *
+ * Before inject_attack() is called, the packet is parsed into pkt_view,
+ * whose views and set methods read and rewrite its headers and its
+ * Modbus frames in place, and looked up in the flow table: flow is the
+ * state of its connection (NULL if it is not TCP or UDP), and flow_dir
+ * its direction in the flow. The DML attributes are:
+ *
+ *   track_flows   keep the per-flow state (true)
+ *   flow_timeout  the time after which an idle flow is removed, in seconds (60)
  */
 class cAppSession : public ProtocolSession {
 
@@ -92,6 +102,13 @@ class cAppSession : public ProtocolSession {
   ProtocolCallbackActivation* dcac;
   IPSession* ip_session;
   int pkt_seq_num;
+  cAppPacket pkt_view;    ///< the headers of the packet being handled
+  cAppFlow* flow;         ///< the flow of the packet being handled, or NULL
+  int flow_dir;           ///< the direction of the packet in its flow
+  cAppFlowTable flows;    ///< the flows seen by the session
+  bool track_flows;       ///< whether the flows are tracked
+  ltime_t flow_timeout;   ///< the idle time after which a flow is removed
+  ltime_t last_expire;    ///< the last time the idle flows were removed
 
   /* Define any attack specific variables here. These must be initialized in inject_attack_init()
      DO NOT MODIFY ANY OF THE ABOVE STATEMENTS      
@@ -136,6 +136,7 @@ void DummySession::init()
 
   Host* owner_host = inHost();
   callback_proc = new Process( (Entity *)owner_host, (void (s3f::Entity::*)(s3f::Activation))&DummySession::callback);
+  callback_proc->set_name("DummySession::callback");
 
   //hello interval = 0 means the dummy session only listens to messages
   if(hello_interval == 0) return;
@@ -35,6 +35,9 @@ class DummyMac: public NicProtocolSession {
    */
   virtual int getProtocolNumber() { return S3FNET_PROTOCOL_TYPE_DUMMY_MAC; }
 
+  /** The MAC session keeps no state of its own; there is nothing to save. */
+  virtual bool save_state(Checkpoint* ckpt) { return true; }
+
  private:
   /**
    * Push message down from the upper layer. msg is the protocol
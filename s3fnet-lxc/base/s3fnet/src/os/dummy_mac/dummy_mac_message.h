@@ -40,6 +40,9 @@ class DummyMacMessage: public ProtocolMessage {
   {
     return ProtocolMessage::packingSize();
   }
+
+  /** The Dummy MAC header has nothing but its type; it can be saved in a checkpoint. */
+  virtual bool serializable() { return true; }
   
   /* The Dummy MAC header is not counted as part of the packet
      when we compute the bandwidth use and delay, etc. */
@@ -5,6 +5,7 @@
  * authors : Dong (Kevin) Jin
  */
 
+#include <string.h>
 #include "os/ipv4/ip_message.h"
 #include "util/errhandle.h"
 
@@ -32,7 +33,25 @@ ProtocolMessage* IPMessage::clone()
 
 IPMessage::~IPMessage(){}
 
-S3FNET_REGISTER_MESSAGE(IPMessage, S3FNET_PROTOCOL_TYPE_IPV4);
+void IPMessage::serialize(byte* buf, int& offset)
+{
+  ProtocolMessage::serialize(buf, offset);
+  memcpy(&buf[offset], &src_ip, sizeof(IPADDR)); offset += sizeof(IPADDR);
+  memcpy(&buf[offset], &dst_ip, sizeof(IPADDR)); offset += sizeof(IPADDR);
+  buf[offset++] = protocol_no;
+  buf[offset++] = time_to_live;
+}
+
+void IPMessage::deserialize(byte* buf, int& offset)
+{
+  ProtocolMessage::deserialize(buf, offset);
+  memcpy(&src_ip, &buf[offset], sizeof(IPADDR)); offset += sizeof(IPADDR);
+  memcpy(&dst_ip, &buf[offset], sizeof(IPADDR)); offset += sizeof(IPADDR);
+  protocol_no = buf[offset++];
+  time_to_live = buf[offset++];
+}
+
+S3FNET_REGISTER_POOLED_MESSAGE(IPMessage, S3FNET_PROTOCOL_TYPE_IPV4);
 
 }; // namespace s3fnet
 }; // namespace s3f
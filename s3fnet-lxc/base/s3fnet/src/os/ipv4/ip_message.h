@@ -46,6 +46,15 @@ class IPMessage: public ProtocolMessage {
   {
     return 2*sizeof(IPADDR)+2*sizeof(uint8)+ProtocolMessage::packingSize();
   }
+
+  /** Pack the IP header into buf from the given offset. */
+  virtual void serialize(byte* buf, int& offset);
+
+  /** Unpack the IP header from buf at the given offset. */
+  virtual void deserialize(byte* buf, int& offset);
+
+  /** The IP header can be saved in a checkpoint. */
+  virtual bool serializable() { return true; }
   
   /**
    * Return the number of bytes that a IP header really occupies in
@@ -67,6 +76,9 @@ class IPMessage: public ProtocolMessage {
   /** Number of hops before the protocol message is dropped. */
   uint8 time_to_live;
 
+  /** IP headers are recycled through a message pool. */
+  S3FNET_POOLED_MESSAGE(IPMessage);
+
  protected:
   /** The destructor is protected from accidental invocation. */
   virtual ~IPMessage();
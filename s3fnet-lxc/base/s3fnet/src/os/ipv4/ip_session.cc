@@ -13,6 +13,10 @@
 #include "net/network_interface.h"
 #include "os/ipv4/ip_message.h"
 #include "os/ipv4/ip_interface.h"
+#include "os/simple_mac/simple_mac.h"
+#include "os/tcp/tcp_master.h"
+#include "os/udp/udp_master.h"
+#include "os/lxcemu/lxcemu_session.h"
 #include <iostream>
 
 #ifdef IP_DEBUG
@@ -30,7 +34,7 @@ IPSession::IPSession(ProtocolGraph* graph) :
   ProtocolSession(graph),
   forwarding_table(0), show_drop(false),
   route_vec(0), dml_route_vec(0), listener_vec(0),
-  pop_intercept_sess(0)
+  pop_intercept_sess(0), std_tcp(0), std_udp(0), std_lxcemu(0)
 {
   IP_DUMP(printf("[host=\"%s\"] new ip session.\n", inHost()->nhi.toString()));
 }
@@ -80,6 +84,11 @@ void IPSession::init()
     if(strcasecmp(name, NET_PROTOCOL_NAME) && strcasecmp(name, IP_PROTOCOL_NAME))
       error_quit("ERROR: IpSession::init(), unmatched protocol name: \"%s\", expecting \"NET\" or \"IP\".\n", name);
 
+    // the sessions above taking the static pipeline
+    std_tcp = session_of_class<TCPMaster>(inHost()->sessionForNumber(S3FNET_PROTOCOL_TYPE_TCP));
+    std_udp = session_of_class<UDPMaster>(inHost()->sessionForNumber(S3FNET_PROTOCOL_TYPE_UDP));
+    std_lxcemu = session_of_class<LxcemuSession>(inHost()->sessionForNumber(S3FNET_PROTOCOL_TYPE_LXCEMU));
+
     // create a forwarding table for this machine
     if(!forwarding_table)
       forwarding_table = new ForwardingTable(this);
@@ -377,7 +386,8 @@ int IPSession::push(Activation msg, ProtocolSession* hi_sess, void* extinfo, siz
   // send the packet to the outgoing_mac
   ProtocolSession* outgoing_mac = outgoing_nic->getHighestProtocolSession();
   IPOptionToBelow mac_ext_info(route_info, false);
-  outgoing_mac->pushdown(ip_msg, this, (void*)&mac_ext_info, sizeof(IPOptionToBelow));
+  pushdown_to(outgoing_nic->getStandardMac(), outgoing_mac, ip_msg, this,
+	      (void*)&mac_ext_info, sizeof(IPOptionToBelow));
 
   return IPPUSHRET_DOWN_DONE;
 }
@@ -549,7 +559,8 @@ int IPSession::handle_pop_pkt(Activation ip_msg, ProtocolSession* lo_sess, void*
       assert(outgoing_nic);
       IPOptionToBelow mac_ext_info(carried_route_info, true);
 
-      outgoing_nic->getHighestProtocolSession()->pushdown(ip_msg, this, (void*)&mac_ext_info, sizeof(IPOptionToBelow));
+      pushdown_to(outgoing_nic->getStandardMac(), outgoing_nic->getHighestProtocolSession(), ip_msg, this,
+		  (void*)&mac_ext_info, sizeof(IPOptionToBelow));
       return IPPOPRET_FORWARD_DONE;
     }
     else
@@ -573,7 +584,8 @@ int IPSession::handle_pop_local_pkt(Activation ip_msg, ProtocolSession* lo_sess)
 {	  
   IPMessage* ip_message = (IPMessage*)ip_msg;
 
-  ProtocolSession* prot = get_parent_by_protocol((int)(uint32)ip_message->protocol_no);
+  uint32 protocol_no = ip_message->protocol_no;
+  ProtocolSession* prot = get_parent_by_protocol(protocol_no);
   IP_DUMP(printf("[host=\"%s\"] %s: receive local packet for protocol %u.\n",
                  inHost()->nhi.toString(), getNowWithThousandSeparator(), ip_message->protocol_no));
     
@@ -591,7 +603,21 @@ int IPSession::handle_pop_local_pkt(Activation ip_msg, ProtocolSession* lo_sess)
       Activation upper_msg (pmsg);
       ip_message->erase(); //detele ip header
 
-      prot->popup(upper_msg, this, (void*)&ipupopt, sizeof(IPOptionToAbove));
+      // the standard sessions above take the static pipeline
+      switch(protocol_no)
+      {
+      case S3FNET_PROTOCOL_TYPE_TCP:
+	popup_to(std_tcp, prot, upper_msg, this, (void*)&ipupopt, sizeof(IPOptionToAbove));
+	break;
+      case S3FNET_PROTOCOL_TYPE_UDP:
+	popup_to(std_udp, prot, upper_msg, this, (void*)&ipupopt, sizeof(IPOptionToAbove));
+	break;
+      case S3FNET_PROTOCOL_TYPE_LXCEMU:
+	popup_to(std_lxcemu, prot, upper_msg, this, (void*)&ipupopt, sizeof(IPOptionToAbove));
+	break;
+      default:
+	prot->popup(upper_msg, this, (void*)&ipupopt, sizeof(IPOptionToAbove));
+      }
       ret_val = IPPOPRET_UP_DONE;
   }
   else
@@ -22,11 +22,16 @@ class IPMessage;
 class ForwardingTable;
 class RouteInfo;
 class DMLRouteInfo;
+class TCPMaster;
+class UDPMaster;
+class LxcemuSession;
 
 /**
  * \brief The Internet protocol session.
  */
 class IPSession: public ProtocolSession {
+  friend class ProtocolSession; // the static pipeline calls push() and pop()
+
  public:
   /**
    * \brief All possible return values of IP push operation.
@@ -168,6 +173,9 @@ class IPSession: public ProtocolSession {
    */
   virtual int control(int ctrltyp, void* ctrlmsg, ProtocolSession* sess);
 
+  /** The forwarding table is loaded from the DML; the IP session has nothing to save. */
+  virtual bool save_state(Checkpoint* ckpt) { return true; }
+
   /* Safe alternative to atoi() if valid numbers could be 0 (which atoi() returns on error). */
   static inline int strtonum(const char* str);
 
@@ -211,6 +219,13 @@ class IPSession: public ProtocolSession {
 
   /** session that intercept packet. */
   ProtocolSession* pop_intercept_sess;
+
+  /** The sessions above of the standard stack, for the static
+      pipeline; NULL if the host's TCP, UDP or LXCEMU session is of
+      another class or missing. */
+  TCPMaster* std_tcp;
+  UDPMaster* std_udp;
+  LxcemuSession* std_lxcemu;
 };
 
 }; // namespace s3fnet
@@ -63,6 +63,7 @@ void LxcemuSession::init() {
 	Host* owner_host = inHost();
 	callback_proc = new Process((Entity *) owner_host,
 			(void (s3f::Entity::*)(s3f::Activation))&LxcemuSession::callback);
+	callback_proc->set_name("LxcemuSession::callback");
 
 }
 
@@ -0,0 +1,462 @@
+/**
+ * \file modbus_client.cc
+ * \brief Source file for the ModbusClientSession class.
+ *
+ * authors : Dong (Kevin) Jin
+ */
+
+#include <string.h>
+#include <pthread.h>
+#include "os/modbus/modbus_client.h"
+#include "os/base/protocols.h"
+#include "util/errhandle.h"
+#include "net/host.h"
+#include "net/net.h"
+#include "net/traffic.h"
+#include "env/namesvc.h"
+
+#ifdef MODBUS_DEBUG
+#define MB_DUMP(x) printf("MBCLT: "); x
+#else
+#define MB_DUMP(x)
+#endif
+
+#define DEFAULT_CLIENT_PORT 2048
+
+namespace s3f {
+namespace s3fnet {
+
+S3FNET_REGISTER_PROTOCOL(ModbusClientSession, "S3F.OS.Modbus.Client");
+
+// all the Modbus clients, for the report at the end of the run
+static S3FNET_VECTOR(ModbusClientSession*) all_clients;
+static pthread_mutex_t all_clients_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static double config_double(s3f::dml::Configuration* cfg, char* attr, double dflt)
+{
+  char* str = (char*)cfg->findSingle(attr);
+  if(!str) return dflt;
+  if(s3f::dml::dmlConfig::isConf(str))
+    error_quit("ERROR: ModbusClientSession::config(), invalid %s attribute.\n", attr);
+  double v = atof(str);
+  if(v < 0)
+    error_quit("ERROR: ModbusClientSession::config(), %s attribute must be non-negative.\n", attr);
+  return v;
+}
+
+static bool config_bool(s3f::dml::Configuration* cfg, char* attr, bool dflt)
+{
+  char* str = (char*)cfg->findSingle(attr);
+  if(!str) return dflt;
+  if(s3f::dml::dmlConfig::isConf(str))
+    error_quit("ERROR: ModbusClientSession::config(), invalid %s attribute.\n", attr);
+  if(!strcasecmp(str, "true")) return true;
+  if(!strcasecmp(str, "false")) return false;
+  error_quit("ERROR: ModbusClientSession::config(), invalid %s attribute (%s).\n", attr, str);
+  return dflt;
+}
+
+ModbusClientSession::ModbusClientSession(ProtocolGraph* graph) : ProtocolSession(graph),
+  connects(0), connect_failures(0), requests(0), responses(0), exceptions(0),
+  timeouts(0), failures(0), latency_sum(0)
+{
+  MB_DUMP(printf("A Modbus client session is created.\n"));
+}
+
+ModbusClientSession::~ModbusClientSession()
+{
+  MB_DUMP(printf("A Modbus client session is reclaimed.\n"));
+}
+
+void ModbusClientSession::config(s3f::dml::Configuration *cfg)
+{
+  ProtocolSession::config(cfg);
+
+  char* str = (char*)cfg->findSingle("server_list");
+  if(str)
+  {
+    if(s3f::dml::dmlConfig::isConf(str))
+      error_quit("ERROR: ModbusClientSession::config(), invalid SERVER_LIST attribute.\n");
+    server_list = str;
+  }
+  else server_list = "modbus";
+
+  str = (char*)cfg->findSingle("poll_servers");
+  if(str)
+  {
+    if(s3f::dml::dmlConfig::isConf(str))
+      error_quit("ERROR: ModbusClientSession::config(), invalid POLL_SERVERS attribute.\n");
+    if(!strcasecmp(str, "all")) poll_all = true;
+    else if(!strcasecmp(str, "random")) poll_all = false;
+    else error_quit("ERROR: ModbusClientSession::config(), invalid POLL_SERVERS attribute (%s).\n", str);
+  }
+  else poll_all = true;
+
+  start_time = config_double(cfg, (char*)"start_time", 0);
+  start_window = config_double(cfg, (char*)"start_window", 0);
+  poll_interval = inHost()->d2t(config_double(cfg, (char*)"poll_interval", 1), 0);
+  if(poll_interval <= 0)
+    error_quit("ERROR: ModbusClientSession::config(), POLL_INTERVAL must be positive.\n");
+  response_timeout = inHost()->d2t(config_double(cfg, (char*)"response_timeout", 1), 0);
+  if(response_timeout <= 0)
+    error_quit("ERROR: ModbusClientSession::config(), RESPONSE_TIMEOUT must be positive.\n");
+  keep_alive = config_bool(cfg, (char*)"keep_alive", true);
+  show_report = config_bool(cfg, (char*)"show_report", false);
+
+  str = (char*)cfg->findSingle("unit_id");
+  if(str)
+  {
+    if(s3f::dml::dmlConfig::isConf(str) || atoi(str) < 0 || atoi(str) > 255)
+      error_quit("ERROR: ModbusClientSession::config(), invalid UNIT_ID attribute.\n");
+    unit_id = atoi(str);
+  }
+  else unit_id = 255;
+
+  str = (char*)cfg->findSingle("client_port");
+  if(str)
+  {
+    if(s3f::dml::dmlConfig::isConf(str) || atoi(str) <= 0 || atoi(str) > 0xffff)
+      error_quit("ERROR: ModbusClientSession::config(), invalid CLIENT_PORT attribute.\n");
+    start_port = atoi(str);
+  }
+  else start_port = DEFAULT_CLIENT_PORT;
+  next_port = start_port;
+
+  s3f::dml::Enumeration* penum = cfg->find("poll");
+  while(penum->hasMoreElements())
+  {
+    s3f::dml::Configuration* pcfg = (s3f::dml::Configuration*)penum->nextElement();
+    if(!s3f::dml::dmlConfig::isConf(pcfg))
+      error_quit("ERROR: ModbusClientSession::config(), invalid POLL attribute.\n");
+
+    ModbusPoll p;
+    str = (char*)pcfg->findSingle("function");
+    if(!str || s3f::dml::dmlConfig::isConf(str))
+      error_quit("ERROR: ModbusClientSession::config(), missing or invalid POLL.FUNCTION attribute.\n");
+    p.function = atoi(str);
+
+    str = (char*)pcfg->findSingle("start");
+    if(!str || s3f::dml::dmlConfig::isConf(str) || atoi(str) < 0 || atoi(str) > 0xffff)
+      error_quit("ERROR: ModbusClientSession::config(), missing or invalid POLL.START attribute.\n");
+    p.start = atoi(str);
+
+    str = (char*)pcfg->findSingle("count");
+    int count = 1;
+    if(str)
+    {
+      if(s3f::dml::dmlConfig::isConf(str))
+	error_quit("ERROR: ModbusClientSession::config(), invalid POLL.COUNT attribute.\n");
+      count = atoi(str);
+    }
+
+    // the largest quantities a request may carry
+    int max_count;
+    switch(p.function)
+    {
+    case MODBUS_READ_COILS:
+    case MODBUS_READ_DISCRETE_INPUTS: max_count = 2000; break;
+    case MODBUS_READ_HOLDING_REGISTERS:
+    case MODBUS_READ_INPUT_REGISTERS: max_count = 125; break;
+    case MODBUS_WRITE_SINGLE_COIL:
+    case MODBUS_WRITE_SINGLE_REGISTER: max_count = 1; break;
+    case MODBUS_WRITE_MULTIPLE_COILS: max_count = 1968; break;
+    case MODBUS_WRITE_MULTIPLE_REGISTERS: max_count = 123; break;
+    default:
+      error_quit("ERROR: ModbusClientSession::config(), unsupported POLL.FUNCTION %d.\n", p.function);
+      max_count = 0;
+    }
+    if(count < 1 || count > max_count)
+      error_quit("ERROR: ModbusClientSession::config(), POLL.COUNT of function %d must be 1 to %d.\n",
+		 p.function, max_count);
+    p.count = count;
+    schedule.push_back(p);
+  }
+  delete penum;
+  if(schedule.empty())
+  {
+    // read 10 holding registers from 1
+    ModbusPoll p;
+    p.function = MODBUS_READ_HOLDING_REGISTERS;
+    p.start = 1;
+    p.count = 10;
+    schedule.push_back(p);
+  }
+
+  MB_DUMP(printf("[host=\"%s\"] config(): server_list=%s, poll_interval=%ld, "
+		 "response_timeout=%ld, keep_alive=%d, %d requests per poll.\n",
+		 inHost()->nhi.toString(), server_list.c_str(), poll_interval,
+		 response_timeout, keep_alive, (int)schedule.size()));
+}
+
+void ModbusClientSession::init()
+{
+  ProtocolSession::init();
+
+  if(!inHost()->sessionForNumber(S3FNET_PROTOCOL_TYPE_SOCKET))
+    error_quit("ERROR: ModbusClientSession::init(), missing socket master on host \"%s\".\n",
+	       inHost()->nhi.toString());
+
+  if(show_report)
+  {
+    pthread_mutex_lock(&all_clients_mutex);
+    all_clients.push_back(this);
+    pthread_mutex_unlock(&all_clients_mutex);
+  }
+
+  S3FNET_VECTOR(IPADDR) ips;
+  S3FNET_VECTOR(uint16) ports;
+  if(!get_servers(ips, ports)) return;
+  for(unsigned i=0; i<ips.size(); i++)
+    poll(ips[i], ports[i]).start();
+}
+
+SocketTask ModbusClientSession::poll(IPADDR server_ip, uint16 server_port)
+{
+  // the timer both paces the polls and guards the connection and the
+  // requests, which never overlap; each timer is a process of the host
+  CoTimer timer(this);
+  CoSocket sock(this);
+  bool connected = false;
+  uint16 tid = 0;
+  byte buf[MODBUS_MAX_ADU_SIZE];
+
+  double t = start_time;
+  if(start_window > 0) t += getRandom()->Uniform(0, 1)*start_window;
+  ltime_t next = inHost()->d2t(t, 0);
+  if(next > getNow()) co_await timer.sleep(next-getNow());
+  next = getNow();
+
+  for(;;)
+  {
+    if(!connected)
+    {
+      // a new socket for each connection
+      if(!sock.bind(IPADDR_INADDR_ANY, next_port, (char*)TCP_PROTOCOL_NAME))
+      {
+	MB_DUMP(printf("poll() on host \"%s\": failed to bind.\n", inHost()->nhi.toString()));
+	co_return -1;
+      }
+      if(++next_port == 0) next_port = start_port;
+
+      timer.start(response_timeout, &ModbusClientSession::timeout, &sock);
+      if(co_await sock.connect(server_ip, server_port) < 0)
+      {
+	MB_DUMP(printf("[host=\"%s\"] %s: poll(), failed to connect to \"%s:%d\".\n",
+		       inHost()->nhi.toString(), getNowWithThousandSeparator(),
+		       IPPrefix::ip2txt(server_ip), server_port));
+	timer.cancel();
+	connect_failures++;
+      }
+      else
+      {
+	timer.cancel();
+	connected = true;
+	connects++;
+      }
+    }
+
+    if(connected)
+    {
+      for(unsigned i=0; i<schedule.size(); i++)
+      {
+	if(co_await transact(sock, timer, schedule[i], tid++, buf) < 0)
+	{
+	  connected = false;
+	  break;
+	}
+      }
+      if(connected && !keep_alive)
+      {
+	close(sock.id()).start();
+	connected = false;
+      }
+    }
+
+    // a late poll is not made up for
+    next += poll_interval;
+    if(next < getNow()) next = getNow();
+    co_await timer.sleep(next-getNow());
+  }
+}
+
+SocketTask ModbusClientSession::transact(CoSocket& sock, CoTimer& guard, const ModbusPoll& p,
+					 uint16 tid, byte* buf)
+{
+  int n = build_request(p, buf+MODBUS_MBAP_SIZE);
+  modbus_put16(buf, tid);
+  modbus_put16(buf+2, 0);
+  modbus_put16(buf+4, n+1);
+  buf[6] = unit_id;
+
+  requests++;
+  ltime_t sent = getNow();
+  guard.start(response_timeout, &ModbusClientSession::timeout, &sock);
+
+  // the response goes to the same buffer, once the request is sent
+  int rc = co_await sock.send(MODBUS_MBAP_SIZE+n, buf);
+  if(rc >= 0) rc = co_await co_recv_all(*this, sock, MODBUS_MBAP_SIZE, buf);
+  if(rc >= 0)
+  {
+    uint16 length = modbus_get16(buf+4);
+    if(modbus_get16(buf) != tid || modbus_get16(buf+2) != 0 ||
+       length < 2 || length > MODBUS_MAX_PDU_SIZE+1) rc = -1;
+    else rc = co_await co_recv_all(*this, sock, length-1, buf+MODBUS_MBAP_SIZE);
+  }
+  if(rc >= 0 && buf[MODBUS_MBAP_SIZE] != p.function && buf[MODBUS_MBAP_SIZE] != (p.function|0x80))
+    rc = -1;
+
+  if(rc < 0)
+  {
+    // if the timer is still running, the request did not time out but
+    // failed; we cancel the timer and reset the connection
+    if(guard.isRunning())
+    {
+      guard.cancel();
+      sock.abort();
+      failures++;
+    }
+    else timeouts++;
+    MB_DUMP(printf("[host=\"%s\"] %s: transact(), request %u failed.\n",
+		   inHost()->nhi.toString(), getNowWithThousandSeparator(), tid));
+    co_return -1;
+  }
+  guard.cancel();
+
+  if(buf[MODBUS_MBAP_SIZE] == p.function) responses++;
+  else exceptions++;
+  latency_sum += inHost()->t2d(getNow()-sent, 0);
+  co_return 0;
+}
+
+SocketTask ModbusClientSession::close(int sockid)
+{
+  CoSocket sock(this, sockid);
+  co_await sock.close();
+  co_return 0;
+}
+
+int ModbusClientSession::build_request(const ModbusPoll& p, byte* buf)
+{
+  buf[0] = (byte)p.function;
+  modbus_put16(buf+1, p.start);
+  switch(p.function)
+  {
+  case MODBUS_WRITE_SINGLE_COIL:
+    modbus_put16(buf+3, getRandom()->Bernoulli(0.5) ? 0xff00 : 0x0000);
+    return 5;
+
+  case MODBUS_WRITE_SINGLE_REGISTER:
+    modbus_put16(buf+3, (uint16)getRandom()->Equilikely(0, 0xffff));
+    return 5;
+
+  case MODBUS_WRITE_MULTIPLE_COILS:
+  {
+    int nbytes = (p.count+7)/8;
+    modbus_put16(buf+3, p.count);
+    buf[5] = (byte)nbytes;
+    for(int i=0; i<nbytes; i++) buf[6+i] = (byte)getRandom()->Equilikely(0, 0xff);
+    return 6+nbytes;
+  }
+
+  case MODBUS_WRITE_MULTIPLE_REGISTERS:
+    modbus_put16(buf+3, p.count);
+    buf[5] = (byte)(2*p.count);
+    for(int i=0; i<p.count; i++) modbus_put16(buf+6+2*i, (uint16)getRandom()->Equilikely(0, 0xffff));
+    return 6+2*p.count;
+
+  default: // the read functions
+    modbus_put16(buf+3, p.count);
+    return 5;
+  }
+}
+
+void ModbusClientSession::timeout(void* sock)
+{
+  ((CoSocket*)sock)->abort();
+}
+
+bool ModbusClientSession::get_servers(S3FNET_VECTOR(IPADDR)& ips, S3FNET_VECTOR(uint16)& ports)
+{
+  Traffic* traffic = 0;
+  Host* host = inHost();
+  host->inNet()->control(NET_CTRL_GET_TRAFFIC, (void*)&traffic);
+  if(!traffic) return false;
+
+  S3FNET_VECTOR(TrafficServerData*) servers;
+  if(!traffic->getServers(host, servers, server_list.c_str()) || servers.size() == 0)
+  {
+    if(show_report)
+      printf("WARNING: [host=\"%s\"] get_servers(), found no server for %s.\n",
+	     inHost()->nhi.toString(), server_list.c_str());
+    return false;
+  }
+
+  unsigned first = 0, last = servers.size();
+  if(!poll_all)
+  {
+    first = (unsigned)floor(getRandom()->Uniform(0, 1) * servers.size());
+    last = first+1;
+  }
+  for(unsigned i=first; i<last; i++)
+  {
+    IPADDR ip = host->inNet()->getNameService()->nhi2ip(*servers[i]->nhi);
+    if(ip == IPADDR_INVALID)
+    {
+      if(show_report)
+	printf("WARNING: [host=\"%s\"] get_servers(), unresolved server for \"%s\".\n",
+	       inHost()->nhi.toString(), server_list.c_str());
+      continue;
+    }
+    ips.push_back(ip);
+    ports.push_back(servers[i]->port);
+    MB_DUMP(printf("[host=\"%s\"] get_servers(), polling server \"%s:%d\".\n",
+		   inHost()->nhi.toString(), IPPrefix::ip2txt(ip), servers[i]->port));
+  }
+  return !ips.empty();
+}
+
+int ModbusClientSession::push(Activation msg, ProtocolSession* hi_sess, void* extinfo, size_t extinfo_size)
+{
+  error_quit("ERROR: ModbusClientSession::push() should not be called.\n");
+  return 1;
+}
+
+int ModbusClientSession::pop(Activation msg, ProtocolSession* lo_sess, void* extinfo, size_t extinfo_size)
+{
+  error_quit("ERROR: ModbusClientSession::pop() should not be called.\n");
+  return 1;
+}
+
+void modbus_client_report(double sim_seconds, double wall_seconds)
+{
+  if(all_clients.empty()) return;
+
+  uint64 conns = 0, cfail = 0, reqs = 0, rsps = 0, excs = 0, tmos = 0, fails = 0;
+  double latency = 0;
+  for(unsigned i=0; i<all_clients.size(); i++)
+  {
+    ModbusClientSession* mc = all_clients[i];
+    conns += mc->connects;
+    cfail += mc->connect_failures;
+    reqs += mc->requests;
+    rsps += mc->responses;
+    excs += mc->exceptions;
+    tmos += mc->timeouts;
+    fails += mc->failures;
+    latency += mc->latency_sum;
+  }
+
+  printf("Modbus clients: %lu\n", (unsigned long)all_clients.size());
+  printf("  connections: %llu made, %llu failed\n",
+	 (unsigned long long)conns, (unsigned long long)cfail);
+  printf("  requests: %llu sent, %llu responses, %llu exceptions, %llu timed out, %llu failed\n",
+	 (unsigned long long)reqs, (unsigned long long)rsps, (unsigned long long)excs,
+	 (unsigned long long)tmos, (unsigned long long)fails);
+  printf("  request rate: %.1f requests/s simulated, %.1f requests/s wall-clock\n",
+	 sim_seconds > 0 ? reqs/sim_seconds : 0.0, wall_seconds > 0 ? reqs/wall_seconds : 0.0);
+  printf("  response time: %.3f ms on average\n",
+	 rsps+excs > 0 ? 1e3*latency/(rsps+excs) : 0.0);
+}
+
+}; // namespace s3fnet
+}; // namespace s3f
@@ -0,0 +1,133 @@
+/**
+ * \file modbus_client.h
+ * \brief Header file for the ModbusClientSession class.
+ *
+ * authors : Dong (Kevin) Jin
+ */
+
+#ifndef __MODBUS_CLIENT_H__
+#define __MODBUS_CLIENT_H__
+
+#include "os/base/protocol_session.h"
+#include "os/socket/co_socket.h"
+#include "os/modbus/modbus_map.h"
+#include "net/ip_prefix.h"
+#include "util/shstl.h"
+
+namespace s3f {
+namespace s3fnet {
+
+/**
+ * \brief A simulated Modbus/TCP master, such as an HMI or a SCADA poller.
+ *
+ * The protocol session polls the Modbus servers of a traffic pattern
+ * list (see ModbusServerSession, or an emulated PLC) at a fixed
+ * interval. Each server is polled by its own socket coroutine, which
+ * connects to the server and sends the requests of the poll schedule
+ * one after the other, waiting for each response, as the Modbus
+ * client blocks of awlsim do. The DML attributes are:
+ *
+ *   server_list      the traffic pattern list of the servers ("modbus")
+ *   poll_servers     "all" the servers of the list, or one "random" (all)
+ *   start_time       the time the polling starts, in seconds (0)
+ *   start_window     the polling starts at a random time in this window (0)
+ *   poll_interval    the time between the polls of a server, in seconds (1)
+ *   response_timeout the time to wait for a connection or a response, in
+ *                    seconds; the connection is reset when it expires (1)
+ *   keep_alive       keep the connection open between polls (true)
+ *   unit_id          the unit id of the requests (255)
+ *   client_port      the first local port of the connections (2048)
+ *   poll             a request of the schedule: [ function F start S
+ *                    count C ]; the values of the write functions are
+ *                    random; may be repeated (read 10 holding registers
+ *                    from 1)
+ *   show_report      print the statistics at the end of the run (false)
+ */
+class ModbusClientSession: public ProtocolSession {
+ public:
+  /** The constructor. */
+  ModbusClientSession(ProtocolGraph* graph);
+
+  /** The destructor. */
+  virtual ~ModbusClientSession();
+
+  /** Configure the Modbus client session. */
+  virtual void config(s3f::dml::Configuration *cfg);
+
+  /** Return the protocol number. */
+  virtual int getProtocolNumber() { return S3FNET_PROTOCOL_TYPE_MODBUS_CLIENT; }
+
+  /** Initialize this protocol session. */
+  virtual void init();
+
+  /** The report at the end of the run (see modbus_map.h) reads the statistics. */
+  friend void modbus_client_report(double sim_seconds, double wall_seconds);
+
+ protected:
+  /** A request of the poll schedule. */
+  struct ModbusPoll {
+    int function;  ///< the function code
+    uint16 start;  ///< the first address
+    uint16 count;  ///< the number of addresses
+  };
+
+  /** Poll the given server until the end of the simulation. */
+  SocketTask poll(IPADDR server_ip, uint16 server_port);
+
+  /**
+   * Send one request of the schedule over the connection and wait for
+   * its response. Return 0 on a response (normal or exception), or -1
+   * if the connection failed or the response is invalid.
+   */
+  SocketTask transact(CoSocket& sock, CoTimer& guard, const ModbusPoll& p, uint16 tid, byte* buf);
+
+  /**
+   * Close the given socket; the poll goes on without waiting for the
+   * connection to be torn down.
+   */
+  SocketTask close(int sockid);
+
+  /** Write the request PDU of the given poll to buf; return its length. */
+  int build_request(const ModbusPoll& p, byte* buf);
+
+  /** Reset the connection of a server that does not answer in time. */
+  static void timeout(void* sock);
+
+  /** Find the servers to poll in the traffic pattern list. */
+  bool get_servers(S3FNET_VECTOR(IPADDR)& ips, S3FNET_VECTOR(uint16)& ports);
+
+  /** The protocol session is on top of the socket layer, so push() and pop() are not used. */
+  virtual int push(Activation msg, ProtocolSession* hi_sess, void* extinfo = 0, size_t extinfo_size = 0);
+  virtual int pop(Activation msg, ProtocolSession* lo_sess, void* extinfo = 0, size_t extinfo_size = 0);
+
+  /** A host may run several Modbus clients, with different schedules. */
+  virtual int instantiation_type() { return PROT_MULTIPLE_INSTANCES; }
+
+ private:
+  S3FNET_STRING server_list;         ///< the traffic pattern list of the servers
+  bool poll_all;                     ///< poll all the servers, or one at random
+  double start_time;                 ///< the time the polling starts
+  double start_window;               ///< the window of the start time
+  ltime_t poll_interval;             ///< the time between polls
+  ltime_t response_timeout;          ///< the time to wait for a response
+  bool keep_alive;                   ///< keep the connection open between polls
+  byte unit_id;                      ///< the unit id of the requests
+  uint16 start_port;                 ///< the first local port
+  uint16 next_port;                  ///< the local port of the next connection
+  bool show_report;                  ///< print the statistics at the end
+  S3FNET_VECTOR(ModbusPoll) schedule; ///< the requests of a poll
+
+  uint64 connects;                   ///< connections made
+  uint64 connect_failures;           ///< connections that failed or timed out
+  uint64 requests;                   ///< requests sent
+  uint64 responses;                  ///< normal responses
+  uint64 exceptions;                 ///< exception responses
+  uint64 timeouts;                   ///< requests that timed out
+  uint64 failures;                   ///< requests lost to a failed connection or an invalid response
+  double latency_sum;                ///< total time from requests to responses, in seconds
+};
+
+}; // namespace s3fnet
+}; // namespace s3f
+
+#endif /*__MODBUS_CLIENT_H__*/
@@ -0,0 +1,195 @@
+/**
+ * \file modbus_map.cc
+ * \brief Source file for the ModbusRegisterMap class.
+ *
+ * authors : Dong (Kevin) Jin
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "os/modbus/modbus_map.h"
+
+namespace s3f {
+namespace s3fnet {
+
+/* the largest quantities a single request may carry (Modbus application protocol v1.1b) */
+#define MODBUS_MAX_READ_BITS        2000
+#define MODBUS_MAX_READ_REGISTERS   125
+#define MODBUS_MAX_WRITE_BITS       1968
+#define MODBUS_MAX_WRITE_REGISTERS  123
+
+ModbusRegisterMap::ModbusRegisterMap() : requests(0), exceptions(0) {}
+
+bool ModbusRegisterMap::addArea(const char* spec)
+{
+  // the parentheses of the exp_config form are optional
+  while(*spec == ' ' || *spec == '(') spec++;
+  int type, block, start, end;
+  if(sscanf(spec, "%d:%d:%d:%d", &type, &block, &start, &end) != 4) return false;
+  if(type < MODBUS_COILS || type > MODBUS_INPUT_REGISTERS ||
+     start < 0 || end < start || end > 0xffff) return false;
+
+  Area area;
+  area.type = type;
+  area.block = block;
+  area.start = start;
+  area.end = end;
+  area.values.resize(end-start+1, 0);
+  areas.push_back(area);
+  return true;
+}
+
+ModbusRegisterMap::Area* ModbusRegisterMap::find(int type, uint16 start, uint16 count)
+{
+  for(unsigned int i=0; i<areas.size(); i++)
+  {
+    Area& a = areas[i];
+    if(a.type == type && start >= a.start && (uint32)start+count-1 <= a.end)
+      return &a;
+  }
+  return 0;
+}
+
+int ModbusRegisterMap::exception(int function, int code, byte* rsp)
+{
+  exceptions++;
+  rsp[0] = (byte)(function|0x80);
+  rsp[1] = (byte)code;
+  return 2;
+}
+
+int ModbusRegisterMap::process(const byte* pdu, int len, byte* rsp)
+{
+  requests++;
+  int function = pdu[0];
+
+  switch(function)
+  {
+  case MODBUS_READ_COILS:
+  case MODBUS_READ_DISCRETE_INPUTS:
+  {
+    if(len != 5) return exception(function, MODBUS_EXCEPTION_ILLEGAL_DATA_VALUE, rsp);
+    uint16 start = modbus_get16(pdu+1);
+    uint16 count = modbus_get16(pdu+3);
+    if(count < 1 || count > MODBUS_MAX_READ_BITS)
+      return exception(function, MODBUS_EXCEPTION_ILLEGAL_DATA_VALUE, rsp);
+    Area* a = find(function == MODBUS_READ_COILS ? MODBUS_COILS : MODBUS_DISCRETE_INPUTS, start, count);
+    if(!a) return exception(function, MODBUS_EXCEPTION_ILLEGAL_DATA_ADDRESS, rsp);
+
+    // the bits are packed from the least significant bit of the first byte
+    int nbytes = (count+7)/8;
+    rsp[0] = (byte)function;
+    rsp[1] = (byte)nbytes;
+    memset(rsp+2, 0, nbytes);
+    const uint16* v = &a->values[start-a->start];
+    for(int i=0; i<count; i++)
+      if(v[i]) rsp[2+i/8] |= (byte)(1 << (i%8));
+    return 2+nbytes;
+  }
+
+  case MODBUS_READ_HOLDING_REGISTERS:
+  case MODBUS_READ_INPUT_REGISTERS:
+  {
+    if(len != 5) return exception(function, MODBUS_EXCEPTION_ILLEGAL_DATA_VALUE, rsp);
+    uint16 start = modbus_get16(pdu+1);
+    uint16 count = modbus_get16(pdu+3);
+    if(count < 1 || count > MODBUS_MAX_READ_REGISTERS)
+      return exception(function, MODBUS_EXCEPTION_ILLEGAL_DATA_VALUE, rsp);
+    Area* a = find(function == MODBUS_READ_HOLDING_REGISTERS ?
+		   MODBUS_HOLDING_REGISTERS : MODBUS_INPUT_REGISTERS, start, count);
+    if(!a) return exception(function, MODBUS_EXCEPTION_ILLEGAL_DATA_ADDRESS, rsp);
+
+    rsp[0] = (byte)function;
+    rsp[1] = (byte)(2*count);
+    const uint16* v = &a->values[start-a->start];
+    for(int i=0; i<count; i++) modbus_put16(rsp+2+2*i, v[i]);
+    return 2+2*count;
+  }
+
+  case MODBUS_WRITE_SINGLE_COIL:
+  {
+    if(len != 5) return exception(function, MODBUS_EXCEPTION_ILLEGAL_DATA_VALUE, rsp);
+    uint16 addr = modbus_get16(pdu+1);
+    uint16 value = modbus_get16(pdu+3);
+    if(value != 0xff00 && value != 0x0000)
+      return exception(function, MODBUS_EXCEPTION_ILLEGAL_DATA_VALUE, rsp);
+    Area* a = find(MODBUS_COILS, addr, 1);
+    if(!a) return exception(function, MODBUS_EXCEPTION_ILLEGAL_DATA_ADDRESS, rsp);
+    a->values[addr-a->start] = (value ? 1 : 0);
+    memcpy(rsp, pdu, 5); // the response echoes the request
+    return 5;
+  }
+
+  case MODBUS_WRITE_SINGLE_REGISTER:
+  {
+    if(len != 5) return exception(function, MODBUS_EXCEPTION_ILLEGAL_DATA_VALUE, rsp);
+    uint16 addr = modbus_get16(pdu+1);
+    Area* a = find(MODBUS_HOLDING_REGISTERS, addr, 1);
+    if(!a) return exception(function, MODBUS_EXCEPTION_ILLEGAL_DATA_ADDRESS, rsp);
+    a->values[addr-a->start] = modbus_get16(pdu+3);
+    memcpy(rsp, pdu, 5);
+    return 5;
+  }
+
+  case MODBUS_WRITE_MULTIPLE_COILS:
+  {
+    if(len < 6) return exception(function, MODBUS_EXCEPTION_ILLEGAL_DATA_VALUE, rsp);
+    uint16 start = modbus_get16(pdu+1);
+    uint16 count = modbus_get16(pdu+3);
+    int nbytes = pdu[5];
+    if(count < 1 || count > MODBUS_MAX_WRITE_BITS || nbytes != (count+7)/8 || len != 6+nbytes)
+      return exception(function, MODBUS_EXCEPTION_ILLEGAL_DATA_VALUE, rsp);
+    Area* a = find(MODBUS_COILS, start, count);
+    if(!a) return exception(function, MODBUS_EXCEPTION_ILLEGAL_DATA_ADDRESS, rsp);
+    uint16* v = &a->values[start-a->start];
+    for(int i=0; i<count; i++) v[i] = (pdu[6+i/8] >> (i%8)) & 1;
+    memcpy(rsp, pdu, 5); // function, start and quantity
+    return 5;
+  }
+
+  case MODBUS_WRITE_MULTIPLE_REGISTERS:
+  {
+    if(len < 6) return exception(function, MODBUS_EXCEPTION_ILLEGAL_DATA_VALUE, rsp);
+    uint16 start = modbus_get16(pdu+1);
+    uint16 count = modbus_get16(pdu+3);
+    int nbytes = pdu[5];
+    if(count < 1 || count > MODBUS_MAX_WRITE_REGISTERS || nbytes != 2*count || len != 6+nbytes)
+      return exception(function, MODBUS_EXCEPTION_ILLEGAL_DATA_VALUE, rsp);
+    Area* a = find(MODBUS_HOLDING_REGISTERS, start, count);
+    if(!a) return exception(function, MODBUS_EXCEPTION_ILLEGAL_DATA_ADDRESS, rsp);
+    uint16* v = &a->values[start-a->start];
+    for(int i=0; i<count; i++) v[i] = modbus_get16(pdu+6+2*i);
+    memcpy(rsp, pdu, 5);
+    return 5;
+  }
+
+  default:
+    return exception(function, MODBUS_EXCEPTION_ILLEGAL_FUNCTION, rsp);
+  }
+}
+
+void ModbusRegisterMap::driftInputs(Random::RNG* rng, double flip_prob, int step)
+{
+  for(unsigned int i=0; i<areas.size(); i++)
+  {
+    Area& a = areas[i];
+    if(a.type == MODBUS_DISCRETE_INPUTS && flip_prob > 0)
+    {
+      for(unsigned int j=0; j<a.values.size(); j++)
+	if(rng->Bernoulli(flip_prob)) a.values[j] ^= 1;
+    }
+    else if(a.type == MODBUS_INPUT_REGISTERS && step > 0)
+    {
+      for(unsigned int j=0; j<a.values.size(); j++)
+      {
+	long v = (long)a.values[j] + rng->Equilikely(-step, step);
+	if(v < 0) v = 0;
+	else if(v > 0xffff) v = 0xffff;
+	a.values[j] = (uint16)v;
+      }
+    }
+  }
+}
+
+}; // namespace s3fnet
+}; // namespace s3f
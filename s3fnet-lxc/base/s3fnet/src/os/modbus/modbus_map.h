@@ -0,0 +1,141 @@
+/**
+ * \file modbus_map.h
+ * \brief Header file for the ModbusRegisterMap class and the Modbus/TCP definitions.
+ *
+ * authors : Dong (Kevin) Jin
+ */
+
+#ifndef __MODBUS_MAP_H__
+#define __MODBUS_MAP_H__
+
+#include "s3f.h"
+#include "s3fnet.h"
+#include "util/shstl.h"
+
+namespace s3f {
+namespace s3fnet {
+
+/** The well-known port of Modbus/TCP. */
+#define MODBUS_TCP_PORT 502
+
+/** Size of the MBAP header: transaction id, protocol id, length and unit id. */
+#define MODBUS_MBAP_SIZE 7
+
+/** Largest Modbus PDU (function code and data). */
+#define MODBUS_MAX_PDU_SIZE 253
+
+/** Largest Modbus/TCP frame (MBAP header and PDU). */
+#define MODBUS_MAX_ADU_SIZE (MODBUS_MBAP_SIZE+MODBUS_MAX_PDU_SIZE)
+
+/** The Modbus function codes served by the simulated devices. */
+enum ModbusFunctionCode {
+  MODBUS_READ_COILS               = 1,
+  MODBUS_READ_DISCRETE_INPUTS     = 2,
+  MODBUS_READ_HOLDING_REGISTERS   = 3,
+  MODBUS_READ_INPUT_REGISTERS     = 4,
+  MODBUS_WRITE_SINGLE_COIL        = 5,
+  MODBUS_WRITE_SINGLE_REGISTER    = 6,
+  MODBUS_WRITE_MULTIPLE_COILS     = 15,
+  MODBUS_WRITE_MULTIPLE_REGISTERS = 16
+};
+
+/** The Modbus exception codes returned by the simulated devices. */
+enum ModbusExceptionCode {
+  MODBUS_EXCEPTION_ILLEGAL_FUNCTION     = 1,
+  MODBUS_EXCEPTION_ILLEGAL_DATA_ADDRESS = 2,
+  MODBUS_EXCEPTION_ILLEGAL_DATA_VALUE   = 3
+};
+
+/**
+ * The Modbus data types, numbered as the data types of the DATA_AREA
+ * tuples in exp_config (see the SIMATIC S7 Open Modbus/TCP manual).
+ */
+enum ModbusDataType {
+  MODBUS_COILS             = 1,
+  MODBUS_DISCRETE_INPUTS   = 2,
+  MODBUS_HOLDING_REGISTERS = 3,
+  MODBUS_INPUT_REGISTERS   = 4
+};
+
+/** Read a big-endian 16-bit field of a Modbus frame. */
+inline uint16 modbus_get16(const byte* p) { return (uint16)((p[0] << 8) | p[1]); }
+
+/** Write a big-endian 16-bit field of a Modbus frame. */
+inline void modbus_put16(byte* p, uint16 v) { p[0] = (byte)(v >> 8); p[1] = (byte)v; }
+
+/**
+ * \brief The data areas of a simulated Modbus device.
+ *
+ * A register map holds the coils, discrete inputs, holding registers
+ * and input registers of a simulated PLC, as data areas given in the
+ * same form as the DATA_AREA tuples of exp_config:
+ * "type:block:start:end" (the parentheses are optional), e.g.
+ * "1:2:1:100" for coils 1 to 100. The data block number, which places
+ * the area in the memory of an S7 PLC, is accepted for compatibility
+ * and otherwise ignored. The map serves the request PDUs of the
+ * functions in ModbusFunctionCode and answers the others with an
+ * exception.
+ */
+class ModbusRegisterMap {
+ public:
+  /** The constructor; the map is empty. */
+  ModbusRegisterMap();
+
+  /** Add a data area given as "type:block:start:end"; return false if the string is invalid. */
+  bool addArea(const char* spec);
+
+  /** Return true if the map has no data area. */
+  bool empty() { return areas.empty(); }
+
+  /**
+   * Serve the given request PDU. The response PDU, a normal response
+   * or an exception, is written to rsp, which must hold
+   * MODBUS_MAX_PDU_SIZE bytes; its length is returned.
+   */
+  int process(const byte* pdu, int len, byte* rsp);
+
+  /**
+   * Move the inputs (discrete inputs and input registers) as the
+   * process the device controls would: each discrete input flips
+   * with the given probability, and each input register takes a
+   * random step of at most the given size.
+   */
+  void driftInputs(Random::RNG* rng, double flip_prob, int step);
+
+  /** Return the number of requests served, and those answered with an exception. */
+  uint64 getRequests() { return requests; }
+  uint64 getExceptions() { return exceptions; }
+
+ protected:
+  /** A data area: the values of the addresses start to end of one data type. */
+  struct Area {
+    int type;                       ///< the data type (ModbusDataType)
+    int block;                      ///< the data block number (unused)
+    uint16 start;                   ///< the first address
+    uint16 end;                     ///< the last address
+    S3FNET_VECTOR(uint16) values;   ///< the values, 0 or 1 for coils and discrete inputs
+  };
+
+  /** Return the area of the given type holding count addresses from start, or NULL. */
+  Area* find(int type, uint16 start, uint16 count);
+
+  /** Write an exception response for the given function to rsp. */
+  int exception(int function, int code, byte* rsp);
+
+  S3FNET_VECTOR(Area) areas; ///< the data areas
+  uint64 requests;           ///< number of requests served
+  uint64 exceptions;         ///< number of exception responses
+};
+
+/**
+ * Print the statistics of the Modbus servers and of the Modbus clients
+ * at the end of the run. They are defined with the protocol sessions,
+ * whose headers need C++20, and declared here for the main program.
+ */
+void modbus_server_report(double sim_seconds, double wall_seconds);
+void modbus_client_report(double sim_seconds, double wall_seconds);
+
+}; // namespace s3fnet
+}; // namespace s3f
+
+#endif /*__MODBUS_MAP_H__*/
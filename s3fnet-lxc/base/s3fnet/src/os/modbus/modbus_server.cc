@@ -0,0 +1,274 @@
+/**
+ * \file modbus_server.cc
+ * \brief Source file for the ModbusServerSession class.
+ *
+ * authors : Dong (Kevin) Jin
+ */
+
+#include <string.h>
+#include <pthread.h>
+#include "os/modbus/modbus_server.h"
+#include "os/base/protocols.h"
+#include "util/errhandle.h"
+#include "net/host.h"
+#include "net/ip_prefix.h"
+
+#ifdef MODBUS_DEBUG
+#define MB_DUMP(x) printf("MBSRV: "); x
+#else
+#define MB_DUMP(x)
+#endif
+
+namespace s3f {
+namespace s3fnet {
+
+S3FNET_REGISTER_PROTOCOL(ModbusServerSession, "S3F.OS.Modbus.Server");
+
+// all the Modbus servers, for the report at the end of the run
+static S3FNET_VECTOR(ModbusServerSession*) all_servers;
+static pthread_mutex_t all_servers_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+ModbusServerSession::ModbusServerSession(ProtocolGraph* graph) : ProtocolSession(graph),
+  last_scan(0), connections(0), active(0), bad_frames(0)
+{
+  MB_DUMP(printf("A Modbus server session is created.\n"));
+}
+
+ModbusServerSession::~ModbusServerSession()
+{
+  MB_DUMP(printf("A Modbus server session is reclaimed.\n"));
+  for(unsigned i=0; i<idle_timers.size(); i++) delete idle_timers[i];
+}
+
+void ModbusServerSession::config(s3f::dml::Configuration *cfg)
+{
+  ProtocolSession::config(cfg);
+
+  char* str = (char*)cfg->findSingle("port");
+  if(str)
+  {
+    if(s3f::dml::dmlConfig::isConf(str))
+      error_quit("ERROR: ModbusServerSession::config(), invalid PORT attribute.\n");
+    server_port = atoi(str);
+  }
+  else server_port = MODBUS_TCP_PORT;
+
+  s3f::dml::Enumeration* denum = cfg->find("data_area");
+  while(denum->hasMoreElements())
+  {
+    char* spec = (char*)denum->nextElement();
+    if(s3f::dml::dmlConfig::isConf(spec) || !regmap.addArea(spec))
+      error_quit("ERROR: ModbusServerSession::config(), invalid DATA_AREA attribute.\n");
+  }
+  delete denum;
+  if(regmap.empty())
+  {
+    // 100 addresses of each data type
+    regmap.addArea("1:0:1:100");
+    regmap.addArea("2:0:1:100");
+    regmap.addArea("3:0:1:100");
+    regmap.addArea("4:0:1:100");
+  }
+
+  str = (char*)cfg->findSingle("response_time");
+  if(str)
+  {
+    if(s3f::dml::dmlConfig::isConf(str) || atof(str) < 0)
+      error_quit("ERROR: ModbusServerSession::config(), invalid RESPONSE_TIME attribute.\n");
+    response_time = inHost()->d2t(atof(str), 0);
+  }
+  else response_time = 0;
+
+  str = (char*)cfg->findSingle("scan_cycle");
+  if(str)
+  {
+    if(s3f::dml::dmlConfig::isConf(str) || atof(str) < 0)
+      error_quit("ERROR: ModbusServerSession::config(), invalid SCAN_CYCLE attribute.\n");
+    scan_cycle = inHost()->d2t(atof(str), 0);
+  }
+  else scan_cycle = 0;
+
+  str = (char*)cfg->findSingle("input_flip");
+  if(str)
+  {
+    if(s3f::dml::dmlConfig::isConf(str) || atof(str) < 0 || atof(str) > 1)
+      error_quit("ERROR: ModbusServerSession::config(), invalid INPUT_FLIP attribute.\n");
+    input_flip = atof(str);
+  }
+  else input_flip = 0.1;
+
+  str = (char*)cfg->findSingle("input_step");
+  if(str)
+  {
+    if(s3f::dml::dmlConfig::isConf(str) || atoi(str) < 0)
+      error_quit("ERROR: ModbusServerSession::config(), invalid INPUT_STEP attribute.\n");
+    input_step = atoi(str);
+  }
+  else input_step = 10;
+
+  str = (char*)cfg->findSingle("show_report");
+  if(str)
+  {
+    if(s3f::dml::dmlConfig::isConf(str))
+      error_quit("ERROR: ModbusServerSession::config(), invalid SHOW_REPORT attribute.\n");
+    if(!strcasecmp(str, "true")) show_report = true;
+    else if(!strcasecmp(str, "false")) show_report = false;
+    else error_quit("ERROR: ModbusServerSession::config(), invalid SHOW_REPORT attribute (%s).\n", str);
+  }
+  else show_report = false;
+
+  MB_DUMP(printf("[host=\"%s\"] config(): port=%u, response_time=%ld, scan_cycle=%ld.\n",
+		 inHost()->nhi.toString(), server_port, response_time, scan_cycle));
+}
+
+void ModbusServerSession::init()
+{
+  ProtocolSession::init();
+
+  if(!inHost()->sessionForNumber(S3FNET_PROTOCOL_TYPE_SOCKET))
+    error_quit("ERROR: ModbusServerSession::init(), missing socket master on host \"%s\".\n",
+	       inHost()->nhi.toString());
+
+  if(show_report)
+  {
+    pthread_mutex_lock(&all_servers_mutex);
+    all_servers.push_back(this);
+    pthread_mutex_unlock(&all_servers_mutex);
+  }
+
+  listen().start();
+}
+
+SocketTask ModbusServerSession::listen()
+{
+  CoSocket sock(this);
+  if(!sock.bind(IPADDR_ANYDEST, server_port, (char*)TCP_PROTOCOL_NAME))
+    error_quit("ERROR: ModbusServerSession::listen(), can't bind port %u on host \"%s\".\n",
+	       server_port, inHost()->nhi.toString());
+
+  for(;;)
+  {
+    // the listening socket stays bound: each connection gets a new socket
+    ltime_t t = getNow();
+    int sockid = co_await sock.accept();
+    if(sockid < 0)
+    {
+      // a connection reset before it was accepted; a socket that fails
+      // at once cannot listen at all
+      if(getNow() == t)
+      {
+	MB_DUMP(printf("[host=\"%s\"] listen(), failed to accept.\n", inHost()->nhi.toString()));
+	co_return -1;
+      }
+      continue;
+    }
+
+    MB_DUMP(printf("[host=\"%s\"] %s: listen(), accepted connection on socket %d.\n",
+		   inHost()->nhi.toString(), getNowWithThousandSeparator(), sockid));
+    serve(sockid).start();
+  }
+}
+
+SocketTask ModbusServerSession::serve(int sockid)
+{
+  CoSocket sock(this, sockid);
+  byte req[MODBUS_MAX_ADU_SIZE];
+  byte rsp[MODBUS_MAX_ADU_SIZE];
+
+  // a device that answers at once needs no timer; otherwise the timer
+  // of a closed connection is reused, since each new timer is a new
+  // process of the host
+  CoTimer* delay = 0;
+  if(response_time > 0)
+  {
+    if(idle_timers.empty()) delay = new CoTimer(this);
+    else
+    {
+      delay = idle_timers.back();
+      idle_timers.pop_back();
+    }
+  }
+
+  connections++;
+  active++;
+  for(;;)
+  {
+    // the MBAP header, then as many bytes as its length field says;
+    // the client closing the connection ends the loop here
+    if(co_await co_recv_all(*this, sock, MODBUS_MBAP_SIZE, req) < 0) break;
+    uint16 length = modbus_get16(req+4); // the unit id and the PDU
+    if(modbus_get16(req+2) != 0 || length < 2 || length > MODBUS_MAX_PDU_SIZE+1)
+    {
+      MB_DUMP(printf("[host=\"%s\"] serve(), malformed MBAP header on socket %d.\n",
+		     inHost()->nhi.toString(), sockid));
+      bad_frames++;
+      active--;
+      if(delay) idle_timers.push_back(delay);
+      sock.abort();
+      co_return -1;
+    }
+    if(co_await co_recv_all(*this, sock, length-1, req+MODBUS_MBAP_SIZE) < 0) break;
+
+    if(delay) co_await delay->sleep(response_time);
+
+    // the inputs move once for all the requests of a scan cycle
+    if(scan_cycle > 0 && getNow()-last_scan >= scan_cycle)
+    {
+      last_scan += (getNow()-last_scan)/scan_cycle*scan_cycle;
+      regmap.driftInputs(getRandom(), input_flip, input_step);
+    }
+
+    // the response has the transaction id, protocol id and unit id of the request
+    int n = regmap.process(req+MODBUS_MBAP_SIZE, length-1, rsp+MODBUS_MBAP_SIZE);
+    memcpy(rsp, req, 4);
+    modbus_put16(rsp+4, n+1);
+    rsp[6] = req[6];
+    if(co_await sock.send(MODBUS_MBAP_SIZE+n, rsp) < 0) break;
+  }
+
+  MB_DUMP(printf("[host=\"%s\"] %s: serve(), closing socket %d.\n",
+		 inHost()->nhi.toString(), getNowWithThousandSeparator(), sockid));
+  active--;
+  if(delay) idle_timers.push_back(delay);
+  co_await sock.close();
+  co_return 0;
+}
+
+int ModbusServerSession::push(Activation msg, ProtocolSession* hi_sess, void* extinfo, size_t extinfo_size)
+{
+  error_quit("ERROR: ModbusServerSession::push() should not be called.\n");
+  return 1;
+}
+
+int ModbusServerSession::pop(Activation msg, ProtocolSession* lo_sess, void* extinfo, size_t extinfo_size)
+{
+  error_quit("ERROR: ModbusServerSession::pop() should not be called.\n");
+  return 1;
+}
+
+void modbus_server_report(double sim_seconds, double wall_seconds)
+{
+  if(all_servers.empty()) return;
+
+  uint64 conns = 0, open = 0, bad = 0, requests = 0, exceptions = 0;
+  for(unsigned i=0; i<all_servers.size(); i++)
+  {
+    ModbusServerSession* ms = all_servers[i];
+    conns += ms->connections;
+    open += ms->active;
+    bad += ms->bad_frames;
+    requests += ms->regmap.getRequests();
+    exceptions += ms->regmap.getExceptions();
+  }
+
+  printf("Modbus servers: %lu\n", (unsigned long)all_servers.size());
+  printf("  connections: %llu accepted, %llu open, %llu closed on a malformed frame\n",
+	 (unsigned long long)conns, (unsigned long long)open, (unsigned long long)bad);
+  printf("  requests: %llu served, %llu exceptions\n",
+	 (unsigned long long)requests, (unsigned long long)exceptions);
+  printf("  request rate: %.1f requests/s simulated, %.1f requests/s wall-clock\n",
+	 sim_seconds > 0 ? requests/sim_seconds : 0.0, wall_seconds > 0 ? requests/wall_seconds : 0.0);
+}
+
+}; // namespace s3fnet
+}; // namespace s3f
@@ -0,0 +1,96 @@
+/**
+ * \file modbus_server.h
+ * \brief Header file for the ModbusServerSession class.
+ *
+ * authors : Dong (Kevin) Jin
+ */
+
+#ifndef __MODBUS_SERVER_H__
+#define __MODBUS_SERVER_H__
+
+#include "os/base/protocol_session.h"
+#include "os/socket/co_socket.h"
+#include "os/modbus/modbus_map.h"
+#include "util/shstl.h"
+
+namespace s3f {
+namespace s3fnet {
+
+/**
+ * \brief A simulated Modbus/TCP device.
+ *
+ * The protocol session stands for a PLC serving Modbus/TCP, without
+ * the container, the awlsim instance and the time dilation an
+ * emulated PLC needs, so that thousands of devices can take part in
+ * an experiment next to a few emulated ones. It listens on the
+ * Modbus port over TCP (via the socket master) and serves each client
+ * connection with a socket coroutine, from a register map configured
+ * as the data areas of exp_config. The DML attributes are:
+ *
+ *   port          the port to listen on (502)
+ *   data_area     a data area "type:block:start:end", as in exp_config;
+ *                 may be repeated (100 addresses of each type from 1)
+ *   response_time the time the device takes to answer a request, in
+ *                 seconds, e.g. its scan cycle (0)
+ *   scan_cycle    the period at which the inputs change, in seconds;
+ *                 the inputs are moved when a request comes, at most
+ *                 once per period (0: the inputs do not change)
+ *   input_flip    the probability a discrete input flips in a period (0.1)
+ *   input_step    the largest step of an input register in a period (10)
+ *   show_report   print the statistics at the end of the run (false)
+ */
+class ModbusServerSession: public ProtocolSession {
+ public:
+  /** The constructor. */
+  ModbusServerSession(ProtocolGraph* graph);
+
+  /** The destructor. */
+  virtual ~ModbusServerSession();
+
+  /** Configure the Modbus server session. */
+  virtual void config(s3f::dml::Configuration *cfg);
+
+  /** Return the protocol number. */
+  virtual int getProtocolNumber() { return S3FNET_PROTOCOL_TYPE_MODBUS_SERVER; }
+
+  /** Initialize this protocol session. */
+  virtual void init();
+
+  /** The report at the end of the run (see modbus_map.h) reads the statistics. */
+  friend void modbus_server_report(double sim_seconds, double wall_seconds);
+
+ protected:
+  /** Accept the connections of the clients, each served by its own coroutine. */
+  SocketTask listen();
+
+  /** Serve the requests that come over a connection until it is closed. */
+  SocketTask serve(int sockid);
+
+  /** The protocol session is on top of the socket layer, so push() and pop() are not used. */
+  virtual int push(Activation msg, ProtocolSession* hi_sess, void* extinfo = 0, size_t extinfo_size = 0);
+  virtual int pop(Activation msg, ProtocolSession* lo_sess, void* extinfo = 0, size_t extinfo_size = 0);
+
+  /** A host may run several Modbus servers, on different ports. */
+  virtual int instantiation_type() { return PROT_MULTIPLE_INSTANCES; }
+
+ private:
+  uint16 server_port;       ///< the port to listen on
+  ltime_t response_time;    ///< the time taken to answer a request
+  ltime_t scan_cycle;       ///< the period at which the inputs change
+  double input_flip;        ///< probability a discrete input flips in a period
+  int input_step;           ///< largest step of an input register in a period
+  bool show_report;         ///< print the statistics at the end
+
+  ModbusRegisterMap regmap; ///< the data areas of the device
+  ltime_t last_scan;        ///< the start of the period the inputs were last moved
+  S3FNET_VECTOR(CoTimer*) idle_timers; ///< the response timers of closed connections, for reuse
+
+  uint64 connections;       ///< connections accepted
+  uint64 active;            ///< connections open
+  uint64 bad_frames;        ///< connections closed on a malformed frame
+};
+
+}; // namespace s3fnet
+}; // namespace s3f
+
+#endif /*__MODBUS_SERVER_H__*/
@@ -78,6 +78,7 @@ void SerialSession::init()
 
   	Host* owner_host = inHost();
 	callback_proc = new Process((Entity *) owner_host,(void (s3f::Entity::*)(s3f::Activation))&SerialSession::callback);
+	callback_proc->set_name("SerialSession::callback");
 
 }
 
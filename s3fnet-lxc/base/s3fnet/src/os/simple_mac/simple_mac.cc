@@ -6,6 +6,8 @@
  */
 
 #include "os/simple_mac/simple_mac.h"
+#include "os/simple_phy/simple_phy.h"
+#include "os/ipv4/ip_session.h"
 #include "util/errhandle.h"
 #include "net/network_interface.h"
 #include "net/mac48_address.h"
@@ -29,7 +31,8 @@ namespace s3fnet {
 
 S3FNET_REGISTER_PROTOCOL(SimpleMac, SIMPLE_MAC_PROTOCOL_CLASSNAME);
 
-SimpleMac::SimpleMac(ProtocolGraph* graph) : NicProtocolSession(graph)
+SimpleMac::SimpleMac(ProtocolGraph* graph) :
+  NicProtocolSession(graph), std_phy(0), std_ip(0)
 {
   SMAC_DUMP(printf("[nic=\"%s\"] new simple_mac session.\n", ((NetworkInterface*)inGraph())->nhi.toString()));
 }
@@ -48,6 +51,9 @@ void SimpleMac::init()
 
   if(strcasecmp(name, MAC_PROTOCOL_NAME))
     error_quit("ERROR: SimpleMac::init(), unmatched protocol name: \"%s\", expecting \"MAC\".\n", name);
+
+  std_phy = session_of_class<SimplePhy>(child_prot);
+  std_ip = session_of_class<IPSession>(parent_prot);
 }
 
 int SimpleMac::push(Activation msg, ProtocolSession* hi_sess, void* extinfo, size_t extinfo_size)
@@ -98,7 +104,7 @@ int SimpleMac::push(Activation msg, ProtocolSession* hi_sess, void* extinfo, siz
   if(!child_prot)
     error_quit("ERROR: SimpleMac::push(), child protocol session has not been set.\n");
 
-  return child_prot->pushdown(simp_mac_hdr, this);
+  return pushdown_to(std_phy, child_prot, simp_mac_hdr, this);
 }
 
 int SimpleMac::pop(Activation msg, ProtocolSession* lo_sess, void* extinfo, size_t extinfo_size)
@@ -123,7 +129,7 @@ int SimpleMac::pop(Activation msg, ProtocolSession* lo_sess, void* extinfo, size
   // check whether this packet is for myself. Ignore it if not.
   //if(mac_hdr->dest != 0 && getNetworkInterface()->getMacAddr() != mac_hdr->dest)
   //if(getNetworkInterface()->getMacAddr() != mac_hdr->dest)
-  if(!getNetworkInterface()->getMac48Addr()->IsEqual(mac_hdr->dst48))
+  if(!mac_hdr->dst48->IsBroadcast() && !getNetworkInterface()->getMac48Addr()->IsEqual(mac_hdr->dst48))
   {
 	msg->erase_all();
 	return 0;
@@ -140,7 +146,7 @@ int SimpleMac::pop(Activation msg, ProtocolSession* lo_sess, void* extinfo, size
   Activation ip_msg (payload);
   mac_hdr->erase(); //delete MAC header
 
-  return parent_prot->popup(ip_msg, this);
+  return popup_to(std_ip, parent_prot, ip_msg, this);
 }
 
 }; // namespace s3fnet
@@ -15,6 +15,9 @@ namespace s3fnet {
 
 #define SIMPLE_MAC_PROTOCOL_CLASSNAME "S3F.OS.SimpleMac"
 
+class SimplePhy;
+class IPSession;
+
 /**
  * \brief A simple MAC layer protocol.
  *
@@ -25,6 +28,8 @@ namespace s3fnet {
  * address.
  */
 class SimpleMac: public NicProtocolSession {
+  friend class ProtocolSession; // the static pipeline calls push() and pop()
+
  public:
   /** The constructor. */
   SimpleMac(ProtocolGraph* graph);
@@ -41,6 +46,9 @@ class SimpleMac: public NicProtocolSession {
    */
   virtual int getProtocolNumber() { return S3FNET_PROTOCOL_TYPE_SIMPLE_MAC; }
 
+  /** The MAC session keeps no state of its own; there is nothing to save. */
+  virtual bool save_state(Checkpoint* ckpt) { return true; }
+
  private:
   /**
    * Push message down from the upper layer. msg is the protocol
@@ -58,6 +66,11 @@ class SimpleMac: public NicProtocolSession {
    */
   virtual int pop(Activation msg, ProtocolSession* lo_sess, void* extinfo, size_t extinfo_size);
 
+  /** The PHY session below if it is a SimplePhy, for the static pipeline. */
+  SimplePhy* std_phy;
+
+  /** The IP session above if it is an IPSession, for the static pipeline. */
+  IPSession* std_ip;
 };
 
 }; // namespace s3fnet
@@ -5,6 +5,7 @@
  * authors : Dong (Kevin) Jin
  */
 
+#include <string.h>
 #include "os/simple_mac/simple_mac_message.h"
 #include "net/mac48_address.h"
 
@@ -47,6 +48,45 @@ SimpleMacMessage::~SimpleMacMessage()
 	if(dst48) delete dst48;
 }
 
+/* the 48-bit addresses are packed as a flag (present or not) and 6 bytes */
+static void serialize_mac48(Mac48Address* addr, byte* buf, int& offset)
+{
+  buf[offset++] = (addr != NULL);
+  if(addr) addr->CopyTo(&buf[offset]);
+  else memset(&buf[offset], 0, 6);
+  offset += 6;
+}
+
+static Mac48Address* deserialize_mac48(byte* buf, int& offset)
+{
+  Mac48Address* addr = NULL;
+  if(buf[offset++])
+  {
+    addr = new Mac48Address();
+    addr->CopyFrom(&buf[offset]);
+  }
+  offset += 6;
+  return addr;
+}
+
+void SimpleMacMessage::serialize(byte* buf, int& offset)
+{
+  ProtocolMessage::serialize(buf, offset);
+  memcpy(&buf[offset], &src, sizeof(MACADDR)); offset += sizeof(MACADDR);
+  memcpy(&buf[offset], &dest, sizeof(MACADDR)); offset += sizeof(MACADDR);
+  serialize_mac48(src48, buf, offset);
+  serialize_mac48(dst48, buf, offset);
+}
+
+void SimpleMacMessage::deserialize(byte* buf, int& offset)
+{
+  ProtocolMessage::deserialize(buf, offset);
+  memcpy(&src, &buf[offset], sizeof(MACADDR)); offset += sizeof(MACADDR);
+  memcpy(&dest, &buf[offset], sizeof(MACADDR)); offset += sizeof(MACADDR);
+  src48 = deserialize_mac48(buf, offset);
+  dst48 = deserialize_mac48(buf, offset);
+}
+
 S3FNET_REGISTER_MESSAGE(SimpleMacMessage, S3FNET_PROTOCOL_TYPE_SIMPLE_MAC);
 
 }; // namespace s3fnet
@@ -52,8 +52,17 @@ class SimpleMacMessage: public ProtocolMessage {
    */
   virtual int packingSize()
   {
-    return 2*sizeof(MACADDR) + ProtocolMessage::packingSize();
+    return 2*sizeof(MACADDR) + 2*(1+6) + ProtocolMessage::packingSize();
   }
+
+  /** Pack the MAC addresses into buf from the given offset. */
+  virtual void serialize(byte* buf, int& offset);
+
+  /** Unpack the MAC addresses from buf at the given offset. */
+  virtual void deserialize(byte* buf, int& offset);
+
+  /** The simple MAC header can be saved in a checkpoint. */
+  virtual bool serializable() { return true; }
   
   /* The simple MAC header is not counted as part of the packet
      when we compute the bandwidth use and delay, etc. */
@@ -6,11 +6,13 @@
  */
 
 #include "os/simple_phy/simple_phy.h"
+#include "os/simple_mac/simple_mac.h"
 #include "util/errhandle.h"
 #include "os/base/protocols.h"
 #include "net/network_interface.h"
 #include "net/host.h"
 #include "net/nic_queue.h"
+#include "net/checkpoint.h"
 
 namespace s3f {
 namespace s3fnet {
@@ -26,7 +28,7 @@ namespace s3fnet {
 S3FNET_REGISTER_PROTOCOL(SimplePhy, SIMPLE_PHY_PROTOCOL_CLASSNAME);
 
 SimplePhy::SimplePhy(ProtocolGraph* graph) :
-  LowestProtocolSession(graph), bitrate(0), bufsize(0), latency(0), jitter_range(0), buffer(0)
+  LowestProtocolSession(graph), bitrate(0), bufsize(0), latency(0), jitter_range(0), buffer(0), std_mac(0)
 {
   SPHY_DUMP(printf("[nic=\"%s\"] new simple_phy session.\n", ((NetworkInterface*)inGraph())->nhi.toString()));
 }
@@ -137,6 +139,8 @@ void SimplePhy::init()
 
   if(strcasecmp(name, PHY_PROTOCOL_NAME))
     error_quit("ERROR: SimplePhy::init(), unmatched protocol name: \"%s\", expecting \"PHY\".\n", name);
+
+  std_mac = session_of_class<SimpleMac>(parent_prot);
   
   // initialize the buffer itself
   buffer->init();
@@ -174,7 +178,7 @@ void SimplePhy::receivePacket(Activation pkt)
   {
     error_quit("ERROR: SimplePhy()::receivePacket(), no parent protocol session set.\n");
   }
-  parent_prot->popup(pkt, this);
+  popup_to(std_mac, parent_prot, pkt, this);
 
 }
 
@@ -214,5 +218,20 @@ int SimplePhy::control(int ctrltyp, void* ctrlmsg, ProtocolSession* sess)
   }
 }
 
+bool SimplePhy::save_state(Checkpoint* ckpt)
+{
+  if(!buffer->save_state(ckpt))
+  {
+    error_retn("WARNING: SimplePhy::save_state(), the nic queue of type %d can't be saved.\n", buffer->type());
+    return false;
+  }
+  return true;
+}
+
+void SimplePhy::restore_state(Checkpoint* ckpt)
+{
+  buffer->restore_state(ckpt);
+}
+
 }; // namespace s3fnet
 }; // namespace s3f
@@ -15,6 +15,7 @@ namespace s3f {
 namespace s3fnet {
 
 class NicQueue;
+class SimpleMac;
 
 #define SIMPLE_PHY_PROTOCOL_CLASSNAME "S3F.OS.SimplePhy"
 
@@ -29,6 +30,8 @@ class NicQueue;
  * layer derives from the LowestProtocolSession class.
  */
 class SimplePhy : public LowestProtocolSession {
+  friend class ProtocolSession; // the static pipeline calls push()
+
  public:
   /** The constructor. */
   SimplePhy(ProtocolGraph* graph);
@@ -61,6 +64,12 @@ class SimplePhy : public LowestProtocolSession {
 
   double getBitrate() { return bitrate; }
 
+  /** Save the state of the nic queue to a checkpoint. */
+  virtual bool save_state(Checkpoint* ckpt);
+
+  /** Restore the state of the nic queue from a checkpoint. */
+  virtual void restore_state(Checkpoint* ckpt);
+
  private:
   /**
    * A packet to be sent is pushed down from the protocol stack from
@@ -84,6 +93,9 @@ class SimplePhy : public LowestProtocolSession {
 
   /** The nic queue for outgoing packets. */
   NicQueue* buffer;
+
+  /** The MAC session above if it is a SimpleMac, for the static pipeline. */
+  SimpleMac* std_mac;
 };
 
 }; // namespace s3fnet
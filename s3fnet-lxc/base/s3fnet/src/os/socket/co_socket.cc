@@ -0,0 +1,112 @@
+/**
+ * \file co_socket.cc
+ * \brief Source file for the coroutine socket interface.
+ *
+ * authors : Dong (Kevin) Jin
+ */
+
+#include "os/socket/co_socket.h"
+
+namespace s3f {
+namespace s3fnet {
+
+/** The activation of the process of a CoTimer. */
+class CoTimerActivation : public ProtocolCallbackActivation {
+ public:
+  CoTimerActivation(ProtocolSession* sess, CoTimer* t) : ProtocolCallbackActivation(sess), timer(t) {}
+  CoTimer* timer;
+};
+
+CoTimer::CoTimer(ProtocolSession* sess) :
+  owner(sess), pending(0), expire_fn(0), expire_arg(0)
+{
+  Host* owner_host = sess->inHost();
+  proc = new Process((Entity*)owner_host, (void (s3f::Entity::*)(s3f::Activation))&CoTimer::callback);
+  proc->set_name("CoTimer::callback");
+  activation = new CoTimerActivation(sess, this);
+
+  // the activation is reused for every expiration: hold an extra
+  // reference so that the event does not reclaim it after it's fired
+  activation->inc_evts();
+}
+
+CoTimer::~CoTimer()
+{
+  // an event still pending at the end of the simulation refers to the
+  // process and the activation; they are left to the event
+  if(!pending)
+  {
+    delete activation;
+    delete proc;
+  }
+}
+
+void CoTimer::set(ltime_t delay)
+{
+  Host* owner_host = owner->inHost();
+  if(pending && owner_host->reschedule(pending, delay)) return;
+  unschedule();
+  Activation ac(activation);
+  pending = owner_host->waitFor(proc, ac, delay, owner_host->tie_breaking_seed);
+}
+
+void CoTimer::start(ltime_t delay, void (*fn)(void*), void* arg)
+{
+  expire_fn = fn;
+  expire_arg = arg;
+  set(delay);
+}
+
+void CoTimer::cancel()
+{
+  unschedule();
+  waiter = nullptr;
+  expire_fn = 0;
+}
+
+void CoTimer::unschedule()
+{
+  if(pending)
+  {
+    Handle h(pending);
+    h.cancel();
+    pending = 0;
+  }
+}
+
+void CoTimer::callback(Activation ac)
+{
+  // called as a method of the host: find the timer from the activation
+  CoTimer* timer = ((CoTimerActivation*)ac)->timer;
+  ProtocolSession* sess = timer->owner;
+  unsigned int outer = sess->enter_cost("timer");
+  timer->pending = 0;
+  if(timer->waiter)
+  {
+    std::coroutine_handle<> h = timer->waiter;
+    timer->waiter = nullptr;
+    h.resume();
+  }
+  else if(timer->expire_fn)
+  {
+    void (*fn)(void*) = timer->expire_fn;
+    timer->expire_fn = 0;
+    fn(timer->expire_arg);
+  }
+  sess->leave_cost(outer);
+}
+
+SocketTask co_recv_all(ProtocolSession& sess, CoSocket& sock, uint32 length, byte* buf)
+{
+  uint32 rcvd = 0;
+  while(rcvd < length)
+  {
+    int n = co_await sock.recv(length-rcvd, buf ? buf+rcvd : 0);
+    if(n <= 0) co_return -1;
+    rcvd += n;
+  }
+  co_return 0;
+}
+
+}; // namespace s3fnet
+}; // namespace s3f
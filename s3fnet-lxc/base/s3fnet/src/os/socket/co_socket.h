@@ -0,0 +1,367 @@
+/**
+ * \file co_socket.h
+ * \brief Header file for the coroutine socket interface.
+ *
+ * The socket master offers a continuation-passing interface: each
+ * blocking call takes a BSocketContinuation whose success() or
+ * failure() method is called when the call completes, so an
+ * application has to be written as a state machine spread over the
+ * continuation. This file wraps the same calls as C++20 coroutines,
+ * so that an application session can be written as straight-line
+ * code:
+ *
+ *   SocketTask MySession::transfer(IPADDR ip, uint16 port)
+ *   {
+ *     CoSocket sock(this);
+ *     if(!sock.bind(IPADDR_INADDR_ANY, 2048, TCP_PROTOCOL_NAME) ||
+ *        co_await sock.connect(ip, port) < 0) co_return -1;
+ *     int n = co_await sock.recv(1000, 0);
+ *     co_await sock.close();
+ *     co_return n;
+ *   }
+ *
+ * The continuation of each call lives in the coroutine frame, and the
+ * frames of the coroutines that are members of a protocol session are
+ * allocated from the frame pool of the host (kept by its socket
+ * master). Coroutines are resumed directly from the continuation
+ * callbacks of the socket master and from the S3F process of a
+ * CoTimer, that is, on the timeline of the host.
+ *
+ * authors : Dong (Kevin) Jin
+ */
+
+#ifndef __CO_SOCKET_H__
+#define __CO_SOCKET_H__
+
+#if !defined(__cpp_impl_coroutine)
+#error "co_socket.h requires C++20 coroutines; compile with -std=c++20"
+#endif
+
+#include <coroutine>
+#include <new>
+#include "os/socket/socket_master.h"
+#include "os/socket/frame_pool.h"
+#include "net/host.h"
+#include "util/errhandle.h"
+
+namespace s3f {
+namespace s3fnet {
+
+/**
+ * \brief A socket coroutine.
+ *
+ * A socket task is a coroutine returning an integer. It does not run
+ * until it is either awaited by another socket coroutine (co_await
+ * task), which resumes when the task returns, or started with
+ * start(), after which it runs on its own and reclaims its frame when
+ * it returns.
+ */
+class SocketTask {
+ public:
+  /** The promise of a socket task. */
+  class promise_type {
+   public:
+    promise_type() : result(0), detached(false) {}
+
+    SocketTask get_return_object() {
+      return SocketTask(std::coroutine_handle<promise_type>::from_promise(*this));
+    }
+
+    std::suspend_always initial_suspend() noexcept { return std::suspend_always(); }
+
+    /** When the task returns, control goes back to the awaiting coroutine, if any. */
+    struct FinalAwaiter {
+      bool await_ready() noexcept { return false; }
+      std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> h) noexcept {
+	promise_type& p = h.promise();
+	if(p.detached) { h.destroy(); return std::noop_coroutine(); }
+	if(p.continuation) return p.continuation;
+	return std::noop_coroutine();
+      }
+      void await_resume() noexcept {}
+    };
+    FinalAwaiter final_suspend() noexcept { return FinalAwaiter(); }
+
+    void return_value(int v) { result = v; }
+
+    void unhandled_exception() {
+      error_quit("ERROR: SocketTask, unhandled exception in a socket coroutine.\n");
+    }
+
+    /**
+     * Allocate the frame of a coroutine that is a member of (or takes
+     * as its first argument) a protocol session from the frame pool of
+     * the host of the session. The pool is recorded in front of the
+     * frame so that it can be returned to the same pool.
+     */
+    template<typename... Args>
+    static void* operator new(size_t size, ProtocolSession& sess, Args&...) {
+      SocketMaster* sm = (SocketMaster*)sess.inHost()->sessionForNumber(S3FNET_PROTOCOL_TYPE_SOCKET);
+      FramePool* pool = sm ? sm->getFramePool() : 0;
+      return allocate(size, pool);
+    }
+
+    /** Allocate the frame of any other coroutine from the heap. */
+    static void* operator new(size_t size) { return allocate(size, 0); }
+
+    /** Reclaim the frame. */
+    static void operator delete(void* p, size_t size) {
+      char* block = (char*)p-FRAME_HEADER_SIZE;
+      FramePool* pool = *(FramePool**)block;
+      if(pool) pool->release(block, size+FRAME_HEADER_SIZE);
+      else ::operator delete(block);
+    }
+
+   private:
+    friend class SocketTask;
+
+    /** Size of the header in front of each frame, which keeps the frames aligned. */
+    enum { FRAME_HEADER_SIZE = __STDCPP_DEFAULT_NEW_ALIGNMENT__ };
+
+    static void* allocate(size_t size, FramePool* pool) {
+      char* block = (char*)(pool ? pool->allocate(size+FRAME_HEADER_SIZE) :
+			    ::operator new(size+FRAME_HEADER_SIZE));
+      *(FramePool**)block = pool;
+      return block+FRAME_HEADER_SIZE;
+    }
+
+    int result; ///< the value returned by the coroutine
+    bool detached; ///< true if the task was started with start()
+    std::coroutine_handle<> continuation; ///< the coroutine awaiting the task
+  };
+
+  /** A task is moved, never copied. */
+  SocketTask(SocketTask&& t) : handle(t.handle) { t.handle = nullptr; }
+
+  /** The destructor reclaims the frame of a task that has not been started. */
+  ~SocketTask() { if(handle) handle.destroy(); }
+
+  /** Run the task on its own; the task reclaims its frame when it returns. */
+  void start() {
+    std::coroutine_handle<promise_type> h = handle;
+    handle = nullptr;
+    h.promise().detached = true;
+    h.resume();
+  }
+
+  /** Awaiting a task runs it and returns its return value. */
+  struct Awaiter {
+    std::coroutine_handle<promise_type> handle;
+    bool await_ready() { return false; }
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> h) {
+      handle.promise().continuation = h;
+      return handle;
+    }
+    int await_resume() { return handle.promise().result; }
+  };
+  Awaiter operator co_await() && { return Awaiter{handle}; }
+
+ private:
+  explicit SocketTask(std::coroutine_handle<promise_type> h) : handle(h) {}
+  SocketTask(const SocketTask&);
+  SocketTask& operator=(const SocketTask&);
+
+  std::coroutine_handle<promise_type> handle;
+};
+
+/**
+ * \brief A blocking socket call being awaited.
+ *
+ * The awaiter is the continuation passed to the socket master. It is
+ * a temporary of the co_await expression and therefore lives in the
+ * frame of the awaiting coroutine. The socket master may complete the
+ * call before returning, in which case the coroutine is not suspended
+ * at all.
+ */
+class SocketAwaiter : public BSocketContinuation {
+ public:
+  /** The socket calls that can be awaited. */
+  enum { CONNECT, ACCEPT, SEND, RECV, CLOSE };
+
+  SocketAwaiter(ProtocolSession* sess, SocketMaster* master, int sock, int call,
+		IPADDR ip = 0, uint16 port = 0, uint32 length = 0, byte* buffer = 0) :
+    BSocketContinuation(sess), sm(master), sockid(sock), op(call),
+    peer_ip(ip), peer_port(port), nbytes(length), buf(buffer),
+    completed(false), failed(false), suspended(false) {}
+
+  virtual const char* getType() { return "SocketAwaiter"; }
+
+  bool await_ready() { return false; }
+
+  bool await_suspend(std::coroutine_handle<> h) {
+    handle = h;
+    switch(op) {
+    case CONNECT: sm->connect(sockid, peer_ip, peer_port, this); break;
+    case ACCEPT: sm->accept(sockid, true, this, 0); break;
+    case SEND: sm->send(sockid, nbytes, buf, this); break;
+    case RECV: sm->recv(sockid, nbytes, buf, this); break;
+    case CLOSE: sm->close(sockid, this); break;
+    }
+    if(completed) return false; // completed immediately, no need to suspend
+    suspended = true;
+    return true;
+  }
+
+  /** Return the return value of the call, or -1 if the call failed. */
+  int await_resume() { return failed ? -1 : retval; }
+
+  virtual void success() { complete(); }
+  virtual void failure() { failed = true; complete(); }
+
+ private:
+  void complete() {
+    completed = true;
+    if(suspended) handle.resume();
+  }
+
+  SocketMaster* sm;
+  int sockid;
+  int op;
+  IPADDR peer_ip;
+  uint16 peer_port;
+  uint32 nbytes;
+  byte* buf;
+  bool completed; ///< the call has completed
+  bool failed;    ///< the call has failed
+  bool suspended; ///< the coroutine has been suspended for the call
+  std::coroutine_handle<> handle;
+};
+
+/**
+ * \brief A socket used from a socket coroutine.
+ *
+ * The blocking calls (connect, accept, send, recv and close) are awaited and
+ * return what the success() method of a continuation would have found
+ * in its return value, or -1 where failure() would have been called.
+ */
+class CoSocket {
+ public:
+  /**
+   * The constructor; the socket belongs to the given protocol session.
+   * The socket is created by bind, unless the id of a socket already
+   * created (e.g. returned by accept) is given.
+   */
+  CoSocket(ProtocolSession* sess, int sock = -1) : owner(sess), sockid(sock) {
+    sm = (SocketMaster*)sess->inHost()->sessionForNumber(S3FNET_PROTOCOL_TYPE_SOCKET);
+    if(!sm) error_quit("ERROR: CoSocket, missing socket master on host \"%s\".\n",
+		       sess->inHost()->nhi.toString());
+  }
+
+  /** Create the socket and bind it (see SocketMaster::bind). */
+  bool bind(IPADDR ip, uint16 port, char* protocol, uint32 options = 0) {
+    sockid = sm->socket();
+    return sm->bind(sockid, ip, port, protocol, options);
+  }
+
+  /** Connect to the given destination. */
+  SocketAwaiter connect(IPADDR ip, uint16 port) {
+    return SocketAwaiter(owner, sm, sockid, SocketAwaiter::CONNECT, ip, port);
+  }
+
+  /**
+   * Wait for a connection on the bound socket; return the id of a new
+   * socket for the connection (see SocketMaster::accept), to be used
+   * with CoSocket(sess, sock).
+   */
+  SocketAwaiter accept() {
+    return SocketAwaiter(owner, sm, sockid, SocketAwaiter::ACCEPT);
+  }
+
+  /** Send the given number of bytes; msg may be NULL (see SocketMaster::send). */
+  SocketAwaiter send(uint32 length, byte* msg) {
+    return SocketAwaiter(owner, sm, sockid, SocketAwaiter::SEND, 0, 0, length, msg);
+  }
+
+  /** Receive up to the given number of bytes (see SocketMaster::recv). */
+  SocketAwaiter recv(uint32 bufsiz, byte* buffer) {
+    return SocketAwaiter(owner, sm, sockid, SocketAwaiter::RECV, 0, 0, bufsiz, buffer);
+  }
+
+  /** Close the connection. */
+  SocketAwaiter close() {
+    return SocketAwaiter(owner, sm, sockid, SocketAwaiter::CLOSE);
+  }
+
+  /** Reset the connection; a pending call fails. */
+  void abort() { sm->abort(sockid); }
+
+  /** Return the socket id. */
+  int id() { return sockid; }
+
+ private:
+  ProtocolSession* owner;
+  SocketMaster* sm;
+  int sockid;
+};
+
+/**
+ * Receive exactly the given number of bytes into buf, with as many
+ * receive calls as it takes, since a receive may return fewer bytes
+ * than asked for. Return 0, or -1 if a receive failed (e.g. the
+ * connection was closed or aborted) before all the bytes arrived.
+ */
+SocketTask co_recv_all(ProtocolSession& sess, CoSocket& sock, uint32 length, byte* buf);
+
+class CoTimerActivation;
+
+/**
+ * \brief A timer for socket coroutines.
+ *
+ * The timer is an S3F process of the host with a single activation
+ * that is reused every time the timer is set, so setting the timer
+ * allocates nothing. A coroutine can sleep on the timer (co_await
+ * timer.sleep(t)), or the timer can be set to call a function when it
+ * expires, for instance to abort a socket that takes too long.
+ */
+class CoTimer {
+ public:
+  /** The constructor; the timer belongs to the given protocol session. */
+  CoTimer(ProtocolSession* sess);
+
+  /** The destructor. */
+  ~CoTimer();
+
+  /** Awaiting a sleep suspends the coroutine for the given time. */
+  struct SleepAwaiter {
+    CoTimer* timer;
+    ltime_t delay;
+    bool await_ready() { return false; }
+    void await_suspend(std::coroutine_handle<> h) { timer->waiter = h; timer->set(delay); }
+    void await_resume() {}
+  };
+
+  /** Sleep for the given time. */
+  SleepAwaiter sleep(ltime_t delay) { return SleepAwaiter{this, delay}; }
+
+  /** Set the timer to call fn(arg) when it expires after the given time. */
+  void start(ltime_t delay, void (*fn)(void*), void* arg);
+
+  /** Cancel the timer if it is set. */
+  void cancel();
+
+  /** Return true if the timer is set. */
+  bool isRunning() { return pending != 0; }
+
+  /** The callback of the timer process. */
+  void callback(Activation ac);
+
+ private:
+  /** Schedule the timer process. */
+  void set(ltime_t delay);
+
+  /** Cancel the scheduled event of the timer process, if any. */
+  void unschedule();
+
+  ProtocolSession* owner;
+  Process* proc;                  ///< the timer process
+  CoTimerActivation* activation;  ///< the activation of the timer process
+  HandleCode pending;             ///< the scheduled event, 0 if none
+  std::coroutine_handle<> waiter; ///< the coroutine sleeping on the timer
+  void (*expire_fn)(void*);       ///< the function called on expiration
+  void* expire_arg;
+};
+
+}; // namespace s3fnet
+}; // namespace s3f
+
+#endif /*__CO_SOCKET_H__*/
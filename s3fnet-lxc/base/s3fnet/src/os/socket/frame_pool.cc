@@ -0,0 +1,80 @@
+/**
+ * \file frame_pool.cc
+ * \brief Source file for the FramePool class.
+ *
+ * authors : Dong (Kevin) Jin
+ */
+
+#include <new>
+#include "os/socket/frame_pool.h"
+
+namespace s3f {
+namespace s3fnet {
+
+#define FRAME_POOL_CLASSES (FRAME_POOL_MAX_SIZE/FRAME_POOL_GRANULARITY)
+
+// the size class of a block of the given size (which must not exceed
+// FRAME_POOL_MAX_SIZE)
+static inline int size_class(size_t size)
+{
+  return size ? (int)((size-1)/FRAME_POOL_GRANULARITY) : 0;
+}
+
+FramePool::FramePool() : nallocs(0), nheap(0), nlive(0)
+{
+  for(int i=0; i<FRAME_POOL_CLASSES; i++) free_lists[i] = 0;
+}
+
+FramePool::~FramePool()
+{
+  for(int i=0; i<FRAME_POOL_CLASSES; i++)
+  {
+    while(free_lists[i])
+    {
+      FreeFrame* f = free_lists[i];
+      free_lists[i] = f->next;
+      ::operator delete((void*)f);
+    }
+  }
+}
+
+void* FramePool::allocate(size_t size)
+{
+  nallocs++; nlive++;
+  if(size > FRAME_POOL_MAX_SIZE)
+  {
+    nheap++;
+    return ::operator new(size);
+  }
+
+  int c = size_class(size);
+  FreeFrame* f = free_lists[c];
+  if(f)
+  {
+    free_lists[c] = f->next;
+    return (void*)f;
+  }
+
+  // the block is rounded up to its class, so that it can be reused by
+  // any frame of the same class
+  nheap++;
+  return ::operator new((c+1)*FRAME_POOL_GRANULARITY);
+}
+
+void FramePool::release(void* p, size_t size)
+{
+  nlive--;
+  if(size > FRAME_POOL_MAX_SIZE)
+  {
+    ::operator delete(p);
+    return;
+  }
+
+  int c = size_class(size);
+  FreeFrame* f = (FreeFrame*)p;
+  f->next = free_lists[c];
+  free_lists[c] = f;
+}
+
+}; // namespace s3fnet
+}; // namespace s3f
@@ -0,0 +1,74 @@
+/**
+ * \file frame_pool.h
+ * \brief Header file for the FramePool class.
+ *
+ * authors : Dong (Kevin) Jin
+ */
+
+#ifndef __FRAME_POOL_H__
+#define __FRAME_POOL_H__
+
+#include <stddef.h>
+#include "s3fnet.h"
+
+namespace s3f {
+namespace s3fnet {
+
+/** Size classes of the frame pool are multiples of this many bytes. */
+#define FRAME_POOL_GRANULARITY 64
+
+/** Blocks larger than this many bytes bypass the frame pool. */
+#define FRAME_POOL_MAX_SIZE 4096
+
+/**
+ * \brief Pool of coroutine frames.
+ *
+ * Each host keeps one frame pool (in its socket master) from which
+ * the frames of the socket coroutines running on the host are
+ * allocated. Released frames are kept on a free list per size class
+ * and handed out again to the next coroutine of the same size, so an
+ * application that runs the same coroutine for each request does not
+ * go to the heap after the first one. All the coroutines of a host
+ * run on the timeline of the host, so the pool needs no locking.
+ */
+class FramePool {
+ public:
+  /** The constructor. */
+  FramePool();
+
+  /** The destructor returns the free blocks to the heap. */
+  ~FramePool();
+
+  /** Return a block of at least the given number of bytes. */
+  void* allocate(size_t size);
+
+  /** Return a block obtained from allocate() with the same size to the pool. */
+  void release(void* p, size_t size);
+
+  /** Return the number of blocks handed out by the pool. */
+  uint64 getAllocations() { return nallocs; }
+
+  /** Return the number of blocks that had to be taken from the heap. */
+  uint64 getHeapAllocations() { return nheap; }
+
+  /** Return the number of blocks currently in use. */
+  uint64 getLiveFrames() { return nlive; }
+
+ private:
+  /** A free block; the link lives in the block itself. */
+  struct FreeFrame {
+    FreeFrame* next;
+  };
+
+  /** Free lists, one for each size class. */
+  FreeFrame* free_lists[FRAME_POOL_MAX_SIZE/FRAME_POOL_GRANULARITY];
+
+  uint64 nallocs; ///< blocks handed out
+  uint64 nheap;   ///< blocks taken from the heap
+  uint64 nlive;   ///< blocks in use
+};
+
+}; // namespace s3fnet
+}; // namespace s3f
+
+#endif /*__FRAME_POOL_H__*/
@@ -227,6 +227,12 @@ bool NBSocketMaster::bind(int sock, IPADDR src_ip, uint16 src_port, char* protoc
       mysocket->release();
       return false;
     }
+
+    // set how the data sent over the socket is carried
+    if(options & SOCK_OPT_PAYLOAD_SIZE_ONLY)
+      mysocket->session->setPayloadMode(SocketSession::PAYLOAD_SIZE_ONLY);
+    else if(options & SOCK_OPT_PAYLOAD_SHARED)
+      mysocket->session->setPayloadMode(SocketSession::PAYLOAD_SHARED);
       
     // move from unbound to bound socket list
     unbound_socks.erase(setiter);
@@ -579,6 +585,7 @@ int NBSocketMaster::accept(int sock, bool make_new_socket, NBSocketContinuation
         caller->failure();
         return EGENERIC;
       }
+      session->setPayloadMode(mysocket->session->getPayloadMode());
       
       int new_sock = socket(); // unbound at first
       Socket* new_mysocket = new Socket();
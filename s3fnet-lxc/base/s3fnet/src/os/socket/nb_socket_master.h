@@ -17,7 +17,7 @@ namespace s3fnet {
 
 // get the socket protocol session; must be called within the protocol
 // session class
-#define SOCKET_API ((NBSocketMaster*)(inHost()->sessionForName(SOCKET_PROTOCOL_NAME)))
+#define SOCKET_API ((NBSocketMaster*)(inHost()->sessionForNumber(S3FNET_PROTOCOL_TYPE_SOCKET)))
 
 class NBSocketMaster;
 
@@ -9,6 +9,7 @@
 #include "util/errhandle.h"
 #include "net/host.h"
 #include "os/base/protocols.h"
+#include "net/checkpoint.h"
 
 
 #ifdef SOCK_DEBUG
@@ -22,6 +23,15 @@ namespace s3fnet {
 
 S3FNET_REGISTER_PROTOCOL(SocketMaster, "S3F.OS.Socket.socketMaster");
 
+// number of entries in SocketMaster::blocked_stages
+#define SOCK_BLOCKED_STAGES 8
+
+void (SocketMaster::*const SocketMaster::blocked_stages[])(int, BSocketContinuation*) = {
+  &SocketMaster::connect1, &SocketMaster::accept1a, &SocketMaster::accept1b,
+  &SocketMaster::accept2a, &SocketMaster::accept2b, &SocketMaster::send1,
+  &SocketMaster::recv1, &SocketMaster::close1
+};
+
 SocketMaster::SocketMaster(ProtocolGraph* graph) : ProtocolSession(graph), new_sockid(0)
 {
   SOCK_DUMP(printf("[host=\"%s\"] new socket master session.\n", inHost()->nhi.toString()));
@@ -147,6 +157,153 @@ int SocketMaster::control(int ctrltyp, void* ctrlmsg, ProtocolSession* sess)
   else return ProtocolSession::control(ctrltyp, ctrlmsg, sess);
 }
 
+bool SocketMaster::save_state(Checkpoint* ckpt)
+{
+  ckpt->put(new_sockid);
+  uint32 n = unbound_socks.size();
+  ckpt->put(n);
+  for(SOCK_SET::iterator iter = unbound_socks.begin(); iter != unbound_socks.end(); iter++)
+    ckpt->put(*iter);
+
+  n = bound_socks.size();
+  ckpt->put(n);
+  for(SOCK_MAP::iterator iter = bound_socks.begin(); iter != bound_socks.end(); iter++)
+  {
+    int sock = (*iter).first;
+    Socket* mysocket = (*iter).second;
+    ckpt->put(sock);
+    ckpt->put(mysocket->state);
+    ckpt->put(mysocket->mask);
+    ckpt->put(mysocket->bytes_completed);
+    ckpt->put(mysocket->resume);
+    ckpt->put(mysocket->active_counter);
+
+    // the session itself is saved by its protocol session master,
+    // which must find it again by the socket id
+    int master = -1;
+    if(mysocket->session)
+    {
+      SessionMaster* sessmaster = mysocket->session->getSessionMaster();
+      if(sessmaster->findSession(sock) != mysocket->session)
+      {
+	error_retn("WARNING: [host=\"%s\"] SocketMaster::save_state(), the session of socket %d "
+		   "can't be saved by protocol session %s.\n", inHost()->nhi.toString(), sock, sessmaster->name);
+	return false;
+      }
+      master = inHost()->sessionIndex(sessmaster);
+    }
+    ckpt->put(master);
+
+    // a continuation is blocked on the socket as long as the mask is
+    // set; otherwise the continuation pointer is stale
+    bool blocked = (mysocket->mask != 0);
+    ckpt->put(blocked);
+    if(!blocked) continue;
+
+    BSocketContinuation* caller = (BSocketContinuation*)mysocket->continuation;
+    int stage = 0;
+    while(stage < SOCK_BLOCKED_STAGES && blocked_stages[stage] != caller->next_stage) stage++;
+    assert(stage < SOCK_BLOCKED_STAGES);
+    int owner = inHost()->sessionIndex(caller->owner);
+    ckpt->put(stage);
+    ckpt->put(caller->retval);
+    ckpt->put(owner);
+    if(owner < 0 || caller->chain_continuation || !caller->owner->save_continuation(ckpt, caller))
+    {
+      error_retn("WARNING: [host=\"%s\"] SocketMaster::save_state(), the continuation blocked on "
+		 "socket %d can't be saved by protocol session %s (%s).\n", inHost()->nhi.toString(),
+		 sock, caller->owner->name, caller->owner->use);
+      return false;
+    }
+  }
+  return true;
+}
+
+void SocketMaster::restore_state(Checkpoint* ckpt)
+{
+  if(!bound_socks.empty() || !unbound_socks.empty())
+    error_quit("ERROR: [host=\"%s\"] SocketMaster::restore_state(), sockets have been opened "
+	       "before the checkpoint is restored.\n", inHost()->nhi.toString());
+
+  ckpt->get(new_sockid);
+  uint32 n;
+  ckpt->get(n);
+  for(uint32 i=0; i<n; i++)
+  {
+    int sock;
+    ckpt->get(sock);
+    unbound_socks.insert(sock);
+  }
+
+  ckpt->get(n);
+  for(uint32 i=0; i<n; i++)
+  {
+    int sock;
+    ckpt->get(sock);
+    Socket* mysocket = new Socket();
+    assert(mysocket);
+    ckpt->get(mysocket->state);
+    ckpt->get(mysocket->mask);
+    ckpt->get(mysocket->bytes_completed);
+    ckpt->get(mysocket->resume);
+    ckpt->get(mysocket->active_counter);
+    bound_socks.insert(S3FNET_MAKE_PAIR(sock, mysocket));
+
+    int master;
+    ckpt->get(master);
+    if(master >= 0)
+    {
+      SessionMaster* sessmaster = (SessionMaster*)inHost()->sessionForIndex(master);
+      if(!sessmaster)
+	error_quit("ERROR: [host=\"%s\"] SocketMaster::restore_state(), unknown protocol session "
+		   "master of socket %d.\n", inHost()->nhi.toString(), sock);
+      restored_masters.insert(S3FNET_MAKE_PAIR(sock, sessmaster));
+    }
+
+    bool blocked;
+    ckpt->get(blocked);
+    if(!blocked) continue;
+
+    int stage, retval, owner;
+    ckpt->get(stage);
+    ckpt->get(retval);
+    ckpt->get(owner);
+    ProtocolSession* owner_sess = inHost()->sessionForIndex(owner);
+    if(stage < 0 || stage >= SOCK_BLOCKED_STAGES || !owner_sess)
+      error_quit("ERROR: [host=\"%s\"] SocketMaster::restore_state(), invalid continuation "
+		 "blocked on socket %d.\n", inHost()->nhi.toString(), sock);
+    BSocketContinuation* caller = (BSocketContinuation*)owner_sess->restore_continuation(ckpt, sock);
+    if(!caller)
+      error_quit("ERROR: [host=\"%s\"] SocketMaster::restore_state(), protocol session %s (%s) "
+		 "can't restore the continuation blocked on socket %d.\n", inHost()->nhi.toString(),
+		 owner_sess->name, owner_sess->use, sock);
+    caller->next_stage = blocked_stages[stage];
+    caller->retval = retval;
+    mysocket->continuation = caller;
+  }
+}
+
+void SocketMaster::restore_links()
+{
+  for(S3FNET_MAP(int, SessionMaster*)::iterator iter = restored_masters.begin();
+      iter != restored_masters.end(); iter++)
+  {
+    int sock = (*iter).first;
+    Socket* mysocket = bound_socks[sock];
+    mysocket->session = (*iter).second->findSession(sock);
+    if(!mysocket->session)
+      error_quit("ERROR: [host=\"%s\"] SocketMaster::restore_links(), protocol session %s "
+		 "has not restored the session of socket %d.\n", inHost()->nhi.toString(),
+		 (*iter).second->name, sock);
+
+    // a receive in progress writes into the buffer of the continuation
+    BSocketContinuation* caller = (BSocketContinuation*)mysocket->continuation;
+    if(mysocket->mask && caller->next_stage == &SocketMaster::recv1)
+      mysocket->session->restoreRecvBuffer(caller->recvBuffer());
+  }
+  restored_masters.clear();
+}
+
 int SocketMaster::push(Activation msg, ProtocolSession* hi_sess, void* extinfo, size_t extinfo_size)
 {
   error_quit("ERROR: SocketMaster::push() should not be called.\n");
@@ -216,6 +373,12 @@ bool SocketMaster::bind(int sock, IPADDR src_ip, uint16 src_port, char* protocol
       mysocket->release();
       return false;
     }
+
+    // set how the data sent over the socket is carried
+    if(options & SOCK_OPT_PAYLOAD_SIZE_ONLY)
+      mysocket->session->setPayloadMode(SocketSession::PAYLOAD_SIZE_ONLY);
+    else if(options & SOCK_OPT_PAYLOAD_SHARED)
+      mysocket->session->setPayloadMode(SocketSession::PAYLOAD_SHARED);
       
     // move from unbound to bound socket list
     unbound_socks.erase(setiter);
@@ -574,6 +737,7 @@ void SocketMaster::accept2a(int sock, BSocketContinuation* caller)
     caller->failure();
     return;
   }
+  session->setPayloadMode(mysocket->session->getPayloadMode());
   
   int new_sock = socket(); // unbound at first
   Socket* new_mysocket = new Socket();
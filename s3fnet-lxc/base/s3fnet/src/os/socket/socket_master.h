@@ -9,6 +9,7 @@
 #define __SOCKET_MASTER_H__
 
 #include "os/socket/socket_session.h"
+#include "os/socket/frame_pool.h"
 #include "os/base/protocol_session.h"
 #include "util/shstl.h"
 
@@ -17,7 +18,7 @@ namespace s3fnet {
 
 // get the socket protocol session; must be called within the protocol
 // session class
-#define SOCKET_API ((SocketMaster*)(inHost()->sessionForName(SOCKET_PROTOCOL_NAME)))
+#define SOCKET_API ((SocketMaster*)(inHost()->sessionForNumber(S3FNET_PROTOCOL_TYPE_SOCKET)))
 
 class SocketMaster;
 
@@ -52,6 +53,14 @@ class BSocketContinuation : public SocketContinuation {
   * SocketMaster class.
   */
   void (SocketMaster::*next_stage)(int, BSocketContinuation*);
+
+  /**
+  * Returns the buffer of the receive the continuation waits for.
+  * Used to link the buffer again when the continuation is restored
+  * from a checkpoint; the default is NULL (no real bytes).
+  * @return the receive buffer
+  */
+  virtual byte* recvBuffer() { return 0; }
 };
 
 /**
@@ -87,6 +96,15 @@ class SocketMaster : public ProtocolSession
   /** Control messages are passed through this function. */
   virtual int control(int ctrltyp, void* ctrlmsg, ProtocolSession* sess);
 
+  /** Save the sockets and the continuations blocked on them to a checkpoint. */
+  virtual bool save_state(Checkpoint* ckpt);
+
+  /** Restore the sockets and the continuations from a checkpoint. */
+  virtual void restore_state(Checkpoint* ckpt);
+
+  /** Link the restored sockets to the sessions of the protocol session masters. */
+  virtual void restore_links();
+
   virtual const char* psesstype() { return "BLOCKING_SOCKET"; } // DEBUG
 
   //
@@ -229,6 +247,12 @@ class SocketMaster : public ProtocolSession
    */
   void close(int sock, BSocketContinuation *caller);
 
+  /**
+   * Return the pool from which the frames of the socket coroutines
+   * running on this host are allocated (see co_socket.h).
+   */
+  FramePool* getFramePool() { return &frame_pool; }
+
  private:
   // these function are continuations of the method in the standard socket interface
   /** continuations of the method connect1() in the standard socket interface */
@@ -260,6 +284,10 @@ class SocketMaster : public ProtocolSession
    */
   void block_till(int sockid, uint32 mask, bool anysignal, BSocketContinuation* caller);
 
+  /** The stages a continuation can be blocked in; a checkpoint saves
+      the index of the stage in this table. */
+  static void (SocketMaster::*const blocked_stages[])(int, BSocketContinuation*);
+
  protected: 
   /** The next available socket id. */
   int new_sockid;
@@ -273,6 +301,13 @@ class SocketMaster : public ProtocolSession
   /** A set of unbound socket ids. */
   SOCK_SET unbound_socks;
 
+  /** The pool of coroutine frames of this host. */
+  FramePool frame_pool;
+
+  /** The protocol session masters of the sockets being restored from
+      a checkpoint, until they are linked by restore_links(). */
+  S3FNET_MAP(int, SessionMaster*) restored_masters;
+
  private:
   /**
    * Push to lower protocol layer.
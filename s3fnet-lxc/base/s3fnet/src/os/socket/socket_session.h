@@ -164,6 +164,14 @@ struct SessionCmp {
   }
 };
 
+/** Socket option flag accepted by bind(): the data sent over the
+    socket is simulated by size only. */
+#define SOCK_OPT_PAYLOAD_SIZE_ONLY 0x00000001
+
+/** Socket option flag accepted by bind(): the data sent over the
+    socket is copied once and shared by all packets carrying it. */
+#define SOCK_OPT_PAYLOAD_SHARED    0x00000002
+
 /**
  * \brief The socket session.
  *
@@ -173,9 +181,19 @@ struct SessionCmp {
  */
 class SocketSession : public SessionID {
  public:
+  /**
+   * How the application data passed to send() is carried down the
+   * protocol stack.
+   */
+  enum {
+    PAYLOAD_REAL      = 0, /**< real bytes are copied into each packet */
+    PAYLOAD_SIZE_ONLY = 1, /**< only the size is simulated; the bytes are ignored */
+    PAYLOAD_SHARED    = 2  /**< bytes are copied once; packets view slices of them */
+  };
+
   /** The constructor. */
   SocketSession(uint32 proto=0, IPADDR srcip=0,  uint16 srcport=0, IPADDR destip=0, uint16 destport=0) :
-    SessionID(proto, srcip, srcport, destip, destport) {}
+    SessionID(proto, srcip, srcport, destip, destport), payload_mode(PAYLOAD_REAL) {}
 
   /** The destructor. */
   virtual ~SocketSession() {}
@@ -275,6 +293,24 @@ class SocketSession : public SessionID {
   * Must be implemented by deriving class (pure virtual).
   */
   virtual void release() = 0;
+
+  /** Set how the data sent over this session is carried. */
+  void setPayloadMode(int mode) { payload_mode = mode; }
+
+  /** Return how the data sent over this session is carried. */
+  int getPayloadMode() { return payload_mode; }
+
+  /**
+   * Set the application buffer of the receive in progress again,
+   * once restored from a checkpoint (the buffer, owned by the
+   * application, is created again). The default is doing nothing.
+   * @param buf the buffer to receive data into
+   */
+  virtual void restoreRecvBuffer(byte* buf) {}
+
+ protected:
+  /** One of PAYLOAD_REAL, PAYLOAD_SIZE_ONLY and PAYLOAD_SHARED. */
+  int payload_mode;
 };
 
 /**
@@ -325,6 +361,7 @@ class SocketSignal {
  * connection.
  */
 class Socket {
+  friend class SocketMaster;
  public:
   /**
   * State of socket
@@ -474,6 +511,13 @@ class SessionMaster : public ProtocolSession {
   /** Create a socket session of a given socket id. */
   virtual SocketSession* createSession(int sock) = 0;
 
+  /**
+   * Return the socket session of the given socket id, or NULL if
+   * there is none; it links the sockets restored from a checkpoint
+   * to the sessions restored by the protocol session master.
+   */
+  virtual SocketSession* findSession(int sock) { return 0; }
+
  protected:
   /** The constructor. */
   SessionMaster(ProtocolGraph* graph) : ProtocolSession(graph), sock_master(0) {}
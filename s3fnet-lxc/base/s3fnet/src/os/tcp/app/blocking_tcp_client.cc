@@ -329,6 +329,7 @@ void BTCPClientSession::main_proc(int sample_off_time, ltime_t lead_time)
 
   Host* owner_host = inHost();
   start_timer_callback_proc = new Process( (Entity *)owner_host, (void (s3f::Entity::*)(s3f::Activation))&BTCPClientSession::start_timer_callback);
+  start_timer_callback_proc->set_name("BTCPClientSession::start_timer_callback");
   start_timer_ac = new ProtocolCallbackActivation(this);
   Activation ac (start_timer_ac);
   HandleCode h = owner_host->waitFor( start_timer_callback_proc, ac, t, owner_host->tie_breaking_seed );
@@ -390,6 +391,7 @@ void BTCPClientSession::server_connected(BTCPClientSessionContinuation* const cn
   Host* owner_host = inHost();
   cnt->user_timer_callback_proc =
 		  new Process( (Entity *)owner_host, (void (s3f::Entity::*)(s3f::Activation))&BTCPClientSessionContinuation::user_timer_callback);
+  cnt->user_timer_callback_proc->set_name("BTCPClientSessionContinuation::user_timer_callback");
   cnt->user_timer_ac = new BTCPClientSessionCallbackActivation(this, cnt);
   Activation ac (cnt->user_timer_ac);
   cnt->user_timer = inHost()->waitFor( cnt->user_timer_callback_proc, ac, user_timeout, inHost()->tie_breaking_seed );
@@ -481,7 +483,7 @@ bool BTCPClientSession::get_random_server(IPADDR& server_ip, uint16& server_port
   }
 
   int sidx = (int)floor(getRandom()->Uniform(0, 1) * servers.size());
-  server_ip = host->inNet()->getNameService()->nhi2ip(servers[sidx]->nhi->toStlString());
+  server_ip = host->inNet()->getNameService()->nhi2ip(*servers[sidx]->nhi);
   server_port = servers[sidx]->port;
 
   if(server_ip == IPADDR_INVALID)
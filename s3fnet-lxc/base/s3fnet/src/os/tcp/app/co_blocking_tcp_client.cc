@@ -0,0 +1,22 @@
+/**
+ * \file co_blocking_tcp_client.cc
+ * \brief Source file for the CoBTCPClientSession class.
+ *
+ * authors : Dong (Kevin) Jin
+ */
+
+#include "os/tcp/app/co_blocking_tcp_client.h"
+#include "os/base/protocols.h"
+
+namespace s3f {
+namespace s3fnet {
+
+S3FNET_REGISTER_PROTOCOL(CoBTCPClientSession, "S3F.OS.TCP.test.CoBTCPClient");
+
+CoBTCPClientSession::CoBTCPClientSession(ProtocolGraph* graph) : CoTCPClientSession(graph)
+{
+  send_request = false;
+}
+
+}; // namespace s3fnet
+}; // namespace s3f
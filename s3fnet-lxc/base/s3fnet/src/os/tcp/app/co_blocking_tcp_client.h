@@ -0,0 +1,39 @@
+/**
+ * \file co_blocking_tcp_client.h
+ * \brief Header file for the CoBTCPClientSession class.
+ *
+ * authors : Dong (Kevin) Jin
+ */
+
+#ifndef __CO_BTCP_CLIENT_H__
+#define __CO_BTCP_CLIENT_H__
+
+#include "os/tcp/app/co_tcp_client.h"
+
+namespace s3f {
+namespace s3fnet {
+
+/**
+ * \brief The blocking TCP client test protocol session, written with socket coroutines.
+ *
+ * The coroutine counterpart of BTCPClientSession: the same client as
+ * CoTCPClientSession, without the request phase. It connects to a
+ * server (such as nb_tcp_server) and receives the file size configured
+ * in DML, which must be the same with the client and the server.
+ */
+class CoBTCPClientSession: public CoTCPClientSession {
+ public:
+  /** The constructor. */
+  CoBTCPClientSession(ProtocolGraph* graph);
+
+  /**
+   * Return the protocol number.
+   * @return Protocol number for the coroutine blocking tcp client
+   */
+  virtual int getProtocolNumber() { return S3FNET_PROTOCOL_TYPE_TCPTEST_CO_BLOCKING_CLIENT; }
+};
+
+}; // namespace s3fnet
+}; // namespace s3f
+
+#endif /*__CO_BTCP_CLIENT_H__*/
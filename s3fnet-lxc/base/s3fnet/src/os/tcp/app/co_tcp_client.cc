@@ -0,0 +1,411 @@
+/**
+ * \file co_tcp_client.cc
+ * \brief Source file for the CoTCPClientSession class.
+ *
+ * authors : Dong (Kevin) Jin
+ */
+
+#include <netinet/in.h>
+#include "os/tcp/app/co_tcp_client.h"
+#include "os/base/protocols.h"
+#include "util/errhandle.h"
+#include "net/host.h"
+#include "net/net.h"
+#include "net/traffic.h"
+#include "env/namesvc.h"
+
+#ifdef TCP_DEBUG
+#define CO_DUMP(x) printf("COCLT: "); x
+#else
+#define CO_DUMP(x)
+#endif
+
+#define DEFAULT_CLIENT_PORT   2048
+
+namespace s3f {
+namespace s3fnet {
+
+S3FNET_REGISTER_PROTOCOL(CoTCPClientSession, "S3F.OS.TCP.test.CoTCPClient");
+
+CoTCPClientSession::CoTCPClientSession(ProtocolGraph* graph) :
+  ProtocolSession(graph), transport(TCP_PROTOCOL_NAME), transport_name("TCP"),
+  send_request(true), nsess(0), server_ip(0), server_port(0), reqbuf(0), off_timer(0), user_timer(0)
+{
+  CO_DUMP(printf("[host=\"%s\"] new coroutine client session.\n", inHost()->nhi.toString()));
+}
+
+CoTCPClientSession::~CoTCPClientSession()
+{
+  if(off_timer) delete off_timer;
+  if(user_timer) delete user_timer;
+  if(reqbuf) delete[] reqbuf;
+}
+
+void CoTCPClientSession::config(s3f::dml::Configuration *cfg)
+{
+  ProtocolSession::config(cfg);
+
+  char* str = (char*)cfg->findSingle("start_time");
+  if(str)
+  {
+    if(s3f::dml::dmlConfig::isConf(str))
+      error_quit("ERROR: CoTCPClientSession::config(), invalid START_TIME attribute.\n");
+    start_time_double = atof(str);
+  }
+  else start_time_double = 0;
+  start_time = inHost()->d2t(start_time_double, 0);
+
+  str = (char*)cfg->findSingle("start_window");
+  if(str)
+  {
+    if(s3f::dml::dmlConfig::isConf(str))
+      error_quit("ERROR: CoTCPClientSession::config(), invalid START_WINDOW attribute.\n");
+    start_window_double = atof(str);
+  }
+  else
+	start_window_double = 0;
+  start_window = inHost()->d2t(start_window_double);
+
+  double user_timeout_double;
+  str = (char*)cfg->findSingle("user_timeout");
+  if(str)
+  {
+    if(s3f::dml::dmlConfig::isConf(str))
+      error_quit("ERROR: CoTCPClientSession::config(), invalid USER_TIMEOUT attribute.\n");
+    user_timeout_double = atof(str);
+  }
+  else user_timeout_double = 100; //default is 100 s
+  user_timeout = inHost()->d2t(user_timeout_double, 0);
+
+  str = (char*)cfg->findSingle("off_time");
+  if(!str || s3f::dml::dmlConfig::isConf(str))
+    error_quit("ERROR: CoTCPClientSession::config(), missing or invalid OFF_TIME attribute.\n");
+  off_time_double = atof(str);
+  off_time = inHost()->d2t(off_time_double, 0);
+
+  str = (char*)cfg->findSingle("off_time_run_first");
+  if(str)
+  {
+    if(s3f::dml::dmlConfig::isConf(str))
+      error_quit("ERROR: CoTCPClientSession::config(), invalid OFF_TIME_RUN_FIRST attribute.\n");
+    if(!strcasecmp(str, "true")) off_time_run_first = true;
+    else off_time_run_first = false;
+  }
+  else off_time_run_first = false;
+
+  str = (char*)cfg->findSingle("off_time_exponential");
+  if(str)
+  {
+    if(s3f::dml::dmlConfig::isConf(str))
+      error_quit("ERROR: CoTCPClientSession::config(), invalid OFF_TIME_EXPONENTIAL attribute.\n");
+    if(!strcasecmp(str, "true")) off_time_exponential = true;
+    else off_time_exponential = false;
+  }
+  else off_time_exponential = false;
+
+  str = (char*)cfg->findSingle("fixed_server");
+  if(str)
+  {
+    if(s3f::dml::dmlConfig::isConf(str))
+      error_quit("ERROR: CoTCPClientSession::config(), invalid FIXED_SERVER attribute.\n");
+    if(!strcasecmp(str, "true")) fixed_server = true;
+    else fixed_server = false;
+  }
+  else fixed_server = false;
+
+  str = (char*)cfg->findSingle("request_size");
+  if(str)
+  {
+    if(s3f::dml::dmlConfig::isConf(str))
+      error_quit("ERROR: CoTCPClientSession::config(), invalid REQUEST_SIZE attribute.\n");
+    request_size = atoi(str);
+    if(request_size < sizeof(uint32))
+      error_quit("ERROR: CoTCPClientSession::config(), REQUEST_SIZE must be larger than 4 (bytes).\n");
+  }
+  else request_size = sizeof(uint32);
+
+  str = (char*)cfg->findSingle("file_size");
+  if(!str || s3f::dml::dmlConfig::isConf(str))
+    error_quit("ERROR: CoTCPClientSession::config(), missing or invalid FILE_SIZE attribute.\n");
+  file_size = atoi(str);
+
+  str = (char*)cfg->findSingle("payload");
+  if(str)
+  {
+    if(s3f::dml::dmlConfig::isConf(str))
+      error_quit("ERROR: CoTCPClientSession::config(), invalid PAYLOAD attribute.\n");
+    if(!strcasecmp(str, "real")) payload_options = 0;
+    else if(!strcasecmp(str, "shared")) payload_options = SOCK_OPT_PAYLOAD_SHARED;
+    else if(!strcasecmp(str, "size_only")) payload_options = SOCK_OPT_PAYLOAD_SIZE_ONLY;
+    else error_quit("ERROR: CoTCPClientSession::config(), invalid PAYLOAD attribute (%s).\n", str);
+  }
+  else payload_options = 0;
+
+  str = (char*)cfg->findSingle("client_port");
+  if(str)
+  {
+    if(s3f::dml::dmlConfig::isConf(str))
+      error_quit("ERROR: CoTCPClientSession::config(), invalid CLIENT_PORT attribute.\n");
+    start_port = atoi(str);
+  }
+  else start_port = DEFAULT_CLIENT_PORT;
+
+  str = (char*)cfg->findSingle("server_list");
+  if(str)
+  {
+    if(s3f::dml::dmlConfig::isConf(str))
+      error_quit("ERROR: CoTCPClientSession::config(), invalid SERVER_LIST attribute.\n");
+    server_list = str;
+  }
+  else server_list = S3FNET_STRING("for")+transport_name;
+
+  str = (char*)cfg->findSingle("SHOW_REPORT");
+  if(str)
+  {
+    if(s3f::dml::dmlConfig::isConf(str))
+      error_quit("ERROR: CoTCPClientSession::config(), invalid SHOW_REPORT attribute.\n");
+    if(!strcasecmp(str, "true")) show_report = true;
+    else if(!strcasecmp(str, "false")) show_report = false;
+    else error_quit("ERROR: CoTCPClientSession::config(), invalid SHOW_REPORT attribute (%s).\n", str);
+  }
+  else show_report = true;
+
+  CO_DUMP(printf("[host=\"%s\"] config():\n"
+		  "  start_time=%ld, start_window=%ld, user_timeout=%ld, off_time=%ld,\n"
+		  "  off_time_run_first=%d, off_time_exponential=%d, fixed_server=%d,\n"
+		  "  request_size=%u, file_size=%u, start_port=%u.\n",
+		  inHost()->nhi.toString(), start_time, start_window, user_timeout,
+		  off_time, off_time_run_first, off_time_exponential, fixed_server,
+		  request_size, file_size, start_port));
+}
+
+void CoTCPClientSession::init()
+{
+  ProtocolSession::init();
+
+  client_ip = inHost()->getDefaultIP();
+  if(IPADDR_INVALID == client_ip)
+    error_quit("ERROR: CoTCPClientSession::init(), invalid IP address, the host's not connected to network.\n");
+
+  if(!inHost()->sessionForNumber(S3FNET_PROTOCOL_TYPE_SOCKET))
+    error_quit("CoTCPClientSession::init(), missing socket master on host \"%s\".\n", inHost()->nhi.toString());
+
+  CO_DUMP(printf("[host=\"%s\"] init(), client_ip=\"%s\".\n",
+		 inHost()->nhi.toString(), IPPrefix::ip2txt(client_ip)));
+
+  // we send real bytes to the server, unless only the sizes are
+  // simulated, in which case the server uses its own file size; the
+  // request is the same for all sessions
+  if(send_request && !(payload_options & SOCK_OPT_PAYLOAD_SIZE_ONLY))
+  {
+    reqbuf = new byte[request_size];
+    memset(reqbuf, 0, request_size);
+    *(uint32*)reqbuf = htonl(file_size);
+  }
+
+  off_timer = new CoTimer(this);
+  user_timer = new CoTimer(this);
+
+  // get new start time and wait
+  if(start_window > 0)
+  {
+    start_time_double += getRandom()->Uniform(0, 1)*start_window_double;
+    start_time = inHost()->d2t(start_time_double, 0);
+  }
+  CO_DUMP(printf("[host=\"%s\"] %s: run(), starting client until %ld.\n",
+		 inHost()->nhi.toString(), getNowWithThousandSeparator(), start_time));
+
+  run().start();
+}
+
+SocketTask CoTCPClientSession::run()
+{
+  bool sample_off_time = off_time_run_first;
+  ltime_t t = start_time;
+
+  // if fixed_server is true, the client connects with the same server
+  // for the whole simulation; the server is chosen randomly from
+  // dml traffic description
+  bool choose_server = true;
+
+  for(;;)
+  {
+    // check whether off time starts first
+    if(sample_off_time)
+    {
+      if(off_time == 0)
+      {
+	CO_DUMP(printf("[host=\"%s\"] %s: run(), OFF (forever).\n",
+		       inHost()->nhi.toString(), getNowWithThousandSeparator()));
+	co_return 0;
+      }
+
+      double vt_double;
+      if(off_time_exponential)
+	vt_double = getRandom()->Exponential(1.0/off_time_double);
+      else
+	vt_double = off_time_double;
+      ltime_t vt = inHost()->d2t(vt_double, 0);
+      t += vt;
+
+      CO_DUMP(printf("[host=\"%s\"] %s: run(), OFF (duration=%ld).\n",
+		     inHost()->nhi.toString(), getNowWithThousandSeparator(), vt));
+    }
+    co_await off_timer->sleep(t);
+
+    if(choose_server)
+    {
+      if(!get_random_server(server_ip, server_port))
+	co_return 0; // stop if something's wrong
+      choose_server = !fixed_server;
+    }
+
+    CO_DUMP(printf("[host=\"%s\"] %s: run(), ON.\n",
+		   inHost()->nhi.toString(), getNowWithThousandSeparator()));
+    if(co_await transfer() < 0) co_return 0;
+
+    sample_off_time = true;
+    t = 0;
+  }
+}
+
+SocketTask CoTCPClientSession::transfer()
+{
+  nsess++;
+
+  CoSocket sock(this);
+  if(!sock.bind(IPADDR_INADDR_ANY/*client_ip*/, start_port++, transport, payload_options))
+  {
+    CO_DUMP(printf("transfer() on host \"%s\": failed to bind.\n", inHost()->nhi.toString()));
+    co_return -1;
+  }
+  ltime_t session_start = getNow();
+
+  CO_DUMP(printf("[host=\"%s\"] %s: transfer(), socket %d connecting to server: \"%s:%d\".\n",
+		 inHost()->nhi.toString(), getNowWithThousandSeparator(), sock.id(),
+		 IPPrefix::ip2txt(server_ip), server_port));
+  if(co_await sock.connect(server_ip, server_port) < 0)
+  {
+    CO_DUMP(printf("transfer() on host \"%s\": failed to connect to server.\n", inHost()->nhi.toString()));
+    co_return -1;
+  }
+
+  if(send_request)
+  {
+    CO_DUMP(printf("[host=\"%s\"] %s: transfer(), socket %d sending request "
+		   "(request_size=%u, file_size=%u).\n",
+		   inHost()->nhi.toString(), getNowWithThousandSeparator(),
+		   sock.id(), request_size, file_size));
+    if(co_await sock.send(request_size, reqbuf) < 0)
+    {
+      CO_DUMP(printf("transfer() on host \"%s\": failed to send request to server.\n", inHost()->nhi.toString()));
+      co_return -1;
+    }
+  }
+
+  // time out if the file transfer takes too long
+  user_timer->start(user_timeout, &CoTCPClientSession::timeout, &sock);
+
+  uint32 rcvd_bytes = 0;
+  while(rcvd_bytes < file_size)
+  {
+    int n = co_await sock.recv(file_size-rcvd_bytes, 0);
+    if(n < 0)
+    {
+      CO_DUMP(printf("transfer() on host \"%s\": failed to receive data.\n", inHost()->nhi.toString()));
+
+      // if the timer is still running, the failed receive is not due
+      // to time out; we cancel the timer and abort the socket
+      if(user_timer->isRunning())
+      {
+	user_timer->cancel();
+	sock.abort();
+      }
+      co_return 0;
+    }
+    rcvd_bytes += n;
+
+    CO_DUMP(printf("[host=\"%s\"] %s: transfer(), socket %d received %d bytes (%d bytes left).\n",
+		   inHost()->nhi.toString(), getNowWithThousandSeparator(),
+		   sock.id(), n, file_size-rcvd_bytes));
+  }
+
+  if(show_report)
+  {
+    char buf1[50]; char buf2[50];
+    double total_time = inHost()->t2d(getNow() - session_start, 0);
+    printf("%s: %s client \"%s\" downloaded %d bytes from server \"%s\", throughput %f Kb/s.\n",
+	   getNowWithThousandSeparator(), transport_name, IPPrefix::ip2txt(client_ip, buf1), file_size,
+	   IPPrefix::ip2txt(server_ip, buf2), (8e-3*file_size/total_time));
+  }
+  user_timer->cancel();
+
+  // waiting for closing the connection
+  if(co_await sock.close() < 0)
+  {
+    CO_DUMP(printf("transfer() on host \"%s\": failed to close connection.\n", inHost()->nhi.toString()));
+    co_return -1;
+  }
+
+  CO_DUMP(printf("[host=\"%s\"] %s: transfer(), socket %d connection closed.\n",
+		 inHost()->nhi.toString(), getNowWithThousandSeparator(), sock.id()));
+  co_return 0;
+}
+
+void CoTCPClientSession::timeout(void* sock)
+{
+  ((CoSocket*)sock)->abort();
+}
+
+int CoTCPClientSession::push(Activation msg, ProtocolSession* hi_sess, void* extinfo, size_t extinfo_size)
+{
+  error_quit("ERROR: CoTCPClientSession::push() should not be called.\n");
+  return 1;
+}
+
+int CoTCPClientSession::pop(Activation msg, ProtocolSession* lo_sess, void* extinfo, size_t extinfo_size)
+{
+  error_quit("ERROR: CoTCPClientSession::pop() should not be called.\n");
+  return 1;
+}
+
+bool CoTCPClientSession::get_random_server(IPADDR& server_ip, uint16& server_port)
+{
+  Traffic* traffic = 0;
+  Host* host = inHost();
+
+  /*printf("CoTCPClientSession::get_random_server(), now = %s, before inNet()->control, ctrl_msg = %d\n",
+		  getNowWithThousandSeparator(), NET_CTRL_GET_TRAFFIC);*/
+
+  host->inNet()->control(NET_CTRL_GET_TRAFFIC, (void*)&traffic);
+  if(!traffic) return false;
+
+  S3FNET_VECTOR(TrafficServerData*) servers;
+  if(!traffic->getServers(host, servers, server_list.c_str()) || servers.size() == 0)
+  {
+    if(show_report)
+      printf("WARNING: [host=\"%s\"] %s: get_random_server(), found no server for %s.\n",
+	     inHost()->nhi.toString(), getNowWithThousandSeparator(), server_list.c_str());
+    return false;
+  }
+
+  int sidx = (int)floor(getRandom()->Uniform(0, 1) * servers.size());
+  server_ip = host->inNet()->getNameService()->nhi2ip(*servers[sidx]->nhi);
+  server_port = servers[sidx]->port;
+
+  if(server_ip == IPADDR_INVALID)
+  {
+    if(show_report)
+      printf("WARNING: [host=\"%s\"] %s: get_random_server(), unresolved server for \"%s\": %s:%d.\n",
+	     inHost()->nhi.toString(), getNowWithThousandSeparator(), server_list.c_str(),
+	     IPPrefix::ip2txt(server_ip), server_port);
+    return false;
+  }
+
+  CO_DUMP(printf("[host=\"%s\"] %s: get_random_server(), selected server: \"%s:%d\".\n",
+		  inHost()->nhi.toString(), getNowWithThousandSeparator(), IPPrefix::ip2txt(server_ip), server_port));
+  return true;
+}
+
+}; // namespace s3fnet
+}; // namespace s3f
@@ -0,0 +1,135 @@
+/**
+ * \file co_tcp_client.h
+ * \brief Header file for the CoTCPClientSession class.
+ *
+ * authors : Dong (Kevin) Jin
+ */
+
+#ifndef __CO_TCP_CLIENT_H__
+#define __CO_TCP_CLIENT_H__
+
+#include "os/base/protocol_session.h"
+#include "os/socket/co_socket.h"
+#include "net/ip_prefix.h"
+#include "util/shstl.h"
+
+namespace s3f {
+namespace s3fnet {
+
+/**
+ * \brief The TCP client test protocol session, written with socket coroutines.
+ *
+ * The protocol behaves exactly as the TCP client test protocol
+ * (TCPClientSession) and takes the same DML attributes: it waits for
+ * a period of time before it randomly selects a TCP server and
+ * retrieves a number of bytes from the server, and repeats until
+ * simulation ends. Instead of a continuation and a timer process per
+ * request, the client runs as one socket coroutine which sleeps on a
+ * reusable timer and awaits a coroutine for each request; the frames
+ * of the coroutines come from the frame pool of the host, so that
+ * requests after the first allocate no memory in the client.
+ */
+class CoTCPClientSession: public ProtocolSession {
+ public:
+  /** The constructor. */
+  CoTCPClientSession(ProtocolGraph* graph);
+
+  /** The destructor. */
+  virtual ~CoTCPClientSession();
+
+  /** Configure the client test protocol session. */
+  virtual void config(s3f::dml::Configuration *cfg);
+
+  /**
+   * Return the protocol number.
+   * @return Protocol number for the coroutine tcp client
+   */
+  virtual int getProtocolNumber() { return S3FNET_PROTOCOL_TYPE_TCPTEST_CO_CLIENT; }
+
+  /** Initialize this protocol session. */
+  virtual void init();
+
+ protected:
+  /** The main loop of the client: off time, then a request, over and over. */
+  SocketTask run();
+
+  /**
+   * One request: connect to the server, send the request and receive
+   * the file. Return 0 to continue with the next request, or -1 if the
+   * client should stop.
+   */
+  SocketTask transfer();
+
+  /**
+   * Get a server ip and port randomly from traffic description
+   * @param server_ip the server IP address
+   * @param server_port the server port
+   * @return False if failed
+   */
+  bool get_random_server(IPADDR& server_ip, uint16& server_port);
+
+  /** Called by the user timer if the file transfer takes too long. */
+  static void timeout(void* sock);
+
+  /**
+  * Push message to lower protocol layer.
+  * This method should not be called; it is provided here to prompt
+  * an error message if it's called accidentally.
+  */
+  virtual int push(Activation msg, ProtocolSession* hi_sess, void* extinfo = 0, size_t extinfo_size = 0);
+
+  /**
+  * Pop message to higher protocol layer.
+  * This method should not be called; it is provided here to prompt
+  * an error message if it's called accidentally.
+  */
+  virtual int pop(Activation msg, ProtocolSession* lo_sess, void* extinfo = 0, size_t extinfo_size = 0);
+
+  /** Multiple instances of this protocol are allowed on the same protocol stack. */
+  virtual int instantiation_type() { return PROT_MULTIPLE_INSTANCES; }
+
+  /** The transport protocol used by the client (tcp or udp). */
+  char* transport;
+
+  /** The name of the transport protocol in the report. */
+  const char* transport_name;
+
+  /**
+   * Whether the client sends a request before receiving the file; if
+   * not, the server must be configured with the same file size.
+   */
+  bool send_request;
+
+ private:
+  // configurable parameters, as in TCPClientSession
+  ltime_t start_time;          ///< time before a session starts
+  double start_time_double;    ///< time before a session starts, in seconds
+  ltime_t start_window;        ///< size of random window before session starts
+  double start_window_double;  ///< size of random window, in seconds
+  ltime_t user_timeout;        ///< timeout before aborting a session
+  ltime_t off_time;            ///< off time between sessions
+  double off_time_double;      ///< off time between sessions, in seconds
+  bool off_time_run_first;     ///< whether 1st session starts with an off time
+  bool off_time_exponential;   ///< constant or exponential off time
+  bool fixed_server;           ///< whether to use the same server all along
+  uint32 request_size;         ///< size of the request sent to the server
+  uint32 file_size;            ///< size of the file to be sent from the server
+  uint32 payload_options;      ///< socket options for the payload of the request
+  uint16 start_port;           ///< the starting port number for client sessions
+  S3FNET_STRING server_list;   ///< traffic server list name
+  bool show_report;            ///< whether we print out the result or not
+
+  // state variables
+  IPADDR client_ip;            ///< the ip address of the client (interface 0)
+  uint32 nsess;                ///< number of sessions initiated by this client
+  IPADDR server_ip;            ///< server ip address of the current connection
+  uint16 server_port;          ///< server port number of the current connection
+  byte* reqbuf;                ///< the request, reused by all sessions
+  CoTimer* off_timer;          ///< the timer for the off time
+  CoTimer* user_timer;         ///< the timer aborting a transfer that takes too long
+};
+
+}; // namespace s3fnet
+}; // namespace s3f
+
+#endif /*__CO_TCP_CLIENT_H__*/
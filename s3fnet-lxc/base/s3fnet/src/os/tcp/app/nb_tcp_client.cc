@@ -163,7 +163,7 @@ bool NBTCPClientSession::get_random_server(IPADDR& server_ip, uint16& server_por
   }
 
   int sidx = (int)floor(getRandom()->Uniform(0, 1) * servers.size());
-  server_ip = host->inNet()->getNameService()->nhi2ip(servers[sidx]->nhi->toStlString());
+  server_ip = host->inNet()->getNameService()->nhi2ip(*servers[sidx]->nhi);
   server_port = servers[sidx]->port;
 
   if(server_ip == IPADDR_INVALID)
@@ -308,6 +308,7 @@ void NBTCPClientSession::init()
 
   Host* owner_host = inHost();
   start_timer_callback_proc = new Process( (Entity *)owner_host, (void (s3f::Entity::*)(s3f::Activation))&NBTCPClientSession::start_timer_callback);
+  start_timer_callback_proc->set_name("NBTCPClientSession::start_timer_callback");
   start_timer_ac = new ProtocolCallbackActivation(this);
   Activation ac (start_timer_ac);
   HandleCode h = inHost()->waitFor( start_timer_callback_proc, ac, 0, inHost()->tie_breaking_seed ); //currently the starting time is 0
@@ -334,6 +334,7 @@ void NBTCPServerSession::init()
 
   Host* owner_host = inHost();
   start_timer_callback_proc = new Process( (Entity *)owner_host, (void (s3f::Entity::*)(s3f::Activation))&NBTCPServerSession::start_timer_callback);
+  start_timer_callback_proc->set_name("NBTCPServerSession::start_timer_callback");
   start_timer_ac = new ProtocolCallbackActivation(this);
   Activation ac (start_timer_ac);
   HandleCode h = inHost()->waitFor( start_timer_callback_proc, ac, 0, inHost()->tie_breaking_seed ); //currently the starting time is 0
@@ -14,6 +14,7 @@
 #include "net/net.h"
 #include "net/traffic.h"
 #include "env/namesvc.h"
+#include "net/checkpoint.h"
 
 #ifdef TCP_DEBUG
 #define TCP_DUMP(x) printf("TCPCLT: "); x
@@ -43,7 +44,7 @@ class TCPClientSessionContinuation : public BSocketContinuation {
   TCPClientSessionContinuation(TCPClientSession* client, int sock, ltime_t startime) :
     BSocketContinuation(client), socket(sock),
     status(TCP_CLIENT_SESSION_UNITIALIZED),
-    start_time(startime), user_timer(0) {}
+    start_time(startime), rcvd_bytes(0), user_timer(0), user_timer_time(0) {}
 
   virtual ~TCPClientSessionContinuation() {}
 
@@ -105,6 +106,7 @@ class TCPClientSessionContinuation : public BSocketContinuation {
     	HandlePtr hptr(new Handle(user_timer)); //todo not sure isRunning is needed or not
     	hptr->cancel();
     	user_timer = 0;
+    	client->timed_continuations.erase(this);
 
     	client->sm->abort(socket);
       }
@@ -136,6 +138,7 @@ class TCPClientSessionContinuation : public BSocketContinuation {
   {
 	//TCPClientSession* client = (TCPClientSession*)((TCPClientSessionCallbackActivation*)ac)->session;
 	TCPClientSessionContinuation* cnt = (TCPClientSessionContinuation*)((TCPClientSessionCallbackActivation*)ac)->cnt;
+	((TCPClientSession*)cnt->owner)->timed_continuations.erase(cnt);
 	cnt->timeout(); // will reclaim this timer and the continuation
   }
 
@@ -145,12 +148,14 @@ class TCPClientSessionContinuation : public BSocketContinuation {
   ltime_t start_time; // the start time of the client session
   uint32 rcvd_bytes; // total bytes received so far
   HandleCode user_timer; // user timer for off time
+  ltime_t user_timer_time; // when the user timer expires
   Process* user_timer_callback_proc;
   TCPClientSessionCallbackActivation* user_timer_ac;
 };
 
 TCPClientSession::TCPClientSession(ProtocolGraph* graph) :
-  ProtocolSession(graph), nsess(0), start_timer_ac(0), start_timer_callback_proc(0), server_ip(0), server_port(0)
+  ProtocolSession(graph), nsess(0), start_timer_ac(0), start_timer_callback_proc(0), server_ip(0), server_port(0),
+  start_timer_pending(false), start_timer_time(0)
 {
   TCP_DUMP(printf("[host=\"%s\"] new tcp client session.\n", inHost()->nhi.toString()));
 }
@@ -245,6 +250,18 @@ void TCPClientSession::config(s3f::dml::Configuration *cfg)
     error_quit("ERROR: TCPClientSession::config(), missing or invalid FILE_SIZE attribute.\n");
   file_size = atoi(str);
 
+  str = (char*)cfg->findSingle("payload");
+  if(str)
+  {
+    if(s3f::dml::dmlConfig::isConf(str))
+      error_quit("ERROR: TCPClientSession::config(), invalid PAYLOAD attribute.\n");
+    if(!strcasecmp(str, "real")) payload_options = 0;
+    else if(!strcasecmp(str, "shared")) payload_options = SOCK_OPT_PAYLOAD_SHARED;
+    else if(!strcasecmp(str, "size_only")) payload_options = SOCK_OPT_PAYLOAD_SIZE_ONLY;
+    else error_quit("ERROR: TCPClientSession::config(), invalid PAYLOAD attribute (%s).\n", str);
+  }
+  else payload_options = 0;
+
   str = (char*)cfg->findSingle("client_port");
   if(str)
   {
@@ -340,11 +357,32 @@ void TCPClientSession::main_proc(int sample_off_time, ltime_t lead_time)
     }
   }
 
+  wait_start(t);
+}
+
+void TCPClientSession::wait_start(ltime_t delay)
+{
   Host* owner_host = inHost();
   start_timer_callback_proc = new Process( (Entity *)owner_host, (void (s3f::Entity::*)(s3f::Activation))&TCPClientSession::start_timer_callback);
+  start_timer_callback_proc->set_name("TCPClientSession::start_timer_callback");
   start_timer_ac = new ProtocolCallbackActivation(this);
   Activation ac (start_timer_ac);
-  HandleCode h = owner_host->waitFor( start_timer_callback_proc, ac, t, owner_host->tie_breaking_seed );
+  HandleCode h = owner_host->waitFor( start_timer_callback_proc, ac, delay, owner_host->tie_breaking_seed );
+  start_timer_pending = true;
+  start_timer_time = getNow() + delay;
+}
+
+void TCPClientSession::wait_user_timeout(TCPClientSessionContinuation* const cnt, ltime_t delay)
+{
+  Host* owner_host = inHost();
+  cnt->user_timer_callback_proc =
+		  new Process( (Entity *)owner_host, (void (s3f::Entity::*)(s3f::Activation))&TCPClientSessionContinuation::user_timer_callback);
+  cnt->user_timer_callback_proc->set_name("TCPClientSessionContinuation::user_timer_callback");
+  cnt->user_timer_ac = new TCPClientSessionCallbackActivation(this, cnt);
+  Activation ac (cnt->user_timer_ac);
+  cnt->user_timer = owner_host->waitFor( cnt->user_timer_callback_proc, ac, delay, owner_host->tie_breaking_seed );
+  cnt->user_timer_time = getNow() + delay;
+  timed_continuations.insert(cnt);
 }
 
 void TCPClientSession::start_once()
@@ -376,7 +414,7 @@ void TCPClientSession::start_on()
   nsess++;
 
   int sock = sm->socket();
-  if(!sm->bind(sock, IPADDR_INADDR_ANY/*client_ip*/, start_port++, TCP_PROTOCOL_NAME, 0))
+  if(!sm->bind(sock, IPADDR_INADDR_ANY/*client_ip*/, start_port++, TCP_PROTOCOL_NAME, payload_options))
   {
     TCP_DUMP(printf("start_on() on host \"%s\": failed to bind.\n", inHost()->nhi.toString()));
     return;
@@ -399,15 +437,20 @@ void TCPClientSession::server_connected(TCPClientSessionContinuation* const cnt)
 		  inHost()->nhi.toString(), getNowWithThousandSeparator(),
 		  cnt->socket, request_size, file_size));
 
-  // we send real bytes to the server
-  byte* reqbuf = new byte[request_size];
-  *(uint32*)reqbuf = htonl(file_size);
+  // we send real bytes to the server, unless only the sizes are
+  // simulated, in which case the server uses its own file size
+  byte* reqbuf = 0;
+  if(!(payload_options & SOCK_OPT_PAYLOAD_SIZE_ONLY))
+  {
+    reqbuf = new byte[request_size];
+    *(uint32*)reqbuf = htonl(file_size);
+  }
 
   // sending out data request
   cnt->status = TCPClientSessionContinuation::TCP_CLIENT_SESSION_REQUESTING;
   sm->send(cnt->socket, request_size, reqbuf, cnt);
 
-  delete[] reqbuf;
+  if(reqbuf) delete[] reqbuf;
 }
 
 void TCPClientSession::request_sent(TCPClientSessionContinuation* const cnt)
@@ -416,12 +459,7 @@ void TCPClientSession::request_sent(TCPClientSessionContinuation* const cnt)
 		  inHost()->nhi.toString(), getNowWithThousandSeparator(), cnt->socket));
 
   // time out if the file transfer takes too long
-  Host* owner_host = inHost();
-  cnt->user_timer_callback_proc =
-		  new Process( (Entity *)owner_host, (void (s3f::Entity::*)(s3f::Activation))&TCPClientSessionContinuation::user_timer_callback);
-  cnt->user_timer_ac = new TCPClientSessionCallbackActivation(this, cnt);
-  Activation ac (cnt->user_timer_ac);
-  cnt->user_timer = inHost()->waitFor( cnt->user_timer_callback_proc, ac, user_timeout, inHost()->tie_breaking_seed );
+  wait_user_timeout(cnt, user_timeout);
 
   cnt->rcvd_bytes = 0;
   if(cnt->rcvd_bytes < file_size)
@@ -461,6 +499,7 @@ void TCPClientSession::data_received(TCPClientSessionContinuation* const cnt)
   HandlePtr hptr(new Handle(cnt->user_timer));
   hptr->cancel();
   cnt->user_timer = 0;
+  timed_continuations.erase(cnt);
 
   // waiting for closing tcp connection.
   cnt->status = TCPClientSessionContinuation::TCP_CLIENT_SESSION_CLOSING;
@@ -476,6 +515,69 @@ void TCPClientSession::session_closed(TCPClientSessionContinuation* const cnt)
   // the continuation will be reclaimed after this
 }
 
+bool TCPClientSession::save_state(Checkpoint* ckpt)
+{
+  ckpt->put(nsess);
+  ckpt->put(start_port);
+  ckpt->put(server_ip);
+  ckpt->put(server_port);
+  ckpt->put(start_timer_called_once);
+  ckpt->put(start_timer_pending);
+  if(start_timer_pending) ckpt->put(start_timer_time);
+  return true;
+}
+
+void TCPClientSession::restore_state(Checkpoint* ckpt)
+{
+  ckpt->get(nsess);
+  ckpt->get(start_port);
+  ckpt->get(server_ip);
+  ckpt->get(server_port);
+  ckpt->get(start_timer_called_once);
+  ckpt->get(start_timer_pending);
+  if(start_timer_pending)
+  {
+    ckpt->get(start_timer_time);
+    ltime_t now = getNow();
+    wait_start((start_timer_time > now) ? start_timer_time-now : 0);
+  }
+}
+
+bool TCPClientSession::save_continuation(Checkpoint* ckpt, SocketContinuation* sc)
+{
+  TCPClientSessionContinuation* cnt = (TCPClientSessionContinuation*)sc;
+  ckpt->put(cnt->socket);
+  ckpt->put(cnt->status);
+  ckpt->put(cnt->start_time);
+  ckpt->put(cnt->rcvd_bytes);
+  bool timed = (timed_continuations.find(cnt) != timed_continuations.end());
+  ckpt->put(timed);
+  if(timed) ckpt->put(cnt->user_timer_time);
+  return true;
+}
+
+SocketContinuation* TCPClientSession::restore_continuation(Checkpoint* ckpt, int sock)
+{
+  int socket, status;
+  ltime_t start;
+  ckpt->get(socket);
+  ckpt->get(status);
+  ckpt->get(start);
+  TCPClientSessionContinuation* cnt = new TCPClientSessionContinuation(this, socket, start);
+  cnt->status = status;
+  ckpt->get(cnt->rcvd_bytes);
+  bool timed;
+  ckpt->get(timed);
+  if(timed)
+  {
+    ltime_t t;
+    ckpt->get(t);
+    ltime_t now = getNow();
+    wait_user_timeout(cnt, (t > now) ? t-now : 0);
+  }
+  return cnt;
+}
+
 int TCPClientSession::push(Activation msg, ProtocolSession* hi_sess, void* extinfo, size_t extinfo_size)
 {
   error_quit("ERROR: TCPClientSession::push() should not be called.\n");
@@ -509,7 +611,7 @@ bool TCPClientSession::get_random_server(IPADDR& server_ip, uint16& server_port)
   }
 
   int sidx = (int)floor(getRandom()->Uniform(0, 1) * servers.size());
-  server_ip = host->inNet()->getNameService()->nhi2ip(servers[sidx]->nhi->toStlString());
+  server_ip = host->inNet()->getNameService()->nhi2ip(*servers[sidx]->nhi);
   server_port = servers[sidx]->port;
 
   if(server_ip == IPADDR_INVALID)
@@ -536,6 +638,7 @@ void TCPClientSession::timeout(int sock)
 void TCPClientSession::start_timer_callback(Activation ac)
 {
   TCPClientSession* client = (TCPClientSession*)((ProtocolCallbackActivation*)ac)->session;
+  client->start_timer_pending = false;
   if(client->start_timer_called_once == true)
   {
 	  client->start_on();
@@ -76,11 +76,30 @@ class TCPClientSession: public ProtocolSession {
   /** check if start_once() is called */
   bool start_timer_called_once;
 
+  /** Save the state of the client to a checkpoint. */
+  virtual bool save_state(Checkpoint* ckpt);
+
+  /** Restore the state of the client from a checkpoint. */
+  virtual void restore_state(Checkpoint* ckpt);
+
+  /** The start timer and the user timers of the sessions are saved. */
+  virtual int saved_timeouts() { return (start_timer_pending ? 1 : 0) + timed_continuations.size(); }
+
+  /** Save a session of the client blocked on a socket. */
+  virtual bool save_continuation(Checkpoint* ckpt, SocketContinuation* cnt);
+
+  /** Restore a session of the client blocked on a socket. */
+  virtual SocketContinuation* restore_continuation(Checkpoint* ckpt, int sock);
+
  protected:
   // functions representing different stages
 
   /** the first function to call for starting a communication at client side */
   void main_proc(int sample_off_time, ltime_t lead_time);
+  /** schedule the start timer after the given delay */
+  void wait_start(ltime_t delay);
+  /** schedule the user timer of a session after the given delay */
+  void wait_user_timeout(TCPClientSessionContinuation* const cnt, ltime_t delay);
 
   /** first time to choose the fixed TCP server if the DML specifies to use fixed server */
   void start_once();
@@ -197,6 +216,12 @@ class TCPClientSession: public ProtocolSession {
   */
   uint32 file_size;
 
+  /**
+  * Socket options selecting how the request is carried (PAYLOAD
+  * attribute: real, shared or size_only).
+  */
+  uint32 payload_options;
+
   /**
   * The starting port number for client sessions.
   */
@@ -238,6 +263,18 @@ class TCPClientSession: public ProtocolSession {
   * Server port number of the current connection.
   */
   uint16 server_port;
+  /**
+  * Whether the start timer is pending.
+  */
+  bool start_timer_pending;
+  /**
+  * When the pending start timer expires.
+  */
+  ltime_t start_timer_time;
+  /**
+  * The sessions whose user timer is pending.
+  */
+  S3FNET_SET(TCPClientSessionContinuation*) timed_continuations;
 };
 
 /**
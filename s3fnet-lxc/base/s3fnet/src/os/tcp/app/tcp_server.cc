@@ -12,6 +12,7 @@
 #include "net/host.h"
 #include "net/network_interface.h"
 #include "os/base/protocols.h"
+#include "net/checkpoint.h"
 
 
 #ifdef TCP_DEBUG
@@ -44,6 +45,7 @@ class TCPServerSessionContinuation : public BSocketContinuation {
     status(TCP_SERVER_SESSION_UNITIALIZED) {
     reqbuf = new byte[server->request_size];
     assert(reqbuf);
+    memset(reqbuf, 0, server->request_size);
   }
 
   /** the destrcutor */
@@ -51,6 +53,11 @@ class TCPServerSessionContinuation : public BSocketContinuation {
     delete[] reqbuf;
   }
 
+  /** The request is received into the request buffer. */
+  virtual byte* recvBuffer() {
+    return (status == TCP_SERVER_SESSION_RECEIVING) ? reqbuf : 0;
+  }
+
   /** When a continuation returns successfully, this function will be
      called. Based on the current status of this continuation, we will
      decide what to do next. */
@@ -140,7 +147,8 @@ class TCPServerSessionContinuation : public BSocketContinuation {
 };
 
 TCPServerSession::TCPServerSession(ProtocolGraph* graph) :
-  ProtocolSession(graph), accept_completed(true), start_timer_ac(0), start_timer_callback_proc(0)
+  ProtocolSession(graph), accept_completed(true), start_timer_ac(0), start_timer_callback_proc(0),
+  start_timer_pending(false)
 {
   TCP_DUMP(printf("[host=\"%s\"] new tcp server session.\n", inHost()->nhi.toString()));
 }
@@ -171,6 +179,32 @@ void TCPServerSession::config(s3f::dml::Configuration *cfg)
   }
   else request_size = sizeof(uint32);
 
+  str = (char*)cfg->findSingle("file_size");
+  if(str)
+  {
+    if(s3f::dml::dmlConfig::isConf(str))
+      error_quit("ERROR: TCPServerSession::config(), invalid FILE_SIZE attribute.\n");
+    default_file_size = atoi(str);
+  }
+  else default_file_size = 0;
+
+  str = (char*)cfg->findSingle("payload");
+  if(str)
+  {
+    if(s3f::dml::dmlConfig::isConf(str))
+      error_quit("ERROR: TCPServerSession::config(), invalid PAYLOAD attribute.\n");
+    if(!strcasecmp(str, "real")) payload_options = 0;
+    else if(!strcasecmp(str, "shared")) payload_options = SOCK_OPT_PAYLOAD_SHARED;
+    else if(!strcasecmp(str, "size_only")) payload_options = SOCK_OPT_PAYLOAD_SIZE_ONLY;
+    else error_quit("ERROR: TCPServerSession::config(), invalid PAYLOAD attribute (%s).\n", str);
+  }
+  else payload_options = 0;
+
+  // the requests of size-only clients carry no file size; the server
+  // would send nothing and the clients would wait forever
+  if((payload_options & SOCK_OPT_PAYLOAD_SIZE_ONLY) && !default_file_size)
+    error_quit("ERROR: TCPServerSession::config(), missing FILE_SIZE attribute, required if PAYLOAD is size_only.\n");
+
   str = (char*)cfg->findSingle("client_limit");
   if(str)
   {
@@ -214,11 +248,18 @@ void TCPServerSession::init()
   TCP_DUMP(printf("[host=\"%s\"] init(), server_ip=\"%s\".\n",
 		  inHost()->nhi.toString(), IPPrefix::ip2txt(server_ip)));
 
+  wait_start(0); //currently the starting time is 0
+}
+
+void TCPServerSession::wait_start(ltime_t delay)
+{
   Host* owner_host = inHost();
   start_timer_callback_proc = new Process( (Entity *)owner_host, (void (s3f::Entity::*)(s3f::Activation))&TCPServerSession::start_timer_callback);
+  start_timer_callback_proc->set_name("TCPServerSession::start_timer_callback");
   start_timer_ac = new ProtocolCallbackActivation(this);
   Activation ac (start_timer_ac);
-  HandleCode h = inHost()->waitFor( start_timer_callback_proc, ac, 0, inHost()->tie_breaking_seed ); //currently the starting time is 0
+  HandleCode h = owner_host->waitFor( start_timer_callback_proc, ac, delay, owner_host->tie_breaking_seed );
+  start_timer_pending = true;
 }
 
 void TCPServerSession::start_on()
@@ -231,7 +272,7 @@ void TCPServerSession::start_on()
 	  accept_completed = false;
 
 	  int ssock = sm->socket();
-	  if(!sm->bind(ssock, IPADDR_ANYDEST, server_port, TCP_PROTOCOL_NAME, 0))
+	  if(!sm->bind(ssock, IPADDR_ANYDEST, server_port, TCP_PROTOCOL_NAME, payload_options))
 	  {
 	    TCP_DUMP(printf("session_proc() on host \"%s\": failed to bind.\n",
 			    inHost()->nhi.toString()));
@@ -275,6 +316,14 @@ void TCPServerSession::request_received(TCPServerSessionContinuation* const cnt)
   assert(cnt->retval == (int)request_size);
 
   cnt->file_size = ntohl(*(uint32*)cnt->reqbuf);
+  if(cnt->file_size == 0) // no real data in the request
+  {
+    if(!default_file_size)
+      error_quit("ERROR: TCPServerSession::request_received(), the request on host \"%s\" "
+		 "carries no file size (from a size-only client?) and FILE_SIZE is not set.\n",
+		 inHost()->nhi.toString());
+    cnt->file_size = default_file_size;
+  }
   TCP_DUMP(printf("[host=\"%s\"] %s: session_proc(), socket %d received request "
 		  "(request_size=%u, file_size=%u).\n",
 		  inHost()->nhi.toString(), getNowWithThousandSeparator(),
@@ -330,6 +379,60 @@ void TCPServerSession::session_closed(TCPServerSessionContinuation* const cnt)
   // the continuation will be reclaimed after this
 }
 
+bool TCPServerSession::save_state(Checkpoint* ckpt)
+{
+  ckpt->put(nclients);
+  ckpt->put(accept_completed);
+  ckpt->put(start_timer_pending);
+  return true;
+}
+
+void TCPServerSession::restore_state(Checkpoint* ckpt)
+{
+  ckpt->get(nclients);
+  ckpt->get(accept_completed);
+  ckpt->get(start_timer_pending);
+
+  // the start timer expires at time zero; it can only be pending in a
+  // checkpoint taken then
+  if(start_timer_pending) wait_start(0);
+}
+
+bool TCPServerSession::save_continuation(Checkpoint* ckpt, SocketContinuation* sc)
+{
+  TCPServerSessionContinuation* cnt = (TCPServerSessionContinuation*)sc;
+  ckpt->put(cnt->server_socket);
+  ckpt->put(cnt->client_socket);
+  ckpt->put(cnt->status);
+  ckpt->put(request_size);
+  ckpt->write(cnt->reqbuf, request_size);
+  ckpt->put(cnt->client_ip);
+  ckpt->put(cnt->client_port);
+  ckpt->put(cnt->file_size);
+  ckpt->put(cnt->sent_bytes);
+  return true;
+}
+
+SocketContinuation* TCPServerSession::restore_continuation(Checkpoint* ckpt, int sock)
+{
+  int ssock;
+  uint32 reqsize;
+  ckpt->get(ssock);
+  TCPServerSessionContinuation* cnt = new TCPServerSessionContinuation(this, ssock);
+  ckpt->get(cnt->client_socket);
+  ckpt->get(cnt->status);
+  ckpt->get(reqsize);
+  if(reqsize != request_size)
+    error_quit("ERROR: [host=\"%s\"] TCPServerSession::restore_continuation(), the checkpoint "
+	       "has REQUEST_SIZE %u, the server %u.\n", inHost()->nhi.toString(), reqsize, request_size);
+  ckpt->read(cnt->reqbuf, request_size);
+  ckpt->get(cnt->client_ip);
+  ckpt->get(cnt->client_port);
+  ckpt->get(cnt->file_size);
+  ckpt->get(cnt->sent_bytes);
+  return cnt;
+}
+
 int TCPServerSession::push(Activation msg, ProtocolSession* hi_sess, void* extinfo, size_t extinfo_size)
 {
   error_quit("ERROR: TCPServerSession::push() should not be called.\n");
@@ -345,6 +448,7 @@ int TCPServerSession::pop(Activation msg, ProtocolSession* lo_sess, void* extinf
 void TCPServerSession::start_timer_callback(Activation ac)
 {
   TCPServerSession* server = (TCPServerSession*)((ProtocolCallbackActivation*)ac)->session;
+  server->start_timer_pending = false;
   server->start_on();
 }
 
@@ -72,9 +72,26 @@ class TCPServerSession: public ProtocolSession {
   */
   ProtocolCallbackActivation* start_timer_ac;
 
+  /** Save the state of the server to a checkpoint. */
+  virtual bool save_state(Checkpoint* ckpt);
+
+  /** Restore the state of the server from a checkpoint. */
+  virtual void restore_state(Checkpoint* ckpt);
+
+  /** The start timer is saved if it is still pending. */
+  virtual int saved_timeouts() { return start_timer_pending ? 1 : 0; }
+
+  /** Save a client session of the server blocked on a socket. */
+  virtual bool save_continuation(Checkpoint* ckpt, SocketContinuation* cnt);
+
+  /** Restore a client session of the server blocked on a socket. */
+  virtual SocketContinuation* restore_continuation(Checkpoint* ckpt, int sock);
+
  protected:
   // functions representing different stages
 
+  /** schedule the start timer after the given delay */
+  void wait_start(ltime_t delay);
   /** start the TCP server */
   void start_on();
 
@@ -124,6 +141,17 @@ class TCPServerSession: public ProtocolSession {
   */
   uint32 request_size;
 
+  /**
+  * Size of the file sent to a client whose request carries no real
+  * data, i.e., a client simulating sizes only (0 if not set).
+  */
+  uint32 default_file_size;
+
+  /**
+  * Socket options for the payload of the data sent to clients.
+  */
+  uint32 payload_options;
+
   /**
   * Number of client sessions that can be handled simultaneously.
   */
@@ -157,6 +185,10 @@ class TCPServerSession: public ProtocolSession {
   * Number of clients currently connected.
   */
   uint32 nclients;
+  /**
+  * Whether the start timer is pending.
+  */
+  bool start_timer_pending;
 };
 
 /**
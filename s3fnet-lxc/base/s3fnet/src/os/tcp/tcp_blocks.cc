@@ -6,252 +6,132 @@
  */
 
 #include "os/tcp/tcp_blocks.h"
+#include "net/checkpoint.h"
 
 namespace s3f {
 namespace s3fnet {
 
-TCPBlockList::TCPBlockList(int pat) : pattern(pat)
-{
-  head_block = new TCPBlock(UINT_MAX, 0);
-}
-
-void TCPBlockList::insert_block(uint32 seqno, uint32 len)
-{
-  TCPBlock *new_block = new TCPBlock(seqno, seqno+len);
-  new_block->next = head_block->next;
-  head_block->next = new_block;
-
-  // if overlapped, we still have to check whether the first block 
-  // overlaps with other blocks. it's tricky. For example, (0, 100), 
-  // (200, 300), now (100, 200) is coming. Then the first time
-  // when overlapping, (0,100) integrates with (100,200), that's 
-  // (0,200), we still have to integrate (0,200) and (200, 300), 
-  // that's (0, 300). However, 2 times is enough.
-  if(overlap_blocks()) overlap_blocks();
-
-  // update highest and lowest
-  head_block->right_edge = mymax(head_block->right_edge, seqno + len);
-  head_block->left_edge = mymin(head_block->left_edge, seqno);
-
-  // if the block list needs to be sorted increasingly
-  if(PATTERN_INCREASE == pattern) resort_blocks();
-}
+TCPBlockList::TCPBlockList(int pat) : pattern(pat), next_stamp(0) {}
 
-bool TCPBlockList::overlap_blocks()
+int TCPBlockList::find_block(uint32 seqno, bool inclusive)
 {
-  bool no_overlap = true;
-  TCPBlock *real_head = head_block->next, *p = real_head;
-
-  // not overlapped if the list is empty
-  if(!p) return false;
-  
-  while(p->next)
+  // binary search over the sorted blocks
+  int lo = 0, hi = blocks.size();
+  while(lo < hi)
   {
-    // example: [100,200]->[0,100]
-    if((real_head->left_edge >= p->next->left_edge) && 
-       (real_head->left_edge <= p->next->right_edge))
-    {
-      no_overlap = false;
-      
-      // combine of the two blocks
-      real_head->left_edge = p->next->left_edge;
-      real_head->right_edge = mymax(real_head->right_edge, p->next->right_edge);
-    }
-    
-    // example: [0,100]->[100,200]
-    else if((real_head->right_edge >= p->next->left_edge) && 
-	    (real_head->right_edge <= p->next->right_edge))
-    {
-      no_overlap = false;
-      
-      real_head->right_edge = p->next->right_edge;
-      real_head->left_edge = mymin(real_head ->left_edge, p->next->left_edge);
-    }
-            
-    if(no_overlap) p = p->next;
-    else
-    {
-      // delete p->next, because it has been integrated to the first
-      // block of the list
-      TCPBlock *q = p->next;
-      p->next = p->next->next;
-      delete q;
-      break;
-    }
+    int mid = (lo+hi)/2;
+    uint32 r = blocks[mid].right_edge;
+    if(r < seqno || (!inclusive && r == seqno)) lo = mid+1;
+    else hi = mid;
   }
-  
-  return !no_overlap;
+  return lo;
 }
 
-void TCPBlockList::resort_blocks()
+void TCPBlockList::insert_block(uint32 seqno, uint32 len)
 {
-  if(!head_block->next) return;
+  if(len == 0) return;
 
-  TCPBlock *p, *q = head_block->next;
-  uint32 first_no = q->left_edge;
+  uint32 left = seqno, right = seqno+len;
 
-  // find the right position of first_no and then relocate the first
-  // block between block q and block p.
-  for(p = q->next; p && p->left_edge < first_no; p = p->next) 
-    q = p;
-  if(q != head_block->next)
+  // coalesce with all blocks that overlap or touch the new one; for
+  // example, (0,100) and (200,300) become (0,300) when (100,200) comes
+  int i = find_block(left, true);
+  int j = i;
+  int n = blocks.size();
+  while(j < n && blocks[j].left_edge <= right)
   {
-    q->next = head_block->next;
-    q = head_block->next->next;
-    head_block->next->next = p;
-    head_block->next = q;
+    left = mymin(left, blocks[j].left_edge);
+    right = mymax(right, blocks[j].right_edge);
+    j++;
   }
-}
 
-void TCPBlockList::clear_blocks(uint32 seqno)
-{
-  TCPBlock *q = head_block, *p = head_block->next;
-  while(p)
+  if(j == i) blocks.insert(blocks.begin()+i, TCPBlock(left, right, next_stamp++));
+  else
   {
-    if(p->left_edge < seqno) // left edge below seqno
-    {
-      // we need to update lowest
-      head_block->left_edge = mymax(head_block->left_edge, seqno);
-      
-      if(p->right_edge > seqno)
-      {
-    	// if seqno is contained in block, we need to cut partially
-    	p->left_edge = seqno;
-	
-    	// if it's increasing sort, we are done
-    	if(PATTERN_INCREASE == pattern) break;
-    	else
-    	{
-    	  q = p;
-    	  p = p->next;
-    	}
-      }
-      else
-      {
-    	// we have to delete the whole block, we have to consider the next block
-    	q->next = p->next;
-    	delete p;
-    	p = q->next;
-      }
-    }
-    else // left edge above seqno
-    {
-      // if it's increasing sort, we're done
-      if(PATTERN_INCREASE == pattern) break;
-      else
-      {
-    	q = p;
-    	p = p->next;
-      }
-    }
-  }
-  
-  // if all blocks are cleared, we have to reset lowest and highest
-  if(!head_block->next)
-  {
-    head_block->left_edge = UINT_MAX;
-    head_block->right_edge = 0;
+    blocks[i].left_edge = left;
+    blocks[i].right_edge = right;
+    blocks[i].stamp = next_stamp++;
+    if(j > i+1) blocks.erase(blocks.begin()+i+1, blocks.begin()+j);
   }
 }
 
-void TCPBlockList::clear_all_blocks()
+void TCPBlockList::clear_blocks(uint32 seqno)
 {
-  clear_blocks(head_block->right_edge);
+  // drop the blocks entirely below seqno, and cut the one containing it
+  int i = find_block(seqno, false);
+  if(i > 0) blocks.erase(blocks.begin(), blocks.begin()+i);
+  if(!blocks.empty() && blocks.front().left_edge < seqno)
+    blocks.front().left_edge = seqno;
 }
 
 int TCPBlockList::fetch_blocks(uint32* buffer, int num)
 {
-  int i;
-  TCPBlock *p = head_block->next;
   assert(buffer);
-  for(i=0; p && i<num; i++, p=p->next)
-  {
-    buffer[2*i] = p->left_edge;
-    buffer[2*i+1] = p->right_edge;
-  }
-  return i;
-}
+  int n = blocks.size();
+  if(num > n) num = n;
 
-uint32 TCPBlockList::remove_lowest(bool remove)
-{
-  TCPBlock* p;
-
-  uint32 ret_len = 0;
-  for(p=head_block; p; p=p->next)
+  if(PATTERN_INCREASE == pattern)
   {
-    if(p->next && p->next->left_edge == head_block->left_edge)
+    for(int i=0; i<num; i++)
     {
-      ret_len = p->next->right_edge - p->next->left_edge;
-      if(remove)
-      {
-    	TCPBlock* q = p->next->next;
-    	delete p->next;
-    	p->next = q;
-      }
-      break;
+      buffer[2*i] = blocks[i].left_edge;
+      buffer[2*i+1] = blocks[i].right_edge;
     }
+    return num;
   }
 
-  // we should elect a new lowest seqno
-  if(remove)
+  // most recently updated blocks first; num is small (the number of
+  // blocks fitting in a tcp option), so a selection pass per block
+  uint32 bound = UINT_MAX;
+  for(int k=0; k<num; k++)
   {
-    // elect a new lowest block
-    if(head_block->next)
-    {
-      head_block->left_edge = head_block->next->left_edge;
-      
-      if(PATTERN_UNSORTED == pattern)
-      {
-    	// if unsorted, we have to traverse all blocks in the list to get the lowest no
-    	for(p=head_block->next->next; p; p=p->next)
-    		head_block->left_edge = mymin(head_block->left_edge, p->left_edge);
-      }
-    }
-    else
+    int best = -1;
+    for(int i=0; i<n; i++)
     {
-      head_block->left_edge = UINT_MAX;
-      head_block->right_edge = 0;
+      if(blocks[i].stamp < bound && (best < 0 || blocks[i].stamp > blocks[best].stamp))
+        best = i;
     }
+    assert(best >= 0);
+    buffer[2*k] = blocks[best].left_edge;
+    buffer[2*k+1] = blocks[best].right_edge;
+    bound = blocks[best].stamp;
   }
+  return num;
+}
+
+uint32 TCPBlockList::remove_lowest(bool remove)
+{
+  if(blocks.empty()) return 0;
+
+  uint32 ret_len = blocks.front().right_edge - blocks.front().left_edge;
+  if(remove) blocks.pop_front();
   return ret_len;
 }
 
 bool TCPBlockList::is_new(uint32* seqno, uint32* length)
 {
   assert(seqno && length);
-
-  uint32 overlap_seqno;
-  uint32 overlap_length;
-
   if(*length == 0) return false;
 
-  for(TCPBlock *p = head_block->next; p; p=p->next)
+  uint32 left = *seqno, right = *seqno + *length;
+  int i = find_block(left, false);
+  int n = blocks.size();
+
+  if(i < n && blocks[i].left_edge <= left)
   {
-    if(pattern == PATTERN_INCREASE && p->left_edge >= *seqno + *length)
-      return true;
+    // the new packet is contained in a block completely
+    if(blocks[i].right_edge >= right) return false;
 
-    overlap_seqno  = mymax(*seqno, p->left_edge);
-    overlap_length = mymin(*seqno + *length, p->right_edge) - overlap_seqno; 
-    
-    if(overlap_length > 0) // if overlap
-    {
-      // the new packet is contained in a block completely
-      if(overlap_length == *length) return false;
-      
-      if(overlap_seqno > p->left_edge)
-      {
-    	// if the left part of the packet is overlapped we get rid of the overlapped part
-    	*seqno  = p->right_edge;
-    	*length = *seqno + *length - p->right_edge;
-      }
-      else
-      {
-    	// right part of the packet is overlapped
-    	*length = p->left_edge - *seqno;
-      }
-    }
+    // the left part of the packet is overlapped; get rid of it
+    left = blocks[i].right_edge;
+    i++;
   }
-  
+
+  // the right part of the packet is overlapped; keep the part before it
+  if(i < n && blocks[i].left_edge < right) right = blocks[i].left_edge;
+
+  *seqno = left;
+  *length = right - left;
   return true;
 }
 
@@ -259,20 +139,34 @@ uint32 TCPBlockList::unavailable(uint32 startno)
 {
   assert(pattern == PATTERN_INCREASE);
 
-  TCPBlock *p, *q = head_block;
-  for(p = q->next; p && startno >= p->left_edge; p = p->next)
-    q = p;
+  // the block that may cover startno is the first one not ending before it
+  int i = find_block(startno, false);
+  if(i < (int)blocks.size() && blocks[i].left_edge <= startno)
+    return blocks[i].right_edge;
+  return startno;
+}
+
+void TCPBlockList::save(Checkpoint* ckpt)
+{
+  uint32 n = blocks.size();
+  ckpt->put(n);
+  for(uint32 i=0; i<n; i++) ckpt->put(blocks[i]);
+  ckpt->put(next_stamp);
+}
 
-  if(q == head_block) return startno;
-  else return mymax(q->right_edge, startno);
+void TCPBlockList::restore(Checkpoint* ckpt)
+{
+  uint32 n;
+  ckpt->get(n);
+  blocks.clear();
+  for(uint32 i=0; i<n; i++)
+  {
+    TCPBlock b(0, 0);
+    ckpt->get(b);
+    blocks.push_back(b);
+  }
+  ckpt->get(next_stamp);
 }
 
 }; // namespace s3fnet
 }; // namespace s3f
-
-
-
-
-
-
-
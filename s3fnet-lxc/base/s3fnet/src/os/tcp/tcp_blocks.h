@@ -9,10 +9,13 @@
 #define __TCP_BLOCKS_H__
 
 #include "s3fnet.h"
+#include "util/shstl.h"
 
 namespace s3f {
 namespace s3fnet {
 
+class Checkpoint;
+
 /**
  * \brief A consecutive block of sequence numbers.
  */
@@ -20,18 +23,24 @@ class TCPBlock {
  public:
   uint32 left_edge;  ///< The left edge of the block.
   uint32 right_edge; ///< The right edge of the block.
-  TCPBlock *next; ///< Point to the next block.
+  uint32 stamp; ///< When the block was last extended (larger is more recent).
 
   /** The constructor. */
-  TCPBlock(uint32 low, uint32 high) :
-    left_edge(low), right_edge(high), next(0) {}
+  TCPBlock(uint32 low, uint32 high, uint32 st = 0) :
+    left_edge(low), right_edge(high), stamp(st) {}
 };
 
 /**
- * \brief A list of blocks of consecutive sequence numbers.
+ * \brief A set of blocks of consecutive sequence numbers.
  *
  * The data structure is used by both sending and receiving windows to
- * keep track of data sent and received.
+ * keep track of data sent and received. The blocks are kept disjoint
+ * and sorted by sequence number in an array, so that insertion and
+ * lookup are done with a binary search and clearing the blocks below
+ * an acknowledged sequence number only drops them from the front.
+ * The pattern decides the order in which blocks are fetched: in
+ * increasing sequence order, or most recently updated first (as the
+ * SACK option requires of a receiver).
  */
 class TCPBlockList {
  public:
@@ -44,7 +53,7 @@ class TCPBlockList {
   TCPBlockList(int pattern); 
 
   /** The destructor. */
-  ~TCPBlockList() { clear_all_blocks(); delete head_block; }
+  ~TCPBlockList() {}
   
   /** Insert a block with sequence numbers of length len starting from
       seqno into the list. */
@@ -54,7 +63,7 @@ class TCPBlockList {
   void clear_blocks(uint32 seqno);
 
   /** Clear all blocks. */
-  void clear_all_blocks();
+  void clear_all_blocks() { blocks.clear(); }
 
   /**
    * Fetch blocks. Put the the boundaries (left edge and right edge)
@@ -80,10 +89,16 @@ class TCPBlockList {
   bool is_new(uint32* seqno, uint32* length);
 
   /** Return the lowest sequence number of this list. */
-  uint32 get_lowest() { return head_block->left_edge; }
+  uint32 get_lowest() { return blocks.empty() ? UINT_MAX : blocks.front().left_edge; }
 
   /** Return the highest sequence number of this list. */
-  uint32 get_highest() { return head_block->right_edge; }
+  uint32 get_highest() { return blocks.empty() ? 0 : blocks.back().right_edge; }
+
+  /** Return the number of blocks in the list. */
+  int size() { return blocks.size(); }
+
+  /** Return true if there is no block in the list. */
+  bool empty() { return blocks.empty(); }
 
   /**
    * Used only when the pattern is PATTERN_INCREASE. The method
@@ -92,21 +107,27 @@ class TCPBlockList {
    */
   uint32 unavailable(uint32 startno);
 
+  /** Save the blocks to a checkpoint. */
+  void save(Checkpoint* ckpt);
+
+  /** Restore the blocks from a checkpoint. */
+  void restore(Checkpoint* ckpt);
+
  protected:
-  /** Coalesce the first block in the list with other blocks in the
-      list; return true if further coalescing is needed. */
-  bool overlap_blocks();
+  /** Return the index of the first block whose right edge is larger
+      than (or equal to, if inclusive) the given seqno. */
+  int find_block(uint32 seqno, bool inclusive);
 
-  /** Resort blocks (in increasing order): relocate the first block
-      (newly inserted) in the list to the correct position. */
-  void resort_blocks();
-  
  private:
-  /** Whether the list should be sorted (increasingly) or not. */
+  /** Whether the list should be fetched in increasing order or most
+      recent first. */
   int pattern;
 
-  /** The head of the block list. */
-  TCPBlock* head_block;
+  /** The blocks, disjoint and sorted by sequence number. */
+  S3FNET_DEQUE(TCPBlock) blocks;
+
+  /** Stamp given to the next block inserted. */
+  uint32 next_stamp;
 };
 
 }; // namespace s3fnet
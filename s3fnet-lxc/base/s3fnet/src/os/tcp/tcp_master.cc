@@ -13,6 +13,8 @@
 #include "os/tcp/tcp_session.h"
 #include "os/ipv4/ip_message.h"
 #include "os/ipv4/ip_interface.h"
+#include "os/ipv4/ip_session.h"
+#include "net/checkpoint.h"
 
 #ifdef TCP_DEBUG
 #define TCP_DUMP(x) printf("TCP: "); x
@@ -41,16 +43,14 @@ static char* legit_nhi(char* nhistr)
   } else return 0;
 }
 
-#define calc_slow_timeout(x) \
-  (slow_timeout_double+slow_timeout_double*((x+boot_time_double)/slow_timeout_double) \
-   -x-boot_time_double)
-
-#define calc_fast_timeout(x) \
-  (fast_timeout_double+fast_timeout_double*((x+boot_time_double)/fast_timeout_double) \
-   -x-boot_time_double)
+// integer division rounding towards negative infinity
+static inline long floor_div(ltime_t a, ltime_t b)
+{
+  return (long)((a >= 0) ? a/b : -((-a+b-1)/b));
+}
 
 TCPMaster::TCPMaster(ProtocolGraph* graph) :
-		SessionMaster(graph), ip_sess(0), slow_timer_callback_proc(0), fast_timer_callback_proc(0), slow_timer_ac(0)
+		SessionMaster(graph), timer_callback_proc(0), timer_event(0), timer_event_time(-1), ip_sess(0), std_ip(0)
 {
   TCP_DUMP(printf("[host=\"%s\"] new tcp master session.\n", inHost()->nhi.toString()));
 
@@ -98,9 +98,6 @@ TCPMaster::~TCPMaster()
       i_iter != idle_sessions.end(); i_iter++)
     delete (*i_iter);
   idle_sessions.clear();
-
-  // delete the list kept for fast timeout sessions
-  fast_timeout_sessions.clear();
 }
 
 void TCPMaster::config(s3f::dml::Configuration* cfg)
@@ -394,23 +391,26 @@ void TCPMaster::init()
   // find out the IP layer protocol session
   ip_sess = inHost()->getNetworkLayerProtocol();
   assert(ip_sess);
-
-  // create the slow timer
-  Host* owner_host = inHost();
-  slow_timer_callback_proc = new Process( (Entity *)owner_host,
-		  (void (s3f::Entity::*)(s3f::Activation))&TCPMaster::slow_timer_callback);
-  // start the slow timer
-  slow_timer_ac = new ProtocolCallbackActivation(this);
-  Activation ac (slow_timer_ac);
-  double t = calc_slow_timeout(0);
-  HandleCode h = owner_host->waitFor( slow_timer_callback_proc, ac, inHost()->d2t(t, 0), owner_host->tie_breaking_seed);
+  std_ip = session_of_class<IPSession>(ip_sess);
+
+  if(slow_timeout <= 0 || fast_timeout <= 0)
+    error_quit("ERROR: TCPMaster::init(), %s and %s must be positive.\n",
+	       TCP_DML_SLOW_TIMEOUT, TCP_DML_FAST_TIMEOUT);
+
+  // the session timers are kept in the timer wheel and only the
+  // earliest deadline is scheduled with the host; nothing is
+  // scheduled until a session sets a timer
+  timer_wheel.setGranularity(mymin(slow_timeout, fast_timeout));
+  timer_callback_proc = new Process( (Entity *)inHost(),
+		  (void (s3f::Entity::*)(s3f::Activation))&TCPMaster::timer_callback);
+  timer_callback_proc->set_name("TCPMaster::timer_callback");
 }
 
 int TCPMaster::push(Activation msg, ProtocolSession* hi_sess, void* extinfo, size_t extinfo_size)
 {
   TCP_DUMP(printf("[host=\"%s\"] %s: push().\n", inHost()->nhi.toString(), getNowWithThousandSeparator()));
 
-  return ip_sess->pushdown(msg, this, extinfo, extinfo_size);
+  return pushdown_to(std_ip, ip_sess, msg, this, extinfo, extinfo_size);
 }
 
 int TCPMaster::pop(Activation msg, ProtocolSession* lo_sess, void* extinfo, size_t extinfo_size)
@@ -480,12 +480,144 @@ SocketSession* TCPMaster::createSession(int sock)
   return session;
 }
 
+SocketSession* TCPMaster::findSession(int sock)
+{
+  TCP_SESSIONS_SET* sets[3] = { &listening_sessions, &connected_sessions, &idle_sessions };
+  for(int i=0; i<3; i++)
+  {
+    for(TCP_SESSIONS_SET::iterator iter = sets[i]->begin(); iter != sets[i]->end(); iter++)
+      if((*iter)->socket == sock) return *iter;
+  }
+  return 0;
+}
+
+bool TCPMaster::save_state(Checkpoint* ckpt)
+{
+  ckpt->put(boot_time);
+
+  // the sessions are identified by their socket ids (defunct sessions
+  // are about to be deleted and hold no timers); the set of each
+  // session is saved ahead of it
+  TCP_SESSIONS_SET* sets[3] = { &listening_sessions, &connected_sessions, &idle_sessions };
+  S3FNET_SET(int) socks;
+  uint32 n = listening_sessions.size() + connected_sessions.size() + idle_sessions.size();
+  ckpt->put(n);
+  for(int i=0; i<3; i++)
+  {
+    for(TCP_SESSIONS_SET::iterator iter = sets[i]->begin(); iter != sets[i]->end(); iter++)
+    {
+      if(!socks.insert((*iter)->socket).second)
+      {
+	error_retn("WARNING: [host=\"%s\"] TCPMaster::save_state(), two tcp sessions "
+		   "have socket %d.\n", inHost()->nhi.toString(), (*iter)->socket);
+	return false;
+      }
+      ckpt->put(i);
+      ckpt->put((*iter)->socket);
+      (*iter)->save(ckpt);
+    }
+  }
+
+  // the pending timers in the order of the wheel's slot lists
+  S3FNET_VECTOR(TCPTimer*) timers;
+  timer_wheel.getPending(timers);
+  n = timers.size();
+  ckpt->put(n);
+  for(uint32 i=0; i<n; i++)
+  {
+    ckpt->put(timers[i]->session->socket);
+    ckpt->put(timers[i]->timer_id);
+    ltime_t deadline = timers[i]->getDeadline();
+    ckpt->put(deadline);
+  }
+  ltime_t cursor = timer_wheel.getCursor();
+  ckpt->put(cursor);
+
+  // the timer event may be pending later than the earliest deadline,
+  // which it is moved to only when the deadline is set
+  bool pending = (timer_event != 0);
+  ckpt->put(pending);
+  if(pending) ckpt->put(timer_event_time);
+  return true;
+}
+
+void TCPMaster::restore_state(Checkpoint* ckpt)
+{
+  if(!listening_sessions.empty() || !connected_sessions.empty() || !idle_sessions.empty())
+    error_quit("ERROR: [host=\"%s\"] TCPMaster::restore_state(), tcp sessions have been "
+	       "created before the checkpoint is restored.\n", inHost()->nhi.toString());
+
+  ckpt->get(boot_time);
+
+  TCP_SESSIONS_SET* sets[3] = { &listening_sessions, &connected_sessions, &idle_sessions };
+  S3FNET_MAP(int, TCPSession*) sessions;
+  uint32 n;
+  ckpt->get(n);
+  for(uint32 i=0; i<n; i++)
+  {
+    int set, sock;
+    ckpt->get(set);
+    ckpt->get(sock);
+    if(set < 0 || set >= 3)
+      error_quit("ERROR: [host=\"%s\"] TCPMaster::restore_state(), invalid tcp session "
+		 "of socket %d.\n", inHost()->nhi.toString(), sock);
+    TCPSession* session = (TCPSession*)createSession(sock);
+    session->restore(ckpt);
+    idle_sessions.erase(session);
+    sets[set]->insert(session);
+    sessions.insert(S3FNET_MAKE_PAIR(sock, session));
+  }
+
+  // schedule the timers from the last to the first so that the slot
+  // lists are in the same order
+  ckpt->get(n);
+  S3FNET_VECTOR(TCPTimer*) timers(n);
+  S3FNET_VECTOR(ltime_t) deadlines(n);
+  for(uint32 i=0; i<n; i++)
+  {
+    int sock, timer_id;
+    ckpt->get(sock);
+    ckpt->get(timer_id);
+    ckpt->get(deadlines[i]);
+    S3FNET_MAP(int, TCPSession*)::iterator iter = sessions.find(sock);
+    if(iter == sessions.end())
+      error_quit("ERROR: [host=\"%s\"] TCPMaster::restore_state(), timer of unknown "
+		 "socket %d.\n", inHost()->nhi.toString(), sock);
+    TCPSession* session = (*iter).second;
+    if(timer_id == TCPSession::RETX_TIMER) timers[i] = &session->rxmit_timer;
+    else if(timer_id == TCPSession::TWO_MSL_TIMER) timers[i] = &session->msl_timer;
+    else if(timer_id == TCPSession::DELAYED_ACK_TIMER) timers[i] = &session->delayed_ack_timer;
+    else error_quit("ERROR: [host=\"%s\"] TCPMaster::restore_state(), invalid timer %d "
+		    "of socket %d.\n", inHost()->nhi.toString(), timer_id, sock);
+  }
+  for(int i=n-1; i>=0; i--)
+    timer_wheel.schedule(timers[i], deadlines[i]);
+  ltime_t cursor;
+  ckpt->get(cursor);
+  timer_wheel.setCursor(cursor);
+
+  bool pending;
+  ckpt->get(pending);
+  if(pending)
+  {
+    ckpt->get(timer_event_time);
+    Host* owner_host = inHost();
+    ltime_t now = getNow();
+    Activation ac (new ProtocolCallbackActivation(this));
+    timer_event = owner_host->waitFor(timer_callback_proc, ac,
+				      (timer_event_time > now) ? timer_event_time-now : 0,
+				      owner_host->tie_breaking_seed);
+  }
+}
+
 void TCPMaster::deleteSession(TCPSession* session)
 {
   TCP_DUMP(printf("deleteSession(sock=%d).\n", session->socket));
 
   assert(session);
   separate_session(session);
+  cancelTimer(&session->rxmit_timer);
+  cancelTimer(&session->msl_timer);
 
   defunct_sessions.insert(session);
 }
@@ -503,8 +635,8 @@ void TCPMaster::separate_session(TCPSession* session)
   else if((iter = idle_sessions.find(session)) != idle_sessions.end())
     idle_sessions.erase(iter);
 
-  if((iter = fast_timeout_sessions.find(session)) != fast_timeout_sessions.end())
-    fast_timeout_sessions.erase(iter);
+  // as with the former fast timer, a state change drops a pending delayed ack
+  cancelTimer(&session->delayed_ack_timer);
 }
 
 void TCPMaster::delete_defunct_sessions()
@@ -532,6 +664,9 @@ void TCPMaster::setListening(TCPSession* session)
 		  inHost()->nhi.toString(), getNowWithThousandSeparator(), session->socket));
 
   separate_session(session);
+  // only connected sessions keep slow timers running
+  cancelTimer(&session->rxmit_timer);
+  cancelTimer(&session->msl_timer);
   listening_sessions.insert(session);
 }
 
@@ -541,95 +676,92 @@ void TCPMaster::setIdle(TCPSession* session)
 		  inHost()->nhi.toString(), getNowWithThousandSeparator(), session->socket));
 
   separate_session(session);
+  // only connected sessions keep slow timers running
+  cancelTimer(&session->rxmit_timer);
+  cancelTimer(&session->msl_timer);
   idle_sessions.insert(session);
 }
 
-void TCPMaster::enableFastTimeout(TCPSession* session)
+void TCPMaster::setTimer(TCPTimer* timer, ltime_t deadline)
 {
-  assert(session);
-  if(!fast_timer_callback_proc)
-  {
-    // only need to schedule the time at the first time
-    // create the fast timer
-    Host* owner_host = inHost();
-    fast_timer_callback_proc = new Process( (Entity *)owner_host,
-  		  (void (s3f::Entity::*)(s3f::Activation))&TCPMaster::fast_timer_callback);
-    // start the fast timer
-    fast_timer_ac = new ProtocolCallbackActivation(this);
-    Activation ac (fast_timer_ac);
-    double time = inHost()->t2d(getNow(), 0);
-    double t = calc_fast_timeout(time);
-    HandleCode h = owner_host->waitFor( fast_timer_callback_proc, ac, inHost()->d2t(t, 0), owner_host->tie_breaking_seed);
-  }
-  fast_timeout_sessions.insert(session);
+  assert(timer);
+  timer_wheel.schedule(timer, deadline);
+  if(timer_event_time < 0 || deadline < timer_event_time)
+    reschedule_timer_event();
 }
 
-void TCPMaster::disableFastTimeout(TCPSession* session)
+void TCPMaster::cancelTimer(TCPTimer* timer)
 {
-  assert(session);
-  fast_timeout_sessions.erase(session);
+  assert(timer);
+  // the pending timer event, if any, is left alone; it will find
+  // nothing to do or move on to the next deadline when it fires
+  timer_wheel.cancel(timer);
 }
 
-void TCPMaster::fast_timer_callback(Activation ac)
+long TCPMaster::getSlowTick(ltime_t t)
 {
-  TCPMaster* tm = (TCPMaster*)((ProtocolCallbackActivation*)ac)->session;
+  return floor_div(t - boot_time, slow_timeout);
+}
 
-  tm->delete_defunct_sessions();
+ltime_t TCPMaster::slowTickAfter(ltime_t t, long n)
+{
+  assert(n >= 1);
+  return boot_time + (getSlowTick(t) + n) * slow_timeout;
+}
+
+ltime_t TCPMaster::fastTickAfter(ltime_t t)
+{
+  return boot_time + (floor_div(t - boot_time, fast_timeout) + 1) * fast_timeout;
+}
+
+void TCPMaster::reschedule_timer_event()
+{
+  ltime_t deadline = timer_wheel.earliest();
+  if(deadline == timer_event_time) return;
 
-  // go through each tcp session that requires fast timer; to prevent
-  // changes during iteration, we copy the list to an array.
-  int mysize;
-  if((mysize = tm->fast_timeout_sessions.size()) > 0)
+  Host* owner_host = inHost();
+  ltime_t now = getNow();
+
+  // move the pending event to the earliest deadline, or cancel it if there is none
+  if(timer_event && deadline >= 0 &&
+     owner_host->reschedule(timer_event, (deadline > now) ? deadline-now : 0))
+  {
+    timer_event_time = (deadline > now) ? deadline : now;
+    return;
+  }
+  if(timer_event)
   {
-    TCPSession** mylist  = new TCPSession*[mysize];
-    assert(mylist);
-    int idx = 0;
-    for(S3FNET_SET(TCPSession*)::iterator iter = tm->fast_timeout_sessions.begin();
-	iter != tm->fast_timeout_sessions.end(); iter++, idx++)
-      mylist[idx] = (*iter);
-    for(idx = 0; idx < mysize; idx++)
-      mylist[idx]->fastTimeoutHandling();
-    delete[] mylist;
+    HandlePtr hptr(new Handle(timer_event));
+    hptr->cancel();
+    timer_event = 0;
+    timer_event_time = -1;
   }
+  if(deadline < 0) return;
 
-  // reschedule for the next timeout
-  double time = tm->inHost()->t2d(tm->getNow(), 0);
-  //double t = calc_fast_timeout(time);
-  double t =  tm->fast_timeout_double +
-		      tm->fast_timeout_double * ((time + tm->boot_time_double) / tm->fast_timeout_double)
-		      - time - tm->boot_time_double;
-  HandleCode h = tm->inHost()->waitFor( tm->fast_timer_callback_proc, ac, tm->inHost()->d2t(t, 0), tm->inHost()->tie_breaking_seed );
+  Activation ac (new ProtocolCallbackActivation(this));
+  timer_event = owner_host->waitFor(timer_callback_proc, ac, (deadline > now) ? deadline-now : 0,
+				    owner_host->tie_breaking_seed);
+  timer_event_time = (deadline > now) ? deadline : now;
 }
 
-void TCPMaster::slow_timer_callback(Activation ac)
+void TCPMaster::timer_callback(Activation ac)
 {
   TCPMaster* tm = (TCPMaster*)((ProtocolCallbackActivation*)ac)->session;
 
+  // the event that fired is no longer pending
+  tm->timer_event = 0;
+  tm->timer_event_time = -1;
+
   tm->delete_defunct_sessions();
 
-  // go through each connected session that requires slow timer; to
-  // prevent changes during iteration, we copy the list to an array.
-  int mysize;
-  if((mysize = tm->connected_sessions.size()) > 0)
-  {
-    TCPSession** mylist  = new TCPSession*[mysize];
-    assert(mylist);
-    int idx = 0;
-    for(S3FNET_SET(TCPSession*)::iterator iter = tm->connected_sessions.begin();
-	iter != tm->connected_sessions.end(); iter++, idx++)
-      mylist[idx] = (*iter);
-    for(idx = 0; idx < mysize; idx++)
-      mylist[idx]->slowTimeoutHandling();
-    delete[] mylist;
-  }
+  // handle the expired timers one at a time, since handling a timer
+  // may set or cancel other timers (including those of other sessions)
+  ltime_t now = tm->getNow();
+  TCPTimer* timer;
+  while((timer = tm->timer_wheel.expire(now)) != 0)
+    timer->session->timeoutHandling(timer);
 
-  // reschedule for the next timeout
-  double time = tm->inHost()->t2d(tm->getNow(), 0);
-  //double t = calc_slow_timeout(time);
-  double t =   tm->slow_timeout_double +
-		  tm->slow_timeout_double * ( (time + tm->boot_time_double) / tm->slow_timeout_double)
-		  - time - tm->boot_time_double;
-  HandleCode h = tm->inHost()->waitFor( tm->slow_timer_callback_proc, ac, tm->inHost()->d2t(t, 0), tm->inHost()->tie_breaking_seed );
+  tm->reschedule_timer_event();
 }
 
 }; // namespace s3fnet
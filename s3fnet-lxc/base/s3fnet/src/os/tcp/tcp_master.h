@@ -10,12 +10,14 @@
 
 #include "os/socket/socket_session.h"
 #include "os/tcp/tcp_init.h"
+#include "os/tcp/tcp_timerwheel.h"
 #include "util/shstl.h"
 
 namespace s3f {
 namespace s3fnet {
 
 class TCPSession;
+class IPSession;
 
 /**
  * \brief The TCP master.
@@ -28,6 +30,7 @@ class TCPSession;
  */
 class TCPMaster : public SessionMaster {
   friend class TCPSession;
+  friend class ProtocolSession; // the static pipeline calls push() and pop()
   
  public:
   /** tcp versions implemented in s3fnet */
@@ -71,6 +74,18 @@ class TCPMaster : public SessionMaster {
   /** Create a new TCP session of the given socket id. */
   virtual SocketSession* createSession(int sock);
 
+  /** Return the TCP session of the given socket id, or NULL. */
+  virtual SocketSession* findSession(int sock);
+
+  /** Save the TCP sessions and their pending timers to a checkpoint. */
+  virtual bool save_state(Checkpoint* ckpt);
+
+  /** Restore the TCP sessions and their timers from a checkpoint. */
+  virtual void restore_state(Checkpoint* ckpt);
+
+  /** The timer event, if pending, is the only timeout of the master. */
+  virtual int saved_timeouts() { return timer_event ? 1 : 0; }
+
   /** Reclaim a TCP session. */
   void deleteSession(TCPSession* session);
   
@@ -83,26 +98,39 @@ class TCPMaster : public SessionMaster {
   /** Change the state of the session to idle. */
   void setIdle(TCPSession* session);
   
-  /** Enable a TCP session for fast timeout handling. */
-  void enableFastTimeout(TCPSession* session);
-  
-  /** Disable a TCP session from fast timeout handling. */
-  void disableFastTimeout(TCPSession* session);
+  /**
+   * Set the given session timer to expire at the given absolute
+   * simulation time. The master keeps one simulation event pending
+   * for the earliest deadline among all timers of this host.
+   */
+  void setTimer(TCPTimer* timer, ltime_t deadline);
 
-  /** Provide call_back functionality for implementing the slow timer in the TCPMaster
-   *  this S3F process is used by waitFor() function */
-  Process* slow_timer_callback_proc;
-  /** Provide call_back functionality for implementing the fast timer in the TCPMaster
+  /** Cancel the given session timer if it is pending. */
+  void cancelTimer(TCPTimer* timer);
+
+  /**
+   * Return the index of the slow timer tick in effect at the given
+   * time. The slow ticks are spaced by the slow timeout interval
+   * starting from the boot time; RTT is measured in these ticks.
+   */
+  long getSlowTick(ltime_t t);
+
+  /**
+   * Return the time of the n-th slow tick after the given time
+   * (n>=1). The retransmission and 2MSL timers expire on slow ticks
+   * as they do with BSD-style periodic timers.
+   */
+  ltime_t slowTickAfter(ltime_t t, long n);
+
+  /** Return the time of the next fast tick after the given time;
+      delayed acknowledgments are sent out on fast ticks. */
+  ltime_t fastTickAfter(ltime_t t);
+
+  /** Provide call_back functionality for the session timers in the TCPMaster;
    *  this S3F process is used by waitFor() function */
-  Process* fast_timer_callback_proc;
-  /** The callback function registered with the slow_timer_callback_proc */
-  void slow_timer_callback(Activation);
-  /** The callback function registered with the fast_timer_callback_proc */
-  void fast_timer_callback(Activation);
-  /** Storing the data for the slow timer callback function. In this case, the TCPMaster object is stored. */
-  ProtocolCallbackActivation* slow_timer_ac;
-  /** Storing the data for the fast timer callback function. In this case, the TCPMaster object is stored. */
-  ProtocolCallbackActivation* fast_timer_ac;
+  Process* timer_callback_proc;
+  /** The callback function registered with the timer_callback_proc */
+  void timer_callback(Activation);
 
  protected:
   /** Send a message down the protocol stack to a lower layer. */
@@ -114,6 +142,9 @@ class TCPMaster : public SessionMaster {
   /** Disassociate a protocol session from managed lists. */
   void separate_session(TCPSession* sess);
 
+  /** Make sure the timer event is pending for the earliest deadline. */
+  void reschedule_timer_event();
+
   /** Finally remove sessions reclaimed using the deleteSession method. */
   void delete_defunct_sessions();
 
@@ -148,9 +179,6 @@ class TCPMaster : public SessionMaster {
   /** TCP sessions that are idle. */
   TCP_SESSIONS_SET idle_sessions;
 
-  /** TCP Sessions to be called when fast timer expires. */
-  TCP_SESSIONS_SET fast_timeout_sessions;
-  
   /** TCP sessions to be deleted. */
   TCP_SESSIONS_SET defunct_sessions;
  
@@ -206,10 +234,22 @@ class TCPMaster : public SessionMaster {
   ltime_t boot_time_window;
   double boot_time_window_double;
 
+  /** Pending timers of all TCP sessions on this host. */
+  TCPTimerWheel timer_wheel;
+
+  /** Handle of the pending timer event; NULL if none is pending. */
+  HandleCode timer_event;
+
+  /** The time at which the pending timer event fires. */
+  ltime_t timer_event_time;
+
  private:
   /** The IP layer protocol session, located below this protocol
       session on the protocol stack. */
   ProtocolSession* ip_sess;
+
+  /** The IP session if it is an IPSession, for the static pipeline. */
+  IPSession* std_ip;
 };
 
 }; // namespace s3fnet
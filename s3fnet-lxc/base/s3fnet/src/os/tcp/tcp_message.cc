@@ -5,12 +5,13 @@
  * authors : Dong (Kevin) Jin
  */
 
+#include <string.h>
 #include "os/tcp/tcp_message.h"
 
 namespace s3f {
 namespace s3fnet {
 
-TCPMessage::TCPMessage() {}
+TCPMessage::TCPMessage() : options(0) {}
 
 TCPMessage::TCPMessage(uint16 sport, uint16 dport, uint32 seq, uint32 ack,
 		       byte f, uint16 w, byte len, byte* opt) :
@@ -40,7 +41,49 @@ TCPMessage::~TCPMessage()
   if(options) delete[] options;
 }
 
-S3FNET_REGISTER_MESSAGE(TCPMessage, S3FNET_PROTOCOL_TYPE_TCP);
+void TCPMessage::serialize(byte* buf, int& offset)
+{
+  ProtocolMessage::serialize(buf, offset);
+  memcpy(&buf[offset], &src_port, sizeof(uint16)); offset += sizeof(uint16);
+  memcpy(&buf[offset], &dst_port, sizeof(uint16)); offset += sizeof(uint16);
+  memcpy(&buf[offset], &seqno, sizeof(uint32)); offset += sizeof(uint32);
+  memcpy(&buf[offset], &ackno, sizeof(uint32)); offset += sizeof(uint32);
+  buf[offset++] = length;
+  buf[offset++] = flags;
+  memcpy(&buf[offset], &wsize, sizeof(uint16)); offset += sizeof(uint16);
+
+  // the header length tells how many bytes of options follow
+  int optlen = options_length();
+  if(optlen > 0)
+  {
+    if(options) memcpy(&buf[offset], options, optlen);
+    else memset(&buf[offset], 0, optlen);
+    offset += optlen;
+  }
+}
+
+void TCPMessage::deserialize(byte* buf, int& offset)
+{
+  ProtocolMessage::deserialize(buf, offset);
+  memcpy(&src_port, &buf[offset], sizeof(uint16)); offset += sizeof(uint16);
+  memcpy(&dst_port, &buf[offset], sizeof(uint16)); offset += sizeof(uint16);
+  memcpy(&seqno, &buf[offset], sizeof(uint32)); offset += sizeof(uint32);
+  memcpy(&ackno, &buf[offset], sizeof(uint32)); offset += sizeof(uint32);
+  length = buf[offset++];
+  flags = buf[offset++];
+  memcpy(&wsize, &buf[offset], sizeof(uint16)); offset += sizeof(uint16);
+
+  int optlen = options_length();
+  if(optlen > 0)
+  {
+    options = new byte[optlen]; assert(options);
+    memcpy(options, &buf[offset], optlen);
+    offset += optlen;
+  }
+  else options = 0;
+}
+
+S3FNET_REGISTER_POOLED_MESSAGE(TCPMessage, S3FNET_PROTOCOL_TYPE_TCP);
 
 }; // namespace s3fnet
 }; // namespace s3f
@@ -86,6 +86,15 @@ class TCPMessage: public ProtocolMessage {
     return 3*sizeof(uint16)+2*sizeof(uint32)+2*sizeof(byte)+
       options_length()+ProtocolMessage::packingSize();
   }
+
+  /** Pack this TCP header, with its options, to buffer starting from the given offset. */
+  virtual void serialize(byte* buf, int& offset);
+
+  /** Unpack the TCP header from buf from given offset. */
+  virtual void deserialize(byte* buf, int& offset);
+
+  /** The TCP header can be saved in a checkpoint or sent to another shard. */
+  virtual bool serializable() { return true; }
   
   /**
    * Return the number of bytes that a TCP header really occupies in
@@ -94,6 +103,9 @@ class TCPMessage: public ProtocolMessage {
    */
   virtual int realByteCount() { return length*sizeof(uint32); }
 
+  /** TCP headers are recycled through a message pool. */
+  S3FNET_POOLED_MESSAGE(TCPMessage);
+
  protected:
   /** The destructor is protected from accidental invocation. */
   virtual ~TCPMessage();
@@ -11,27 +11,19 @@
 namespace s3f {
 namespace s3fnet {
 
+// initial size of the ring buffer, unless the window is larger
+#define TCP_RCVWND_MIN_RING_SIZE 4096
+
 TCPRecvWindow::TCPRecvWindow(uint32 initseq, uint32 winsiz) :
-  TCPSeqWindow(initseq, winsiz), seg_buffer(0), 
-  free_seg_list(0), highest_seqno(initseq), 
+  TCPSeqWindow(initseq, winsiz),
+  rcvd_blocks(TCPBlockList::PATTERN_INCREASE),
+  real_blocks(TCPBlockList::PATTERN_INCREASE),
+  ring(0), ring_size(0), highest_seqno(initseq), 
   appl_rcvbuf(0), appl_rcvbuf_size(0), appl_data_rcvd(0) {}
 
 TCPRecvWindow::~TCPRecvWindow() 
 {
-  while(seg_buffer)
-  {
-    TCPSegment* seg = seg_buffer->next; 
-    if(seg_buffer->msg) delete[] seg_buffer->msg;
-    delete seg_buffer;
-    seg_buffer = seg;
-  }
-
-  while(free_seg_list)
-  {
-    TCPSegment* seg = free_seg_list->next;
-    delete free_seg_list;
-    free_seg_list = seg;
-  }
+  if(ring) delete[] ring;
 }
 
 bool TCPRecvWindow::available()
@@ -40,7 +32,7 @@ bool TCPRecvWindow::available()
   // buffer set previously when TCPSession::recv() is called
   if(appl_rcvbuf_size > 0)
   {
-    if(seg_buffer && seg_buffer->seqno <= expect())
+    if(!rcvd_blocks.empty() && rcvd_blocks.get_lowest() <= expect())
     {
       appl_data_rcvd = generate(appl_rcvbuf_size, appl_rcvbuf);
       return appl_data_rcvd > 0;
@@ -52,79 +44,41 @@ bool TCPRecvWindow::available()
 
 uint32 TCPRecvWindow::generate(uint32 length, byte* msg)
 {
-  // we always grab one block from the buffer and report it to the
-  // upper layer.
-  uint32 request_len = length;
-  while(seg_buffer && length > 0 && (expect() == seg_buffer->seqno))
+  // submit as much in-order data as requested to the upper layer
+  uint32 from = expect();
+  uint32 n = mymin(length, rcvd_blocks.unavailable(from) - from);
+  if(n == 0) return 0;
+
+  if(msg)
   {
-    // we consider the situation in which the upper layer has
-    // requested different data lengths.
-    if(length >= seg_buffer->length)
+    // real bytes come from the ring buffer; fake data reads as zeros
+    uint32 seqno = from, end = from + n;
+    while(seqno < end)
     {
-      // can submit whole data block to the upper layer.
-      if(msg)
+      uint32 real_end = real_blocks.unavailable(seqno);
+      if(real_end > seqno)
       {
-    	if(seg_buffer->msg)
-    	{
-    	  memcpy(msg, seg_buffer->msg, seg_buffer->length);
-    	  delete[] seg_buffer->msg;
-    	}
-    	else
-    	{
-    		memset(msg, 0, seg_buffer->length);
-    	}
-    	msg += seg_buffer->length;
+    	uint32 len = mymin(real_end, end) - seqno;
+    	ring_copy_out(seqno, len, msg);
+    	msg += len; seqno += len;
       }
-      else if(seg_buffer->msg)
+      else
       {
-    	delete[] seg_buffer->msg;
+    	// fake data up to the next real block (or the end)
+    	uint32 fake_seqno = seqno, len = end - seqno;
+    	real_blocks.is_new(&fake_seqno, &len);
+    	memset(msg, 0, len);
+    	msg += len; seqno += len;
       }
-      
-      // update the start sequence number
-      shift(seg_buffer->length);  
-      length -= seg_buffer->length;
-
-      TCPSegment* seg = seg_buffer->next;
-      add_a_free_segment(seg_buffer);
-      seg_buffer = seg;
     }
-    else
-    {
-      // we have to cut the current data block into two pieces.
-      if(msg)
-      {
-    	if(seg_buffer->msg)
-    	{
-    	  memcpy(msg, seg_buffer->msg, length);
-    	  byte* remain_msg = new byte[seg_buffer->length - length];
-    	  memcpy(remain_msg, seg_buffer->msg+length, seg_buffer->length - length);
-    	  delete [] seg_buffer->msg;
-    	  seg_buffer->msg = remain_msg;
-    	}
-    	else
-    	{
-    		memset(msg, 0, length);
-    	}
-    	msg += seg_buffer->length;
-      }
-      else if(seg_buffer->msg)
-      {
-    	byte* remain_msg = new byte[seg_buffer->length - length];
-    	memcpy(remain_msg, seg_buffer->msg+length, seg_buffer->length - length);
-    	delete [] seg_buffer->msg;
-    	seg_buffer->msg = remain_msg;
-      }
+  }
 
-      // shorten the length of the remaining message.
-      seg_buffer->seqno += length;
-      seg_buffer->length -= length;
+  rcvd_blocks.clear_blocks(from + n);
+  real_blocks.clear_blocks(from + n);
 
-      // update the start sequence number
-      shift(length);
-      length = 0;
-    }
-  }
-  return request_len - length;
+  // update the start sequence number
+  shift(n);
+  return n;
 }
 
 void TCPRecvWindow::addToBuffer(DataMessage* msg, uint32 seqno)
@@ -132,8 +86,7 @@ void TCPRecvWindow::addToBuffer(DataMessage* msg, uint32 seqno)
   assert(msg);
   if(msg->real_length > 0)
   {
-    bool new_data = add_to_buffer_helper(seqno, msg->real_length, (byte*)msg->payload);
-    if(new_data && msg->payload) msg->payload = 0;
+    add_to_buffer_helper(seqno, msg->real_length, (byte*)msg->payload);
     use(msg->real_length);
   }
   else
@@ -141,124 +94,117 @@ void TCPRecvWindow::addToBuffer(DataMessage* msg, uint32 seqno)
     DataChunk* node = (DataChunk*)msg->payload;
     while(node)
     {
-      DataChunk* next_node = node->next;
-      bool new_data = add_to_buffer_helper(seqno, node->real_length, node->real_data);
-      if(new_data && node->real_data)
-    	  node->real_data = 0;
-
+      add_to_buffer_helper(seqno, node->real_length, node->real_data);
       seqno += node->real_length;
       use(node->real_length);
-      node = next_node;
+      node = node->next;
     }
   }
 }
 
-uint32 TCPRecvWindow::getExpectedSeqno()
-{
-  uint32 expect_no = expect();
-  for(TCPSegment* seg = seg_buffer; seg; seg = seg->next)
-  {
-    // if the packet with the expect sequence number has already been
-    // in the buffer, we find the next one
-    if(expect_no >= seg->seqno) expect_no += seg->length;
-    else return expect_no;
-  }
-  return expect_no;
-}
-
 bool TCPRecvWindow::add_to_buffer_helper(uint32 seqno, uint32 length, byte* msg)
 {
-  /* Copy the received message to the buffer, if msg is NULL, we will
-    take it as fake data. Here we assume that the packet either
-    overlaps completely with a packet already received, or is a
-    totally new packet. In other words, the sender will never send out
-    a partially overlapped packet. The method returns true if the data
-    is new. Otherwise, it returns false. */
-
   if(length <= 0) return false;
   highest_seqno = mymax(highest_seqno, seqno + length - 1);
 
-  // we use a linked list to put all segments.
-  if(!seg_buffer)
+  // anything before the expected sequence number has been delivered
+  uint32 from = expect();
+  if(seqno + length <= from) return false;
+  if(seqno < from)
   {
-    // there is no segment in the buffer
-    TCPSegment* seg = get_a_segment();
-    seg->set(seqno, length, msg, 0);
-    seg_buffer = seg;
-    return true; // a new packet
+    if(msg) msg += from - seqno;
+    length -= from - seqno;
+    seqno = from;
   }
-  else if(seqno < seg_buffer->seqno)
+
+  // partially overlapped segments are handled as well; the overlapped
+  // part is simply written again
+  uint32 new_seqno = seqno, new_length = length;
+  if(!rcvd_blocks.is_new(&new_seqno, &new_length)) return false;
+
+  rcvd_blocks.insert_block(seqno, length);
+  if(msg)
   {
-    // if the newly arrived is a packet predates all received ones
-    if(seqno + length == seg_buffer->seqno && !msg && !seg_buffer->msg)
-    {
-      // the new packet is just before the head packet in the buffer
-      // and both of them use fake data. we can merge them together.
-      seg_buffer->seqno = seqno;
-      seg_buffer->length += length;
-    }
-    else
-    {
-      TCPSegment* seg = get_a_segment();
-      seg->set(seqno, length, msg, seg_buffer);
-      seg_buffer = seg;
-    }
-    return true; // a new packet
+    reserve_ring(seqno + length);
+    ring_copy_in(seqno, length, msg);
+    real_blocks.insert_block(seqno, length);
   }
-  else if(seqno < seg_buffer->seqno + length)
+  return true;
+}
+
+void TCPRecvWindow::save(Checkpoint* ckpt)
+{
+  TCPSeqWindow::save(ckpt);
+  rcvd_blocks.save(ckpt);
+  real_blocks.save(ckpt);
+  ckpt->put(ring_size);
+  if(ring) ckpt->write(ring, ring_size);
+  ckpt->put(highest_seqno);
+  ckpt->put(appl_rcvbuf_size);
+  ckpt->put(appl_data_rcvd);
+}
+
+void TCPRecvWindow::restore(Checkpoint* ckpt)
+{
+  TCPSeqWindow::restore(ckpt);
+  rcvd_blocks.restore(ckpt);
+  real_blocks.restore(ckpt);
+  if(ring) delete[] ring;
+  ckpt->get(ring_size);
+  ring = 0;
+  if(ring_size > 0)
   {
-    // this must be an old packet; according to our assumption, there
-    // must be a complete match
-    return false; 
+    ring = new byte[ring_size];
+    ckpt->read(ring, ring_size);
   }
-  else
+  ckpt->get(highest_seqno);
+  ckpt->get(appl_rcvbuf_size);
+  ckpt->get(appl_data_rcvd);
+  appl_rcvbuf = 0;
+}
+
+void TCPRecvWindow::reserve_ring(uint32 upto)
+{
+  uint32 need = upto - expect();
+  if(ring && need <= ring_size) return;
+
+  uint32 new_size = ring_size ? ring_size : TCP_RCVWND_MIN_RING_SIZE;
+  while(new_size < need || new_size < win_size) new_size <<= 1;
+  byte* new_ring = new byte[new_size];
+
+  if(ring)
   {
-    // the new packet is after the already-received packet.
-    TCPSegment* seg;
-    for(seg = seg_buffer; seg->next && seqno >= seg->next->seqno; seg = seg->next);
-    // check whether there is overlapping. when the loop stops, it
-    // must be either seg->next is NULL or seqno < seg->next->segno;
-    // therefore, the new packet can only overlap with the segment
-    // pointed by seg.
-    if(seqno < seg->seqno + seg->length)
-    {
-      // overlapping with an old packet
-      return false;
-    }
-    else if(seqno == seg->seqno + seg->length && !msg && !seg->msg)
+    // move the real bytes still in the buffer over to the new ring
+    int nblocks = real_blocks.size();
+    uint32* edges = new uint32[2*nblocks];
+    real_blocks.fetch_blocks(edges, nblocks);
+    for(int i=0; i<nblocks; i++)
     {
-      // contiguous packets and they both use fake data.
-      seg->length += length;
-      return true;
-    }
-    else
-    {
-      // non-overlapping, non-contiguous, just put it behind seg.
-      TCPSegment* new_seg = get_a_segment();
-      new_seg->set(seqno, length, msg, seg->next);
-      seg->next = new_seg;
-      return true;
+      for(uint32 seqno = edges[2*i]; seqno != edges[2*i+1]; seqno++)
+    	new_ring[seqno & (new_size-1)] = ring[seqno & (ring_size-1)];
     }
+    delete[] edges;
+    delete[] ring;
   }
+
+  ring = new_ring;
+  ring_size = new_size;
 }
 
-TCPSegment* TCPRecvWindow::get_a_segment()
+void TCPRecvWindow::ring_copy_in(uint32 seqno, uint32 length, byte* msg)
 {
-  if(free_seg_list)
-  {
-    TCPSegment* ret = free_seg_list;
-    free_seg_list = ret->next;
-    return ret;
-  }
-  else
-	return new TCPSegment();
+  uint32 offset = seqno & (ring_size-1);
+  uint32 first = mymin(length, ring_size - offset);
+  memcpy(ring + offset, msg, first);
+  if(length > first) memcpy(ring, msg + first, length - first);
 }
 
-void TCPRecvWindow::add_a_free_segment(TCPSegment* seg)
+void TCPRecvWindow::ring_copy_out(uint32 seqno, uint32 length, byte* msg)
 {
-  assert(seg);
-  seg->next = free_seg_list;
-  free_seg_list = seg;
+  uint32 offset = seqno & (ring_size-1);
+  uint32 first = mymin(length, ring_size - offset);
+  memcpy(msg, ring + offset, first);
+  if(length > first) memcpy(msg + first, ring, length - first);
 }
 
 }; // namespace s3fnet
@@ -9,45 +9,23 @@
 #define __TCP_RCVWND_H__
 
 #include "os/tcp/tcp_seqwnd.h"
+#include "os/tcp/tcp_blocks.h"
 
 namespace s3f {
 namespace s3fnet {
 
 class DataMessage;
-
-/**
- * \brief A TCP segment received by the TCP receiver.
- *
- * The received TCP segments are organized as a linked list in the
- * receive window.
- */
-class TCPSegment {
- public:
-  /** The default constructor. */
-  TCPSegment() {}
-
-  /** The constructor with given fields. */
-  TCPSegment(uint32 sno, uint32 len, byte* m, TCPSegment* nxt = 0) :
-    seqno(sno), length(len), msg(m), next(nxt) {}
-
-  /** Set the fields. */
-  void set(uint32 sno, uint32 len, byte* m, TCPSegment* nxt = 0) {
-    seqno = sno; length = len; msg = m; next = nxt;
-  }
-    
- public:
-  uint32 seqno; ///< The sequence number of the first byte of the segement.
-  uint32 length; ///< The length of the segment.
-  byte* msg; ///< Point to the data; NULL if it's fake data.
-  TCPSegment* next; ///< Point to the next segment.
-};
   
 /**
  * \brief The sliding window for TCP receiver.
  * 
- * We use a linked list as the buffer to store received packets. When
- * the upper layer requests to receive data, it will pop up data from
- * the linked list.
+ * Received data is reassembled in a contiguous ring buffer indexed
+ * by sequence number; the ranges of sequence numbers received (and
+ * the subset of those carrying real bytes rather than fake data) are
+ * tracked with block lists. When the upper layer requests to receive
+ * data, it is copied out of the ring buffer from the expected
+ * sequence number. The ring buffer is only allocated once real data
+ * arrives, so that sessions carrying fake data only never touch it.
  */
 class TCPRecvWindow: public TCPSeqWindow {
  public:
@@ -81,7 +59,7 @@ class TCPRecvWindow: public TCPSeqWindow {
    * necessary because an ACK packet may be sent out before the buffer
    * is released.
    */
-  uint32 getExpectedSeqno();
+  uint32 getExpectedSeqno() { return rcvd_blocks.unavailable(expect()); }
 
   // The following methods are used to interact (using signals) with
   // the protocol layer above.
@@ -103,25 +81,48 @@ class TCPRecvWindow: public TCPSeqWindow {
   /** Return the number of bytes received last time. */
   uint32 dataReceived() { return appl_data_rcvd; }
 
+  /** Set the application buffer again after the window is restored
+      from a checkpoint, if a receive is in progress. */
+  void restoreRecvBuffer(byte* buf)
+  {
+    if(appl_rcvbuf_size > 0) appl_rcvbuf = buf;
+  }
+
+  /** Save the window and the data it holds to a checkpoint. */
+  void save(Checkpoint* ckpt);
+
+  /** Restore the window and its data from a checkpoint; the
+      application buffer is set by restoreRecvBuffer(). */
+  void restore(Checkpoint* ckpt);
+
  private:
-  /** A helper function for addToBuffer. */
-  bool add_to_buffer_helper(uint32 seqno, uint32 length, byte* msg);
-  
   /**
-   * Return a free segment. We use a list to keep old segments to save
-   * time on memory allocation.
+   * A helper function for addToBuffer: put the segment into the
+   * buffer; if msg is NULL, it's fake data. The method returns true
+   * if any part of the segment is new.
    */
-  TCPSegment* get_a_segment();
+  bool add_to_buffer_helper(uint32 seqno, uint32 length, byte* msg);
+
+  /** Make sure the ring buffer can hold sequence numbers from the
+      expected one up to (but excluding) the given one. */
+  void reserve_ring(uint32 upto);
 
-  /** Add a segment to the free list. */
-  void add_a_free_segment(TCPSegment* seg);
+  /** Copy bytes between the ring buffer and a flat buffer. */
+  void ring_copy_in(uint32 seqno, uint32 length, byte* msg);
+  void ring_copy_out(uint32 seqno, uint32 length, byte* msg);
 
  private:
-  /** A buffer to put received segments. */
-  TCPSegment* seg_buffer;
+  /** Sequence numbers received but not yet delivered. */
+  TCPBlockList rcvd_blocks;
+
+  /** Sequence numbers received with real bytes stored in the ring. */
+  TCPBlockList real_blocks;
+
+  /** The ring buffer holding real bytes; NULL until needed. */
+  byte* ring;
 
-  /** A list of unused segments. */
-  TCPSegment* free_seg_list;
+  /** Size of the ring buffer; always a power of two. */
+  uint32 ring_size;
 
   /** The highest sequence number received. */
   uint32 highest_seqno;
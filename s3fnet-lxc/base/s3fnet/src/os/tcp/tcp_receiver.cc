@@ -267,7 +267,7 @@ bool TCPSession::process_ACK(TCPMessage* tcphdr, int& signal)
   case TCP_STATE_LAST_ACK:
     if(tcphdr->ackno == sndwnd->next())
     {
-      rxmit_timer_count = 0;
+      cancel_rxmit_timer();
       sndwnd->setFIN(false);  // ACK our FIN
       signal |= init_state_closed();
       // when connection is closed, we release the session
@@ -296,7 +296,7 @@ bool TCPSession::process_ACK(TCPMessage* tcphdr, int& signal)
   case TCP_STATE_CLOSING:
     if(tcphdr->ackno == sndwnd->next())
     {
-      rxmit_timer_count = 0;
+      cancel_rxmit_timer();
       sndwnd->setFIN(false);  // ACK our FIN
       signal |= init_state_time_wait();
     } 
@@ -305,7 +305,8 @@ bool TCPSession::process_ACK(TCPMessage* tcphdr, int& signal)
   case TCP_STATE_TIME_WAIT: 
     if(tcphdr->ackno == sndwnd->next())
     {
-      msl_timer_count = 0;
+      // the 2*msl timer expires at the next slow tick
+      set_msl_timer(0);
     }
     return false;
   }
@@ -369,13 +370,13 @@ void TCPSession::process_new_acks(TCPMessage* tcphdr, uint32 acked)
   // update retransmission timeout, and then update rtt. Is it right?
 
   // we don't need the retransmission timer any more
-  rxmit_timer_count = 0;
+  cancel_rxmit_timer();
   
   // if there's still packet on the fly, we should reset the timeout
   if(sndwnd->used() > 0)
   {
     // reschedule timer
-    rxmit_timer_count = timeout_value();
+    set_rxmit_timer();
   }
 
   // update timers. if data acked was RXMIT data then do not update
@@ -383,7 +384,7 @@ void TCPSession::process_new_acks(TCPMessage* tcphdr, uint32 acked)
   if(rtt_count && (tcphdr->ackno > measured_seq))
   {
     // Jakobson's Algorithm for timers (1988)
-    rtt_measured = rtt_count - 1;
+    rtt_measured = tcp_master->getSlowTick(now()) - rtt_start_tick;
     update_timeout();
   }
   
@@ -25,8 +25,16 @@ uint32 TCPSession::appl_send(uint32 length, byte* msg)
   // clear how much data has been buffered.
   sndwnd->clearDataBuffered();
 
-  // request to send out data
-  if(msg)
+  // request to send out data; in the size-only mode the bytes are
+  // ignored, and in the shared mode they are copied once into a buffer
+  // that the segments (and their retransmissions) only view
+  if(msg && payload_mode == PAYLOAD_SHARED)
+  {
+    PayloadBuffer* buf = new PayloadBuffer(length, msg);
+    sndwnd->requestToSendShared(buf, length);
+    buf->unref();
+  }
+  else if(msg && payload_mode == PAYLOAD_REAL)
   {
     byte* msgcpy = new byte[length]; assert(msgcpy);
     memcpy(msgcpy, msg, length);
@@ -92,6 +100,7 @@ void TCPSession::send_data(uint32 seqno, uint32 length, byte mask, uint32 ackno,
   {
     measured_seq = seqno;        
     rtt_count = 1;
+    rtt_start_tick = tcp_master->getSlowTick(now());
   }
   
   // Physically Send the Data
@@ -101,9 +110,9 @@ void TCPSession::send_data(uint32 seqno, uint32 length, byte mask, uint32 ackno,
   // if timer is not scheduled, schedule it and start RTT measurment;
   // whenever a segment is sent out, we should check whether we need
   // to start the retransmission timer
-  if(need_set_rextimeout && rxmit_timer_count == 0)
+  if(need_set_rextimeout && !rxmit_timer_set())
   {
-    rxmit_timer_count = timeout_value();
+    set_rxmit_timer();
   }
 }
 
@@ -144,7 +153,7 @@ uint32 TCPSession::segment_and_send(uint32 seqno, uint32 length)
 uint32 TCPSession::resend_segments(uint32 seqno, uint32 nsegments) 
 { 
   // first cancel retransmission timeout
-  rxmit_timer_count = 0;
+  cancel_rxmit_timer();
 
   // send up to nsegments
   uint32 bytes_sent = 0;
@@ -260,12 +269,14 @@ uint32 TCPSession::calc_advertised_wnd()
 void TCPSession::send_delay_ack()
 {
   delayed_ack = true;
-  tcp_master->enableFastTimeout(this);
+  // the delayed ack goes out at the next fast tick
+  if(!delayed_ack_timer.isSet())
+    tcp_master->setTimer(&delayed_ack_timer, tcp_master->fastTickAfter(now()));
 }
 
 void TCPSession::cancel_delay_ack()
 {
-  tcp_master->disableFastTimeout(this);
+  tcp_master->cancelTimer(&delayed_ack_timer);
   delayed_ack = false;
 }
 
@@ -9,6 +9,7 @@
 #define __TCP_SEQWND_H__
 
 #include "s3fnet.h"
+#include "net/checkpoint.h"
 
 namespace s3f {
 namespace s3fnet {
@@ -152,6 +153,20 @@ class TCPSeqWindow {
   /** Resets the window. */
   void reset() { used_size = 0; syn_included = fin_included = 0; }
 
+  /** Save the window to a checkpoint. */
+  void save(Checkpoint* ckpt)
+  {
+    ckpt->put(start_seqno); ckpt->put(win_size); ckpt->put(used_size);
+    ckpt->put(syn_included); ckpt->put(fin_included);
+  }
+
+  /** Restore the window from a checkpoint. */
+  void restore(Checkpoint* ckpt)
+  {
+    ckpt->get(start_seqno); ckpt->get(win_size); ckpt->get(used_size);
+    ckpt->get(syn_included); ckpt->get(fin_included);
+  }
+
  protected:
   /** Shift the window by the given offset permanently. */
   void seq_shift(uint32 offset) { start_seqno += offset; } 
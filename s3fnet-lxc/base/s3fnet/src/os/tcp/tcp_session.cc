@@ -32,14 +32,15 @@ TCPSession::TCPSession(TCPMaster* master, int sock) :
   rcvwnd(0), sndwnd(0), 
   rcvwnd_size(0), cwnd(0), ssthresh(0), mss(0), 
   ndupacks(0), nrxmits(0), persist_shift(0),
-  rtt_smoothed(0), rtt_measured(0), rtt_count(0), rtt_var(0),
+  rtt_smoothed(0), rtt_measured(0), rtt_count(0), rtt_start_tick(0), rtt_var(0),
   rxmit_seq(0), measured_seq(0), recover_seq(0), sack_pipe(0),
   delayed_ack(false), fast_recovery(false), 
   timeout_loss(false), sack_permitted(false), 
   close_issued(false), simultaneous_closing(false),
   snd_scoreboard(0), rcv_scoreboard(0),
   rxmit_timeout(0), idle_time(0),    
-  rxmit_timer_count(0), msl_timer_count(0)
+  rxmit_timer(this, RETX_TIMER), msl_timer(this, TWO_MSL_TIMER),
+  delayed_ack_timer(this, DELAYED_ACK_TIMER)
 {
   TCP_DUMP(printf("[host=\"%s\"] %s: new tcp session.\n",
 		  tcp_master->inHost()->nhi.toString(), tcp_master->getNowWithThousandSeparator()));
@@ -49,8 +50,13 @@ TCPSession::TCPSession(TCPMaster* master, int sock) :
 
 TCPSession::~TCPSession()
 {
+  tcp_master->cancelTimer(&rxmit_timer);
+  tcp_master->cancelTimer(&msl_timer);
+  tcp_master->cancelTimer(&delayed_ack_timer);
   if(rcvwnd) delete rcvwnd;
   if(sndwnd) delete sndwnd;
+  if(snd_scoreboard) delete snd_scoreboard;
+  if(rcv_scoreboard) delete rcv_scoreboard;
 }
 
 bool TCPSession::connect(IPADDR destip, uint16 destport)
@@ -247,14 +253,141 @@ void TCPSession::allocate_buffers()
   // allocate receive buffer
   rcvwnd = new TCPRecvWindow(0, tcp_master->getRcvWndSize());
   assert(rcvwnd);
+
+  // allocate the sack scoreboards; the receiver reports the most
+  // recently received blocks first (RFC 2018), while the sender
+  // walks its scoreboard in sequence order to find holes
+  if(TCPMaster::TCP_VERSION_SACK == tcp_master->getVersion())
+  {
+    snd_scoreboard = new TCPBlockList(TCPBlockList::PATTERN_INCREASE);
+    rcv_scoreboard = new TCPBlockList(TCPBlockList::PATTERN_UNSORTED);
+  }
 }
 
 void TCPSession::deallocate_buffers()
 {
   if(rcvwnd) { delete rcvwnd; rcvwnd = 0; }
   if(sndwnd) { delete sndwnd; sndwnd = 0; }
+  if(snd_scoreboard) { delete snd_scoreboard; snd_scoreboard = 0; }
+  if(rcv_scoreboard) { delete rcv_scoreboard; rcv_scoreboard = 0; }
 }
   
+void TCPSession::save(Checkpoint* ckpt)
+{
+  ckpt->put(prot_id);
+  ckpt->put(src_ip);
+  ckpt->put(dst_ip);
+  ckpt->put(src_port);
+  ckpt->put(dst_port);
+  ckpt->put(payload_mode);
+  ckpt->put(state);
+
+  ckpt->put(rcvwnd_size);
+  ckpt->put(cwnd);
+  ckpt->put(ssthresh);
+  ckpt->put(mss);
+  ckpt->put(ndupacks);
+  ckpt->put(nrxmits);
+  ckpt->put(persist_shift);
+  ckpt->put(rtt_smoothed);
+  ckpt->put(rtt_measured);
+  ckpt->put(rtt_count);
+  ckpt->put(rtt_start_tick);
+  ckpt->put(rtt_var);
+  ckpt->put(rxmit_seq);
+  ckpt->put(measured_seq);
+  ckpt->put(recover_seq);
+  ckpt->put(sack_pipe);
+  ckpt->put(delayed_ack);
+  ckpt->put(fast_recovery);
+  ckpt->put(timeout_loss);
+  ckpt->put(sack_permitted);
+  ckpt->put(close_issued);
+  ckpt->put(simultaneous_closing);
+  ckpt->put(rxmit_timeout);
+  ckpt->put(rxmit_timeout_double);
+  ckpt->put(idle_time);
+  ckpt->put(idle_time_double);
+
+  // the windows are allocated while the session is open; the
+  // scoreboards only with sack
+  bool has_sndwnd = (sndwnd != 0), has_rcvwnd = (rcvwnd != 0);
+  bool has_snd_scoreboard = (snd_scoreboard != 0), has_rcv_scoreboard = (rcv_scoreboard != 0);
+  ckpt->put(has_sndwnd);
+  if(has_sndwnd) sndwnd->save(ckpt);
+  ckpt->put(has_rcvwnd);
+  if(has_rcvwnd) rcvwnd->save(ckpt);
+  ckpt->put(has_snd_scoreboard);
+  if(has_snd_scoreboard) snd_scoreboard->save(ckpt);
+  ckpt->put(has_rcv_scoreboard);
+  if(has_rcv_scoreboard) rcv_scoreboard->save(ckpt);
+}
+
+void TCPSession::restore(Checkpoint* ckpt)
+{
+  ckpt->get(prot_id);
+  ckpt->get(src_ip);
+  ckpt->get(dst_ip);
+  ckpt->get(src_port);
+  ckpt->get(dst_port);
+  ckpt->get(payload_mode);
+  ckpt->get(state);
+
+  ckpt->get(rcvwnd_size);
+  ckpt->get(cwnd);
+  ckpt->get(ssthresh);
+  ckpt->get(mss);
+  ckpt->get(ndupacks);
+  ckpt->get(nrxmits);
+  ckpt->get(persist_shift);
+  ckpt->get(rtt_smoothed);
+  ckpt->get(rtt_measured);
+  ckpt->get(rtt_count);
+  ckpt->get(rtt_start_tick);
+  ckpt->get(rtt_var);
+  ckpt->get(rxmit_seq);
+  ckpt->get(measured_seq);
+  ckpt->get(recover_seq);
+  ckpt->get(sack_pipe);
+  ckpt->get(delayed_ack);
+  ckpt->get(fast_recovery);
+  ckpt->get(timeout_loss);
+  ckpt->get(sack_permitted);
+  ckpt->get(close_issued);
+  ckpt->get(simultaneous_closing);
+  ckpt->get(rxmit_timeout);
+  ckpt->get(rxmit_timeout_double);
+  ckpt->get(idle_time);
+  ckpt->get(idle_time_double);
+
+  deallocate_buffers();
+  bool has;
+  ckpt->get(has);
+  if(has)
+  {
+    sndwnd = new TCPSendWindow(0, tcp_master->getSndBufSize(), tcp_master->getSndWndSize());
+    sndwnd->restore(ckpt);
+  }
+  ckpt->get(has);
+  if(has)
+  {
+    rcvwnd = new TCPRecvWindow(0, tcp_master->getRcvWndSize());
+    rcvwnd->restore(ckpt);
+  }
+  ckpt->get(has);
+  if(has)
+  {
+    snd_scoreboard = new TCPBlockList(TCPBlockList::PATTERN_INCREASE);
+    snd_scoreboard->restore(ckpt);
+  }
+  ckpt->get(has);
+  if(has)
+  {
+    rcv_scoreboard = new TCPBlockList(TCPBlockList::PATTERN_UNSORTED);
+    rcv_scoreboard->restore(ckpt);
+  }
+}
+
 void TCPSession::reset()
 {
   // go to closed state
@@ -40,6 +40,15 @@ class TCPSession : public SocketSession {
     TCP_STATE_TIME_WAIT    = 10
   };
 
+  // ids of the timers kept by a tcp session
+  enum {
+    RETX_TIMER        = 0,
+    PERSIST_TIMER     = 1,
+    KEEP_ALIVE_TIMER  = 2,
+    TWO_MSL_TIMER     = 3,
+    DELAYED_ACK_TIMER = 4
+  };
+
   /** The constructor. */
   TCPSession(TCPMaster* master, int sock);
 
@@ -92,17 +101,24 @@ class TCPSession : public SocketSession {
 
   /** Release this session if unnecessary. */
   virtual void release();
+
+  /** Set the application buffer of the receive in progress again. */
+  virtual void restoreRecvBuffer(byte* buf) { if(rcvwnd) rcvwnd->restoreRecvBuffer(buf); }
   
   /* Functions to be called by the tcp master. */
 
   /** Receive the message popped up from the ip session. */
   void receive(TCPMessage* tcphdr);
 
-  /** Slow timeout handler (in tcp_tmr.cc). */ 
-  void slowTimeoutHandling();  
+  /** Handle the expiration of one of the session's timers (in tcp_timer.cc). */
+  void timeoutHandling(TCPTimer* timer);
+
+  /** Save the state of the session, with its windows, to a
+      checkpoint; the timers are saved by the tcp master. */
+  void save(Checkpoint* ckpt);
 
-  /** Fast timeout handler (in tcp_tmr.cc). */
-  void fastTimeoutHandling();
+  /** Restore the state of the session from a checkpoint. */
+  void restore(Checkpoint* ckpt);
 
  private:
   /** Point to the tcp master. */
@@ -147,9 +163,12 @@ class TCPSession : public SocketSession {
   /** Measured round trip time. */
   int rtt_measured;
 
-  /** The current RTT count. */
+  /** Non-zero if a segment is being timed for RTT measurement. */
   int rtt_count;
 
+  /** The slow tick at which the RTT measurement started. */
+  long rtt_start_tick;
+
   /** Current estimated RTT variance. */
   int rtt_var;
 
@@ -197,14 +216,14 @@ class TCPSession : public SocketSession {
   ltime_t idle_time;
   double idle_time_double;
 
-  /** Retransmission timer count. */
-  ltime_t rxmit_timer_count;
-  double rxmit_timer_count_double;
+  /** The retransmission timer. */
+  TCPTimer rxmit_timer;
 
+  /** The timer that lasts 2*msl. */
+  TCPTimer msl_timer;
 
-  /** The timer count that lasts 2*msl. */
-  ltime_t msl_timer_count;
-  double msl_timer_count_double;
+  /** The timer for sending out the delayed ACK. */
+  TCPTimer delayed_ack_timer;
 
  private:
   //
@@ -374,6 +393,25 @@ class TCPSession : public SocketSession {
   /** Slow timeout handler with a given timer id. */
   uint32 slow_timeout_handling_helper(const uint32 timerid);
 
+  /** Fast timeout handler; sends out the delayed ACK. */
+  void fast_timeout_handling();
+
+  /** Start the retransmission timer with the current timeout value. */
+  void set_rxmit_timer();
+
+  /** Stop the retransmission timer. */
+  void cancel_rxmit_timer() { tcp_master->cancelTimer(&rxmit_timer); }
+
+  /** Return true if the retransmission timer is running. */
+  bool rxmit_timer_set() { return rxmit_timer.isSet(); }
+
+  /** Start the 2*msl timer with the given duration; a non-positive
+      duration expires at the next slow tick. */
+  void set_msl_timer(ltime_t duration);
+
+  /** Stop the 2*msl timer. */
+  void cancel_msl_timer() { tcp_master->cancelTimer(&msl_timer); }
+
   /** Update the current smoothed RTT timeout with the new rtt
       measurment. */
   void update_timeout();
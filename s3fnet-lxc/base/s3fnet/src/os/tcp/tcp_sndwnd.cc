@@ -60,7 +60,12 @@ DataMessage* TCPSendWindow::generate(uint32 seqno, uint32 length)
   {
     byte* payload;
     // the current node can satisfy the data length requested.
-    if(node->real_data)
+    if(node->shared)
+    {
+      // the message views the same shared buffer; nothing is copied
+      return new DataMessage(length, node->shared, node->real_data+offset-node->shared->data);
+    }
+    else if(node->real_data)
     {
       // if the current node carries real data, it is the first node
       // and, at the same time, the current node can satisfy the data
@@ -90,11 +95,31 @@ DataMessage* TCPSendWindow::generate(uint32 seqno, uint32 length)
       int len = mymin(node->real_length-offset, cur_length);
       
       assert(node);
-      if(node->real_data)
+      if(node->shared)
+      {
+    	// put a chunk viewing the same shared buffer at the tail
+    	DataChunk* msg_node = new DataChunk(len, node->shared, node->real_data+offset-node->shared->data);
+    	if(!msglist_head)
+    	{
+    	  msglist_head = msglist_tail = msg_node;
+    	}
+    	else
+    	{
+    	  msglist_tail->next = msg_node;
+    	  msglist_tail = msg_node;
+    	}
+
+    	if((cur_length -= len) > 0)
+    	{
+    	  node = node->next;
+    	  offset = 0;
+    	}
+      }
+      else if(node->real_data)
       {
     	// look ahead to see how many real data ahead; we want to consolidate the real data here...
     	int contiguous_len = len;
-    	for(DataChunk* pnode = node->next; pnode && pnode->real_data; pnode = pnode->next)
+    	for(DataChunk* pnode = node->next; pnode && pnode->real_data && !pnode->shared; pnode = pnode->next)
     	{
     	  if(pnode->real_length+contiguous_len >= cur_length)
     	  {
@@ -187,7 +212,18 @@ void TCPSendWindow::release(uint32 length)
 
 void TCPSendWindow::requestToSend(byte* msg, uint32 msg_len)
 { 
-  DataChunk* datachk = new DataChunk(msg_len, msg);
+  append_chunk(new DataChunk(msg_len, msg));
+}
+
+void TCPSendWindow::requestToSendShared(PayloadBuffer* buf, uint32 msg_len)
+{
+  assert(buf && msg_len <= buf->size);
+  append_chunk(new DataChunk(msg_len, buf, 0));
+}
+
+void TCPSendWindow::append_chunk(DataChunk* datachk)
+{
+  uint32 msg_len = datachk->real_length;
   if(tail_chunk)
   {
     assert(head_chunk);
@@ -198,7 +234,7 @@ void TCPSendWindow::requestToSend(byte* msg, uint32 msg_len)
   {
     assert(!first_raw_data && !head_chunk);
     head_chunk = tail_chunk = datachk;
-    first_raw_data = datachk->real_data;
+    first_raw_data = datachk->shared ? 0 : datachk->real_data;
   }
 
   // how much data is been requested to send currently
@@ -218,7 +254,7 @@ void TCPSendWindow::reset()
   // entire list
   if(head_chunk)
   {
-    if(head_chunk->real_data) 
+    if(head_chunk->real_data && !head_chunk->shared)
       head_chunk->real_data = first_raw_data;
     delete head_chunk;
   }
@@ -227,6 +263,76 @@ void TCPSendWindow::reset()
   first_raw_data = 0;
 }
 
+void TCPSendWindow::save(Checkpoint* ckpt)
+{
+  TCPSeqWindow::save(ckpt);
+  ckpt->put(buffer_size);
+  ckpt->put(length_in_buffer);
+  ckpt->put(length_in_request);
+  ckpt->put(length_buffered);
+
+  // each chunk is saved with the bytes it still holds (the head chunk
+  // may have been released in part); a chunk viewing a shared payload
+  // buffer gets a buffer of its own when restored
+  uint32 n = 0;
+  for(DataChunk* node = head_chunk; node; node = node->next) n++;
+  ckpt->put(n);
+  for(DataChunk* node = head_chunk; node; node = node->next)
+  {
+    byte kind = node->shared ? 2 : (node->real_data ? 1 : 0);
+    ckpt->put(node->real_length);
+    ckpt->put(kind);
+    if(kind) ckpt->write(node->real_data, node->real_length);
+  }
+}
+
+void TCPSendWindow::restore(Checkpoint* ckpt)
+{
+  reset();
+  TCPSeqWindow::restore(ckpt);
+  ckpt->get(buffer_size);
+  ckpt->get(length_in_buffer);
+  ckpt->get(length_in_request);
+  ckpt->get(length_buffered);
+
+  uint32 n;
+  ckpt->get(n);
+  for(uint32 i=0; i<n; i++)
+  {
+    uint32 len;
+    byte kind;
+    ckpt->get(len);
+    ckpt->get(kind);
+
+    DataChunk* node;
+    if(kind == 2)
+    {
+      PayloadBuffer* buf = new PayloadBuffer(len);
+      ckpt->read(buf->data, len);
+      node = new DataChunk(len, buf, 0);
+      buf->unref();
+    }
+    else if(kind == 1)
+    {
+      byte* data = new byte[len];
+      ckpt->read(data, len);
+      node = new DataChunk(len, data);
+    }
+    else node = new DataChunk(len);
+
+    if(tail_chunk)
+    {
+      tail_chunk->next = node;
+      tail_chunk = node;
+    }
+    else
+    {
+      head_chunk = tail_chunk = node;
+      first_raw_data = (kind == 1) ? node->real_data : 0;
+    }
+  }
+}
+
 void TCPSendWindow::add_to_buffer(uint32 length)
 {
   assert(length_in_buffer + length <= buffer_size);
@@ -270,7 +376,7 @@ void TCPSendWindow::release_buffer(uint32 length)
       if(first_raw_data) delete[] first_raw_data;
       if(head_chunk)
       {
-    	first_raw_data = head_chunk->real_data;
+    	first_raw_data = head_chunk->shared ? 0 : head_chunk->real_data;
       }
       else
       {
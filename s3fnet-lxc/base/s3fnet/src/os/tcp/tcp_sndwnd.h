@@ -41,12 +41,23 @@ class TCPSendWindow: public TCPSeqWindow {
    */
   bool needToRequest() { return length_in_request <= 0; }
 
-  /** Request to send new data. */
+  /** Request to send new data; the window takes the ownership of
+      msg (NULL for fake data). */
   void requestToSend(byte* msg, uint32 length);
 
+  /** Request to send new data viewing a shared payload buffer; the
+      window adds its own reference to the buffer. */
+  void requestToSendShared(PayloadBuffer* buf, uint32 length);
+
   /** Reset the window. */
   void reset();
 
+  /** Save the window and the data it holds to a checkpoint. */
+  void save(Checkpoint* ckpt);
+
+  /** Restore the window and its data from a checkpoint. */
+  void restore(Checkpoint* ckpt);
+
  public:
   /** Returns how much of the buffer is used. */
   uint32 dataInBuffer()  { return length_in_buffer; }
@@ -81,6 +92,9 @@ class TCPSendWindow: public TCPSeqWindow {
    */
   void add_to_buffer(uint32 length);
 
+  /** Append a data chunk to the list of data requested to be sent. */
+  void append_chunk(DataChunk* datachk);
+
  protected:
   /** Buffer size. */
   uint32 buffer_size;
@@ -107,7 +121,8 @@ class TCPSendWindow: public TCPSeqWindow {
    * move the left unacknowledged data to it.  Instead, in order to
    * optimize the performance, we simply keep a pointer as the offset
    * to the raw message. If the first whole block is released, we can
-   * delete this raw message.
+   * delete this raw message. It is NULL if the first block is fake or
+   * views a shared payload buffer.
    */
   byte* first_raw_data;
 };
@@ -22,8 +22,8 @@ int TCPSession::init_state_closed()
   state = TCP_STATE_CLOSED;
 
   // reset all the variables
-  rxmit_timer_count  = 0;
-  msl_timer_count  = 0;
+  cancel_rxmit_timer();
+  cancel_msl_timer();
   rcvwnd_size = tcp_master->getRcvWndSize();
   cwnd = tcp_master->getMSS();
   ssthresh = tcp_master->getInitThresh();
@@ -108,8 +108,8 @@ int TCPSession::init_state_listen()
   state = TCP_STATE_LISTEN;
 
   // cancel any timers
-  rxmit_timer_count = 0;
-  msl_timer_count = 0;
+  cancel_rxmit_timer();
+  cancel_msl_timer();
 
   return 0;
 }
@@ -132,7 +132,7 @@ int TCPSession::init_state_close_wait()
   int signal = 0;
 
   state = TCP_STATE_CLOSE_WAIT;
-  rxmit_timer_count = 0;
+  cancel_rxmit_timer();
  
   // at this point we have received a FIN, so if nothing in receive
   // window, there won't be, so signal EOF to application
@@ -181,7 +181,6 @@ int TCPSession::init_state_fin_wait_1()
 	      TCPMessage::TCP_FLAG_FIN | TCPMessage::TCP_FLAG_ACK,
 	      rcvwnd->expect(), true, true);
     cancel_delay_ack();
-    tcp_master->disableFastTimeout(this);
   }
   else
   {
@@ -202,7 +201,7 @@ int TCPSession::init_state_fin_wait_2()
   state = TCP_STATE_FIN_WAIT_2;
 
   // schedules timeout so we don't wait forever
-  rxmit_timer_count = 0;    
+  cancel_rxmit_timer();    
 
   return 0;
 }
@@ -227,7 +226,7 @@ int TCPSession::init_state_time_wait()
   state = TCP_STATE_TIME_WAIT;
  
   // set up the 2*msl timeout
-  msl_timer_count = TCP_DEFAULT_MSL_TIMEOUT_FACTOR * tcp_master->getMSL();
+  set_msl_timer(TCP_DEFAULT_MSL_TIMEOUT_FACTOR * tcp_master->getMSL());
 
   return 0;
 }
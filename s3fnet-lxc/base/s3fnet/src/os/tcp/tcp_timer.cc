@@ -17,54 +17,44 @@ namespace s3fnet {
 #define TCP_DUMP(x)
 #endif
 
-// various timer ids and timeout values
-#define RETX_TIMER                    0
-#define PERSIST_TIMER                 1
-#define KEEP_ALIVE_TIMER              2
-#define TWO_MSL_TIMER                 3
-
 static int tcp_backoff[] =
   { 1, 2, 4, 8, 16, 32, 64, 64, 64, 64, 64, 64, 64 };
 
-void TCPSession::slowTimeoutHandling()
+void TCPSession::timeoutHandling(TCPTimer* timer)
 {
-  uint32 signal = 0;
-
-  // update measured RTT
-  if(rtt_count) rtt_count++;
-  TCP_DUMP(printf("[host=\"%s\"] %s: slowTimeoutHandling(), rtt=%d, rxmit=%ld, msl=%ld.\n",
+  TCP_DUMP(printf("[host=\"%s\"] %s: timeoutHandling(), timer=%d, rtt=%d.\n",
 		  tcp_master->inHost()->nhi.toString(),
-		  tcp_master->getNowWithThousandSeparator(), rtt_count,
-		  rxmit_timer_count, msl_timer_count));
-
-  // update retransmission timer. if the count is set as 0, then it's
-  // not a valid timer, meaning that the timer is not set.
-  if(rxmit_timer_count > 0)
-  {
-    rxmit_timer_count -= tcp_master->getSlowTimeout();
-    
-    // if it's time out, handle it.
-    if(rxmit_timer_count <= 0)
-      signal |= slow_timeout_handling_helper(RETX_TIMER);
-  }
+		  tcp_master->getNowWithThousandSeparator(), timer->timer_id, rtt_count));
 
-  // update 2msl timer. 
-  if(msl_timer_count > 0)
-  {
-    msl_timer_count -= tcp_master->getSlowTimeout();
-    
-    // if it's time out, handle it.
-    if(msl_timer_count <= 0)
-      signal |= slow_timeout_handling_helper(TWO_MSL_TIMER);
-  }
-  else if(state == TCP_STATE_TIME_WAIT)
+  if(timer->timer_id == DELAYED_ACK_TIMER)
   {
-    signal |= slow_timeout_handling_helper(TWO_MSL_TIMER);
+    fast_timeout_handling();
+    return;
   }
 
+  uint32 signal = slow_timeout_handling_helper(timer->timer_id);
   if(signal) wake_app(signal);
 }
 
+void TCPSession::set_rxmit_timer()
+{
+  // the timer expires on the slow tick at which the BSD-style
+  // countdown (decremented by one slow timeout each tick) would
+  // reach zero
+  ltime_t slow = tcp_master->getSlowTimeout();
+  long nticks = (long)((timeout_value() + slow - 1) / slow);
+  if(nticks < 1) nticks = 1;
+  tcp_master->setTimer(&rxmit_timer, tcp_master->slowTickAfter(now(), nticks));
+}
+
+void TCPSession::set_msl_timer(ltime_t duration)
+{
+  ltime_t slow = tcp_master->getSlowTimeout();
+  long nticks = (duration > 0) ? (long)((duration + slow - 1) / slow) : 1;
+  if(nticks < 1) nticks = 1;
+  tcp_master->setTimer(&msl_timer, tcp_master->slowTickAfter(now(), nticks));
+}
+
 uint32 TCPSession::slow_timeout_handling_helper(uint32 timerid)
 {
   uint32 signal = 0;
@@ -99,7 +89,7 @@ uint32 TCPSession::slow_timeout_handling_helper(uint32 timerid)
       }
 
       // cancel retransmission timer
-      rxmit_timer_count = 0;
+      cancel_rxmit_timer();
       // we should resend the packet assumed to get lost
       timeout_resend();
     }
@@ -114,6 +104,9 @@ uint32 TCPSession::slow_timeout_handling_helper(uint32 timerid)
   else if(timerid == TWO_MSL_TIMER)
   {
     assert(state == TCP_STATE_TIME_WAIT);
+    // keep signaling on every slow tick for as long as the session
+    // stays in TIME_WAIT, as the periodic slow timer used to do
+    set_msl_timer(0);
     signal |= (SocketSignal::CONN_CLOSED | 
 	       SocketSignal::SESSION_RELEASED);
   }
@@ -122,7 +115,7 @@ uint32 TCPSession::slow_timeout_handling_helper(uint32 timerid)
   return signal;
 }
 
-void TCPSession::fastTimeoutHandling()
+void TCPSession::fast_timeout_handling()
 {
   if(delayed_ack)
   {
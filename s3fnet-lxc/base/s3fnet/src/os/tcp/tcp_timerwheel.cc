@@ -0,0 +1,124 @@
+/**
+ * \file tcp_timerwheel.cc
+ * \brief Source file for the TCPTimerWheel class.
+ *
+ * authors : Dong (Kevin) Jin
+ */
+
+#include "os/tcp/tcp_timerwheel.h"
+#include <string.h>
+
+namespace s3f {
+namespace s3fnet {
+
+TCPTimerWheel::TCPTimerWheel() : granularity(1), cursor(0), count(0)
+{
+  memset(slots, 0, sizeof(slots));
+}
+
+TCPTimerWheel::~TCPTimerWheel()
+{
+  // the timers are owned by the tcp sessions; just unlink them
+  for(int i=0; i<TCP_TIMER_WHEEL_SLOTS; i++)
+  {
+    while(slots[i]) cancel(slots[i]);
+  }
+}
+
+void TCPTimerWheel::schedule(TCPTimer* timer, ltime_t deadline)
+{
+  assert(timer);
+  if(timer->isSet()) cancel(timer);
+
+  timer->deadline = deadline;
+  timer->slot = slot_of(deadline);
+  timer->prev = 0;
+  timer->next = slots[timer->slot];
+  if(timer->next) timer->next->prev = timer;
+  slots[timer->slot] = timer;
+  count++;
+}
+
+void TCPTimerWheel::cancel(TCPTimer* timer)
+{
+  assert(timer);
+  if(!timer->isSet()) return;
+
+  if(timer->prev) timer->prev->next = timer->next;
+  else slots[timer->slot] = timer->next;
+  if(timer->next) timer->next->prev = timer->prev;
+  timer->prev = timer->next = 0;
+  timer->slot = -1;
+  count--;
+}
+
+void TCPTimerWheel::getPending(S3FNET_VECTOR(TCPTimer*)& timers)
+{
+  for(int i=0; i<TCP_TIMER_WHEEL_SLOTS; i++)
+  {
+    for(TCPTimer* t = slots[i]; t; t = t->next)
+      timers.push_back(t);
+  }
+}
+
+ltime_t TCPTimerWheel::earliest()
+{
+  if(count == 0) return -1;
+
+  // walk one revolution from the cursor; the first slot holding a
+  // timer of the current revolution holds the earliest deadline
+  ltime_t w = cursor / granularity;
+  for(int i=0; i<TCP_TIMER_WHEEL_SLOTS; i++, w++)
+  {
+    ltime_t window_end = (w+1)*granularity;
+    ltime_t found = -1;
+    for(TCPTimer* t = slots[w & (TCP_TIMER_WHEEL_SLOTS-1)]; t; t = t->next)
+    {
+      if(t->deadline < window_end && (found < 0 || t->deadline < found))
+        found = t->deadline;
+    }
+    if(found >= 0) return found;
+  }
+
+  // all pending timers are more than one revolution away
+  ltime_t found = -1;
+  for(int i=0; i<TCP_TIMER_WHEEL_SLOTS; i++)
+  {
+    for(TCPTimer* t = slots[i]; t; t = t->next)
+    {
+      if(found < 0 || t->deadline < found) found = t->deadline;
+    }
+  }
+  return found;
+}
+
+TCPTimer* TCPTimerWheel::expire(ltime_t now)
+{
+  if(count == 0)
+  {
+    if(now > cursor) cursor = now;
+    return 0;
+  }
+
+  ltime_t w = cursor / granularity;
+  ltime_t w_end = now / granularity;
+  if(w_end - w >= TCP_TIMER_WHEEL_SLOTS) w_end = w + TCP_TIMER_WHEEL_SLOTS - 1;
+  for(; w <= w_end; w++)
+  {
+    for(TCPTimer* t = slots[w & (TCP_TIMER_WHEEL_SLOTS-1)]; t; t = t->next)
+    {
+      if(t->deadline <= now)
+      {
+        if(w*granularity > cursor) cursor = w*granularity;
+        cancel(t);
+        return t;
+      }
+    }
+  }
+
+  if(now > cursor) cursor = now;
+  return 0;
+}
+
+}; // namespace s3fnet
+}; // namespace s3f
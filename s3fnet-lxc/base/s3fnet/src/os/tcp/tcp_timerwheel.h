@@ -0,0 +1,134 @@
+/**
+ * \file tcp_timerwheel.h
+ * \brief Header file for the TCPTimer and TCPTimerWheel classes.
+ *
+ * authors : Dong (Kevin) Jin
+ */
+
+#ifndef __TCP_TIMERWHEEL_H__
+#define __TCP_TIMERWHEEL_H__
+
+#include "s3f.h"
+#include "util/shstl.h"
+
+namespace s3f {
+namespace s3fnet {
+
+class TCPSession;
+
+/** Number of slots in a TCP timer wheel; must be a power of two. */
+#define TCP_TIMER_WHEEL_SLOTS 512
+
+/**
+ * \brief A deadline timer owned by a TCP session.
+ *
+ * The timer is embedded in the TCP session and linked into the
+ * TCP master's timer wheel while it is pending, so that setting and
+ * cancelling the timer never allocates memory.
+ */
+class TCPTimer {
+  friend class TCPTimerWheel;
+
+ public:
+  /** The constructor. */
+  TCPTimer(TCPSession* sess, int id) :
+    session(sess), timer_id(id), deadline(0), slot(-1), prev(0), next(0) {}
+
+  /** Return true if the timer is pending in a timer wheel. */
+  bool isSet() { return slot >= 0; }
+
+  /** Return the absolute simulation time at which the timer expires. */
+  ltime_t getDeadline() { return deadline; }
+
+  /** The TCP session owning this timer. */
+  TCPSession* session;
+
+  /** Identify which of the session's timers this is. */
+  int timer_id;
+
+ private:
+  /** The absolute expiration time. */
+  ltime_t deadline;
+
+  /** The slot in the timer wheel; -1 if not pending. */
+  int slot;
+
+  /** Links of the doubly-linked slot list. */
+  TCPTimer* prev;
+  TCPTimer* next;
+};
+
+/**
+ * \brief A hashed timing wheel holding the pending TCP timers of a host.
+ *
+ * Timers are hashed into slots by their deadline at the given
+ * granularity; timers further in the future than one revolution of
+ * the wheel simply share a slot with nearer ones and are skipped
+ * until their own revolution comes. Both setting and cancelling a
+ * timer take constant time. The TCP master asks the wheel for the
+ * earliest pending deadline so that it only needs to keep a single
+ * simulation event outstanding.
+ */
+class TCPTimerWheel {
+ public:
+  /** The constructor. */
+  TCPTimerWheel();
+
+  /** The destructor. */
+  ~TCPTimerWheel();
+
+  /** Set the time covered by each slot; must be called before any timer is set. */
+  void setGranularity(ltime_t g) { granularity = (g > 0) ? g : 1; }
+
+  /** Set (or reset) the timer to expire at the given absolute time. */
+  void schedule(TCPTimer* timer, ltime_t deadline);
+
+  /** Remove the timer from the wheel if it is pending. */
+  void cancel(TCPTimer* timer);
+
+  /** Return the earliest pending deadline, or -1 if the wheel is empty. */
+  ltime_t earliest();
+
+  /**
+   * Remove and return one timer whose deadline is no later than the
+   * given time, or NULL if no such timer is pending.
+   */
+  TCPTimer* expire(ltime_t now);
+
+  /** Return the number of pending timers. */
+  int size() { return count; }
+
+  /**
+   * Append the pending timers to the given vector, slot by slot and
+   * in the order of each slot list; scheduling them again from the
+   * last to the first rebuilds the same slot lists.
+   */
+  void getPending(S3FNET_VECTOR(TCPTimer*)& timers);
+
+  /** Return the time before which all timers have been expired. */
+  ltime_t getCursor() { return cursor; }
+
+  /** Set the time before which all timers have been expired. */
+  void setCursor(ltime_t t) { cursor = t; }
+
+ private:
+  /** Return the slot index of the given time. */
+  int slot_of(ltime_t t) { return (int)((t / granularity) & (TCP_TIMER_WHEEL_SLOTS-1)); }
+
+  /** Slot lists of pending timers. */
+  TCPTimer* slots[TCP_TIMER_WHEEL_SLOTS];
+
+  /** Time covered by each slot. */
+  ltime_t granularity;
+
+  /** All timers with deadlines before this time have been expired. */
+  ltime_t cursor;
+
+  /** Number of pending timers. */
+  int count;
+};
+
+}; // namespace s3fnet
+}; // namespace s3f
+
+#endif /*__TCP_TIMERWHEEL_H__*/
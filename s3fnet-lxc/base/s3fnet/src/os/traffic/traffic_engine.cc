@@ -0,0 +1,413 @@
+/**
+ * \file traffic_engine.cc
+ * \brief Source file for the TrafficEngineSession class.
+ *
+ * authors : Dong (Kevin) Jin
+ */
+
+#include <math.h>
+#include <pthread.h>
+#include "os/traffic/traffic_engine.h"
+#include "os/traffic/traffic_message.h"
+#include "os/ipv4/ip_session.h"
+#include "os/ipv4/ip_interface.h"
+#include "os/base/protocols.h"
+#include "util/errhandle.h"
+#include "net/host.h"
+#include "net/net.h"
+#include "net/traffic.h"
+#include "net/checkpoint.h"
+#include "env/namesvc.h"
+
+#ifdef TRAFFIC_ENGINE_DEBUG
+#define TENG_DUMP(x) printf("TENG: "); x
+#else
+#define TENG_DUMP(x)
+#endif
+
+namespace s3f {
+namespace s3fnet {
+
+S3FNET_REGISTER_PROTOCOL(TrafficEngineSession, TRAFFIC_ENGINE_PROTOCOL_CLASSNAME);
+
+// all the traffic engines, for the report at the end of the
+// simulation; the engines are initialized in parallel
+static S3FNET_VECTOR(TrafficEngineSession*) all_engines;
+static pthread_mutex_t all_engines_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+// read a non-negative number from the given attribute
+static double config_double(s3f::dml::Configuration* cfg, char* attr, double dflt)
+{
+  char* str = (char*)cfg->findSingle(attr);
+  if(!str) return dflt;
+  if(s3f::dml::dmlConfig::isConf(str))
+    error_quit("ERROR: TrafficEngineSession::config(), invalid %s attribute.\n", attr);
+  double v = atof(str);
+  if(v < 0)
+    error_quit("ERROR: TrafficEngineSession::config(), %s attribute must be non-negative.\n", attr);
+  return v;
+}
+
+TrafficEngineSession::TrafficEngineSession(ProtocolGraph* graph) : ProtocolSession(graph),
+  ip_session(0), timers(0), next_flow_id(0), rand_next(TRAFFIC_ENGINE_RANDOM_BATCH),
+  flows_started(0), flows_completed(0), flows_rejected(0), active_flows(0), peak_flows(0),
+  pkts_sent(0), bytes_sent(0), pkts_rcvd(0), bytes_rcvd(0)
+{
+  TENG_DUMP(printf("A traffic engine session is created.\n"));
+}
+
+TrafficEngineSession::~TrafficEngineSession()
+{
+  TENG_DUMP(printf("A traffic engine session is reclaimed.\n"));
+  if(timers) delete timers;
+}
+
+void TrafficEngineSession::config(s3f::dml::Configuration* cfg)
+{
+  // the same method at the parent class must be called
+  ProtocolSession::config(cfg);
+
+  char* str = (char*)cfg->findSingle("server_list");
+  if(str)
+  {
+    if(s3f::dml::dmlConfig::isConf(str))
+      error_quit("ERROR: TrafficEngineSession::config(), invalid SERVER_LIST attribute.\n");
+    server_list = str;
+  }
+
+  flow_rate = config_double(cfg, "flow_rate", 0);
+  flow_size_mean = config_double(cfg, "flow_size_mean", 100000);
+  flow_size_shape = config_double(cfg, "flow_size_shape", 1.5);
+  if(flow_size_shape > 0 && flow_size_shape <= 1)
+    error_quit("ERROR: TrafficEngineSession::config(), flow_size_shape must be greater than 1 "
+	       "(or 0 for flows of constant size).\n");
+  flow_size_max = config_double(cfg, "flow_size_max", 1e9);
+  if(flow_size_max < 1 || flow_size_max > 4e9)
+    error_quit("ERROR: TrafficEngineSession::config(), flow_size_max must be between 1 and 4e9.\n");
+
+  double d = config_double(cfg, "packet_size", 1000);
+  if(d < 1) error_quit("ERROR: TrafficEngineSession::config(), packet_size must be positive.\n");
+  packet_size = (uint32)d;
+  d = config_double(cfg, "packet_rate", 100);
+  if(d <= 0) error_quit("ERROR: TrafficEngineSession::config(), packet_rate must be positive.\n");
+  packet_interval = inHost()->d2t(1.0/d, 0);
+
+  on_time = config_double(cfg, "on_time", 0);
+  off_time = config_double(cfg, "off_time", 0);
+
+  diurnal_amplitude = config_double(cfg, "diurnal_amplitude", 0);
+  if(diurnal_amplitude > 1)
+    error_quit("ERROR: TrafficEngineSession::config(), diurnal_amplitude must not exceed 1.\n");
+  diurnal_period = config_double(cfg, "diurnal_period", 86400);
+  if(diurnal_period == 0)
+    error_quit("ERROR: TrafficEngineSession::config(), diurnal_period must be positive.\n");
+  diurnal_peak = config_double(cfg, "diurnal_peak", 0);
+
+  max_flows = (uint32)config_double(cfg, "max_flows", 0);
+  start_time = inHost()->d2t(config_double(cfg, "start_time", 0), 0);
+  stop_time = inHost()->d2t(config_double(cfg, "stop_time", 0), 0);
+
+  str = (char*)cfg->findSingle("show_report");
+  if(str)
+  {
+    if(s3f::dml::dmlConfig::isConf(str))
+      error_quit("ERROR: TrafficEngineSession::config(), invalid SHOW_REPORT attribute.\n");
+    if(!strcasecmp(str, "true")) show_report = true;
+    else if(!strcasecmp(str, "false")) show_report = false;
+    else error_quit("ERROR: TrafficEngineSession::config(), invalid SHOW_REPORT attribute (%s).\n", str);
+  }
+  else show_report = false;
+
+  TENG_DUMP(printf("[host=\"%s\"] config(): flow_rate=%g, flow_size_mean=%g, flow_size_shape=%g, "
+		   "packet_size=%u, packet_interval=%ld, on_time=%g, off_time=%g, max_flows=%u.\n",
+		   inHost()->nhi.toString(), flow_rate, flow_size_mean, flow_size_shape,
+		   packet_size, packet_interval, on_time, off_time, max_flows));
+}
+
+void TrafficEngineSession::init()
+{
+  // the same method at the parent class must be called
+  ProtocolSession::init();
+
+  ip_session = (IPSession*)inHost()->getNetworkLayerProtocol();
+  if(!ip_session) error_quit("ERROR: TrafficEngineSession::init(), can't find the IP layer.\n");
+
+  pthread_mutex_lock(&all_engines_mutex);
+  all_engines.push_back(this);
+  pthread_mutex_unlock(&all_engines_mutex);
+
+  if(flow_rate == 0) return; // only receives
+
+  // resolve the destinations once; a flow keeps only the ip address
+  Host* host = inHost();
+  Traffic* traffic = 0;
+  host->inNet()->control(NET_CTRL_GET_TRAFFIC, (void*)&traffic);
+  S3FNET_VECTOR(TrafficServerData*) sdata;
+  if(traffic) traffic->getServers(host, sdata, server_list.empty() ? 0 : server_list.c_str());
+  for(unsigned i=0; i<sdata.size(); i++)
+  {
+    IPADDR ip = host->inNet()->getNameService()->nhi2ip(*sdata[i]->nhi);
+    if(ip != IPADDR_INVALID) servers.push_back(ip);
+  }
+  if(servers.empty())
+  {
+    printf("WARNING: [host=\"%s\"] TrafficEngineSession::init(), found no server%s%s; "
+	   "no flows generated.\n", host->nhi.toString(),
+	   server_list.empty() ? "" : " for ", server_list.c_str());
+    return;
+  }
+
+  timers = new TrafficTimerQueue(this, expire, this);
+  double max_rate = flow_rate*(1+diurnal_amplitude);
+  timers->schedule(start_time+host->d2t(exponential(1/max_rate), 0), ARRIVAL_KEY);
+}
+
+void TrafficEngineSession::expire(void* engine, uint32 key)
+{
+  TrafficEngineSession* te = (TrafficEngineSession*)engine;
+  if(key == ARRIVAL_KEY) te->arrival();
+  else te->flow_timeout(key);
+}
+
+double TrafficEngineSession::exponential(double mean)
+{
+  return -mean*log(uniform());
+}
+
+uint32 TrafficEngineSession::flow_size()
+{
+  double size = flow_size_mean;
+  if(flow_size_shape > 0)
+  {
+    // Pareto with the given mean: the scale is mean*(shape-1)/shape
+    double scale = flow_size_mean*(flow_size_shape-1)/flow_size_shape;
+    size = scale/pow(uniform(), 1/flow_size_shape);
+  }
+  if(size > flow_size_max) size = flow_size_max;
+  return size < 1 ? 1 : (uint32)size;
+}
+
+void TrafficEngineSession::arrival()
+{
+  Host* host = inHost();
+  ltime_t now = getNow();
+  if(stop_time > 0 && now >= stop_time) return;
+
+  // arrivals are drawn at the peak rate and thinned to the current rate
+  double max_rate = flow_rate*(1+diurnal_amplitude);
+  timers->schedule(now+host->d2t(exponential(1/max_rate), 0), ARRIVAL_KEY);
+  double u = uniform();
+  if(diurnal_amplitude > 0)
+  {
+    double t = host->t2d(now, 0);
+    double rate = flow_rate*(1+diurnal_amplitude*cos(2*M_PI*(t-diurnal_peak)/diurnal_period));
+    if(u*max_rate > rate) return;
+  }
+
+  if(max_flows > 0 && active_flows >= max_flows)
+  {
+    flows_rejected++;
+    return;
+  }
+
+  uint32 idx;
+  if(!free_flows.empty())
+  {
+    idx = free_flows.back();
+    free_flows.pop_back();
+  }
+  else
+  {
+    idx = flows.size();
+    flows.push_back(TrafficFlow());
+  }
+
+  TrafficFlow& f = flows[idx];
+  f.dst = servers[(size_t)(uniform()*servers.size())];
+  f.remaining = flow_size();
+  f.id = next_flow_id++;
+  f.on = true;
+  f.period_end = on_time > 0 ? now+host->d2t(exponential(on_time), 0) : 0;
+
+  flows_started++;
+  if(++active_flows > peak_flows) peak_flows = active_flows;
+
+  TENG_DUMP(char s[32]; printf("[host=\"%s\"] %s: flow %u of %u bytes to %s.\n",
+			       host->nhi.toString(), getNowWithThousandSeparator(), f.id,
+			       f.remaining, IPPrefix::ip2txt(f.dst, s)));
+
+  // the first packet goes right away
+  flow_timeout(idx);
+}
+
+void TrafficEngineSession::flow_timeout(uint32 idx)
+{
+  TrafficFlow& f = flows[idx];
+  ltime_t now = getNow();
+
+  if(on_time > 0 && now >= f.period_end)
+  {
+    if(f.on)
+    {
+      f.on = false;
+      f.period_end = now+inHost()->d2t(exponential(off_time), 0);
+      timers->schedule(f.period_end, idx);
+      return;
+    }
+    f.on = true;
+    f.period_end = now+inHost()->d2t(exponential(on_time), 0);
+  }
+
+  uint32 bytes = f.remaining < packet_size ? f.remaining : packet_size;
+  TrafficMessage* msg = new TrafficMessage(f.id, bytes);
+  Activation msg_ac(msg);
+
+  IPPushOption ipopt;
+  ipopt.dst_ip = f.dst;
+  ipopt.src_ip = IPADDR_INADDR_ANY;
+  ipopt.prot_id = S3FNET_PROTOCOL_TYPE_TRAFFIC_ENGINE;
+  ipopt.ttl = DEFAULT_IP_TIMETOLIVE;
+  ip_session->pushdown(msg_ac, this, (void*)&ipopt, sizeof(IPPushOption));
+
+  pkts_sent++;
+  bytes_sent += bytes;
+  f.remaining -= bytes;
+
+  if(f.remaining > 0)
+  {
+    timers->schedule(now+packet_interval, idx);
+    return;
+  }
+
+  // the flow is done; its entry is reused by the next flow
+  flows_completed++;
+  active_flows--;
+  free_flows.push_back(idx);
+  if(show_report)
+  {
+    char s[32];
+    printf("%s: traffic engine \"%s\" completed flow %u to \"%s\".\n",
+	   getNowWithThousandSeparator(), inHost()->nhi.toString(), f.id, IPPrefix::ip2txt(f.dst, s));
+  }
+}
+
+int TrafficEngineSession::push(Activation msg, ProtocolSession* hi_sess, void* extinfo, size_t extinfo_size)
+{
+  error_quit("ERROR: a message is pushed down to the traffic engine from protocol layer above; it's impossible.\n");
+  return 0;
+}
+
+int TrafficEngineSession::pop(Activation msg, ProtocolSession* lo_sess, void* extinfo, size_t extinfo_size)
+{
+  TrafficMessage* tmsg = (TrafficMessage*)msg;
+  pkts_rcvd++;
+  bytes_rcvd += tmsg->bytes;
+  tmsg->erase_all();
+  return 0;
+}
+
+bool TrafficEngineSession::save_state(Checkpoint* ckpt)
+{
+  // the servers come from the traffic patterns and are resolved again
+  // by init(); the configuration may have changed, the flows may not
+  uint32 n = flows.size();
+  ckpt->put(n);
+  if(n > 0) ckpt->write(&flows[0], n*sizeof(TrafficFlow));
+  n = free_flows.size();
+  ckpt->put(n);
+  if(n > 0) ckpt->write(&free_flows[0], n*sizeof(uint32));
+  ckpt->put(next_flow_id);
+  ckpt->write(rand_buf, sizeof(rand_buf));
+  ckpt->put(rand_next);
+
+  ckpt->put(flows_started);
+  ckpt->put(flows_completed);
+  ckpt->put(flows_rejected);
+  ckpt->put(active_flows);
+  ckpt->put(peak_flows);
+  ckpt->put(pkts_sent);
+  ckpt->put(bytes_sent);
+  ckpt->put(pkts_rcvd);
+  ckpt->put(bytes_rcvd);
+
+  bool has_timers = (timers != 0);
+  ckpt->put(has_timers);
+  if(has_timers) timers->save(ckpt);
+  return true;
+}
+
+void TrafficEngineSession::restore_state(Checkpoint* ckpt)
+{
+  uint32 n;
+  ckpt->get(n);
+  flows.resize(n);
+  if(n > 0) ckpt->read(&flows[0], n*sizeof(TrafficFlow));
+  ckpt->get(n);
+  free_flows.resize(n);
+  if(n > 0) ckpt->read(&free_flows[0], n*sizeof(uint32));
+  ckpt->get(next_flow_id);
+  ckpt->read(rand_buf, sizeof(rand_buf));
+  ckpt->get(rand_next);
+
+  ckpt->get(flows_started);
+  ckpt->get(flows_completed);
+  ckpt->get(flows_rejected);
+  ckpt->get(active_flows);
+  ckpt->get(peak_flows);
+  ckpt->get(pkts_sent);
+  ckpt->get(bytes_sent);
+  ckpt->get(pkts_rcvd);
+  ckpt->get(bytes_rcvd);
+
+  bool has_timers;
+  ckpt->get(has_timers);
+  if(has_timers != (timers != 0))
+    error_quit("ERROR: [host=\"%s\"] TrafficEngineSession::restore_state(), "
+	       "the checkpoint does not match the flow_rate and the servers of the host.\n",
+	       inHost()->nhi.toString());
+  if(has_timers) timers->restore(ckpt);
+}
+
+void TrafficEngineSession::report(double sim_seconds, double wall_seconds)
+{
+  if(all_engines.empty()) return;
+
+  uint64 started = 0, completed = 0, rejected = 0, active = 0, peak = 0;
+  uint64 psent = 0, bsent = 0, prcvd = 0, brcvd = 0;
+  size_t memory = 0;
+  for(unsigned i=0; i<all_engines.size(); i++)
+  {
+    TrafficEngineSession* te = all_engines[i];
+    started += te->flows_started;
+    completed += te->flows_completed;
+    rejected += te->flows_rejected;
+    active += te->active_flows;
+    peak += te->peak_flows;
+    psent += te->pkts_sent;
+    bsent += te->bytes_sent;
+    prcvd += te->pkts_rcvd;
+    brcvd += te->bytes_rcvd;
+    memory += te->flows.capacity()*sizeof(TrafficFlow)+te->free_flows.capacity()*sizeof(uint32);
+    if(te->timers) memory += te->timers->memoryUsage();
+  }
+
+  printf("Traffic engines: %lu\n", (unsigned long)all_engines.size());
+  printf("  flows: %llu started, %llu completed, %llu active, %llu rejected\n",
+	 (unsigned long long)started, (unsigned long long)completed,
+	 (unsigned long long)active, (unsigned long long)rejected);
+  printf("  flow rate: %.1f flows/s simulated, %.1f flows/s wall-clock\n",
+	 sim_seconds > 0 ? started/sim_seconds : 0.0, wall_seconds > 0 ? started/wall_seconds : 0.0);
+  printf("  packets: %llu sent (%llu bytes), %llu received (%llu bytes)\n",
+	 (unsigned long long)psent, (unsigned long long)bsent,
+	 (unsigned long long)prcvd, (unsigned long long)brcvd);
+  // the engines peak at different times (and their timelines at
+  // different simulated times), so the sum of their peaks is an upper
+  // bound of the flows active at once; it is also how many flows the
+  // flow tables were sized for
+  printf("  memory: %llu flows (sum of per-host peaks), %.1f bytes per flow (%lu in the flow table)\n",
+	 (unsigned long long)peak, peak > 0 ? (double)memory/peak : 0.0,
+	 (unsigned long)sizeof(TrafficFlow));
+}
+
+}; // namespace s3fnet
+}; // namespace s3f
@@ -0,0 +1,180 @@
+/**
+ * \file traffic_engine.h
+ * \brief Header file for the TrafficEngineSession class.
+ *
+ * authors : Dong (Kevin) Jin
+ */
+
+#ifndef __TRAFFIC_ENGINE_H__
+#define __TRAFFIC_ENGINE_H__
+
+#include "os/base/protocol_session.h"
+#include "os/traffic/traffic_timer_queue.h"
+#include "util/shstl.h"
+#include "net/ip_prefix.h"
+
+namespace s3f {
+namespace s3fnet {
+
+class IPSession;
+
+#define TRAFFIC_ENGINE_PROTOCOL_CLASSNAME "S3F.OS.TrafficEngine"
+
+/** Number of uniform random numbers the traffic engine draws at a time. */
+#define TRAFFIC_ENGINE_RANDOM_BATCH 64
+
+/**
+ * \brief A flow of the traffic engine.
+ *
+ * This is all the state the engine keeps for an active flow; the
+ * flows of a host live in one table and their timeouts in one timer
+ * queue.
+ */
+struct TrafficFlow {
+  IPADDR dst;         ///< the destination of the flow
+  uint32 remaining;   ///< bytes left to send
+  ltime_t period_end; ///< end of the current on or off period (if on_time is set)
+  uint32 id;          ///< the id of the flow, unique within the host
+  bool on;            ///< whether the flow is in an on period
+};
+
+/**
+ * \brief Synthetic background traffic generator.
+ *
+ * A single protocol session on top of IP generates all the background
+ * flows of a host from statistical models, where the client/server
+ * test protocols need a session, processes, timers and socket
+ * continuations for each flow. New flows arrive as a Poisson process
+ * whose rate may follow a sinusoidal (diurnal) profile; each flow
+ * sends a Pareto-distributed number of bytes to a server selected
+ * uniformly from the servers the traffic patterns of the network list
+ * for this host, as packets of a fixed size at a fixed rate, possibly
+ * alternating exponential on and off periods. The packets are pushed
+ * directly to the IP layer. The traffic engine session on the
+ * destination host, if any, counts what it receives.
+ *
+ * DML attributes (times in seconds, sizes in bytes):
+ *   - server_list: the server list in the traffic patterns (default: all)
+ *   - flow_rate: mean number of new flows per second (0: only receive)
+ *   - flow_size_mean, flow_size_shape, flow_size_max: the Pareto flow size
+ *   - packet_size, packet_rate: packets of a flow (per second, while on)
+ *   - on_time, off_time: mean on and off periods (0: always on)
+ *   - diurnal_amplitude, diurnal_period, diurnal_peak: the rate is
+ *     flow_rate*(1+amplitude*cos(2*pi*(t-peak)/period))
+ *   - max_flows: most flows active at the same time (0: no limit)
+ *   - start_time, stop_time: when new flows arrive (stop_time 0: until the end)
+ *   - show_report: print the flows as they complete
+ */
+class TrafficEngineSession : public ProtocolSession {
+ public:
+  /** The constructor. */
+  TrafficEngineSession(ProtocolGraph* graph);
+
+  /** The destructor. */
+  virtual ~TrafficEngineSession();
+
+  /** Return the protocol number. */
+  virtual int getProtocolNumber() { return S3FNET_PROTOCOL_TYPE_TRAFFIC_ENGINE; }
+
+  /** Configure the traffic engine. */
+  virtual void config(s3f::dml::Configuration* cfg);
+
+  /** Initialize the traffic engine. */
+  virtual void init();
+
+  /** The traffic engine is the top of the stack; this should not be called. */
+  virtual int push(Activation msg, ProtocolSession* hi_sess, void* extinfo = 0, size_t extinfo_size = 0);
+
+  /** Count a packet received from the IP layer. */
+  virtual int pop(Activation msg, ProtocolSession* lo_sess, void* extinfo = 0, size_t extinfo_size = 0);
+
+  /** Save the flows, their timeouts and the statistics to a checkpoint. */
+  virtual bool save_state(Checkpoint* ckpt);
+
+  /** Restore the flows, their timeouts and the statistics from a checkpoint. */
+  virtual void restore_state(Checkpoint* ckpt);
+
+  /** Return the number of timeouts the session has scheduled. */
+  virtual int saved_timeouts() { return timers ? timers->scheduled() : 0; }
+
+  /**
+   * Print the flows generated by all the traffic engines, the rate at
+   * which they were generated in simulation time and in wall-clock
+   * time, and the memory taken by each flow. Called at the end of the
+   * simulation; prints nothing if there is no traffic engine.
+   */
+  static void report(double sim_seconds, double wall_seconds);
+
+ protected:
+  /** The key of the arrival of the next flow in the timer queue. */
+  enum { ARRIVAL_KEY = 0xffffffff };
+
+  /** Called back by the timer queue. */
+  static void expire(void* engine, uint32 key);
+
+  /** A new flow may arrive. */
+  void arrival();
+
+  /** The timeout of a flow: send its next packet or start or end a period. */
+  void flow_timeout(uint32 idx);
+
+  /** Return the next uniform random number in (0,1). */
+  double uniform() {
+    if(rand_next == TRAFFIC_ENGINE_RANDOM_BATCH)
+    {
+      getRandom()->Random(rand_buf, TRAFFIC_ENGINE_RANDOM_BATCH);
+      rand_next = 0;
+    }
+    return rand_buf[rand_next++];
+  }
+
+  /** Return an exponentially distributed random number with the given mean. */
+  double exponential(double mean);
+
+  /** Return the size of a new flow. */
+  uint32 flow_size();
+
+  // configurable parameters
+  S3FNET_STRING server_list;   ///< traffic server list name
+  double flow_rate;            ///< mean number of new flows per second
+  double flow_size_mean;       ///< mean flow size
+  double flow_size_shape;      ///< shape of the Pareto flow size
+  double flow_size_max;        ///< largest flow size
+  uint32 packet_size;          ///< size of the packets
+  ltime_t packet_interval;     ///< time between two packets of a flow
+  double on_time;              ///< mean on period, 0 if the flows are always on
+  double off_time;             ///< mean off period
+  double diurnal_amplitude;    ///< relative amplitude of the rate
+  double diurnal_period;       ///< period of the rate
+  double diurnal_peak;         ///< time at which the rate peaks
+  uint32 max_flows;            ///< most active flows, 0 if no limit
+  ltime_t start_time;          ///< time at which flows start to arrive
+  ltime_t stop_time;           ///< time at which flows stop arriving, 0 if never
+  bool show_report;            ///< whether to print the flows as they complete
+
+  // state variables
+  IPSession* ip_session;       ///< the IP layer below
+  S3FNET_VECTOR(IPADDR) servers; ///< the destinations of the flows
+  S3FNET_VECTOR(TrafficFlow) flows; ///< the flow table
+  S3FNET_VECTOR(uint32) free_flows; ///< the free entries of the flow table
+  TrafficTimerQueue* timers;   ///< the timeouts of the flows and of the next arrival
+  uint32 next_flow_id;         ///< id of the next flow
+  double rand_buf[TRAFFIC_ENGINE_RANDOM_BATCH]; ///< uniform random numbers drawn in advance
+  int rand_next;               ///< the next unused number in rand_buf
+
+  // statistics
+  uint64 flows_started;        ///< flows generated
+  uint64 flows_completed;      ///< flows that sent all their bytes
+  uint64 flows_rejected;       ///< arrivals dropped because of max_flows
+  uint64 active_flows;         ///< flows in the flow table
+  uint64 peak_flows;           ///< most flows in the flow table
+  uint64 pkts_sent;            ///< packets pushed to the IP layer
+  uint64 bytes_sent;           ///< bytes pushed to the IP layer
+  uint64 pkts_rcvd;            ///< packets received
+  uint64 bytes_rcvd;           ///< bytes received
+};
+
+}; // namespace s3fnet
+}; // namespace s3f
+
+#endif /*__TRAFFIC_ENGINE_H__*/
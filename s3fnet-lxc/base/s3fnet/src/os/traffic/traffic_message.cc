@@ -0,0 +1,47 @@
+/**
+ * \file traffic_message.cc
+ * \brief Source file for the TrafficMessage class.
+ *
+ * authors : Dong (Kevin) Jin
+ */
+
+#include <string.h>
+#include "os/traffic/traffic_message.h"
+
+namespace s3f {
+namespace s3fnet {
+
+S3FNET_REGISTER_POOLED_MESSAGE(TrafficMessage, S3FNET_PROTOCOL_TYPE_TRAFFIC_ENGINE);
+
+TrafficMessage::TrafficMessage() : flow(0), bytes(0) {}
+
+TrafficMessage::TrafficMessage(uint32 f, uint32 b) : flow(f), bytes(b) {}
+
+TrafficMessage::TrafficMessage(const TrafficMessage& msg) :
+  ProtocolMessage(msg), // the base class's copy constructor must be called
+  flow(msg.flow), bytes(msg.bytes) {}
+
+TrafficMessage::~TrafficMessage() {}
+
+int TrafficMessage::packingSize()
+{
+  // must add the parent class packing size
+  return ProtocolMessage::packingSize()+2*sizeof(uint32);
+}
+
+void TrafficMessage::serialize(byte* buf, int& offset)
+{
+  ProtocolMessage::serialize(buf, offset);
+  memcpy(&buf[offset], &flow, sizeof(uint32)); offset += sizeof(uint32);
+  memcpy(&buf[offset], &bytes, sizeof(uint32)); offset += sizeof(uint32);
+}
+
+void TrafficMessage::deserialize(byte* buf, int& offset)
+{
+  ProtocolMessage::deserialize(buf, offset);
+  memcpy(&flow, &buf[offset], sizeof(uint32)); offset += sizeof(uint32);
+  memcpy(&bytes, &buf[offset], sizeof(uint32)); offset += sizeof(uint32);
+}
+
+}; // namespace s3fnet
+}; // namespace s3f
@@ -0,0 +1,70 @@
+/**
+ * \file traffic_message.h
+ * \brief Header file for the TrafficMessage class.
+ *
+ * authors : Dong (Kevin) Jin
+ */
+
+#ifndef __TRAFFIC_MESSAGE_H__
+#define __TRAFFIC_MESSAGE_H__
+
+#include "os/base/protocol_message.h"
+#include "s3fnet.h"
+
+namespace s3f {
+namespace s3fnet {
+
+/**
+ * \brief A packet of a synthetic flow of the traffic engine.
+ *
+ * The message carries no data; it only records the flow it belongs
+ * to and the number of bytes it stands for, which is what the links
+ * and the queues are charged for.
+ */
+class TrafficMessage : public ProtocolMessage {
+ public:
+  /** The default constructor. */
+  TrafficMessage();
+
+  /** A packet of the given flow, standing for the given number of bytes. */
+  TrafficMessage(uint32 flow, uint32 bytes);
+
+  /** The copy constructor. */
+  TrafficMessage(const TrafficMessage& msg);
+
+  /** Clone a TrafficMessage. */
+  virtual ProtocolMessage* clone() { return new TrafficMessage(*this); }
+
+  /** The protocol type of the traffic engine. */
+  virtual int type() { return S3FNET_PROTOCOL_TYPE_TRAFFIC_ENGINE; }
+
+  /** Return the buffer size needed to serialize this protocol message. */
+  virtual int packingSize();
+
+  /** Pack the flow and the size of the packet into buf from the given offset. */
+  virtual void serialize(byte* buf, int& offset);
+
+  /** Unpack the flow and the size of the packet from buf at the given offset. */
+  virtual void deserialize(byte* buf, int& offset);
+
+  /** Traffic packets can be saved in a checkpoint. */
+  virtual bool serializable() { return true; }
+
+  /** Return the number of bytes the packet stands for on a real network. */
+  virtual int realByteCount() { return bytes; }
+
+  /** Traffic packets are recycled through a message pool. */
+  S3FNET_POOLED_MESSAGE(TrafficMessage);
+
+  uint32 flow;  ///< the id of the flow (unique within the sending host)
+  uint32 bytes; ///< the size of the packet
+
+ protected:
+  /** The destructor is protected from accidental invocation. */
+  virtual ~TrafficMessage();
+};
+
+}; // namespace s3fnet
+}; // namespace s3f
+
+#endif /*__TRAFFIC_MESSAGE_H__*/
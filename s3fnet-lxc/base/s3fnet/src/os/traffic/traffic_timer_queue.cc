@@ -0,0 +1,156 @@
+/**
+ * \file traffic_timer_queue.cc
+ * \brief Source file for the TrafficTimerQueue class.
+ *
+ * authors : Dong (Kevin) Jin
+ */
+
+#include "os/traffic/traffic_timer_queue.h"
+#include "net/host.h"
+#include "net/checkpoint.h"
+
+namespace s3f {
+namespace s3fnet {
+
+/** The activation of the process of a TrafficTimerQueue. */
+class TrafficTimerActivation : public ProtocolCallbackActivation {
+ public:
+  TrafficTimerActivation(ProtocolSession* sess, TrafficTimerQueue* q) : ProtocolCallbackActivation(sess), queue(q) {}
+  TrafficTimerQueue* queue;
+};
+
+TrafficTimerQueue::TrafficTimerQueue(ProtocolSession* sess, Callback fn, void* owner) :
+  owner_sess(sess), expire_fn(fn), expire_owner(owner), next_seq(0), pending(0), pending_time(0),
+  dispatching(false)
+{
+  Host* owner_host = sess->inHost();
+  proc = new Process((Entity*)owner_host, (void (s3f::Entity::*)(s3f::Activation))&TrafficTimerQueue::callback);
+  proc->set_name("TrafficTimerQueue::callback");
+  activation = new TrafficTimerActivation(sess, this);
+
+  // the activation is reused for every expiration: hold an extra
+  // reference so that the event does not reclaim it after it's fired
+  activation->inc_evts();
+}
+
+TrafficTimerQueue::~TrafficTimerQueue()
+{
+  // an event still pending at the end of the simulation refers to the
+  // process and the activation; they are left to the event
+  if(!pending)
+  {
+    delete activation;
+    delete proc;
+  }
+}
+
+void TrafficTimerQueue::schedule(ltime_t time, uint32 key)
+{
+  Entry e;
+  e.time = time;
+  e.key = key;
+  e.seq = next_seq++;
+
+  // sift up
+  size_t i = heap.size();
+  heap.push_back(e);
+  while(i > 0)
+  {
+    size_t parent = (i-1)/2;
+    if(!earlier(e, heap[parent])) break;
+    heap[i] = heap[parent];
+    i = parent;
+  }
+  heap[i] = e;
+
+  if(i == 0 && !dispatching) arm();
+}
+
+void TrafficTimerQueue::arm()
+{
+  if(heap.empty()) return;
+  if(pending && pending_time <= heap[0].time) return;
+
+  Host* owner_host = owner_sess->inHost();
+  ltime_t now = owner_sess->getNow();
+  ltime_t delay = heap[0].time > now ? heap[0].time-now : 0;
+  if(pending)
+  {
+    // move the pending timer event up rather than scheduling another one
+    if(owner_host->reschedule(pending, delay))
+    {
+      pending_time = now+delay;
+      return;
+    }
+    Handle h(pending);
+    h.cancel();
+  }
+  Activation ac(activation);
+  pending = owner_host->waitFor(proc, ac, delay, owner_host->tie_breaking_seed);
+  pending_time = now+delay;
+}
+
+void TrafficTimerQueue::save(Checkpoint* ckpt)
+{
+  uint32 n = heap.size();
+  ckpt->put(n);
+  if(n > 0) ckpt->write(&heap[0], n*sizeof(Entry));
+  ckpt->put(next_seq);
+}
+
+void TrafficTimerQueue::restore(Checkpoint* ckpt)
+{
+  uint32 n;
+  ckpt->get(n);
+  heap.resize(n);
+  if(n > 0) ckpt->read(&heap[0], n*sizeof(Entry));
+  ckpt->get(next_seq);
+  pending = 0;
+  arm();
+}
+
+void TrafficTimerQueue::callback(Activation ac)
+{
+  // called as a method of the host: find the queue from the activation
+  TrafficTimerQueue* q = ((TrafficTimerActivation*)ac)->queue;
+  ProtocolSession* sess = q->owner_sess;
+  unsigned int outer = sess->enter_cost("timer");
+  q->pending = 0;
+  q->dispatching = true;
+
+  ltime_t now = q->owner_sess->getNow();
+  while(!q->heap.empty() && q->heap[0].time <= now)
+  {
+    uint32 key = q->heap[0].key;
+
+    // pop the earliest timeout: sift the last one down from the top
+    Entry last = q->heap.back();
+    q->heap.pop_back();
+    size_t n = q->heap.size();
+    if(n > 0)
+    {
+      size_t i = 0;
+      for(;;)
+      {
+	size_t child = 2*i+1;
+	if(child >= n) break;
+	if(child+1 < n && earlier(q->heap[child+1], q->heap[child])) child++;
+	if(!earlier(q->heap[child], last)) break;
+	q->heap[i] = q->heap[child];
+	i = child;
+      }
+      q->heap[i] = last;
+    }
+
+    // the owner may schedule new timeouts, including ones that expire
+    // right now and are called back in this loop; the timer is armed
+    // once, for whatever is left
+    q->expire_fn(q->expire_owner, key);
+  }
+  q->dispatching = false;
+  q->arm();
+  sess->leave_cost(outer);
+}
+
+}; // namespace s3fnet
+}; // namespace s3f
@@ -0,0 +1,99 @@
+/**
+ * \file traffic_timer_queue.h
+ * \brief Header file for the TrafficTimerQueue class.
+ *
+ * authors : Dong (Kevin) Jin
+ */
+
+#ifndef __TRAFFIC_TIMER_QUEUE_H__
+#define __TRAFFIC_TIMER_QUEUE_H__
+
+#include "os/base/protocol_session.h"
+#include "util/shstl.h"
+
+namespace s3f {
+namespace s3fnet {
+
+class TrafficTimerActivation;
+class Checkpoint;
+
+/**
+ * \brief One timer for a large number of timeouts.
+ *
+ * A protocol session that keeps many timeouts of its own (such as one
+ * for each flow of the traffic engine) holds them in this queue, a
+ * binary heap of (time, key) pairs, instead of scheduling one S3F
+ * event for each. The queue keeps a single S3F process of the host
+ * scheduled for its earliest timeout, with a single activation that
+ * is reused, and calls back the owner with the key of each timeout as
+ * it expires. Timeouts expiring at the same time are called back in
+ * the order in which they were scheduled.
+ */
+class TrafficTimerQueue {
+ public:
+  /** The function called for an expired timeout. */
+  typedef void (*Callback)(void* owner, uint32 key);
+
+  /** The constructor; the queue belongs to the given protocol session. */
+  TrafficTimerQueue(ProtocolSession* sess, Callback fn, void* owner);
+
+  /** The destructor. */
+  ~TrafficTimerQueue();
+
+  /** Schedule a timeout with the given key at the given (absolute) time. */
+  void schedule(ltime_t time, uint32 key);
+
+  /** Return the number of timeouts in the queue. */
+  size_t size() { return heap.size(); }
+
+  /** Return the number of bytes taken by the queue. */
+  size_t memoryUsage() { return heap.capacity()*sizeof(Entry); }
+
+  /** Write the timeouts in the queue to a checkpoint. */
+  void save(Checkpoint* ckpt);
+
+  /**
+   * Read back the timeouts from a checkpoint and schedule the timer
+   * process for the earliest one. The event scheduled before, if any,
+   * has been discarded with the events of the initialization.
+   */
+  void restore(Checkpoint* ckpt);
+
+  /** Return the number of S3F timeouts the queue has scheduled (0 or 1). */
+  int scheduled() { return pending ? 1 : 0; }
+
+  /** The callback of the timer process. */
+  void callback(Activation ac);
+
+ private:
+  /** A timeout. */
+  struct Entry {
+    ltime_t time; ///< the expiration time
+    uint32 key;   ///< the key handed back to the owner
+    uint32 seq;   ///< the order in which the timeouts were scheduled
+  };
+
+  /** Return true if timeout a expires before timeout b. */
+  static bool earlier(const Entry& a, const Entry& b) {
+    return a.time < b.time || (a.time == b.time && (int32)(a.seq-b.seq) < 0);
+  }
+
+  /** Make sure the timer process is scheduled for the earliest timeout. */
+  void arm();
+
+  ProtocolSession* owner_sess;
+  Callback expire_fn;
+  void* expire_owner;
+  S3FNET_VECTOR(Entry) heap;          ///< the timeouts, earliest first
+  uint32 next_seq;                    ///< the order of the next timeout
+  Process* proc;                      ///< the timer process
+  TrafficTimerActivation* activation; ///< the activation of the timer process
+  HandleCode pending;                 ///< the scheduled event, 0 if none
+  ltime_t pending_time;               ///< the time of the scheduled event
+  bool dispatching;                   ///< the expired timeouts are being called back
+};
+
+}; // namespace s3fnet
+}; // namespace s3f
+
+#endif /*__TRAFFIC_TIMER_QUEUE_H__*/
@@ -0,0 +1,23 @@
+/**
+ * \file co_udp_client.cc
+ * \brief Source file for the CoUDPClientSession class.
+ *
+ * authors : Dong (Kevin) Jin
+ */
+
+#include "os/udp/app/co_udp_client.h"
+#include "os/base/protocols.h"
+
+namespace s3f {
+namespace s3fnet {
+
+S3FNET_REGISTER_PROTOCOL(CoUDPClientSession, "S3F.OS.UDP.test.CoUDPClient");
+
+CoUDPClientSession::CoUDPClientSession(ProtocolGraph* graph) : CoTCPClientSession(graph)
+{
+  transport = UDP_PROTOCOL_NAME;
+  transport_name = "UDP";
+}
+
+}; // namespace s3fnet
+}; // namespace s3f
@@ -0,0 +1,37 @@
+/**
+ * \file co_udp_client.h
+ * \brief Header file for the CoUDPClientSession class.
+ *
+ * authors : Dong (Kevin) Jin
+ */
+
+#ifndef __CO_UDP_CLIENT_H__
+#define __CO_UDP_CLIENT_H__
+
+#include "os/tcp/app/co_tcp_client.h"
+
+namespace s3f {
+namespace s3fnet {
+
+/**
+ * \brief The UDP client test protocol session, written with socket coroutines.
+ *
+ * The coroutine counterpart of UDPClientSession: the same client as
+ * CoTCPClientSession, which retrieves the files from UDP servers.
+ */
+class CoUDPClientSession: public CoTCPClientSession {
+ public:
+  /** The constructor. */
+  CoUDPClientSession(ProtocolGraph* graph);
+
+  /**
+   * Return the protocol number.
+   * @return Protocol number for the coroutine udp client
+   */
+  virtual int getProtocolNumber() { return S3FNET_PROTOCOL_TYPE_UDPTEST_CO_CLIENT; }
+};
+
+}; // namespace s3fnet
+}; // namespace s3f
+
+#endif /*__CO_UDP_CLIENT_H__*/
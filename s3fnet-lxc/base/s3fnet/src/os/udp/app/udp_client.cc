@@ -240,6 +240,18 @@ void UDPClientSession::config(s3f::dml::Configuration *cfg)
     error_quit("ERROR: UDPClientSession::config(), missing or invalid FILE_SIZE attribute.\n");
   file_size = atoi(str);
 
+  str = (char*)cfg->findSingle("payload");
+  if(str)
+  {
+    if(s3f::dml::dmlConfig::isConf(str))
+      error_quit("ERROR: UDPClientSession::config(), invalid PAYLOAD attribute.\n");
+    if(!strcasecmp(str, "real")) payload_options = 0;
+    else if(!strcasecmp(str, "shared")) payload_options = SOCK_OPT_PAYLOAD_SHARED;
+    else if(!strcasecmp(str, "size_only")) payload_options = SOCK_OPT_PAYLOAD_SIZE_ONLY;
+    else error_quit("ERROR: UDPClientSession::config(), invalid PAYLOAD attribute (%s).\n", str);
+  }
+  else payload_options = 0;
+
   str = (char*)cfg->findSingle("client_port");
   if(str)
   {
@@ -336,6 +348,7 @@ void UDPClientSession::main_proc(int sample_off_time, ltime_t lead_time)
 
   Host* owner_host = inHost();
   start_timer_callback_proc = new Process( (Entity *)owner_host, (void (s3f::Entity::*)(s3f::Activation))&UDPClientSession::start_timer_callback);
+  start_timer_callback_proc->set_name("UDPClientSession::start_timer_callback");
   start_timer_ac = new ProtocolCallbackActivation(this);
   Activation ac (start_timer_ac);
   HandleCode h = owner_host->waitFor( start_timer_callback_proc, ac, t, owner_host->tie_breaking_seed );
@@ -371,7 +384,7 @@ void UDPClientSession::start_on()
   nsess++;
 
   int sock = sm->socket();
-  if(!sm->bind(sock, IPADDR_INADDR_ANY/*client_ip*/, start_port++, UDP_PROTOCOL_NAME, 0))
+  if(!sm->bind(sock, IPADDR_INADDR_ANY/*client_ip*/, start_port++, UDP_PROTOCOL_NAME, payload_options))
   {
     UDP_DUMP(printf("start_on() on host \"%s\": failed to bind.\n", inHost()->nhi.toString()));
     return;
@@ -394,15 +407,20 @@ void UDPClientSession::server_connected(UDPClientSessionContinuation* const cnt)
 		  inHost()->nhi.toString(), getNowWithThousandSeparator(),
 		  cnt->socket, request_size, file_size));
   
-  // we send real bytes to the server
-  byte* reqbuf = new byte[request_size];
-  *(uint32*)reqbuf = htonl(file_size);
+  // we send real bytes to the server, unless only the sizes are
+  // simulated, in which case the server uses its own file size
+  byte* reqbuf = 0;
+  if(!(payload_options & SOCK_OPT_PAYLOAD_SIZE_ONLY))
+  {
+    reqbuf = new byte[request_size];
+    *(uint32*)reqbuf = htonl(file_size);
+  }
 
   // sending out data request
   cnt->status = UDPClientSessionContinuation::UDP_CLIENT_SESSION_REQUESTING;
   sm->send(cnt->socket, request_size, reqbuf, cnt);
 
-  delete[] reqbuf;
+  if(reqbuf) delete[] reqbuf;
 }
 
 void UDPClientSession::request_sent(UDPClientSessionContinuation* const cnt)
@@ -414,6 +432,7 @@ void UDPClientSession::request_sent(UDPClientSessionContinuation* const cnt)
   Host* owner_host = inHost();
   cnt->user_timer_callback_proc =
 		  new Process( (Entity *)owner_host, (void (s3f::Entity::*)(s3f::Activation))&UDPClientSessionContinuation::user_timer_callback);
+  cnt->user_timer_callback_proc->set_name("UDPClientSessionContinuation::user_timer_callback");
   cnt->user_timer_ac = new UDPClientSessionCallbackActivation(this, cnt);
   Activation ac (cnt->user_timer_ac);
   cnt->user_timer = inHost()->waitFor( cnt->user_timer_callback_proc, ac, user_timeout, inHost()->tie_breaking_seed );
@@ -501,7 +520,7 @@ bool UDPClientSession::get_random_server(IPADDR& server_ip, uint16& server_port)
   }
 
   int sidx = (int)floor(getRandom()->Uniform(0, 1) * servers.size());
-  server_ip = host->inNet()->getNameService()->nhi2ip(servers[sidx]->nhi->toStlString());
+  server_ip = host->inNet()->getNameService()->nhi2ip(*servers[sidx]->nhi);
   server_port = servers[sidx]->port;
 
   if(server_ip == IPADDR_INVALID)
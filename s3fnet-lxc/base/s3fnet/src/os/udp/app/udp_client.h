@@ -110,6 +110,7 @@ class UDPClientSession: public ProtocolSession {
   bool fixed_server; ///< Whether to find a random target.
   uint32 request_size; ///< Size of the request sent to the server.
   uint32 file_size; ///< Size of the file to be sent from the server.
+  uint32 payload_options; ///< Socket options selecting how the request is carried (PAYLOAD attribute).
   uint16 start_port; ///< The starting port number for client sessions.
   S3FNET_STRING server_list; //< Traffic server list name (default: forUDP)
   bool show_report; ///< Whether we print out the result or not.
@@ -42,6 +42,7 @@ class UDPServerSessionContinuation : public BSocketContinuation {
     status(UDP_SERVER_SESSION_UNITIALIZED) {
     reqbuf = new byte[server->request_size];
     assert(reqbuf);
+    memset(reqbuf, 0, server->request_size);
   }
 
   virtual ~UDPServerSessionContinuation() {
@@ -179,6 +180,32 @@ void UDPServerSession::config(s3f::dml::Configuration *cfg)
   }
   else request_size = sizeof(uint32);
 
+  str = (char*)cfg->findSingle("file_size");
+  if(str)
+  {
+    if(s3f::dml::dmlConfig::isConf(str))
+      error_quit("ERROR: UDPServerSession::config(), invalid FILE_SIZE attribute.\n");
+    default_file_size = atoi(str);
+  }
+  else default_file_size = 0;
+
+  str = (char*)cfg->findSingle("payload");
+  if(str)
+  {
+    if(s3f::dml::dmlConfig::isConf(str))
+      error_quit("ERROR: UDPServerSession::config(), invalid PAYLOAD attribute.\n");
+    if(!strcasecmp(str, "real")) payload_options = 0;
+    else if(!strcasecmp(str, "shared")) payload_options = SOCK_OPT_PAYLOAD_SHARED;
+    else if(!strcasecmp(str, "size_only")) payload_options = SOCK_OPT_PAYLOAD_SIZE_ONLY;
+    else error_quit("ERROR: UDPServerSession::config(), invalid PAYLOAD attribute (%s).\n", str);
+  }
+  else payload_options = 0;
+
+  // the requests of size-only clients carry no file size; the server
+  // would send nothing and the clients would wait forever
+  if((payload_options & SOCK_OPT_PAYLOAD_SIZE_ONLY) && !default_file_size)
+    error_quit("ERROR: UDPServerSession::config(), missing FILE_SIZE attribute, required if PAYLOAD is size_only.\n");
+
   str = (char*)cfg->findSingle("client_limit");
   if(str)
   {
@@ -245,6 +272,7 @@ void UDPServerSession::init()
 
   Host* owner_host = inHost();
   start_timer_callback_proc = new Process( (Entity *)owner_host, (void (s3f::Entity::*)(s3f::Activation))&UDPServerSession::start_timer_callback);
+  start_timer_callback_proc->set_name("UDPServerSession::start_timer_callback");
   start_timer_ac = new ProtocolCallbackActivation(this);
   Activation ac (start_timer_ac);
   HandleCode h = inHost()->waitFor( start_timer_callback_proc, ac, 0, inHost()->tie_breaking_seed ); //currently the starting time is 0
@@ -256,7 +284,7 @@ void UDPServerSession::start_on()
 		  inHost()->nhi.toString(), getNowWithThousandSeparator()));
 
   int ssock = sm->socket();
-  if(!sm->bind(ssock, IPADDR_ANYDEST, server_port, UDP_PROTOCOL_NAME, 0))
+  if(!sm->bind(ssock, IPADDR_ANYDEST, server_port, UDP_PROTOCOL_NAME, payload_options))
   {
     UDP_DUMP(printf("start_on() on host \"%s\": failed to bind.\n",
 		    inHost()->nhi.toString()));
@@ -286,6 +314,14 @@ void UDPServerSession::request_received(UDPServerSessionContinuation* const cnt)
   assert(cnt->retval == (int)request_size);
 
   cnt->file_size = ntohl(*(uint32*)cnt->reqbuf);
+  if(cnt->file_size == 0) // no real data in the request
+  {
+    if(!default_file_size)
+      error_quit("ERROR: UDPServerSession::request_received(), the request on host \"%s\" "
+		 "carries no file size (from a size-only client?) and FILE_SIZE is not set.\n",
+		 inHost()->nhi.toString());
+    cnt->file_size = default_file_size;
+  }
   UDP_DUMP(printf("[host=\"%s\"] %s: session_proc(), socket %d received request "
 		  "(request_size=%u, file_size=%u).\n",
 		  inHost()->nhi.toString(), getNowWithThousandSeparator(),
@@ -305,7 +341,7 @@ void UDPServerSession::request_received(UDPServerSessionContinuation* const cnt)
     handle_client(cnt->server_socket);
   
   cnt->client_socket = sm->socket();
-  if(!sm->bind(cnt->client_socket, server_ip, ++server_port, UDP_PROTOCOL_NAME, 0))
+  if(!sm->bind(cnt->client_socket, server_ip, ++server_port, UDP_PROTOCOL_NAME, payload_options))
   {
     UDP_DUMP(printf("request_received() on host \"%s\": failed to bind.\n", inHost()->nhi.toString()));
     if(client_limit && nclients-- == client_limit)
@@ -330,6 +366,7 @@ void UDPServerSession::client_connected(UDPServerSessionContinuation* const cnt)
     Host* owner_host = inHost();
     cnt->send_time_callback_proc =
   		  new Process( (Entity *)owner_host, (void (s3f::Entity::*)(s3f::Activation))&UDPServerSessionContinuation::send_time_callback);
+    cnt->send_time_callback_proc->set_name("UDPServerSessionContinuation::send_time_callback");
     cnt->send_time_ac = new UDPServerSessionCallbackActivation(this, cnt);
     Activation ac (cnt->send_time_ac);
     cnt->send_timer = inHost()->waitFor( cnt->send_time_callback_proc, ac, send_interval, inHost()->tie_breaking_seed );
@@ -91,6 +91,8 @@ class UDPServerSession: public ProtocolSession {
   // configurable parameters
   uint16 server_port; ///< Port number to receive incoming request.
   uint32 request_size; ///< Size of the request from client (must be consistent).
+  uint32 default_file_size; ///< Size of the file sent to a client whose request carries no real data (0 if not set).
+  uint32 payload_options; ///< Socket options for the payload of the data sent to clients.
   uint32 client_limit; ///< Number of client sessions that can be handled simultaneously.
   uint32 datagram_size; ///< Size of each udp datagram sent to client.
   ltime_t send_interval; ///< Time between successive sends.
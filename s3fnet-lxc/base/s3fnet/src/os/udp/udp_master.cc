@@ -13,6 +13,7 @@
 #include "os/udp/udp_session.h"
 #include "os/ipv4/ip_message.h"
 #include "os/ipv4/ip_interface.h"
+#include "os/ipv4/ip_session.h"
 
 #ifdef UDP_DEBUG
 #define UDP_DUMP(x) printf("UDP: "); x
@@ -25,7 +26,7 @@ namespace s3fnet {
 
 S3FNET_REGISTER_PROTOCOL_WITH_ALIAS(UDPMaster, "S3F.OS.UDP", "S3F.OS.UDP.udpSessionMaster");
 
-UDPMaster::UDPMaster(ProtocolGraph* graph) : SessionMaster(graph), ip_sess(0), max_datagram_size(INT_MAX)
+UDPMaster::UDPMaster(ProtocolGraph* graph) : SessionMaster(graph), ip_sess(0), std_ip(0), max_datagram_size(INT_MAX)
 {
   UDP_DUMP(printf("[host=\"%s\"] new udp master session.\n", inHost()->nhi.toString()));
 }
@@ -79,6 +80,7 @@ void UDPMaster::init()
   // find out the IP layer protocol session
   ip_sess = inHost()->getNetworkLayerProtocol();
   assert(ip_sess);
+  std_ip = session_of_class<IPSession>(ip_sess);
 }
 
 int UDPMaster::control(int ctrltyp, void* ctrlmsg, ProtocolSession* sess)
@@ -101,7 +103,7 @@ int UDPMaster::push(Activation msg, ProtocolSession* hi_sess, void* extinfo, siz
 {
   UDP_DUMP(printf("[host=\"%s\"] %s: push().\n", inHost()->nhi.toString(), getNowWithThousandSeparator()));
 
-  return ip_sess->pushdown(msg, this, extinfo, extinfo_size);
+  return pushdown_to(std_ip, ip_sess, msg, this, extinfo, extinfo_size);
 }
 
 int UDPMaster::pop(Activation msg, ProtocolSession* lo_sess, void* extinfo, size_t extinfo_size)
@@ -15,6 +15,7 @@ namespace s3f {
 namespace s3fnet {
 
 class UDPSession;
+class IPSession;
  
 /**
  * \brief The UDP master.
@@ -23,6 +24,7 @@ class UDPSession;
  */
 class UDPMaster : public SessionMaster {
   friend class UDPSession;
+  friend class ProtocolSession; // the static pipeline calls push() and pop()
 
  public:
   /** The constructor. */
@@ -71,6 +73,9 @@ class UDPMaster : public SessionMaster {
   /** The IP protocol session is right below this protocol session. */
   ProtocolSession* ip_sess;
 
+  /** The IP session if it is an IPSession, for the static pipeline. */
+  IPSession* std_ip;
+
   /** The maximum UDP datagram size. */
   int max_datagram_size;
 
@@ -5,6 +5,7 @@
  * authors : Dong (Kevin) Jin
  */
 
+#include <string.h>
 #include "os/udp/udp_message.h"
 
 namespace s3f {
@@ -30,14 +31,14 @@ void UDPMessage::setPorts(uint16 sport, uint16 dport) {
   dst_port = dport;
 }
 
-/*void UDPMessage::serialize(byte* buf, int& offset)
+void UDPMessage::serialize(byte* buf, int& offset)
 {
   ProtocolMessage::serialize(buf, offset);
 
-  s3f::ssf::ssf_compact::serialize(src_port, &buf[offset]);
+  memcpy(&buf[offset], &src_port, sizeof(uint16));
   offset += sizeof(uint16);
 
-  s3f::ssf::ssf_compact::serialize(dst_port, &buf[offset]);
+  memcpy(&buf[offset], &dst_port, sizeof(uint16));
   offset += sizeof(uint16);
 }
 
@@ -45,14 +46,14 @@ void UDPMessage::deserialize(byte* buf, int& offset)
 {
   ProtocolMessage::deserialize(buf, offset);
   
-  s3f::ssf::ssf_compact::deserialize(src_port, &buf[offset]);
+  memcpy(&src_port, &buf[offset], sizeof(uint16));
   offset += sizeof(uint16);
 
-  s3f::ssf::ssf_compact::deserialize(dst_port, &buf[offset]);
+  memcpy(&dst_port, &buf[offset], sizeof(uint16));
   offset += sizeof(uint16);
-}*/
+}
 
-S3FNET_REGISTER_MESSAGE(UDPMessage, S3FNET_PROTOCOL_TYPE_UDP);
+S3FNET_REGISTER_POOLED_MESSAGE(UDPMessage, S3FNET_PROTOCOL_TYPE_UDP);
 
 }; // namespace s3fnet
 }; // namespace s3f
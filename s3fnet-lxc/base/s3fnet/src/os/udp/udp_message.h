@@ -55,10 +55,13 @@ class UDPMessage : public ProtocolMessage {
   }
 
   /** Pack this UDP header to buffer starting from the given offset. */
-  //virtual void serialize(byte* buf, int& offset);
+  virtual void serialize(byte* buf, int& offset);
   
   /** Unpack the UDP header from buf from given offset. */
-  //virtual void deserialize(byte* buf, int& offset);
+  virtual void deserialize(byte* buf, int& offset);
+
+  /** The UDP header can be saved in a checkpoint. */
+  virtual bool serializable() { return true; }
   
   /**
    * Return the number of bytes that a UDP header really occupies in
@@ -67,6 +70,9 @@ class UDPMessage : public ProtocolMessage {
    */
   virtual int realByteCount() { return S3FNET_UDPHDR_LENGTH; }
 
+  /** UDP headers are recycled through a message pool. */
+  S3FNET_POOLED_MESSAGE(UDPMessage);
+
  protected:
   /** The destructor is protected from accidental invocation. */
   virtual ~UDPMessage();
@@ -143,6 +143,12 @@ void UDPSession::clear_app_state(int signal)
 
 int UDPSession::send(int length, byte* msg)
 {
+  // in the shared mode, the bytes are copied once and each datagram
+  // views a slice; in the size-only mode, the bytes are ignored
+  PayloadBuffer* buf = 0;
+  if(msg && payload_mode == PAYLOAD_SHARED) buf = new PayloadBuffer(length, msg);
+  else if(payload_mode == PAYLOAD_SIZE_ONLY) msg = 0;
+
   int offset = 0;
   while(offset < length) // if there's anything left to be sent
   {
@@ -153,7 +159,8 @@ int UDPSession::send(int length, byte* msg)
 		    udp_master->getNowWithThousandSeparator(), length, to_send, offset));
 
     DataMessage* dmsg;
-    if(msg) dmsg = new DataMessage(to_send, &msg[offset], true);
+    if(buf) dmsg = new DataMessage(to_send, buf, offset);
+    else if(msg) dmsg = new DataMessage(to_send, &msg[offset], true);
     else dmsg = new DataMessage(to_send);
     offset += to_send;
 
@@ -163,6 +170,7 @@ int UDPSession::send(int length, byte* msg)
     IPPushOption ops(src_ip, dst_ip, S3FNET_PROTOCOL_TYPE_UDP, DEFAULT_IP_TIMETOLIVE);
     udp_master->pushdown(ac, 0, (void*)&ops, sizeof(IPPushOption));
   }
+  if(buf) buf->unref();
 
   wake_app(SocketSignal::OK_TO_SEND);
   return length;
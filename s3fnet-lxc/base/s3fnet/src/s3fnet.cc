@@ -9,7 +9,14 @@
 #include "s3fnet.h"
 #include <ctype.h>
 #include <unistd.h>
+#include <sys/time.h>
 #include "net/net.h"
+#include "net/host.h"
+#include "net/checkpoint.h"
+#include "net/pcap_capture.h"
+#include "os/base/protocol_message.h"
+#include "os/traffic/traffic_engine.h"
+#include "os/modbus/modbus_map.h"
 #include "util/errhandle.h"
 #include "tklxcmngr/tk_lxc_manager.h"
 #include "signal.h"
@@ -24,6 +31,9 @@ namespace s3fnet {
 #define MAIN_DUMP(x)
 #endif
 
+/** Bytes of each shared-memory ring between a shard and a timeline of another shard. */
+#define S3FNET_SHARD_RING_BYTES (1<<20)
+
 static void show_usage(char* prognam)
 {
   fprintf(stderr, "USAGE: %s [S3FNET-OPTIONS] <dml-file> [<dml-file> ...]\n", prognam);
@@ -31,12 +41,72 @@ static void show_usage(char* prognam)
   fprintf(stderr, "  Available S3FNET-OPTIONS:\n");
   fprintf(stderr, "    -h: show this message\n");
   fprintf(stderr, "    -q: quiet mode (no system messages)\n");
+  fprintf(stderr, "    -c <cache-file>: load the model from the given binary cache if it\n"
+	  "        matches the DML files; otherwise parse the DML files and write the cache\n");
+  fprintf(stderr, "    -p <profile-file>: profiling mode; at the end of the run, write the\n"
+	  "        events executed by each host, the time its LXC advanced, and the packets\n"
+	  "        sent over each link to the given file (to be fed to dmlpart -p)\n");
+  fprintf(stderr, "    -s <checkpoint-file>: at the end of the run, save the state of the\n"
+	  "        simulation to the given file\n");
+  fprintf(stderr, "    -r <checkpoint-file>: restore the state of the simulation from the given\n"
+	  "        file (saved with -s from the same network model) and run for run_time more\n");
+  fprintf(stderr, "    -n <num-shards>: run the simulation in the given number of processes,\n"
+	  "        each building and running the hosts of the timelines the map_info of\n"
+	  "        the DML assigns to it (see dmlpart -m <num-shards>); the packets between\n"
+	  "        shards cross shared memory, so their headers must be serializable (MAC,\n"
+	  "        IP, TCP, UDP, data and traffic engine messages; no emulated hosts).\n"
+	  "        With rng_type \"philox\" the run is the same as in a single process\n");
+  fprintf(stderr, "    -j <json-file>: at the end of the run, append the runtime measurements\n"
+	  "        (events/sec, windows/sec, barrier wait share, peak RSS) to the given\n"
+	  "        file as one JSON object per line\n");
+  fprintf(stderr, "    -P: at the end of the run, print the CPU cost of the process bodies,\n"
+	  "        the costliest first, by process, by entity type and by session class\n");
   fprintf(stderr, "  <dml-file> [<dml-file>...]: a list of DML files that altogether define\n"
 	  "    the network model (including intermediate DMLs created by utility programs).\n");
   fprintf(stderr, "  e.g., %s test.dml test-env.dml test-rt.dml \n", prognam);
   fprintf(stderr, "  Refer to s3fnet/test for more examples. \n");
 }
 
+static double wall_clock()
+{
+  struct timeval tv;
+  gettimeofday(&tv, 0);
+  return tv.tv_sec+tv.tv_usec/1e6;
+}
+
+// the shard of each timeline, from the map_info of the partition made by
+// dmlpart: map [ alignment "<timeline>" machid <shard> ].  The timelines
+// the partition does not name run in shard 0
+static void read_shard_map(s3f::dml::dmlConfig* cfg, int num_shards, int total_timeline,
+			   vector<int>& owners)
+{
+  s3f::dml::Configuration* mcfg = (s3f::dml::Configuration*)cfg->findSingle("map_info");
+  if(!mcfg || !s3f::dml::dmlConfig::isConf(mcfg))
+    error_quit("ERROR: %d shards need the map_info of the partition; "
+	       "run dmlpart -m %d on the DML files and add its output to them.\n", num_shards, num_shards);
+
+  owners.assign(total_timeline, 0);
+  s3f::dml::Enumeration* menum = mcfg->find("map");
+  while(menum->hasMoreElements())
+  {
+    s3f::dml::Configuration* ecfg = (s3f::dml::Configuration*)menum->nextElement();
+    if(!s3f::dml::dmlConfig::isConf(ecfg))
+      error_quit("ERROR: invalid map_info.map attribute.\n");
+    char* align = (char*)ecfg->findSingle("alignment");
+    char* machid = (char*)ecfg->findSingle("machid");
+    if(!align || s3f::dml::dmlConfig::isConf(align) || !machid || s3f::dml::dmlConfig::isConf(machid))
+      error_quit("ERROR: map_info.map needs an alignment and a machid.\n");
+    int tl = atoi(align), shard = atoi(machid);
+    if(tl < 0 || tl >= total_timeline)
+      error_quit("ERROR: map_info maps timeline %s, the model has %d.\n", align, total_timeline);
+    if(shard < 0 || shard >= num_shards)
+      error_quit("ERROR: map_info maps timeline %d to machine %d, there are %d shards; "
+		 "run dmlpart -m %d.\n", tl, shard, num_shards, num_shards);
+    owners[tl] = shard;
+  }
+  delete menum;
+}
+
 static void strsub(S3FNET_STRING& cp, S3FNET_STRING oldstr, S3FNET_STRING newstr, int num_times = -1)
 {
   int startpos = 0;
@@ -85,6 +155,17 @@ void SimInterface::BuildModel( s3f::dml::dmlConfig* cfg )
   delete cfg;
 }
 
+bool SimInterface::pack_activation(Activation act, vector<unsigned char>& buf)
+{
+  ProtocolMessage* msg = dynamic_cast<ProtocolMessage*>(act);
+  return msg && msg->serializeAll(buf);
+}
+
+Activation SimInterface::unpack_activation(const unsigned char* buf, unsigned int len)
+{
+  return ProtocolMessage::deserializeAll(buf, len);
+}
+
 }; // namespace s3fnet
 }; // namespace s3f
 
@@ -95,15 +176,29 @@ int main(int argc, char** argv)
 {
   bool showuse = false;
   bool silent = false;
+  char* cachefile = 0;
+  char* profilefile = 0;
+  char* savefile = 0;
+  char* restorefile = 0;
+  int num_shards = 1;
+  char* jsonfile = 0;
+  bool process_cost = false;
 
   for(;;)
   {
-    int c = getopt(argc, argv, "hq");
+    int c = getopt(argc, argv, "hqc:p:s:r:n:j:P");
     if(c == -1) break;
     switch(c)
     {
     	case 'h': showuse = true; break;
     	case 'q': silent = true; break;
+    	case 'c': cachefile = optarg; break;
+    	case 'p': profilefile = optarg; break;
+    	case 's': savefile = optarg; break;
+    	case 'r': restorefile = optarg; break;
+    	case 'n': num_shards = atoi(optarg); break;
+    	case 'j': jsonfile = optarg; break;
+    	case 'P': process_cost = true; break;
     	case '?': break;
     }
   }
@@ -130,7 +225,19 @@ int main(int argc, char** argv)
     //printf("=> %s\n", mystr.c_str());
   }
   dmlfiles[argc-optind] = 0;
-  s3f::dml::dmlConfig* dml_cfg = new s3f::dml::dmlConfig(dmlfiles);
+
+  // load the model from the binary cache if it is up to date with
+  // the dml files; otherwise parse the dml files (and refresh the cache)
+  double load_start = wall_clock();
+  s3f::dml::dmlConfig* dml_cfg = new s3f::dml::dmlConfig();
+  bool from_cache = cachefile && !dml_cfg->load_cache(cachefile, dmlfiles);
+  if(!from_cache)
+  {
+    dml_cfg->load(dmlfiles);
+    if(cachefile && dml_cfg->save_cache(cachefile, dmlfiles))
+      fprintf(stderr, "WARNING: failed to write model cache %s.\n", cachefile);
+  }
+  double load_time = wall_clock()-load_start;
   if(silent == false)
   {
     if(argc == optind+1)
@@ -145,6 +252,8 @@ int main(int argc, char** argv)
     	  printf("  %s\n", dmlfiles[k]);
       }
     }
+    if(from_cache) printf("Model loaded from cache %s in %g seconds\n", cachefile, load_time);
+    else printf("Model parsed in %g seconds\n", load_time);
   }
   for(int j=0; dmlfiles[j]; j++)
   {
@@ -212,6 +321,86 @@ int main(int argc, char** argv)
       error_quit("ERROR: seed attribute must be a non-negative integer.\n");
   }
 
+  // the generator of the random streams: the MRG32k3a package
+  // (default) or counter-based Philox streams keyed by host
+  str = (char*)dml_cfg->findSingle("rng_type");
+  if(str)
+  {
+    if(s3f::dml::dmlConfig::isConf(str))
+      error_quit("ERROR: invalid rng_type attribute.\n");
+    if(!strcasecmp(str, "philox")) Host::counter_based_rng = true;
+    else if(strcasecmp(str, "mrg32k3a"))
+      error_quit("ERROR: unknown rng_type attribute \"%s\" (mrg32k3a or philox).\n", str);
+  }
+  Host::rng_seed = seed;
+
+  // adapt the advance quantum of the LXCs to keep the packets they send
+  // within the given time of their timeline's (the default, 0, advances
+  // the LXCs straight to the next event)
+  double lateness_bound = 0, quantum_min = 0, quantum_max = 0;
+  str = (char*)dml_cfg->findSingle("lateness_bound");
+  if(str)
+  {
+    if(s3f::dml::dmlConfig::isConf(str) || atof(str) < 0)
+      error_quit("ERROR: invalid lateness_bound attribute.\n");
+    lateness_bound = atof(str);
+  }
+  str = (char*)dml_cfg->findSingle("advance_quantum_min");
+  if(!str) quantum_min = lateness_bound/8;
+  else
+  {
+    if(s3f::dml::dmlConfig::isConf(str) || atof(str) <= 0)
+      error_quit("ERROR: invalid advance_quantum_min attribute.\n");
+    quantum_min = atof(str);
+  }
+  str = (char*)dml_cfg->findSingle("advance_quantum_max");
+  if(!str) quantum_max = lateness_bound*64;
+  else
+  {
+    if(s3f::dml::dmlConfig::isConf(str) || atof(str) < quantum_min)
+      error_quit("ERROR: invalid advance_quantum_max attribute.\n");
+    quantum_max = atof(str);
+  }
+
+  // run in paced real time at the given ratio of virtual to wall time
+  // (the default, 0, runs as fast as possible), in windows of at most
+  // realtime_quantum seconds, spinning the last realtime_spin seconds
+  // before the end of a window rather than sleeping
+  double realtime_ratio = 0, realtime_quantum = 1e-3, realtime_spin = 1e-4;
+  str = (char*)dml_cfg->findSingle("realtime_ratio");
+  if(str)
+  {
+    if(s3f::dml::dmlConfig::isConf(str) || atof(str) < 0)
+      error_quit("ERROR: invalid realtime_ratio attribute.\n");
+    realtime_ratio = atof(str);
+  }
+  str = (char*)dml_cfg->findSingle("realtime_quantum");
+  if(str)
+  {
+    if(s3f::dml::dmlConfig::isConf(str) || atof(str) <= 0)
+      error_quit("ERROR: invalid realtime_quantum attribute.\n");
+    realtime_quantum = atof(str);
+  }
+  str = (char*)dml_cfg->findSingle("realtime_spin");
+  if(str)
+  {
+    if(s3f::dml::dmlConfig::isConf(str) || atof(str) < 0)
+      error_quit("ERROR: invalid realtime_spin attribute.\n");
+    realtime_spin = atof(str);
+  }
+
+  // pin the timelines, their ingress threads and their LXCs to the first
+  // n_cpus CPUs; off unless the attribute is given (0 leaves all the
+  // threads to the scheduler)
+  int n_cpus = 0;
+  str = (char*)dml_cfg->findSingle("n_cpus");
+  if(str)
+  {
+    if(s3f::dml::dmlConfig::isConf(str) || atoi(str) < 0)
+      error_quit("ERROR: invalid n_cpus attribute.\n");
+    n_cpus = atoi(str);
+  }
+
   char outDirBuf[1000];
   str = (char*)dml_cfg->findSingle("log_dir");
   if(!str) sprintf(outDirBuf, "%s/experiment-data", PATH_TO_S3FNETLXC);
@@ -225,22 +414,73 @@ int main(int argc, char** argv)
 		  total_timeline, tick_per_second, sim_single_run_time, seed));
 
   /* Generate the first random number stream according the seed value.
-   * Seed i means that we use the ith random number stream as the first one. */
-  for (int i=0; i<seed; i++)
+   * Seed i means that we use the ith random number stream as the first one.
+   * Counter-based streams take the seed in their keys instead. */
+  for (int i=0; i<seed && !Host::counter_based_rng; i++)
   {
 	  Random::RNG* rng = new Random::RNG();
 	  if(rng) delete rng;
   }
 
+  // fork the shards before any thread is created; each builds and
+  // runs the hosts of its own timelines, as the partition assigns them
+  ShardGroup* shards = 0;
+  if(num_shards < 1 || num_shards > total_timeline)
+    error_quit("ERROR: the number of shards must be between 1 and total_timeline (%d).\n", total_timeline);
+  if(num_shards > 1)
+  {
+    if(savefile || restorefile)
+      error_quit("ERROR: a sharded simulation can't be saved or restored.\n");
+    vector<int> owners;
+    read_shard_map(dml_cfg, num_shards, total_timeline, owners);
+    shards = ShardGroup::create(num_shards, total_timeline, S3FNET_SHARD_RING_BYTES, owners);
+    if(!shards) error_quit("ERROR: can't create %d shards.\n", num_shards);
+    shards->fork_shards();
+  }
+
   // create total timelines and timescale
   sim_inf = new SimInterface( total_timeline, tick_per_second );
   sim_inf->get_timeline_interface()->lm->init(outDirBuf);
+  if(shards && !sim_inf->join_shards(shards, sim_inf))
+    error_quit("ERROR: the simulation can't run in %d shards.\n", num_shards);
+
+  // before the model is built, so that each timeline builds its hosts
+  // in the memory of its own node
+  if(n_cpus > 0)
+  {
+    CpuPlacement* placement = CpuPlacement::create(total_timeline, n_cpus);
+    if(!placement || !sim_inf->place_timelines(placement))
+      error_quit("ERROR: can't place the timelines on %d CPUs.\n", n_cpus);
+    if(silent == false) placement->print(stdout);
+  }
 
-  // build and configure the simulation model
+  // build and configure the simulation model; the hosts are
+  // configured in parallel by the timeline threads
+  double build_start = wall_clock();
   sim_inf->BuildModel( dml_cfg );
+  if(shards && sim_inf->get_timeline_interface()->lm->listOfProxies.size() > 0)
+    error_quit("ERROR: a simulation with emulated hosts can't be sharded.\n");
 
-  // initialize the entities (hosts)
+  // initialize the entities (hosts), each timeline its own
+  double init_start = wall_clock();
   sim_inf->InitModel();
+  if(silent == false)
+    printf("Model built in %g seconds, initialized in %g seconds on %d timelines\n",
+	   init_start-build_start, wall_clock()-init_start, total_timeline);
+
+  // continue from a checkpoint: the events scheduled by the init
+  // methods are replaced by those of the checkpoint
+  if(restorefile)
+  {
+    Checkpoint::restore(restorefile, sim_inf, sim_inf->topnet);
+    if(silent == false) printf("Checkpoint %s restored at time %ld\n", restorefile, sim_inf->clock());
+  }
+
+  if(lateness_bound > 0)
+  {
+    double tps = pow(10.0, tick_per_second);
+    sim_inf->adapt_windows(ltime_t(lateness_bound*tps), ltime_t(quantum_min*tps), ltime_t(quantum_max*tps));
+  }
 
   // run it some window increments
   int num_epoch = 1; //number of epoch to run, currently epoch is set to 1
@@ -260,6 +500,12 @@ int main(int argc, char** argv)
   printf("|                                                                                      |\n");
   printf("'--------------------------------------------------------------------------------------'\n");
 
+  if(process_cost) sim_inf->profile_processes();
+  PcapCapture::start(total_timeline, tick_per_second, shards ? shards->shard() : 0, num_shards);
+  if(realtime_ratio > 0)
+    sim_inf->pace_windows(realtime_ratio, ltime_t(realtime_quantum*pow(10.0, tick_per_second)),
+			  (long long)(realtime_spin*1e9));
+  double run_start = wall_clock();
   for(int i=1; i<=num_epoch; i++)
   {
     cout << "enter epoch window " << i << endl;
@@ -267,9 +513,37 @@ int main(int argc, char** argv)
     cout << "completed epoch window, advanced time to " << clock << endl;
   }
   cout << "Finished" << endl;
+  PcapCapture::finish(silent);
+
+  // write the profile while the LXCs are still around
+  if(profilefile)
+  {
+    FILE* fp = fopen(profilefile, "w");
+    if(!fp) error_quit("ERROR: can't open profile file %s.\n", profilefile);
+    fprintf(fp, "profile [\n");
+    sim_inf->topnet->write_profile(fp);
+    fprintf(fp, "]\n");
+    fclose(fp);
+    if(silent == false) printf("Profile written to %s\n", profilefile);
+  }
+
+  if(savefile && Checkpoint::save(savefile, sim_inf, sim_inf->topnet) && silent == false)
+    printf("Checkpoint written to %s at time %ld\n", savefile, sim_inf->clock());
 
   // simulation runtime speed measurement
   sim_inf->runtime_measurements();
+  if(jsonfile)
+  {
+    FILE* fp = fopen(jsonfile, "a");
+    if(!fp) error_quit("ERROR: can't open measurement file %s.\n", jsonfile);
+    sim_inf->write_measurements(fp, argv[optind]);
+    fclose(fp);
+  }
+  sim_inf->process_measurements(stdout, 20);
+  MessagePool::report();
+  TrafficEngineSession::report(run_time_double*num_epoch, wall_clock()-run_start);
+  modbus_server_report(run_time_double*num_epoch, wall_clock()-run_start);
+  modbus_client_report(run_time_double*num_epoch, wall_clock()-run_start);
 
   #ifndef TAP_DISABLED
   for (unsigned int i = 0; i < sim_inf->get_numTimelines(); i++)
@@ -287,6 +561,9 @@ int main(int argc, char** argv)
   sim_inf->get_timeline_interface()->lm->printLXCstats();
   delete sim_inf;
 
+  if(shards && !shards->wait_shards())
+    error_quit("ERROR: a shard of the simulation failed.\n");
+
   printf(".--------------------------------------------------------------------------------------.\n");
   printf("|                                                                                      |\n");
   printf("|                           SUCCESSFUL SIMULATION COMPLETION                           |\n");
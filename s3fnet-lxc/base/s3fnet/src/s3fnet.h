@@ -200,6 +200,24 @@ enum S3FNetProtocolType {
   /** A server-side protocol for testing the UDP model. */
   S3FNET_PROTOCOL_TYPE_UDPTEST_SERVER = 228,
 
+  /** A client-side protocol for testing the TCP model, written with socket coroutines. */
+  S3FNET_PROTOCOL_TYPE_TCPTEST_CO_CLIENT = 229,
+
+  /** A client-side protocol for testing the UDP model, written with socket coroutines. */
+  S3FNET_PROTOCOL_TYPE_UDPTEST_CO_CLIENT = 230,
+
+  /** The synthetic traffic generator (background flows injected at the IP layer). */
+  S3FNET_PROTOCOL_TYPE_TRAFFIC_ENGINE = 231,
+
+  /** A simulated Modbus/TCP device (server). */
+  S3FNET_PROTOCOL_TYPE_MODBUS_SERVER = 232,
+
+  /** A simulated Modbus/TCP master polling the devices (client). */
+  S3FNET_PROTOCOL_TYPE_MODBUS_CLIENT = 233,
+
+  /** A client-side protocol for testing the blocking TCP model, written with socket coroutines. */
+  S3FNET_PROTOCOL_TYPE_TCPTEST_CO_BLOCKING_CLIENT = 234,
+
   /** A protocol for communicating with the database for sending and receiving commands */
   S3FNET_PROTOCOL_TYPE_COMMAND = 238,
 
@@ -408,7 +426,7 @@ enum ProtocolSessionCtrlTypes {
  *
  * The S3FNet network simulation interface class for interacting with the underlying S3F API.
  */
-class SimInterface : public Interface {
+class SimInterface : public Interface, public ShardCodec {
  public:
    /** the constructor
     * @param tl the number of simulation threads to create (pthreads).
@@ -422,6 +440,12 @@ class SimInterface : public Interface {
    /** to build the s3fnet simulation model based on the DML file */
    void BuildModel( s3f::dml::dmlConfig* cfg );
 
+   /** pack a protocol message written to a host of another shard */
+   virtual bool pack_activation(Activation act, vector<unsigned char>& buf);
+
+   /** rebuild a protocol message written by a host of another shard */
+   virtual Activation unpack_activation(const unsigned char* buf, unsigned int len);
+
  // protected:
    /** pointer to the topnet object */
    Net* topnet;
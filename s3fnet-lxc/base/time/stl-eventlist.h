@@ -1,6 +1,6 @@
 /**
  * \file stl-eventlist.h
- * \brief Header file for S3F %event list, implemented using STL priority queue.
+ * \brief Header file for S3F %event list, implemented as an indexed binary heap.
  */
 
 #ifndef __STL_EVENTLIST_H__
@@ -25,26 +25,31 @@ bool operator()(const EventPtr lhs, const EventPtr rhs) const
 };
 
 /**
- * %Event list implementation using STL priority queue
+ * %Event list implementation using a binary heap.  The heap is sifted by the
+ * same rules as the STL priority queue it replaces, so events of equal time
+ * and priority run in the same order as before.  Each event records its
+ * position in the heap (Event::__heap_pos), so that a pending event can be
+ * taken out of the list, or moved to another time, in O(log n) instead of
+ * staying in the list as a cancelled entry until it reaches the top.
  */
 class STL_EventList : pq {
 public:
 	pthread_mutex_t  MUTEX;
-	STL_EventList()
+	STL_EventList() : __max_size(0), __removed(0), __moved(0)
 	{
 		pthread_mutex_init(&MUTEX, NULL);
 	}
-	priority_queue<EventPtr, vector<EventPtr>, evt_Comparer> evtList;
+	vector<EventPtr> evtList; ///< the heap, the next event first
 	inline void push(EventPtr n)
 	{
 		pthread_mutex_lock(&MUTEX);
-		evtList.push(n);
+		push_lockless(n);
 		pthread_mutex_unlock(&MUTEX);
 	}
 	inline void pop()
 	{
 		pthread_mutex_lock(&MUTEX);
-		evtList.pop();
+		pop_lockless();
 		pthread_mutex_unlock(&MUTEX);
 	}
 	inline bool empty()
@@ -64,7 +69,7 @@ public:
 	EventPtr top()
 	{
 		pthread_mutex_lock(&MUTEX);
-		EventPtr pppp = evtList.top();
+		EventPtr pppp = evtList.front();
 		pthread_mutex_unlock(&MUTEX);
 		return pppp;
 	}
@@ -77,14 +82,114 @@ public:
 
 	EventPtr top_lockless()
 	{
-		EventPtr pppp = evtList.top();
+		EventPtr pppp = evtList.front();
 		return pppp;
 	}
 
+	inline void push_lockless(EventPtr n)
+	{
+		evtList.push_back(n);
+		sift_up(evtList.size()-1, 0, n);
+		if( evtList.size() > __max_size ) __max_size = evtList.size();
+	}
+
 	inline void pop_lockless()
 	{
-		evtList.pop();
+		evtList.front()->__heap_pos = -1;
+		EventPtr last = evtList.back();
+		evtList.pop_back();
+		if( !evtList.empty() ) sift_down(0, last);
+	}
+
+	/** Take the given event out of the list; false if it is not in it. */
+	bool remove(Event* e)
+	{
+		pthread_mutex_lock(&MUTEX);
+		int i = e->__heap_pos;
+		bool found = ( i >= 0 && i < (int)evtList.size() && evtList[i]->adrs() == (void*)e );
+		if( found ) {
+			// keep a reference while the heap is rearranged
+			EventPtr eptr = evtList[i];
+			eptr->__heap_pos = -1;
+			EventPtr last = evtList.back();
+			evtList.pop_back();
+			if( (unsigned int)i < evtList.size() ) settle(i, last);
+			__removed++;
+		}
+		pthread_mutex_unlock(&MUTEX);
+		return found;
+	}
+
+	/** Move the given event, which must be in the list, to time t; false if it is not in it. */
+	bool move(Event* e, ltime_t t)
+	{
+		pthread_mutex_lock(&MUTEX);
+		int i = e->__heap_pos;
+		bool found = ( i >= 0 && i < (int)evtList.size() && evtList[i]->adrs() == (void*)e );
+		if( found ) {
+			EventPtr eptr = evtList[i];
+			eptr->__time = t;
+			settle(i, eptr);
+			__moved++;
+		}
+		pthread_mutex_unlock(&MUTEX);
+		return found;
 	}
+
+	unsigned long get_max_size() { return __max_size; } ///< most events in the list at once
+	unsigned long get_removed()  { return __removed;  } ///< events cancelled out of the list
+	unsigned long get_moved()    { return __moved;    } ///< events moved in the list
+
+private:
+	/* put e in the hole at i, moving up the events it comes before (up to top) */
+	inline void sift_up(unsigned int i, unsigned int top, EventPtr e)
+	{
+		evt_Comparer later;
+		while( i > top ) {
+			unsigned int parent = (i-1)/2;
+			if( !later(evtList[parent], e) ) break;
+			evtList[i] = evtList[parent];
+			evtList[i]->__heap_pos = i;
+			i = parent;
+		}
+		evtList[i] = e;
+		e->__heap_pos = i;
+	}
+
+	/* fill the hole at i with e: the hole goes down to a leaf along the
+	   earlier children, then e goes up from there (as std::pop_heap does) */
+	inline void sift_down(unsigned int i, EventPtr e)
+	{
+		evt_Comparer later;
+		unsigned int top = i;
+		unsigned int len = evtList.size();
+		unsigned int child = i;
+		while( child < (len-1)/2 ) {
+			child = 2*(child+1);
+			if( later(evtList[child], evtList[child-1]) ) child--;
+			evtList[i] = evtList[child];
+			evtList[i]->__heap_pos = i;
+			i = child;
+		}
+		if( (len & 1) == 0 && child == (len-2)/2 ) {
+			child = 2*(child+1);
+			evtList[i] = evtList[child-1];
+			evtList[i]->__heap_pos = i;
+			i = child-1;
+		}
+		sift_up(i, top, e);
+	}
+
+	/* put e in the hole at i, up or down as its time requires */
+	inline void settle(unsigned int i, EventPtr e)
+	{
+		evt_Comparer later;
+		if( i > 0 && later(evtList[(i-1)/2], e) ) sift_up(i, 0, e);
+		else sift_down(i, e);
+	}
+
+	unsigned long __max_size;
+	unsigned long __removed;
+	unsigned long __moved;
 };
 #endif /* __STL_EVENTLIST_H */
-
@@ -154,6 +154,11 @@ void LXC_Proxy::dilateLXCAndAddToExperiment()
 	usleep(TIME_200_MS_IN_US);
 
 	addToExp(PID, timelineLXCAlignedOn->s3fid()); // Sends a command to Timekeeper to add the PID to the experiment
+
+	// keep the LXC on the cores of its timeline (see CpuPlacement)
+	CpuPlacement* placement = lxcMan->siminf->get_timeline_interface()->placement;
+	if (placement && placement->has_helper_cores(timelineLXCAlignedOn->s3fid()) && placement->pin_lxc(PID, timelineLXCAlignedOn->s3fid()))
+		lxcMan->debugPrint("| Pinned %s to the cores of Timeline %u\n", lxcName, timelineLXCAlignedOn->s3fid());
 	add_lxc_to_socket_monitor(PID, lxcName);
 	#ifdef LXC_INIT_DEBUG
 	printInfo();
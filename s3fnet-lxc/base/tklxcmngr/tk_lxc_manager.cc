@@ -143,12 +143,10 @@ void* LxcManager::setUpTearDownLXCs(unsigned int timelineID, int typeFlag)
 
 void* LxcManager::manageIncomingPacketsByTimeLine(int timelineID)
 {
-	//cpu_set_t cpuset;
-	//int cpu = 7;
-	//CPU_ZERO(&cpuset);       //clears the cpuset
-	//CPU_SET( cpu , &cpuset); //set CPU 2 on cpuset
-	//sched_setaffinity(0, sizeof(cpuset), &cpuset);
-	// while(1){}
+	// run next to the timeline and its LXCs (see CpuPlacement)
+	CpuPlacement* placement = siminf->get_timeline_interface()->placement;
+	if (placement && placement->has_helper_cores(timelineID))
+		placement->pin_ingress_thread(timelineID);
 
 	int numAdvancing = 0;
 	int ret = 0;
@@ -825,6 +823,10 @@ bool LxcManager::advanceLXCsOnTimeline(unsigned int timelineID, ltime_t timeToAd
 	int numAdvancing = 0;
 	int ret = 0;
 
+	// a pure S3F model (no init) has no LXCs at all
+	if (listOfProxiesByTimeline == NULL)
+		return false;
+
 	vector<LXC_Proxy*> proxiesBeingAdvanced;
 	vector<LXC_Proxy*>* proxiesOnTimeline = listOfProxiesByTimeline[timelineID];
 
@@ -1281,6 +1283,25 @@ void LxcManager::debugPrintFileOnly(char* format, ...)
 	va_end(argptr);
 }
 
+void LxcManager::getInjectionStats(unsigned int timelineID, long* packets, long* late, long* lateness)
+{
+	vector<LXC_Proxy*>* proxiesOnTimeline = listOfProxiesByTimeline[timelineID];
+	*packets = *late = *lateness = 0;
+	for (unsigned int i = 0; i < proxiesOnTimeline->size(); i++)
+	{
+		LXC_Proxy* proxy = (*proxiesOnTimeline)[i];
+		*packets  += proxy->packetsInjectedIntoPast + proxy->packetsInjectedIntoFuture + proxy->packetsInjectedAtCorrectTime;
+		*late     += proxy->packetsInjectedIntoPast;
+		*lateness += proxy->totalTimeInjectedIntoPast;
+	}
+}
+
+void LxcManager::getProgressStats(unsigned int timelineID, long* calls, unsigned long* wallTime)
+{
+	*calls    = vectorOfHowManyTimesTimelineCalledProgress[timelineID];
+	*wallTime = vectorOfTotalTimesSpentAdvancing[timelineID];
+}
+
 unsigned long LxcManager::getWallClockTime()
 {
 	struct timeval tv;
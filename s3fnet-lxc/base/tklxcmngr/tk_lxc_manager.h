@@ -166,6 +166,17 @@ class LxcManager
 		 */
 		bool advanceLXCsOnTimeline(unsigned int id, ltime_t timeToAdvance);
 
+		/*
+		 * Sums, over the LXCs on a given timeline, the packets injected into the simulation, those injected
+		 * into the past of the timeline and how far into the past (used to adapt the timeline's window)
+		 */
+		void getInjectionStats(unsigned int id, long* packets, long* late, long* lateness);
+
+		/*
+		 * Returns how many times a given timeline called progress(...), and the wall time those calls took
+		 */
+		void getProgressStats(unsigned int id, long* calls, unsigned long* wallTime);
+
 		/*
 		 *
 		 */